@@ -0,0 +1,288 @@
+#include "audio_service.h"
+#include "file_audio_codec.h"
+#include "jitter_buffer.h"
+#include "ogg_demuxer.h"
+
+#include <esp_timer.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+
+/*
+ * Host benchmarks for the audio pipeline.
+ *
+ *   bench_audio_pipeline [speed]
+ *
+ * Reports demuxer and Opus throughput and a simulated jitter buffer run, then drives AudioService
+ * through two scripted sessions over FileAudioCodec: listening replays a microphone WAV at the
+ * given speed into the send queue, speaking plays a jittery downlink in real time. Without libopus
+ * the opus wrappers pack raw PCM (see opus/), so the Opus numbers only count with it.
+ */
+
+#define FRAME_SAMPLES (16000 * OPUS_FRAME_DURATION_MS / 1000)
+
+static int64_t Percentile(std::vector<int64_t> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(values.size() * p))];
+}
+
+// Stop the tasks and give them time to leave before the service goes away
+static void StopService(AudioService& service) {
+    service.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+template <typename F>
+static double MeasureSamplesPerSecond(size_t samples_per_run, F run) {
+    int runs = 0;
+    int64_t start_us = esp_timer_get_time();
+    int64_t elapsed_us;
+    do {
+        run();
+        runs++;
+        elapsed_us = esp_timer_get_time() - start_us;
+    } while (elapsed_us < 200000);
+    return (double)samples_per_run * runs * 1000000 / elapsed_us;
+}
+
+static void BenchOggDemuxer() {
+    std::ifstream file(HOST_TEST_ASSETS_DIR "/popup.ogg", std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<uint8_t> payload;
+    double bytes_per_second = MeasureSamplesPerSecond(data.size(), [&] {
+        OggDemuxer demuxer;
+        demuxer.Parse(data);
+        for (size_t i = 0; i < demuxer.packet_count(); i++) {
+            demuxer.ReadPacket(i, payload);
+        }
+    });
+    printf("Ogg demuxer: %.1f MB/s (index and read every packet of popup.ogg)\n", bytes_per_second / 1e6);
+}
+
+static void WriteNoiseWav(const std::string& path, int frames) {
+    // Mono 16 kHz noise
+    std::vector<int16_t> noise(frames * FRAME_SAMPLES);
+    std::mt19937 rng(2);
+    for (auto& sample : noise) {
+        sample = (int16_t)((int)(rng() % 2000) - 1000);
+    }
+    uint32_t data_bytes = noise.size() * sizeof(int16_t);
+    uint32_t header[11] = {0x46464952, 36 + data_bytes, 0x45564157, 0x20746d66, 16, 0x00010001, 16000, 32000,
+        0x00100002, 0x61746164, data_bytes};
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(noise.data(), sizeof(int16_t), noise.size(), f);
+    fclose(f);
+}
+
+// Opus encode and decode of 60 ms mono frames, as AudioService runs them
+static void BenchOpus() {
+    std::vector<int16_t> pcm(FRAME_SAMPLES);
+    std::mt19937 rng(4);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (int16_t)(8000 * sin(i * 0.05) + (int)(rng() % 2000) - 1000);
+    }
+    OpusEncoderWrapper encoder(16000, 1, OPUS_FRAME_DURATION_MS);
+    OpusDecoderWrapper decoder(16000, 1, OPUS_FRAME_DURATION_MS);
+    std::vector<uint8_t> opus;
+    std::vector<int16_t> decoded;
+    encoder.Encode(std::vector<int16_t>(pcm), opus);
+    std::vector<uint8_t> packet = opus;
+
+    double encode_rate = MeasureSamplesPerSecond(pcm.size(), [&] {
+        encoder.Encode(std::vector<int16_t>(pcm), opus);
+    });
+    double decode_rate = MeasureSamplesPerSecond(pcm.size(), [&] {
+        decoder.Decode(std::vector<uint8_t>(packet), decoded);
+    });
+#if HOST_HAVE_OPUS
+    const char* backend = "libopus";
+#else
+    const char* backend = "raw PCM stand-in, build with libopus for codec timings";
+#endif
+    printf("Opus (%s): encode %.0fx real time, decode %.0fx real time, 60 ms frames at 16 kHz\n", backend,
+        encode_rate / 16000, decode_rate / 16000);
+}
+
+// Listening: AudioService reads the microphone WAV at the given speed and encodes it to the send queue
+static void BenchListening(float speed) {
+    const int frames = 50;
+    std::string input_path = HOST_TEST_OUTPUT_DIR "/bench_mic.wav";
+    WriteNoiseWav(input_path, frames);
+
+    FileAudioCodec codec(input_path.c_str(), HOST_TEST_OUTPUT_DIR "/bench_listening.wav", 24000, speed);
+    Board::GetInstance().SetAudioCodec(&codec);
+    auto& profiler = AudioLatencyProfiler::GetInstance();
+    profiler.Reset();
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+
+    int64_t start_us = esp_timer_get_time();
+    service.EnableVoiceProcessing(true);
+    int sent = 0;
+    size_t payload_bytes = 0;
+    while (sent < frames && esp_timer_get_time() - start_us < 10000000) {
+        auto packet = service.PopPacketFromSendQueue();
+        if (!packet) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        sent++;
+        payload_bytes += packet->payload.size();
+    }
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    StopService(service);
+
+    auto stats = profiler.GetStats();
+    auto& queue = stats.stages[kAudioLatencyStageEncodeQueue];
+    printf("Listening session: %d of %d x 60 ms frames at speed %.1f in %lld ms (%.1fx real time), %u bytes/frame\n",
+        sent, frames, speed, (long long)elapsed_us / 1000, sent * 60000.0 / elapsed_us,
+        sent > 0 ? (unsigned)(payload_bytes / sent) : 0);
+    printf("  encode queue depth max %u, wait avg %llu us max %u us, encode drops %u\n",
+        (unsigned)stats.max_encode_queue, queue.frames > 0 ? (unsigned long long)(queue.total_us / queue.frames) : 0ULL,
+        (unsigned)queue.max_us, (unsigned)stats.encode_drops);
+}
+
+// Speaking: AudioService receives a jittery 16 kHz downlink in real time and plays it at 24 kHz
+static void BenchSpeakingService() {
+    const int frame_us = OPUS_FRAME_DURATION_MS * 1000;
+    const int frames = 50;
+    std::string output_path = HOST_TEST_OUTPUT_DIR "/bench_speaking.wav";
+    FileAudioCodec codec(HOST_TEST_OUTPUT_DIR "/bench_no_mic.wav", output_path.c_str(), 24000, 1.0f);
+    Board::GetInstance().SetAudioCodec(&codec);
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+
+    std::vector<int16_t> pcm(FRAME_SAMPLES);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = (int16_t)(8000 * sin(i * 0.05));
+    }
+    OpusEncoderWrapper encoder(16000, 1, OPUS_FRAME_DURATION_MS);
+    std::mt19937 rng(5);
+    std::exponential_distribution<double> delay(1.0 / 25000);
+
+    int64_t start_us = esp_timer_get_time();
+    std::vector<std::pair<int64_t, int>> arrivals;
+    for (int i = 0; i < frames; i++) {
+        arrivals.push_back({(int64_t)i * frame_us + (int64_t)delay(rng), i + 1});
+    }
+    std::sort(arrivals.begin(), arrivals.end());
+    for (auto& arrival : arrivals) {
+        int64_t wait_us = start_us + arrival.first - esp_timer_get_time();
+        if (wait_us > 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(wait_us));
+        }
+        auto packet = AudioStreamPacket::Acquire();
+        packet->sample_rate = 16000;
+        packet->frame_duration = OPUS_FRAME_DURATION_MS;
+        packet->timestamp = 0;
+        packet->sequence = arrival.second;
+        encoder.Encode(std::vector<int16_t>(pcm), packet->payload);
+        service.PushPacketToDecodeQueue(std::move(packet), true);
+    }
+    while (!service.IsIdle() && esp_timer_get_time() - start_us < (int64_t)frames * frame_us + 5000000) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    // The playback queue and the frame being written are still to be played
+    std::this_thread::sleep_for(std::chrono::milliseconds(OPUS_FRAME_DURATION_MS * (MAX_PLAYBACK_TASKS_IN_QUEUE + 2)));
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    StopService(service);
+
+    long played = codec.output_samples();
+    printf("Speaking session: %d x 60 ms frames through AudioService, 25 ms mean network delay\n", frames);
+    printf("  played %.1f frames in %lld ms, %lld ms after the last frame was due\n",
+        played / (24000.0 * OPUS_FRAME_DURATION_MS / 1000), (long long)elapsed_us / 1000,
+        (long long)(elapsed_us - (int64_t)frames * frame_us) / 1000);
+}
+
+// Jitter buffer on its own: 60 ms downlink frames with random network delay and loss, in simulated time
+static void BenchJitterBuffer() {
+    const int frame_us = 60000;
+    const int frames = 500;
+    std::mt19937 rng(3);
+    std::exponential_distribution<double> delay(1.0 / 25000);
+    std::uniform_real_distribution<double> loss(0, 1);
+
+    struct Arrival {
+        int64_t arrival_us;
+        uint32_t sequence;
+    };
+    std::vector<Arrival> arrivals;
+    for (int i = 0; i < frames; i++) {
+        if (loss(rng) < 0.01) {
+            continue;
+        }
+        arrivals.push_back({(int64_t)i * frame_us + (int64_t)delay(rng), (uint32_t)i + 1});
+    }
+    std::sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b) {
+        return a.arrival_us < b.arrival_us;
+    });
+
+    JitterBuffer buffer(16, 1, 6);
+    std::vector<int64_t> latencies;
+    std::vector<int64_t> put_time(frames + 2, -1);
+    size_t next = 0;
+    size_t max_depth = 0;
+    int played = 0;
+    int64_t end_us = (int64_t)(frames + 10) * frame_us;
+    // The decoder wakes every frame once playback started, and whenever a packet arrives
+    int64_t now_us = 0;
+    int64_t next_tick_us = -1;
+    while (now_us < end_us) {
+        int64_t next_arrival_us = next < arrivals.size() ? arrivals[next].arrival_us : end_us;
+        now_us = next_tick_us >= 0 ? std::min(next_tick_us, next_arrival_us) : next_arrival_us;
+        while (next < arrivals.size() && arrivals[next].arrival_us <= now_us) {
+            auto packet = std::make_unique<AudioStreamPacket>();
+            packet->sample_rate = 16000;
+            packet->frame_duration = frame_us / 1000;
+            packet->sequence = arrivals[next].sequence;
+            put_time[packet->sequence] = arrivals[next].arrival_us;
+            buffer.Put(std::move(packet), arrivals[next].arrival_us);
+            next++;
+        }
+        max_depth = std::max(max_depth, buffer.GetStats().depth);
+        if (next_tick_us >= 0 && now_us < next_tick_us) {
+            continue;
+        }
+        std::unique_ptr<AudioStreamPacket> packet;
+        auto result = buffer.Get(packet, now_us);
+        if (result == JitterBuffer::kPacket) {
+            latencies.push_back(now_us - put_time[packet->sequence]);
+        }
+        if (result != JitterBuffer::kNotReady) {
+            played++;
+            next_tick_us = now_us + frame_us;
+        } else {
+            next_tick_us = buffer.Empty() ? -1 : now_us + frame_us;
+        }
+    }
+
+    auto stats = buffer.GetStats();
+    printf("Jitter buffer: %d frames, 25 ms mean network delay, 1%% loss\n", frames);
+    printf("  played %d, concealed %u, late %u, underruns %u, depth max %u target %d, jitter %d ms\n", played,
+        (unsigned)stats.concealed_frames, (unsigned)stats.late_packets, (unsigned)stats.underruns,
+        (unsigned)max_depth, stats.target_depth, stats.jitter_ms);
+    printf("  arrival to decode latency p50 %lld ms p95 %lld ms\n", (long long)Percentile(latencies, 0.5) / 1000,
+        (long long)Percentile(latencies, 0.95) / 1000);
+}
+
+int main(int argc, char** argv) {
+    float speed = argc > 1 ? atof(argv[1]) : 10.0f;
+    BenchOggDemuxer();
+    BenchOpus();
+    BenchJitterBuffer();
+    BenchListening(speed);
+    BenchSpeakingService();
+    return 0;
+}
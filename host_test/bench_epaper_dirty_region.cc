@@ -0,0 +1,121 @@
+#include "epaper_dirty_region.h"
+
+#include <cstdio>
+#include <vector>
+
+/*
+ * Host simulation of e-paper partial refreshes on the GxEPD2_290_T5D (128x296, rotation 3).
+ *
+ * Each scenario is a set of label changes on a built-in page, with the boxes SetupUI gives those
+ * labels (text boxes are x, y, w_max and the height of the text before and after). Before, every
+ * UpdateLabel ran a waveform over its own box and UpdateUI(false) ran one over the whole screen;
+ * now the old and new boxes go into EpaperDirtyRegion and each merged window is one waveform.
+ * Reports waveforms, refreshed pixels and the time at ~750 ms per partial waveform.
+ */
+
+#define NATIVE_WIDTH 128
+#define NATIVE_HEIGHT 296
+#define ROTATION 3
+#define WAVEFORM_MS 750
+
+struct Change {
+    EpaperRect before;
+    EpaperRect after;
+};
+
+struct Scenario {
+    const char* name;
+    // The page was redrawn with UpdateUI(false) rather than label by label
+    bool page_update;
+    std::vector<Change> changes;
+};
+
+static EpaperRect Rect(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+    EpaperRect rect;
+    rect.x = x;
+    rect.y = y;
+    rect.w = w;
+    rect.h = h;
+    return rect;
+}
+
+// A label whose content changes within the same box
+static Change Same(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+    return {Rect(x, y, w, h), Rect(x, y, w, h)};
+}
+
+// Area of a rectangle once aligned the way setPartialWindow aligns it
+static uint32_t AlignedArea(const EpaperRect& rect) {
+    EpaperDirtyRegion region(NATIVE_WIDTH, NATIVE_HEIGHT);
+    region.SetRotation(ROTATION);
+    region.Add(rect);
+    return region.area();
+}
+
+static void Simulate(const Scenario& scenario, uint32_t totals[4]) {
+    uint32_t before_waveforms = 0;
+    uint32_t before_area = 0;
+    if (scenario.page_update) {
+        before_waveforms = 1;
+        before_area = NATIVE_WIDTH * NATIVE_HEIGHT;
+    } else {
+        // The old refresh box of a text label was the larger of the two heights at the new position
+        for (const auto& change : scenario.changes) {
+            EpaperRect rect = change.after;
+            rect.h = change.before.h > change.after.h ? change.before.h : change.after.h;
+            before_waveforms++;
+            before_area += AlignedArea(rect);
+        }
+    }
+
+    EpaperDirtyRegion region(NATIVE_WIDTH, NATIVE_HEIGHT);
+    region.SetRotation(ROTATION);
+    for (const auto& change : scenario.changes) {
+        region.Add(change.before);
+        region.Add(change.after);
+    }
+    uint32_t after_waveforms = region.regions().size();
+    uint32_t after_area = region.area();
+
+    printf("  %-34s %u -> %u waveforms, %6u -> %6u px, %5u -> %5u ms\n", scenario.name,
+        (unsigned)before_waveforms, (unsigned)after_waveforms, (unsigned)before_area, (unsigned)after_area,
+        (unsigned)(before_waveforms * WAVEFORM_MS), (unsigned)(after_waveforms * WAVEFORM_MS));
+    totals[0] += before_waveforms;
+    totals[1] += after_waveforms;
+    totals[2] += before_area;
+    totals[3] += after_area;
+}
+
+int main() {
+    const std::vector<Scenario> scenarios = {
+        {"home: clock minute", false, {Same(5, 40, 150, 45)}},
+        {"home: clock and date at midnight", false, {Same(5, 40, 150, 45), Same(20, 105, 120, 18)}},
+        {"home: fridge counts", false, {Same(230, 38, 70, 18), Same(230, 67, 70, 18), Same(230, 98, 70, 18)}},
+        {"home: counts via UpdateUI", true, {Same(230, 38, 70, 18), Same(230, 67, 70, 18), Same(230, 98, 70, 18)}},
+        {"chat: listening -> speaking", false, {
+            Same(0, 10, 96, 16),
+            Same(32, 50, 32, 32),
+            {Rect(100, 50, 192, 18), Rect(100, 34, 192, 54)},
+        }},
+        {"chat: message grows", false, {{Rect(100, 42, 192, 36), Rect(100, 26, 192, 72)}}},
+        {"chat: notification shown", false, {{Rect(100, 5, 192, 0), Rect(100, 5, 192, 16)}}},
+        {"chat: new turn via UpdateUI", true, {
+            Same(0, 10, 96, 16),
+            Same(32, 50, 32, 32),
+            {Rect(100, 34, 192, 54), Rect(100, 50, 192, 18)},
+        }},
+        {"photo: clock minute", false, {Same(140, 5, 150, 45)}},
+        {"photo: clock, date and days", false, {Same(140, 5, 150, 45), Same(140, 55, 140, 16), Same(172, 78, 60, 16)}},
+    };
+
+    printf("Partial refreshes, before -> after (%dx%d, rotation %d, at most %d windows)\n", NATIVE_WIDTH,
+        NATIVE_HEIGHT, ROTATION, EPAPER_DIRTY_MAX_REGIONS);
+    uint32_t totals[4] = {};
+    for (const auto& scenario : scenarios) {
+        Simulate(scenario, totals);
+    }
+    printf("  %-34s %u -> %u waveforms, %6u -> %6u px, %5u -> %5u ms\n", "total", (unsigned)totals[0],
+        (unsigned)totals[1], (unsigned)totals[2], (unsigned)totals[3], (unsigned)(totals[0] * WAVEFORM_MS),
+        (unsigned)(totals[1] * WAVEFORM_MS));
+    return 0;
+}
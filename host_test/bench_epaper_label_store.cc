@@ -0,0 +1,171 @@
+#include "epaper_label_store.h"
+
+#include <esp_timer.h>
+#include <cstdio>
+#include <map>
+#include <string>
+
+/*
+ * Host microbenchmark of the e-paper label store: 15 pages of 30 labels each, held once in the
+ * std::map<String, EpaperLabel*> EpaperDisplay used before and once in EpaperLabelStore. Times the
+ * lookups the display and CustomPageManager make: rendering one page, the per-second dynamic
+ * check of a custom page, counting canvas labels, finding a label by id and reloading a page.
+ */
+
+#define PAGES 15
+#define LABELS_PER_PAGE 30
+// Custom pages are 7 to 15, the canvas page is 6
+#define FIRST_CUSTOM_PAGE 7
+#define CANVAS_PAGE 6
+#define ITERATIONS 20000
+
+using LabelMap = std::map<String, EpaperLabel*>;
+
+static String LabelId(uint16_t page, int index) {
+    char id[32];
+    if (page >= FIRST_CUSTOM_PAGE) {
+        snprintf(id, sizeof(id), "cp_p%u_e%d", page, index);
+    } else if (page == CANVAS_PAGE) {
+        snprintf(id, sizeof(id), "canvas_%d", index);
+    } else {
+        snprintf(id, sizeof(id), "page%u_label_%d", page, index);
+    }
+    return String(id);
+}
+
+static EpaperLabel MakeLabel(uint16_t page, int index) {
+    if (index % 3 == 0) {
+        auto label = EpaperLabel::Text("12:00", 10, index * 4, 0, 16, 16, nullptr, GxEPD_BLACK,
+            EpaperTextAlign::LEFT, 1, true, false, page);
+        // One clock on every custom page
+        if (page >= FIRST_CUSTOM_PAGE && index == 0) {
+            strcpy(label.dynamic_type, "clock");
+        }
+        return label;
+    }
+    return EpaperLabel::Rect(index * 8, index * 4, 20, 10, index % 2, GxEPD_BLACK, 1, true, page);
+}
+
+// The visit RenderWindowLabels makes, the sum keeps the loop from being optimized away
+static uint32_t RenderPage(LabelMap& labels, uint16_t page) {
+    uint32_t sum = 0;
+    for (auto& pair : labels) {
+        EpaperLabel* label = pair.second;
+        if (label->page != page || !label->visible) continue;
+        sum += label->x + label->y;
+    }
+    return sum;
+}
+
+static uint32_t RenderPage(EpaperLabelStore& store, uint16_t page) {
+    uint32_t sum = 0;
+    for (auto handle : store.PageLabels(page)) {
+        EpaperLabel* label = store.Get(handle);
+        if (!label->visible) continue;
+        sum += label->x + label->y;
+    }
+    return sum;
+}
+
+// CustomPageManager::TickDynamicUpdate before the store
+static bool HasDynamic(LabelMap& labels, uint16_t page) {
+    char prefix[16];
+    int length = snprintf(prefix, sizeof(prefix), "cp_p%u_", page);
+    for (const auto& pair : labels) {
+        if (strncmp(pair.first.c_str(), prefix, length) != 0) continue;
+        if (pair.second->type == EpaperObjectType::TEXT && pair.second->dynamic_type[0] != '\0') {
+            return true;
+        }
+    }
+    return false;
+}
+
+static size_t CountCanvasLabels(LabelMap& labels) {
+    size_t count = 0;
+    for (const auto& pair : labels) {
+        count += strncmp(pair.first.c_str(), "canvas_", 7) == 0;
+    }
+    return count;
+}
+
+static void ReloadPage(LabelMap& labels, uint16_t page) {
+    for (int i = 0; i < LABELS_PER_PAGE; i++) {
+        auto it = labels.find(LabelId(page, i));
+        delete it->second;
+        labels.erase(it);
+    }
+    for (int i = 0; i < LABELS_PER_PAGE; i++) {
+        labels[LabelId(page, i)] = new EpaperLabel(MakeLabel(page, i));
+    }
+}
+
+static void ReloadPage(EpaperLabelStore& store, uint16_t page) {
+    for (int i = 0; i < LABELS_PER_PAGE; i++) {
+        store.Remove(store.Find(LabelId(page, i)));
+    }
+    for (int i = 0; i < LABELS_PER_PAGE; i++) {
+        store.Add(LabelId(page, i), MakeLabel(page, i));
+    }
+}
+
+template <typename F>
+static double NsPerOp(int iterations, F op) {
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < iterations; i++) {
+        op(i);
+    }
+    return (double)(esp_timer_get_time() - start_us) * 1000 / iterations;
+}
+
+int main() {
+    LabelMap labels;
+    EpaperLabelStore store;
+    for (uint16_t page = 1; page <= PAGES; page++) {
+        for (int i = 0; i < LABELS_PER_PAGE; i++) {
+            labels[LabelId(page, i)] = new EpaperLabel(MakeLabel(page, i));
+            store.Add(LabelId(page, i), MakeLabel(page, i));
+        }
+    }
+
+    // Both must see the same labels
+    bool same = CountCanvasLabels(labels) == store.PrefixLabels("canvas_").size();
+    for (uint16_t page = 1; page <= PAGES; page++) {
+        same &= RenderPage(labels, page) == RenderPage(store, page);
+        same &= HasDynamic(labels, page) == (store.DynamicCount(page) > 0);
+    }
+
+    // Keeps every result alive
+    volatile uint32_t sink = 0;
+    printf("%d pages x %d labels, ns per operation: std::map -> EpaperLabelStore\n", PAGES, LABELS_PER_PAGE);
+    auto report = [](const char* name, double before, double after) {
+        printf("  %-22s %9.1f -> %7.1f\n", name, before, after);
+    };
+    report("render one page",
+        NsPerOp(ITERATIONS, [&](int i) { sink += RenderPage(labels, 1 + i % PAGES); }),
+        NsPerOp(ITERATIONS, [&](int i) { sink += RenderPage(store, 1 + i % PAGES); }));
+    report("dynamic tick",
+        NsPerOp(ITERATIONS, [&](int i) { sink += HasDynamic(labels, FIRST_CUSTOM_PAGE + i % 9); }),
+        NsPerOp(ITERATIONS, [&](int i) { sink += store.DynamicCount(FIRST_CUSTOM_PAGE + i % 9) > 0; }));
+    report("count canvas labels",
+        NsPerOp(ITERATIONS, [&](int) { sink += CountCanvasLabels(labels); }),
+        NsPerOp(ITERATIONS, [&](int) { sink += store.PrefixLabels("canvas_").size(); }));
+
+    String ids[PAGES * LABELS_PER_PAGE];
+    for (int i = 0; i < PAGES * LABELS_PER_PAGE; i++) {
+        ids[i] = LabelId(1 + i / LABELS_PER_PAGE, i % LABELS_PER_PAGE);
+    }
+    report("find by id",
+        NsPerOp(ITERATIONS, [&](int i) { sink += labels.find(ids[i % (PAGES * LABELS_PER_PAGE)])->second->x; }),
+        NsPerOp(ITERATIONS, [&](int i) { sink += store.Get(store.Find(ids[i % (PAGES * LABELS_PER_PAGE)]))->x; }));
+    report("reload a custom page",
+        NsPerOp(ITERATIONS / 100, [&](int i) { ReloadPage(labels, FIRST_CUSTOM_PAGE + i % 9); }),
+        NsPerOp(ITERATIONS / 100, [&](int i) { ReloadPage(store, FIRST_CUSTOM_PAGE + i % 9); }));
+
+    for (auto& pair : labels) {
+        delete pair.second;
+    }
+    if (!same) {
+        printf("  the two stores disagree\n");
+    }
+    return same ? 0 : 1;
+}
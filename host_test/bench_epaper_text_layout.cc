@@ -0,0 +1,104 @@
+#include "legacy_text_wrap.h"
+
+#include <esp_timer.h>
+#include <cstdio>
+#include <vector>
+
+/*
+ * Host benchmark of wrapped U8g2 text on the e-paper display: a long Chinese recipe in the recipe
+ * page's text box and a chat message, laid out by the line breaker EpaperDisplay used before
+ * (a growing String measured with getUTF8Width after every glyph) and by EpaperTextLayout.
+ * A refresh of a wrapped label lays its text out twice, once in CalculateTextBounds and once in
+ * RenderTextWithWrap.
+ *
+ * The host U8g2 stub measures with fixed per-font metrics and no glyph lookup, so it is far
+ * cheaper per call than u8g2 on the device; the count of width measurements is the figure that
+ * carries over.
+ */
+
+#define ITERATIONS 200
+
+// Host stub fonts: ASCII advance and width, then CJK advance and width
+static const uint8_t kFont12[] = {6, 5, 12, 11};
+static const uint8_t kFont16[] = {8, 7, 16, 15};
+
+static const char* const kRecipe =
+    "番茄炒蛋（两人份）\n"
+    "食材：鸡蛋3个，番茄2个，葱1根，盐2克，白糖5克，食用油15毫升。\n"
+    "1. 番茄顶部划十字，用开水烫30秒后去皮，切成小块；葱切成葱花，葱白和葱绿分开放。\n"
+    "2. 鸡蛋打入碗中，加一小撮盐，用筷子顺着一个方向打散，打到表面起细小的泡沫为止。\n"
+    "3. 锅烧热后倒入10毫升油，油温七成热时倒入蛋液，等底部凝固后用铲子轻轻推动，"
+    "炒到八成熟就盛出备用，不要炒得太老。\n"
+    "4. 锅里再倒入剩下的油，先放葱白爆香，然后放入番茄块，中火翻炒两分钟，"
+    "用铲子压出汤汁，加入白糖和剩下的盐。\n"
+    "5. 番茄出沙以后倒回炒好的鸡蛋，翻炒均匀让鸡蛋裹上汤汁，关火前撒上葱绿即可出锅。\n"
+    "小贴士：番茄选熟透的沙瓤番茄，汤汁更浓；喜欢酸甜口味可以多加一点糖，"
+    "喜欢汤汁多的可以在番茄出沙后加两勺清水。冰箱里剩下的番茄建议三天内吃完，"
+    "鸡蛋放在冷藏室内侧，不要放在门上，温度更稳定，保存时间更长。";
+
+static const char* const kChat =
+    "好的，我看了一下冰箱，还有3个鸡蛋和2个番茄，今天晚上可以做番茄炒蛋，大概15分钟就能做好。"
+    "需要我把步骤显示在食谱页面上吗？";
+
+static void Report(const char* name, int64_t elapsed_us, uint32_t width_calls) {
+    printf("  %-22s %8.1f us/refresh, %6.1f width measurements/refresh\n", name, (double)elapsed_us / ITERATIONS,
+        (double)width_calls / ITERATIONS);
+}
+
+// Returns false when the two breakers disagree
+static bool Bench(const char* name, const char* text_chars, const uint8_t* font, uint16_t w_max,
+                  EpaperTextAlign align) {
+    String text(text_chars);
+    U8G2_FOR_ADAFRUIT_GFX u8g2;
+    u8g2.setFont(font);
+    std::vector<EpaperTextLine> old_lines;
+    LegacyBreakLines(u8g2, text, w_max, align, old_lines);
+    printf("%s: %u bytes, %zu lines of at most %u px\n", name, text.length(), old_lines.size(), w_max);
+
+    uint32_t calls = u8g2.width_calls();
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < ITERATIONS; i++) {
+        LegacyBreakLines(u8g2, text, w_max, align, old_lines);
+        LegacyBreakLines(u8g2, text, w_max, align, old_lines);
+    }
+    Report("String per glyph", esp_timer_get_time() - start_us, u8g2.width_calls() - calls);
+
+    EpaperTextLayout layout(u8g2);
+    bool same = SameLines(layout.Layout(text, font, w_max, align), old_lines);
+    // Twice as many keys as the cache holds, so every refresh misses once: the glyph metrics are
+    // known, the lines are not
+    calls = u8g2.width_calls();
+    start_us = esp_timer_get_time();
+    for (int i = 0; i < ITERATIONS; i++) {
+        uint16_t width = w_max - i % (2 * EPAPER_TEXT_LAYOUT_CACHE_SIZE);
+        layout.Layout(text, font, width, align);
+        layout.Layout(text, font, width, align);
+    }
+    Report("layout, text changed", esp_timer_get_time() - start_us, u8g2.width_calls() - calls);
+
+    calls = u8g2.width_calls();
+    start_us = esp_timer_get_time();
+    for (int i = 0; i < ITERATIONS; i++) {
+        layout.Layout(text, font, w_max, align);
+        layout.Layout(text, font, w_max, align);
+    }
+    Report("layout, cached", esp_timer_get_time() - start_us, u8g2.width_calls() - calls);
+
+    // The first layout with a cold glyph table, what a new font costs once
+    EpaperTextLayout cold(u8g2);
+    calls = u8g2.width_calls();
+    start_us = esp_timer_get_time();
+    same &= SameLines(cold.Layout(text, font, w_max, align), old_lines);
+    printf("  %-22s %8lld us, %4u width measurements\n", "first layout", (long long)(esp_timer_get_time() - start_us),
+        (unsigned)(u8g2.width_calls() - calls));
+    if (!same) {
+        printf("  lines differ from the old breaker\n");
+    }
+    return same;
+}
+
+int main() {
+    bool same = Bench("Recipe text box", kRecipe, kFont12, 188, EpaperTextAlign::LEFT);
+    same &= Bench("Chat message", kChat, kFont16, 192, EpaperTextAlign::CENTER);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+#include "pcm_kernels.h"
+#include "spsc_ring.h"
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Host benchmark of the AudioService queue hops.
+ *
+ * Synthetic 60 ms frames run through an uplink (input -> encode queue -> encoder -> send queue ->
+ * sender) and, at the same time, a downlink (receiver -> decode queue -> decoder -> playback queue
+ * -> output), once with the SPSC rings and per-queue event bits AudioService uses and once with
+ * the deques behind one mutex and notify_all() it used before. Reports the latency of each hop,
+ * how often a task had to wait for the queue lock and how often a wakeup found nothing to do.
+ *
+ * On host the event group is itself a mutex and a condition variable, so the ring numbers include
+ * that; on the device the bits are set without a lock held across the queue operation.
+ */
+
+#define FRAMES 2000
+#define FRAME_SAMPLES 960
+// Frames are produced this fast, 60 ms of audio every 500 us
+#define FRAME_INTERVAL_US 500
+#define QUEUE_CAPACITY 2
+#define HOPS 4
+
+static const char* const kHopNames[HOPS] = {"encode queue", "send queue", "decode queue", "playback queue"};
+
+struct Frame {
+    int64_t queued_us = 0;
+    std::vector<int16_t> pcm;
+};
+using FramePtr = std::unique_ptr<Frame>;
+
+struct HopStats {
+    std::vector<int64_t> latencies;
+    uint32_t lock_waits = 0;
+    uint32_t empty_wakeups = 0;
+};
+
+// The previous design: every queue behind one mutex, every push and pop wakes every task
+class LockedQueues {
+public:
+    void Push(int hop, FramePtr frame, HopStats& stats) {
+        std::unique_lock<std::mutex> lock = Lock(stats);
+        cv_.wait(lock, [&] { return queues_[hop].size() < QUEUE_CAPACITY; });
+        queues_[hop].push_back(std::move(frame));
+        cv_.notify_all();
+    }
+
+    FramePtr Pop(int hop, HopStats& stats) {
+        std::unique_lock<std::mutex> lock = Lock(stats);
+        while (queues_[hop].empty()) {
+            cv_.wait(lock);
+            if (queues_[hop].empty()) {
+                stats.empty_wakeups++;
+            }
+        }
+        FramePtr frame = std::move(queues_[hop].front());
+        queues_[hop].pop_front();
+        cv_.notify_all();
+        return frame;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<FramePtr> queues_[HOPS];
+
+    std::unique_lock<std::mutex> Lock(HopStats& stats) {
+        std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            stats.lock_waits++;
+            lock.lock();
+        }
+        return lock;
+    }
+};
+
+// AudioService now: one ring per hop, the consumer and producer of a hop sleep on their own bit
+class RingQueues {
+public:
+    RingQueues() {
+        event_group_ = xEventGroupCreate();
+        for (auto& ring : rings_) {
+            ring.Reserve(QUEUE_CAPACITY);
+        }
+    }
+
+    ~RingQueues() {
+        vEventGroupDelete(event_group_);
+    }
+
+    void Push(int hop, FramePtr frame, HopStats& stats) {
+        while (!rings_[hop].Push(std::move(frame))) {
+            xEventGroupWaitBits(event_group_, NotFullBit(hop), pdTRUE, pdFALSE, portMAX_DELAY);
+        }
+        xEventGroupSetBits(event_group_, NotEmptyBit(hop));
+    }
+
+    FramePtr Pop(int hop, HopStats& stats) {
+        FramePtr frame;
+        if (!rings_[hop].Pop(frame)) {
+            while (true) {
+                xEventGroupWaitBits(event_group_, NotEmptyBit(hop), pdTRUE, pdFALSE, portMAX_DELAY);
+                if (rings_[hop].Pop(frame)) {
+                    break;
+                }
+                stats.empty_wakeups++;
+            }
+        }
+        xEventGroupSetBits(event_group_, NotFullBit(hop));
+        return frame;
+    }
+
+private:
+    EventGroupHandle_t event_group_;
+    SpscRing<FramePtr> rings_[HOPS];
+
+    static EventBits_t NotEmptyBit(int hop) { return 1 << hop; }
+    static EventBits_t NotFullBit(int hop) { return 1 << (HOPS + hop); }
+};
+
+static int64_t Percentile(std::vector<int64_t> values, double p) {
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(values.size() * p))];
+}
+
+static void Merge(HopStats& into, const HopStats& from) {
+    into.latencies.insert(into.latencies.end(), from.latencies.begin(), from.latencies.end());
+    into.lock_waits += from.lock_waits;
+    into.empty_wakeups += from.empty_wakeups;
+}
+
+// One direction: a paced source, a middle task doing a pass over the PCM, and a sink
+template <typename Queues>
+static void RunChain(Queues& queues, int hop, HopStats* stats) {
+    // Every task counts into stats of its own, merged once the chain is done
+    HopStats source_stats, middle_in_stats, middle_out_stats, sink_stats;
+    std::thread source([&] {
+        int64_t start_us = esp_timer_get_time();
+        for (int i = 0; i <= FRAMES; i++) {
+            while (esp_timer_get_time() < start_us + (int64_t)i * FRAME_INTERVAL_US) {
+                std::this_thread::yield();
+            }
+            FramePtr frame;
+            if (i < FRAMES) {
+                frame = std::make_unique<Frame>();
+                frame->pcm.assign(FRAME_SAMPLES, (int16_t)i);
+                frame->queued_us = esp_timer_get_time();
+            }
+            // A null frame ends the chain
+            queues.Push(hop, std::move(frame), source_stats);
+        }
+    });
+    std::thread middle([&] {
+        while (true) {
+            FramePtr frame = queues.Pop(hop, middle_in_stats);
+            if (!frame) {
+                queues.Push(hop + 1, nullptr, middle_out_stats);
+                break;
+            }
+            middle_in_stats.latencies.push_back(esp_timer_get_time() - frame->queued_us);
+            PcmApplyGain(frame->pcm.data(), frame->pcm.size(), 30000);
+            frame->queued_us = esp_timer_get_time();
+            queues.Push(hop + 1, std::move(frame), middle_out_stats);
+        }
+    });
+    std::thread sink([&] {
+        while (FramePtr frame = queues.Pop(hop + 1, sink_stats)) {
+            sink_stats.latencies.push_back(esp_timer_get_time() - frame->queued_us);
+        }
+    });
+    source.join();
+    middle.join();
+    sink.join();
+    Merge(stats[hop], source_stats);
+    Merge(stats[hop], middle_in_stats);
+    Merge(stats[hop + 1], middle_out_stats);
+    Merge(stats[hop + 1], sink_stats);
+}
+
+template <typename Queues>
+static void Bench(const char* name) {
+    Queues queues;
+    HopStats stats[HOPS];
+    std::thread uplink([&] { RunChain(queues, 0, stats); });
+    std::thread downlink([&] { RunChain(queues, 2, stats); });
+    uplink.join();
+    downlink.join();
+
+    printf("%s: %d frames each way, one every %d us\n", name, FRAMES, FRAME_INTERVAL_US);
+    for (int hop = 0; hop < HOPS; hop++) {
+        printf("  %-15s p50 %5lld us p95 %5lld us max %6lld us, lock waits %5u, empty wakeups %5u\n",
+            kHopNames[hop], (long long)Percentile(stats[hop].latencies, 0.5),
+            (long long)Percentile(stats[hop].latencies, 0.95), (long long)Percentile(stats[hop].latencies, 1.0),
+            (unsigned)stats[hop].lock_waits, (unsigned)stats[hop].empty_wakeups);
+    }
+}
+
+int main() {
+    Bench<LockedQueues>("Shared mutex, notify_all");
+    Bench<RingQueues>("SPSC rings, per-queue bits");
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+/*
+ * Minimal test runner for the host tests, no framework is available in the ESP-IDF toolchain.
+ *
+ * TEST() registers a case, CHECK() and CHECK_EQ() record a failure and keep going, and
+ * RunAllTests() returns the process exit code for ctest.
+ */
+
+struct HostTestCase {
+    const char* name;
+    std::function<void()> body;
+};
+
+inline std::vector<HostTestCase>& HostTestCases() {
+    static std::vector<HostTestCase> cases;
+    return cases;
+}
+
+inline int& HostTestFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct HostTestRegistrar {
+    HostTestRegistrar(const char* name, std::function<void()> body) {
+        HostTestCases().push_back({name, std::move(body)});
+    }
+};
+
+#define TEST(name)                                                          \
+    static void name();                                                     \
+    static HostTestRegistrar name##_registrar(#name, name);                 \
+    static void name()
+
+#define CHECK(cond) do {                                                    \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            HostTestFailures()++;                                           \
+        }                                                                   \
+    } while (0)
+
+#define CHECK_EQ(a, b) do {                                                 \
+        auto a_ = (a);                                                      \
+        auto b_ = (b);                                                      \
+        if (!(a_ == b_)) {                                                  \
+            fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, \
+                #a, #b, (long long)a_, (long long)b_);                      \
+            HostTestFailures()++;                                           \
+        }                                                                   \
+    } while (0)
+
+inline int RunAllTests() {
+    for (auto& test : HostTestCases()) {
+        int failures = HostTestFailures();
+        test.body();
+        printf("%-40s %s\n", test.name, HostTestFailures() == failures ? "ok" : "FAILED");
+    }
+    printf("%d check(s) failed\n", HostTestFailures());
+    return HostTestFailures() == 0 ? 0 : 1;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,109 @@
+#ifndef HOST_TEST_LEGACY_TEXT_WRAP_H
+#define HOST_TEST_LEGACY_TEXT_WRAP_H
+
+#include "epaper_text_layout.h"
+
+#include <vector>
+
+/*
+ * The line breaker EpaperDisplay ran in RenderTextWithWrap and CalculateTextBounds before
+ * EpaperTextLayout, kept as the reference the layout must match.
+ */
+inline void LegacyBreakLines(U8G2_FOR_ADAFRUIT_GFX& u8g2, const String& text, uint16_t w_max,
+                             EpaperTextAlign align, std::vector<EpaperTextLine>& lines) {
+    lines.clear();
+    auto render_line = [&](const String& line) {
+        EpaperTextLine out;
+        out.text = line.c_str();
+        out.width = u8g2.getUTF8Width(line.c_str());
+        if (align == EpaperTextAlign::CENTER) {
+            out.offset = (w_max - out.width) / 2;
+        } else if (align == EpaperTextAlign::RIGHT) {
+            out.offset = w_max - out.width;
+        }
+        lines.push_back(out);
+    };
+
+    int text_len = text.length();
+    int start_idx = 0;
+    while (start_idx < text_len) {
+        int explicit_break = text.indexOf('\n', start_idx);
+        String paragraph = (explicit_break >= 0) ? text.substring(start_idx, explicit_break) : text.substring(start_idx);
+
+        if (paragraph.length() == 0) {
+            render_line("");
+        } else {
+            int paragraph_len = paragraph.length();
+            int local_start = 0;
+            while (local_start < paragraph_len) {
+                String line = "";
+                int local_end = local_start;
+                while (local_end < paragraph_len) {
+                    String next_char = "";
+                    uint8_t c = paragraph[local_end];
+                    if ((c & 0x80) == 0) {
+                        next_char = String((char)c);
+                        local_end++;
+                    } else if ((c & 0xE0) == 0xC0) {
+                        if (local_end + 1 < paragraph_len) {
+                            next_char = paragraph.substring(local_end, local_end + 2);
+                            local_end += 2;
+                        } else {
+                            break;
+                        }
+                    } else if ((c & 0xF0) == 0xE0) {
+                        if (local_end + 2 < paragraph_len) {
+                            next_char = paragraph.substring(local_end, local_end + 3);
+                            local_end += 3;
+                        } else {
+                            break;
+                        }
+                    } else if ((c & 0xF8) == 0xF0) {
+                        if (local_end + 3 < paragraph_len) {
+                            next_char = paragraph.substring(local_end, local_end + 4);
+                            local_end += 4;
+                        } else {
+                            break;
+                        }
+                    } else {
+                        local_end++;
+                        continue;
+                    }
+
+                    String test_line = line + next_char;
+                    int16_t test_width = u8g2.getUTF8Width(test_line.c_str());
+                    if (test_width > w_max && line.length() > 0) {
+                        local_end -= next_char.length();
+                        break;
+                    }
+                    line = test_line;
+                }
+
+                render_line(line);
+                if (local_end == local_start) {
+                    local_end++;
+                }
+                local_start = local_end;
+            }
+        }
+
+        if (explicit_break < 0) {
+            break;
+        }
+        start_idx = explicit_break + 1;
+    }
+}
+
+inline bool SameLines(const std::vector<EpaperTextLine>& a, const std::vector<EpaperTextLine>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].text != b[i].text || a[i].width != b[i].width || a[i].offset != b[i].offset) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif // HOST_TEST_LEGACY_TEXT_WRAP_H
@@ -0,0 +1,35 @@
+#ifndef HOST_OPUS_DECODER_H
+#define HOST_OPUS_DECODER_H
+
+#include <cstdint>
+#include <vector>
+
+struct OpusDecoder;
+
+/*
+ * Host version of the esp-opus-encoder decoder wrapper, see opus_encoder.h.
+ *
+ * Without libopus a packet packed by the host encoder is unpacked, any other packet (the Opus
+ * frames of the embedded sounds) decodes to one frame of silence, and an empty packet is not
+ * concealed.
+ */
+class OpusDecoderWrapper {
+public:
+    OpusDecoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusDecoderWrapper();
+
+    // An empty packet conceals one lost frame
+    bool Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm);
+    void ResetState();
+
+    int sample_rate() const { return sample_rate_; }
+    int duration_ms() const { return duration_ms_; }
+
+private:
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+    OpusDecoder* decoder_ = nullptr;
+};
+
+#endif // HOST_OPUS_DECODER_H
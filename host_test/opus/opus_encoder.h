@@ -0,0 +1,39 @@
+#ifndef HOST_OPUS_ENCODER_H
+#define HOST_OPUS_ENCODER_H
+
+#include <cstdint>
+#include <vector>
+
+struct OpusEncoder;
+
+/*
+ * Host version of the esp-opus-encoder wrapper, with the calls the firmware makes.
+ *
+ * With HOST_HAVE_OPUS the frames are encoded by libopus, the codec esp-opus is built from.
+ * Without it a frame is packed as raw PCM, so the pipeline still runs but the timings do not
+ * include the codec. SetBitrate() only exists with libopus, like older wrapper versions lack it.
+ */
+class OpusEncoderWrapper {
+public:
+    OpusEncoderWrapper(int sample_rate, int channels, int duration_ms = 60);
+    ~OpusEncoderWrapper();
+
+    // pcm must hold exactly one frame
+    bool Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus);
+    void SetComplexity(int complexity);
+#if HOST_HAVE_OPUS
+    void SetBitrate(int bitrate);
+#endif
+    void ResetState();
+
+    int sample_rate() const { return sample_rate_; }
+    int duration_ms() const { return duration_ms_; }
+
+private:
+    int sample_rate_;
+    int channels_;
+    int duration_ms_;
+    OpusEncoder* encoder_ = nullptr;
+};
+
+#endif // HOST_OPUS_ENCODER_H
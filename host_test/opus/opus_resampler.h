@@ -0,0 +1,27 @@
+#ifndef HOST_OPUS_RESAMPLER_H
+#define HOST_OPUS_RESAMPLER_H
+
+#include <cstdint>
+
+/*
+ * Host version of the esp-opus-encoder resampler. The SILK resampler behind the real one is not
+ * exported by libopus, so this one interpolates linearly. It keeps state across calls like the
+ * real one, which is what the users of the class depend on, but its output differs from SILK.
+ */
+class OpusResampler {
+public:
+    void Configure(int input_sample_rate, int output_sample_rate);
+    // output must hold GetOutputSamples(input_samples) samples
+    void Process(const int16_t* input, int input_samples, int16_t* output);
+    int GetOutputSamples(int input_samples) const;
+
+    int input_sample_rate() const { return input_sample_rate_; }
+    int output_sample_rate() const { return output_sample_rate_; }
+
+private:
+    int input_sample_rate_ = 0;
+    int output_sample_rate_ = 0;
+    int16_t previous_ = 0;
+};
+
+#endif // HOST_OPUS_RESAMPLER_H
@@ -0,0 +1,161 @@
+#include "opus_encoder.h"
+#include "opus_decoder.h"
+#include "opus_resampler.h"
+
+#include <esp_log.h>
+#include <cstring>
+#if HOST_HAVE_OPUS
+#include <opus.h>
+#endif
+
+#define TAG "HostOpus"
+
+// Largest packet libopus produces for one frame
+#define MAX_OPUS_PACKET_SIZE 1275
+
+OpusEncoderWrapper::OpusEncoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+#if HOST_HAVE_OPUS
+    int error;
+    encoder_ = opus_encoder_create(sample_rate, channels, OPUS_APPLICATION_VOIP, &error);
+    if (encoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio encoder, error code: %d", error);
+    }
+#endif
+}
+
+OpusEncoderWrapper::~OpusEncoderWrapper() {
+#if HOST_HAVE_OPUS
+    if (encoder_ != nullptr) {
+        opus_encoder_destroy(encoder_);
+    }
+#endif
+}
+
+bool OpusEncoderWrapper::Encode(std::vector<int16_t>&& pcm, std::vector<uint8_t>& opus) {
+    size_t frame_samples = sample_rate_ / 1000 * duration_ms_ * channels_;
+    if (pcm.size() != frame_samples) {
+        ESP_LOGE(TAG, "Audio data size %u does not match the frame size %u", (unsigned)pcm.size(),
+            (unsigned)frame_samples);
+        return false;
+    }
+#if HOST_HAVE_OPUS
+    if (encoder_ == nullptr) {
+        return false;
+    }
+    opus.resize(MAX_OPUS_PACKET_SIZE);
+    int size = opus_encode(encoder_, pcm.data(), frame_samples / channels_, opus.data(), opus.size());
+    if (size < 0) {
+        ESP_LOGE(TAG, "Failed to encode audio, error code: %d", size);
+        return false;
+    }
+    opus.resize(size);
+#else
+    opus.resize(pcm.size() * sizeof(int16_t));
+    memcpy(opus.data(), pcm.data(), opus.size());
+#endif
+    return true;
+}
+
+void OpusEncoderWrapper::SetComplexity(int complexity) {
+#if HOST_HAVE_OPUS
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_COMPLEXITY(complexity));
+    }
+#endif
+}
+
+#if HOST_HAVE_OPUS
+void OpusEncoderWrapper::SetBitrate(int bitrate) {
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_SET_BITRATE(bitrate));
+    }
+}
+#endif
+
+void OpusEncoderWrapper::ResetState() {
+#if HOST_HAVE_OPUS
+    if (encoder_ != nullptr) {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+    }
+#endif
+}
+
+OpusDecoderWrapper::OpusDecoderWrapper(int sample_rate, int channels, int duration_ms)
+    : sample_rate_(sample_rate), channels_(channels), duration_ms_(duration_ms) {
+#if HOST_HAVE_OPUS
+    int error;
+    decoder_ = opus_decoder_create(sample_rate, channels, &error);
+    if (decoder_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create audio decoder, error code: %d", error);
+    }
+#endif
+}
+
+OpusDecoderWrapper::~OpusDecoderWrapper() {
+#if HOST_HAVE_OPUS
+    if (decoder_ != nullptr) {
+        opus_decoder_destroy(decoder_);
+    }
+#endif
+}
+
+bool OpusDecoderWrapper::Decode(std::vector<uint8_t>&& opus, std::vector<int16_t>& pcm) {
+    size_t frame_samples = sample_rate_ / 1000 * duration_ms_ * channels_;
+#if HOST_HAVE_OPUS
+    if (decoder_ == nullptr) {
+        return false;
+    }
+    pcm.resize(frame_samples);
+    int samples = opus_decode(decoder_, opus.empty() ? nullptr : opus.data(), opus.size(), pcm.data(),
+        frame_samples / channels_, 0);
+    if (samples < 0) {
+        ESP_LOGE(TAG, "Failed to decode audio, error code: %d", samples);
+        return false;
+    }
+    pcm.resize(samples * channels_);
+#else
+    if (opus.empty()) {
+        return false;
+    }
+    pcm.assign(frame_samples, 0);
+    if (opus.size() == frame_samples * sizeof(int16_t)) {
+        memcpy(pcm.data(), opus.data(), opus.size());
+    }
+#endif
+    return true;
+}
+
+void OpusDecoderWrapper::ResetState() {
+#if HOST_HAVE_OPUS
+    if (decoder_ != nullptr) {
+        opus_decoder_ctl(decoder_, OPUS_RESET_STATE);
+    }
+#endif
+}
+
+void OpusResampler::Configure(int input_sample_rate, int output_sample_rate) {
+    input_sample_rate_ = input_sample_rate;
+    output_sample_rate_ = output_sample_rate;
+    previous_ = 0;
+}
+
+int OpusResampler::GetOutputSamples(int input_samples) const {
+    return (int64_t)input_samples * output_sample_rate_ / input_sample_rate_;
+}
+
+void OpusResampler::Process(const int16_t* input, int input_samples, int16_t* output) {
+    // Output sample i sits at input position i * in / out, one sample late so the sample before the
+    // block is interpolated from the previous call
+    int output_samples = GetOutputSamples(input_samples);
+    for (int i = 0; i < output_samples; i++) {
+        int64_t position = (int64_t)i * input_sample_rate_ * 65536 / output_sample_rate_;
+        int index = position >> 16;
+        int fraction = position & 0xffff;
+        int before = index > 0 ? input[index - 1] : previous_;
+        output[i] = before + (((int)input[index] - before) * fraction >> 16);
+    }
+    if (input_samples > 0) {
+        previous_ = input[input_samples - 1];
+    }
+}
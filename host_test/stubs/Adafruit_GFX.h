@@ -0,0 +1,127 @@
+#ifndef HOST_STUB_ADAFRUIT_GFX_H
+#define HOST_STUB_ADAFRUIT_GFX_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * The part of Adafruit_GFX that EpaperCanvas builds on: rotation, the primitives it overrides and
+ * GFXcanvas1 with the same buffer layout (MSB first, WIDTH/8 bytes a row) and rotation mapping.
+ * Shapes go through drawPixel and the fast lines, as in the library.
+ */
+
+class Adafruit_GFX {
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h), _width(w), _height(h) {}
+    virtual ~Adafruit_GFX() = default;
+
+    virtual void drawPixel(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+        for (int16_t i = 0; i < h; i++) {
+            drawPixel(x, y + i, color);
+        }
+    }
+
+    virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+        for (int16_t i = 0; i < w; i++) {
+            drawPixel(x + i, y, color);
+        }
+    }
+
+    virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        for (int16_t i = x; i < x + w; i++) {
+            drawFastVLine(i, y, h, color);
+        }
+    }
+
+    virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        drawFastHLine(x, y, w, color);
+        drawFastHLine(x, y + h - 1, w, color);
+        drawFastVLine(x, y, h, color);
+        drawFastVLine(x + w - 1, y, h, color);
+    }
+
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+        if (x0 == x1) {
+            drawFastVLine(x0, y0 < y1 ? y0 : y1, abs(y1 - y0) + 1, color);
+            return;
+        }
+        if (y0 == y1) {
+            drawFastHLine(x0 < x1 ? x0 : x1, y0, abs(x1 - x0) + 1, color);
+            return;
+        }
+        // Bresenham
+        int16_t dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+        int16_t dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+        int16_t err = dx + dy;
+        while (true) {
+            drawPixel(x0, y0, color);
+            if (x0 == x1 && y0 == y1) break;
+            int16_t e2 = 2 * err;
+            if (e2 >= dy) { err += dy; x0 += sx; }
+            if (e2 <= dx) { err += dx; y0 += sy; }
+        }
+    }
+
+    void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t w, int16_t h, uint16_t color,
+                    uint16_t bg) {
+        int16_t row_bytes = (w + 7) / 8;
+        for (int16_t j = 0; j < h; j++) {
+            for (int16_t i = 0; i < w; i++) {
+                bool set = bitmap[j * row_bytes + i / 8] & (0x80 >> (i & 7));
+                drawPixel(x + i, y + j, set ? color : bg);
+            }
+        }
+    }
+
+    void setRotation(uint8_t r) {
+        rotation = r & 3;
+        _width = (rotation & 1) ? HEIGHT : WIDTH;
+        _height = (rotation & 1) ? WIDTH : HEIGHT;
+    }
+    uint8_t getRotation() const { return rotation; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+protected:
+    const int16_t WIDTH, HEIGHT;
+    int16_t _width, _height;
+    uint8_t rotation = 0;
+};
+
+class GFXcanvas1 : public Adafruit_GFX {
+public:
+    GFXcanvas1(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {
+        buffer = (uint8_t*)calloc((size_t)(w + 7) / 8 * h, 1);
+    }
+    ~GFXcanvas1() override { free(buffer); }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+        int16_t t;
+        switch (rotation) {
+            case 1: t = x; x = WIDTH - 1 - y; y = t; break;
+            case 2: x = WIDTH - 1 - x; y = HEIGHT - 1 - y; break;
+            case 3: t = x; x = y; y = HEIGHT - 1 - t; break;
+        }
+        if (x < 0 || y < 0 || x >= WIDTH || y >= HEIGHT) {
+            return;
+        }
+        uint8_t* ptr = &buffer[(x / 8) + y * ((WIDTH + 7) / 8)];
+        if (color) {
+            *ptr |= 0x80 >> (x & 7);
+        } else {
+            *ptr &= ~(0x80 >> (x & 7));
+        }
+    }
+
+    uint8_t* getBuffer() const { return buffer; }
+
+private:
+    uint8_t* buffer;
+};
+
+#endif // HOST_STUB_ADAFRUIT_GFX_H
@@ -0,0 +1,56 @@
+#ifndef HOST_STUB_ARDUINO_H
+#define HOST_STUB_ARDUINO_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <avr/pgmspace.h>
+
+/*
+ * Arduino's String over std::string, only the members the e-paper modules and their host tests
+ * use. Like WString, copies and concatenation allocate on the heap.
+ */
+class String {
+public:
+    String() = default;
+    String(const char* s) : s_(s != nullptr ? s : "") {}
+    explicit String(char c) : s_(1, c) {}
+    explicit String(int value) : s_(std::to_string(value)) {}
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    char operator[](unsigned int index) const { return index < s_.size() ? s_[index] : 0; }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t pos = s_.find(c, from);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int from) const { return substring(from, s_.size()); }
+    String substring(unsigned int from, unsigned int to) const {
+        String result;
+        if (from < to && from < s_.size()) {
+            result.s_ = s_.substr(from, to - from);
+        }
+        return result;
+    }
+    bool startsWith(const String& prefix) const { return s_.compare(0, prefix.s_.size(), prefix.s_) == 0; }
+
+    String& operator+=(const String& other) { s_ += other.s_; return *this; }
+    String& operator+=(const char* other) { s_ += other; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    friend String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+    friend String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+    friend String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+
+    bool operator==(const String& other) const { return s_ == other.s_; }
+    bool operator==(const char* other) const { return s_ == other; }
+    bool operator!=(const String& other) const { return s_ != other.s_; }
+    bool operator<(const String& other) const { return s_ < other.s_; }
+
+private:
+    std::string s_;
+};
+
+#endif // HOST_STUB_ARDUINO_H
@@ -0,0 +1,11 @@
+#ifndef HOST_STUB_GXEPD2_BW_H
+#define HOST_STUB_GXEPD2_BW_H
+
+#include <Adafruit_GFX.h>
+
+// Only the colours, the panel driver is not built on host
+
+#define GxEPD_BLACK 0x0000
+#define GxEPD_WHITE 0xFFFF
+
+#endif // HOST_STUB_GXEPD2_BW_H
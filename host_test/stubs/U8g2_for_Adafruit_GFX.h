@@ -0,0 +1,42 @@
+#ifndef HOST_STUB_U8G2_FOR_ADAFRUIT_GFX_H
+#define HOST_STUB_U8G2_FOR_ADAFRUIT_GFX_H
+
+#include <Adafruit_GFX.h>
+#include <cstdint>
+
+/*
+ * Text measurement only. A host "font" is four bytes: advance and width of an ASCII glyph, then
+ * of any other glyph; a space has no ink. getUTF8Width() sums the advances of all glyphs but the
+ * last and adds the width of the last one, as u8g2 does, and counts its calls.
+ */
+class U8G2_FOR_ADAFRUIT_GFX {
+public:
+    void begin(Adafruit_GFX& gfx) { gfx_ = &gfx; }
+    void setFont(const uint8_t* font) { font_ = font; }
+
+    int16_t getUTF8Width(const char* str) {
+        width_calls_++;
+        int16_t width = 0;
+        int16_t last_advance = 0, last_width = 0;
+        for (auto p = (const uint8_t*)str; *p != 0;) {
+            size_t bytes = *p < 0x80 ? 1 : *p < 0xE0 ? 2 : *p < 0xF0 ? 3 : 4;
+            bool ascii = bytes == 1;
+            last_advance = ascii ? font_[0] : font_[2];
+            last_width = *p == ' ' ? 0 : ascii ? font_[1] : font_[3];
+            width += last_advance;
+            for (size_t i = 0; i < bytes && *p != 0; i++) {
+                p++;
+            }
+        }
+        return width == 0 ? 0 : width - last_advance + last_width;
+    }
+
+    uint32_t width_calls() const { return width_calls_; }
+
+private:
+    Adafruit_GFX* gfx_ = nullptr;
+    const uint8_t* font_ = nullptr;
+    uint32_t width_calls_ = 0;
+};
+
+#endif // HOST_STUB_U8G2_FOR_ADAFRUIT_GFX_H
@@ -0,0 +1,11 @@
+#ifndef HOST_STUB_AVR_PGMSPACE_H
+#define HOST_STUB_AVR_PGMSPACE_H
+
+#include <cstdint>
+
+// Flash and RAM are one address space on host
+
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+
+#endif // HOST_STUB_AVR_PGMSPACE_H
@@ -0,0 +1,21 @@
+#ifndef HOST_STUB_BOARD_H
+#define HOST_STUB_BOARD_H
+
+class AudioCodec;
+
+// AudioService asks the board for its codec, host programs register theirs
+class Board {
+public:
+    static Board& GetInstance() {
+        static Board instance;
+        return instance;
+    }
+
+    AudioCodec* GetAudioCodec() { return audio_codec_; }
+    void SetAudioCodec(AudioCodec* codec) { audio_codec_ = codec; }
+
+private:
+    AudioCodec* audio_codec_ = nullptr;
+};
+
+#endif // HOST_STUB_BOARD_H
@@ -0,0 +1,30 @@
+#ifndef HOST_STUB_ESP_HEAP_CAPS_H
+#define HOST_STUB_ESP_HEAP_CAPS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+// One heap on host, the capabilities are ignored
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+inline void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return malloc(size);
+}
+
+inline void* heap_caps_malloc_prefer(size_t size, size_t num, ...) {
+    return malloc(size);
+}
+
+inline void* heap_caps_calloc_prefer(size_t n, size_t size, size_t num, ...) {
+    return calloc(n, size);
+}
+
+inline void heap_caps_free(void* ptr) {
+    free(ptr);
+}
+
+#endif // HOST_STUB_ESP_HEAP_CAPS_H
@@ -0,0 +1,111 @@
+#ifndef HOST_STUB_ESP_TIMER_H
+#define HOST_STUB_ESP_TIMER_H
+
+#include "esp_err.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#define ESP_ERR_INVALID_STATE 0x103
+
+// Microseconds on the monotonic clock, like esp_timer counts from boot
+inline int64_t esp_timer_get_time() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+    ESP_TIMER_ISR,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+// Every start runs the callbacks on a thread of its own, a stop or restart ends that thread
+struct esp_timer {
+    struct State {
+        std::mutex mutex;
+        std::condition_variable changed;
+        uint64_t generation = 0;
+        bool running = false;
+    };
+    esp_timer_create_args_t args;
+    std::shared_ptr<State> state = std::make_shared<State>();
+};
+typedef esp_timer* esp_timer_handle_t;
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* timer) {
+    *timer = new esp_timer{*args};
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start(esp_timer_handle_t timer, uint64_t period_us, bool periodic) {
+    auto state = timer->state;
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->running) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        state->running = true;
+        generation = ++state->generation;
+    }
+    auto args = timer->args;
+    std::thread([state, args, generation, period_us, periodic] {
+        auto deadline = std::chrono::steady_clock::now();
+        do {
+            deadline += std::chrono::microseconds(period_us);
+            {
+                std::unique_lock<std::mutex> lock(state->mutex);
+                if (state->changed.wait_until(lock, deadline, [&] { return state->generation != generation; })) {
+                    return;
+                }
+                if (!periodic) {
+                    state->running = false;
+                }
+            }
+            args.callback(args.arg);
+        } while (periodic);
+    }).detach();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return esp_timer_start(timer, period_us, true);
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return esp_timer_start(timer, timeout_us, false);
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    auto& state = *timer->state;
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (!state.running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    state.running = false;
+    state.generation++;
+    state.changed.notify_all();
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    esp_timer_stop(timer);
+    delete timer;
+    return ESP_OK;
+}
+
+#endif // HOST_STUB_ESP_TIMER_H
@@ -0,0 +1,10 @@
+#ifndef HOST_STUB_ESP_WN_MODELS_H
+#define HOST_STUB_ESP_WN_MODELS_H
+
+#include "esp_wn_iface.h"
+
+inline const esp_wn_iface_t* esp_wn_handle_from_name(const char* model_name) {
+    return nullptr;
+}
+
+#endif // HOST_STUB_ESP_WN_MODELS_H
@@ -0,0 +1,22 @@
+#ifndef HOST_STUB_FREERTOS_H
+#define HOST_STUB_FREERTOS_H
+
+#include <cstdint>
+#include "sdkconfig.h"
+
+// Thin FreeRTOS shim: a 1 ms tick on top of std::thread, enough for the code built on host
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define configTICK_RATE_HZ 1000
+#define portNUM_PROCESSORS 2
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+
+#endif // HOST_STUB_FREERTOS_H
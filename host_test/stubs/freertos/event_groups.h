@@ -0,0 +1,66 @@
+#ifndef HOST_STUB_FREERTOS_EVENT_GROUPS_H
+#define HOST_STUB_FREERTOS_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+typedef TickType_t EventBits_t;
+
+struct EventGroupDef_t {
+    std::mutex mutex;
+    std::condition_variable changed;
+    EventBits_t bits = 0;
+};
+typedef EventGroupDef_t* EventGroupHandle_t;
+
+inline EventGroupHandle_t xEventGroupCreate() {
+    return new EventGroupDef_t();
+}
+
+inline void vEventGroupDelete(EventGroupHandle_t group) {
+    delete group;
+}
+
+inline EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+// Returns the bits before they were cleared
+inline EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    EventBits_t previous = group->bits;
+    group->bits &= ~bits;
+    return previous;
+}
+
+inline EventBits_t xEventGroupGetBits(EventGroupHandle_t group) {
+    std::lock_guard<std::mutex> lock(group->mutex);
+    return group->bits;
+}
+
+// Returns the bits when the wait ended, before clear_on_exit cleared them
+inline EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear_on_exit,
+                                       BaseType_t wait_for_all, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(group->mutex);
+    auto satisfied = [&] {
+        return wait_for_all ? (group->bits & bits) == bits : (group->bits & bits) != 0;
+    };
+    if (ticks == portMAX_DELAY) {
+        group->changed.wait(lock, satisfied);
+    } else {
+        group->changed.wait_for(lock, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), satisfied);
+    }
+    EventBits_t result = group->bits;
+    if (clear_on_exit && satisfied()) {
+        group->bits &= ~bits;
+    }
+    return result;
+}
+
+#endif // HOST_STUB_FREERTOS_EVENT_GROUPS_H
@@ -0,0 +1,42 @@
+#ifndef HOST_STUB_FREERTOS_TASK_H
+#define HOST_STUB_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct tskTaskControlBlock* TaskHandle_t;
+
+#define tskNO_AFFINITY 0x7fffffff
+
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks * portTICK_PERIOD_MS));
+}
+
+#define taskYIELD() std::this_thread::yield()
+
+// Tasks run on detached threads, stack size, priority and core are ignored. The handle only
+// tells tasks apart, a task ends by returning after vTaskDelete(NULL).
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stack_depth,
+                                          void* arg, UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) {
+    static std::atomic<uintptr_t> next_handle{1};
+    std::thread(function, arg).detach();
+    if (handle != nullptr) {
+        *handle = reinterpret_cast<TaskHandle_t>(next_handle++);
+    }
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stack_depth, void* arg,
+                              UBaseType_t priority, TaskHandle_t* handle) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+inline void vTaskDelete(TaskHandle_t task) {
+}
+
+#endif // HOST_STUB_FREERTOS_TASK_H
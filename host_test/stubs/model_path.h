@@ -0,0 +1,26 @@
+#ifndef HOST_STUB_MODEL_PATH_H
+#define HOST_STUB_MODEL_PATH_H
+
+// No esp-sr models on host, the wake word finds none and stays off
+
+#define ESP_WN_PREFIX "wn"
+#define ESP_MN_PREFIX "mn"
+
+typedef struct {
+    char** model_name;
+    char** model_info;
+    int num;
+} srmodel_list_t;
+
+inline srmodel_list_t* esp_srmodel_init(const char* partition_label) {
+    return nullptr;
+}
+
+inline void esp_srmodel_deinit(srmodel_list_t* models) {
+}
+
+inline char* esp_srmodel_filter(srmodel_list_t* models, const char* keyword1, const char* keyword2) {
+    return nullptr;
+}
+
+#endif // HOST_STUB_MODEL_PATH_H
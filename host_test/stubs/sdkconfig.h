@@ -0,0 +1,8 @@
+#ifndef HOST_STUB_SDKCONFIG_H
+#define HOST_STUB_SDKCONFIG_H
+
+// No Kconfig on host, every boolean CONFIG_ option is off and the values use their defaults
+
+#define CONFIG_SOUND_PCM_CACHE_SIZE_KB 128
+
+#endif // HOST_STUB_SDKCONFIG_H
@@ -0,0 +1,15 @@
+#ifndef HOST_STUB_SETTINGS_H
+#define HOST_STUB_SETTINGS_H
+
+#include <string>
+
+// No NVS on host, reads return the default and writes are dropped
+class Settings {
+public:
+    Settings(const std::string& ns, bool read_write = false) {}
+
+    int GetInt(const std::string& key, int default_value = 0) { return default_value; }
+    void SetInt(const std::string& key, int value) {}
+};
+
+#endif // HOST_STUB_SETTINGS_H
@@ -0,0 +1,208 @@
+#include "host_test.h"
+#include "aec_clock_aligner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#define OUTPUT_RATE 24000
+#define INPUT_RATE 16000
+#define FRAME_MS 60
+#define FRAME_SAMPLES (OUTPUT_RATE * FRAME_MS / 1000)
+#define DMA_CHUNK_SAMPLES 240
+#define DMA_DESCRIPTORS 6
+#define MIC_CHUNK_SAMPLES 160
+#define UPLINK_SAMPLES (INPUT_RATE * FRAME_MS / 1000)
+#define STEP_US 100
+
+// Both I2S directions run off a crystal 0.1% slower than esp_timer, exaggerated so drift shows
+static const double kClockRatio = 0.999;
+
+struct Descriptor {
+    uint32_t timestamp;     // 0 for silence
+    int first_sample;       // Offset into its frame
+};
+
+struct DownlinkFrame {
+    int64_t available_us;
+    uint32_t timestamp;
+};
+
+/*
+ * Plays a downlink script through a model of the I2S DMA and captures the microphone at the
+ * drifting clock, feeding the aligner the same events as AudioService. The expected stamp of an
+ * uplink frame is what the model actually played when its first sample was captured.
+ */
+class AlignerSimulation {
+public:
+    explicit AlignerSimulation(std::vector<DownlinkFrame> downlink) : downlink_(std::move(downlink)) {
+        aligner_.Configure(OUTPUT_RATE, DMA_CHUNK_SAMPLES * DMA_DESCRIPTORS, DMA_CHUNK_SAMPLES, INPUT_RATE);
+    }
+
+    void Run(int64_t duration_us) {
+        for (int64_t now = 0; now < duration_us; now += STEP_US) {
+            StepPlayback(now);
+            StepCapture(now);
+        }
+    }
+
+    AecClockAligner aligner_;
+    int max_error_ms_ = 0;
+    int presence_mismatches_ = 0;   // Stamped while silent or the other way round
+    int compared_frames_ = 0;
+
+private:
+    std::vector<DownlinkFrame> downlink_;
+    size_t next_frame_ = 0;
+    bool writing_ = false;
+    int64_t write_start_us_ = 0;
+    int placed_ = 0;
+
+    // One descriptor plays while the others wait, a write blocks until it has placed every chunk
+    std::deque<Descriptor> pending_;
+    double next_load_us_ = 0;
+    std::vector<std::pair<double, Descriptor>> played_;
+
+    uint64_t captured_ = 0;
+    uint64_t mic_chunks_ = 0;
+    uint64_t uplink_frames_ = 0;
+
+    static double OutputDescriptorUs() { return DMA_CHUNK_SAMPLES * 1e6 / (OUTPUT_RATE * kClockRatio); }
+    static double InputSampleUs(uint64_t sample) { return sample * 1e6 / (INPUT_RATE * kClockRatio); }
+
+    void StepPlayback(int64_t now) {
+        if (now >= next_load_us_) {
+            Descriptor next = {0, 0};
+            if (!pending_.empty()) {
+                next = pending_.front();
+                pending_.pop_front();
+            }
+            played_.push_back({next_load_us_, next});
+            next_load_us_ += OutputDescriptorUs();
+        }
+
+        if (!writing_ && next_frame_ < downlink_.size() && downlink_[next_frame_].available_us <= now) {
+            writing_ = true;
+            write_start_us_ = now;
+            placed_ = 0;
+        }
+        while (writing_ && pending_.size() < DMA_DESCRIPTORS - 1) {
+            pending_.push_back({downlink_[next_frame_].timestamp, placed_ * DMA_CHUNK_SAMPLES});
+            if (++placed_ * DMA_CHUNK_SAMPLES == FRAME_SAMPLES) {
+                aligner_.OnPlaybackWrite(downlink_[next_frame_].timestamp, false, FRAME_SAMPLES, write_start_us_, now);
+                writing_ = false;
+                next_frame_++;
+            }
+        }
+    }
+
+    void StepCapture(int64_t now) {
+        // A chunk is read shortly after its last sample, the task wakes up with some jitter
+        uint64_t chunk_end = (mic_chunks_ + 1) * MIC_CHUNK_SAMPLES;
+        int64_t jitter_us = (mic_chunks_ * 37 % 20) * STEP_US;
+        if (now >= InputSampleUs(chunk_end - 1) + jitter_us) {
+            aligner_.OnCapture(MIC_CHUNK_SAMPLES, now);
+            captured_ = chunk_end;
+            mic_chunks_++;
+        }
+
+        // The processor hands out a frame two chunks after its last sample came in
+        while (captured_ >= (uplink_frames_ + 1) * UPLINK_SAMPLES + 2 * MIC_CHUNK_SAMPLES) {
+            uint32_t stamp = aligner_.StampUplinkFrame(UPLINK_SAMPLES);
+            uint32_t expected = Audible(InputSampleUs(uplink_frames_ * UPLINK_SAMPLES));
+            uplink_frames_++;
+            if ((stamp == 0) != (expected == 0)) {
+                presence_mismatches_++;
+            } else if (stamp != 0) {
+                int error_ms = std::abs((int32_t)(stamp - expected));
+                max_error_ms_ = std::max(max_error_ms_, error_ms);
+                compared_frames_++;
+            }
+        }
+    }
+
+    // Far-end timestamp plus offset of the sample playing at capture_us, 0 for silence
+    uint32_t Audible(double capture_us) const {
+        for (auto it = played_.rbegin(); it != played_.rend(); ++it) {
+            if (it->first <= capture_us) {
+                if (it->second.timestamp == 0) {
+                    return 0;
+                }
+                int sample = it->second.first_sample +
+                    (int)((capture_us - it->first) * OUTPUT_RATE * kClockRatio / 1e6);
+                return it->second.timestamp + sample * 1000 / OUTPUT_RATE;
+            }
+        }
+        return 0;
+    }
+};
+
+static uint32_t FrameTimestamp(int index) {
+    return 1000 + index * FRAME_MS;
+}
+
+TEST(StampsWithinOneFrameUnderClockDrift) {
+    std::vector<DownlinkFrame> downlink;
+    // A sentence decoded in one burst, so the writes wait for the DMA
+    for (int i = 0; i < 50; i++) {
+        downlink.push_back({200000, FrameTimestamp(i)});
+    }
+    // After a pause, one arriving in real time behind a three frame jitter buffer
+    for (int i = 50; i < 100; i++) {
+        downlink.push_back({5000000 + std::max(0, i - 52) * FRAME_MS * 1000, FrameTimestamp(i)});
+    }
+
+    AlignerSimulation sim(downlink);
+    sim.Run(9000000);
+
+    auto stats = sim.aligner_.GetStats();
+    printf("max error %d ms over %d frames, %d presence mismatches, %u corrections, max drift %d us\n",
+        sim.max_error_ms_, sim.compared_frames_, sim.presence_mismatches_, (unsigned)stats.corrections,
+        (int)stats.max_drift_us);
+    CHECK_EQ(stats.played_frames, 100u);
+    CHECK(sim.compared_frames_ >= 90);
+    CHECK(sim.max_error_ms_ <= FRAME_MS);
+    // Only the frames straddling the start or end of a sentence may disagree
+    CHECK(sim.presence_mismatches_ <= 4);
+    CHECK(stats.silent_frames > 0);
+}
+
+TEST(StampsByCaptureTimeOfFirstSample) {
+    AecClockAligner aligner;
+    aligner.Configure(OUTPUT_RATE, DMA_CHUNK_SAMPLES * DMA_DESCRIPTORS, DMA_CHUNK_SAMPLES, INPUT_RATE);
+    // From the first to the last sample of an uplink frame
+    const int64_t span_us = (int64_t)(UPLINK_SAMPLES - 1) * 1000000 / INPUT_RATE;
+
+    // Nothing captured yet
+    CHECK_EQ(aligner.StampUplinkFrame(UPLINK_SAMPLES), 0u);
+    aligner.ResetCapture();
+
+    // Written into an idle DMA, the frame plays from 100 ms to 160 ms
+    aligner.OnPlaybackWrite(FrameTimestamp(0), false, FRAME_SAMPLES, 100000, 100000);
+    aligner.OnCapture(UPLINK_SAMPLES, 90000 + span_us);
+    CHECK_EQ(aligner.StampUplinkFrame(UPLINK_SAMPLES), 0u);
+    aligner.OnCapture(UPLINK_SAMPLES, 120000 + span_us);
+    CHECK_EQ(aligner.StampUplinkFrame(UPLINK_SAMPLES), FrameTimestamp(0) + 20);
+
+    // A local sound is not far-end audio
+    aligner.ResetPlayback();
+    aligner.OnPlaybackWrite(FrameTimestamp(1), true, FRAME_SAMPLES, 300000, 300000);
+    aligner.OnCapture(UPLINK_SAMPLES, 320000 + span_us);
+    CHECK_EQ(aligner.StampUplinkFrame(UPLINK_SAMPLES), 0u);
+
+    // The server's first frame may carry timestamp 0, it is still far-end audio
+    aligner.ResetPlayback();
+    aligner.OnPlaybackWrite(0, false, FRAME_SAMPLES, 500000, 500000);
+    aligner.OnCapture(UPLINK_SAMPLES, 530000 + span_us);
+    CHECK_EQ(aligner.StampUplinkFrame(UPLINK_SAMPLES), 30u);
+
+    auto stats = aligner.GetStats();
+    CHECK_EQ(stats.stamped_frames, 2u);
+    CHECK_EQ(stats.silent_frames, 3u);
+}
+
+int main() {
+    return RunAllTests();
+}
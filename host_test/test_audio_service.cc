@@ -0,0 +1,127 @@
+#include "host_test.h"
+#include "audio_service.h"
+#include "file_audio_codec.h"
+
+#include <esp_timer.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+/*
+ * Runs AudioService on its FreeRTOS tasks over FileAudioCodec, unpaced. Without libopus the
+ * host opus wrappers pack raw PCM, so the uplink payloads can be compared with the input.
+ */
+
+#define INPUT_FRAMES 20
+#define FRAME_SAMPLES 960
+
+static std::string TempPath(const char* name) {
+    return std::string(HOST_TEST_OUTPUT_DIR "/") + name;
+}
+
+static std::vector<int16_t> WriteInputWav(const std::string& path) {
+    std::vector<int16_t> samples(INPUT_FRAMES * FRAME_SAMPLES);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int16_t)(i * 13);
+    }
+    uint32_t data_bytes = samples.size() * sizeof(int16_t);
+    uint32_t header[11] = {0x46464952, 36 + data_bytes, 0x45564157, 0x20746d66, 16, 0x00010001, 16000, 32000,
+        0x00100002, 0x61746164, data_bytes};
+    FILE* f = fopen(path.c_str(), "wb");
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(samples.data(), sizeof(int16_t), samples.size(), f);
+    fclose(f);
+    return samples;
+}
+
+// Samples in the data chunk of a WAV written by FileAudioCodec
+static long WavSamples(const std::string& path) {
+    FILE* f = fopen(path.c_str(), "rb");
+    uint32_t header[11] = {};
+    fread(header, sizeof(header), 1, f);
+    fclose(f);
+    return header[10] / sizeof(int16_t);
+}
+
+// Stop the tasks and give them time to leave before the service goes away
+static void StopService(AudioService& service) {
+    service.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+}
+
+TEST(EncodesMicrophoneFramesInOrder) {
+    auto input = WriteInputWav(TempPath("service_mic.wav"));
+    FileAudioCodec codec(TempPath("service_mic.wav").c_str(), TempPath("service_uplink_out.wav").c_str(), 24000, 0);
+    Board::GetInstance().SetAudioCodec(&codec);
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    std::vector<std::unique_ptr<AudioStreamPacket>> packets;
+    int64_t deadline_us = esp_timer_get_time() + 5000000;
+    while (packets.size() < INPUT_FRAMES && esp_timer_get_time() < deadline_us) {
+        auto packet = service.PopPacketFromSendQueue();
+        if (packet) {
+            packets.push_back(std::move(packet));
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    StopService(service);
+
+    CHECK_EQ(packets.size(), (size_t)INPUT_FRAMES);
+    for (auto& packet : packets) {
+        CHECK_EQ(packet->sample_rate, 16000);
+        CHECK_EQ(packet->frame_duration, OPUS_FRAME_DURATION_MS);
+        CHECK(!packet->payload.empty());
+    }
+#if !HOST_HAVE_OPUS
+    int mismatches = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        CHECK_EQ(packets[i]->payload.size(), FRAME_SAMPLES * sizeof(int16_t));
+        mismatches += memcmp(packets[i]->payload.data(), input.data() + i * FRAME_SAMPLES,
+            FRAME_SAMPLES * sizeof(int16_t)) != 0;
+    }
+    CHECK_EQ(mismatches, 0);
+#endif
+}
+
+TEST(PlaysDownlinkPacketsResampled) {
+    const int packets = 10;
+    {
+        FileAudioCodec codec(TempPath("service_no_mic.wav").c_str(), TempPath("service_downlink_out.wav").c_str(), 24000, 0);
+        Board::GetInstance().SetAudioCodec(&codec);
+        AudioService service;
+        service.Initialize(&codec);
+        service.Start();
+
+        OpusEncoderWrapper encoder(16000, 1, OPUS_FRAME_DURATION_MS);
+        for (int i = 0; i < packets; i++) {
+            auto packet = AudioStreamPacket::Acquire();
+            packet->sample_rate = 16000;
+            packet->frame_duration = OPUS_FRAME_DURATION_MS;
+            packet->timestamp = 0;
+            // A server may count from 0, which must not be taken for a local sound
+            packet->sequence = i;
+            CHECK(encoder.Encode(std::vector<int16_t>(FRAME_SAMPLES, 1000), packet->payload));
+            CHECK(service.PushPacketToDecodeQueue(std::move(packet), true));
+        }
+
+        // The jitter buffer starts playing once its start deadline passes
+        int64_t deadline_us = esp_timer_get_time() + 5000000;
+        while (!service.IsIdle() && esp_timer_get_time() < deadline_us) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        CHECK(service.IsIdle());
+        StopService(service);
+    }
+    // Every 16 kHz frame comes out at the 24 kHz output rate
+    CHECK_EQ(WavSamples(TempPath("service_downlink_out.wav")), (long)packets * FRAME_SAMPLES * 3 / 2);
+}
+
+int main() {
+    return RunAllTests();
+}
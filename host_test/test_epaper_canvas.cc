@@ -0,0 +1,177 @@
+#include "host_test.h"
+#include "epaper_canvas.h"
+#include "epaper_image.h"
+
+#include <esp_timer.h>
+#include <cstdio>
+#include <random>
+#include <string>
+
+/*
+ * EpaperCanvas on the GxEPD2_290_T5D geometry in every rotation: clipped drawing must equal the
+ * unclipped drawing masked to the window, and the changes found against the pushed frame must
+ * lie inside the native window RefreshRetained writes. The scenes are written as PBM files.
+ *
+ * The built-in pages themselves are not rendered here: they draw their text through
+ * U8g2_for_Adafruit_GFX and need EpaperDisplay, which the host build does not have.
+ */
+
+#define NATIVE_WIDTH 128
+#define NATIVE_HEIGHT 296
+// GxEPD_BLACK and GxEPD_WHITE
+#define BLACK 0x0000
+#define WHITE 0xFFFF
+
+static EpaperRect Rect(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+    EpaperRect rect;
+    rect.x = x;
+    rect.y = y;
+    rect.w = w;
+    rect.h = h;
+    return rect;
+}
+
+// The home page without its text: dividers, status icons and the fridge icons
+static void DrawScene(Adafruit_GFX& gfx) {
+    for (int offset = 0; offset < 2; offset++) {
+        gfx.drawLine(10, 29 + offset, 286, 29 + offset, BLACK);
+        gfx.drawLine(189 + offset, 35, 189 + offset, 120, BLACK);
+    }
+    gfx.drawLine(10, 100, 150, 100, BLACK);
+    gfx.drawLine(20, 120, 150, 40, BLACK);
+    gfx.drawBitmap(270, 0, EpaperImage::battery_full_24x24, 24, 24, BLACK, WHITE);
+    gfx.drawBitmap(240, 0, EpaperImage::wifi_full_24x24, 24, 24, BLACK, WHITE);
+    gfx.drawBitmap(200, 35, EpaperImage::Fridge_24x24, 24, 24, BLACK, WHITE);
+    gfx.drawBitmap(200, 65, EpaperImage::Fridge_category_24x24, 24, 24, BLACK, WHITE);
+    gfx.drawBitmap(200, 95, EpaperImage::Fridge_warning_24x24, 24, 24, BLACK, WHITE);
+    gfx.drawRect(5, 40, 150, 45, BLACK);
+}
+
+static bool LogicalPixel(const GFXcanvas1& canvas, uint8_t rotation, int16_t x, int16_t y) {
+    int16_t t;
+    switch (rotation) {
+        case 1: t = x; x = NATIVE_WIDTH - 1 - y; y = t; break;
+        case 2: x = NATIVE_WIDTH - 1 - x; y = NATIVE_HEIGHT - 1 - y; break;
+        case 3: t = x; x = y; y = NATIVE_HEIGHT - 1 - t; break;
+    }
+    return canvas.getBuffer()[x / 8 + y * (NATIVE_WIDTH / 8)] & (0x80 >> (x & 7));
+}
+
+// Binary PBM, 1 is black there and white in the frame buffer
+static void WritePbm(const std::string& path, const GFXcanvas1& canvas, uint8_t rotation) {
+    int width = (rotation & 1) ? NATIVE_HEIGHT : NATIVE_WIDTH;
+    int height = (rotation & 1) ? NATIVE_WIDTH : NATIVE_HEIGHT;
+    FILE* f = fopen(path.c_str(), "wb");
+    fprintf(f, "P4\n%d %d\n", width, height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x += 8) {
+            uint8_t byte = 0;
+            for (int bit = 0; bit < 8 && x + bit < width; bit++) {
+                if (!LogicalPixel(canvas, rotation, x + bit, y)) {
+                    byte |= 0x80 >> bit;
+                }
+            }
+            fputc(byte, f);
+        }
+    }
+    fclose(f);
+}
+
+// Differences between the canvas and the scene drawn without clipping, kept only inside rect
+static int CompareWithMaskedScene(const EpaperCanvas& canvas, uint8_t rotation, const EpaperRect& rect) {
+    GFXcanvas1 reference(NATIVE_WIDTH, NATIVE_HEIGHT);
+    reference.setRotation(rotation);
+    reference.fillScreen(WHITE);
+    DrawScene(reference);
+
+    int differences = 0;
+    for (int16_t y = 0; y < canvas.height(); y++) {
+        for (int16_t x = 0; x < canvas.width(); x++) {
+            bool inside = x >= rect.x && x < rect.right() && y >= rect.y && y < rect.bottom();
+            bool expected = inside ? LogicalPixel(reference, rotation, x, y) : true;
+            differences += LogicalPixel(canvas, rotation, x, y) != expected;
+        }
+    }
+    return differences;
+}
+
+static bool Contains(const EpaperRect& outer, const EpaperRect& inner) {
+    return inner.x >= outer.x && inner.right() <= outer.right() && inner.y >= outer.y &&
+           inner.bottom() <= outer.bottom();
+}
+
+TEST(StartsWhiteWithNothingToPush) {
+    EpaperCanvas canvas(NATIVE_WIDTH, NATIVE_HEIGHT);
+    CHECK(canvas.valid());
+    CHECK(canvas.FindChanges(canvas.NativeScreen()).empty());
+}
+
+TEST(ClippedWindowsOnlyChangeInsideTheirNativeWindow) {
+    std::mt19937 rng(3);
+    int failures = 0;
+    for (uint8_t rotation = 0; rotation < 4; rotation++) {
+        for (int i = 0; i < 25; i++) {
+            EpaperCanvas canvas(NATIVE_WIDTH, NATIVE_HEIGHT);
+            canvas.setRotation(rotation);
+            EpaperRect rect = Rect(rng() % canvas.width(), rng() % canvas.height(), 1 + rng() % 120, 1 + rng() % 60);
+
+            // What RefreshRetained does for one dirty window
+            canvas.SetClip(rect);
+            canvas.fillRect(rect.x, rect.y, rect.w, rect.h, WHITE);
+            DrawScene(canvas);
+            canvas.ResetClip();
+
+            failures += CompareWithMaskedScene(canvas, rotation, rect) != 0;
+            EpaperRect native = canvas.ToNative(rect);
+            failures += native.x % 8 != 0 || native.w % 8 != 0;
+            EpaperRect changed = canvas.FindChanges(canvas.NativeScreen());
+            failures += !changed.empty() && !Contains(native, changed);
+            failures += changed.x % 8 != 0 || changed.w % 8 != 0;
+            // Once pushed, the same window has nothing left to send
+            canvas.MarkPushed(changed);
+            failures += !canvas.FindChanges(canvas.NativeScreen()).empty();
+        }
+    }
+    CHECK_EQ(failures, 0);
+}
+
+TEST(FindsTheChangedBytesOfOnePixel) {
+    for (uint8_t rotation = 0; rotation < 4; rotation++) {
+        EpaperCanvas canvas(NATIVE_WIDTH, NATIVE_HEIGHT);
+        canvas.setRotation(rotation);
+        canvas.drawPixel(37, 21, BLACK);
+        EpaperRect changed = canvas.FindChanges(canvas.NativeScreen());
+        EpaperRect native = canvas.ToNative(Rect(37, 21, 1, 1));
+        CHECK_EQ(changed.w, 8);
+        CHECK_EQ(changed.h, 1);
+        CHECK_EQ(changed.x, native.x);
+        CHECK_EQ(changed.y, native.y);
+        // Changes outside the searched window are not reported
+        EpaperRect elsewhere = canvas.ToNative(Rect(100, 100, 20, 20));
+        CHECK(canvas.FindChanges(elsewhere).empty());
+    }
+}
+
+TEST(RendersTheSceneInEveryRotation) {
+    for (uint8_t rotation = 0; rotation < 4; rotation++) {
+        EpaperCanvas canvas(NATIVE_WIDTH, NATIVE_HEIGHT);
+        canvas.setRotation(rotation);
+        int64_t start_us = esp_timer_get_time();
+        canvas.fillScreen(WHITE);
+        DrawScene(canvas);
+        int64_t render_us = esp_timer_get_time() - start_us;
+        EpaperRect changed = canvas.FindChanges(canvas.NativeScreen());
+        int64_t diff_us = esp_timer_get_time() - start_us - render_us;
+        CHECK(!changed.empty());
+        CHECK_EQ(CompareWithMaskedScene(canvas, rotation, Rect(0, 0, canvas.width(), canvas.height())), 0);
+
+        std::string path = std::string(HOST_TEST_OUTPUT_DIR "/epaper_rotation_") + std::to_string(rotation) + ".pbm";
+        WritePbm(path, canvas, rotation);
+        printf("rotation %d: render %lld us, diff %lld us, changed %dx%d native, %s\n", rotation,
+            (long long)render_us, (long long)diff_us, changed.w, changed.h, path.c_str());
+    }
+}
+
+int main() {
+    return RunAllTests();
+}
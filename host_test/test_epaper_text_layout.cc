@@ -0,0 +1,64 @@
+#include "host_test.h"
+#include "legacy_text_wrap.h"
+
+#include <random>
+#include <string>
+
+/*
+ * EpaperTextLayout against the line breaker it replaced, on random mixes of ASCII, CJK, emoji,
+ * newlines and a truncated sequence, in every alignment. The host U8g2 stub's fonts are four
+ * bytes: ASCII advance and width, then CJK advance and width.
+ */
+
+static const uint8_t kFont12[] = {6, 5, 12, 11};
+static const uint8_t kFont16[] = {8, 7, 16, 15};
+
+TEST(MatchesTheOldBreakerOnRandomText) {
+    const char* const pieces[] = {"a", "i", " ", "7", "\xe4\xb8\xad", "\xe6\x96\x87", "\xef\xbc\x8c", "\n",
+        "\xc3\xa9", "\xf0\x9f\x98\x80", "\xe4"};
+    const EpaperTextAlign aligns[] = {EpaperTextAlign::LEFT, EpaperTextAlign::CENTER, EpaperTextAlign::RIGHT};
+    std::mt19937 rng(1);
+    U8G2_FOR_ADAFRUIT_GFX u8g2;
+    EpaperTextLayout layout(u8g2);
+    std::vector<EpaperTextLine> expected;
+    int mismatches = 0;
+    for (int i = 0; i < 3000; i++) {
+        std::string text;
+        int count = rng() % 80;
+        for (int j = 0; j < count; j++) {
+            text += pieces[rng() % (sizeof(pieces) / sizeof(pieces[0]))];
+        }
+        const uint8_t* font = i % 2 ? kFont12 : kFont16;
+        uint16_t w_max = 10 + rng() % 190;
+        EpaperTextAlign align = aligns[i % 3];
+
+        u8g2.setFont(font);
+        LegacyBreakLines(u8g2, String(text.c_str()), w_max, align, expected);
+        mismatches += !SameLines(layout.Layout(String(text.c_str()), font, w_max, align), expected);
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+TEST(MeasuresEachGlyphOnce) {
+    U8G2_FOR_ADAFRUIT_GFX u8g2;
+    u8g2.setFont(kFont12);
+    EpaperTextLayout layout(u8g2);
+    // 600 copies of one CJK character: one measurement of the glyph alone and one of it twice
+    std::string text;
+    for (int i = 0; i < 600; i++) {
+        text += "\xe4\xb8\xad";
+    }
+    const auto& lines = layout.Layout(String(text.c_str()), kFont12, 192, EpaperTextAlign::LEFT);
+    CHECK_EQ(u8g2.width_calls(), 2u);
+    CHECK_EQ(lines.size(), (size_t)(600 / 16 + 1));
+    CHECK_EQ(lines[0].width, 16 * 12 - 1);
+
+    // The same layout again comes from the cache
+    layout.Layout(String(text.c_str()), kFont12, 192, EpaperTextAlign::LEFT);
+    CHECK_EQ(layout.hits(), 1u);
+    CHECK_EQ(layout.misses(), 1u);
+}
+
+int main() {
+    return RunAllTests();
+}
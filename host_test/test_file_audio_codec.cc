@@ -0,0 +1,156 @@
+#include "host_test.h"
+#include "file_audio_codec.h"
+
+#include <esp_timer.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+static std::string TempPath(const char* name) {
+    return std::string(HOST_TEST_OUTPUT_DIR "/") + name;
+}
+
+static void WriteWav(const std::string& path, int sample_rate, int channels, const std::vector<int16_t>& samples) {
+    FILE* f = fopen(path.c_str(), "wb");
+    uint32_t data_bytes = samples.size() * sizeof(int16_t);
+    uint32_t riff_size = 36 + data_bytes;
+    uint32_t fmt_size = 16;
+    uint16_t format = 1;
+    uint16_t wav_channels = channels;
+    uint32_t rate = sample_rate;
+    uint32_t byte_rate = sample_rate * channels * 2;
+    uint16_t block_align = channels * 2;
+    uint16_t bits = 16;
+    fwrite("RIFF", 1, 4, f);
+    fwrite(&riff_size, 4, 1, f);
+    fwrite("WAVE", 1, 4, f);
+    // A LIST chunk before fmt, as some recorders write
+    uint32_t list_size = 3;
+    fwrite("LIST", 1, 4, f);
+    fwrite(&list_size, 4, 1, f);
+    fwrite("abc\0", 1, 4, f);
+    fwrite("fmt ", 1, 4, f);
+    fwrite(&fmt_size, 4, 1, f);
+    fwrite(&format, 2, 1, f);
+    fwrite(&wav_channels, 2, 1, f);
+    fwrite(&rate, 4, 1, f);
+    fwrite(&byte_rate, 4, 1, f);
+    fwrite(&block_align, 2, 1, f);
+    fwrite(&bits, 2, 1, f);
+    fwrite("data", 1, 4, f);
+    fwrite(&data_bytes, 4, 1, f);
+    fwrite(samples.data(), sizeof(int16_t), samples.size(), f);
+    fclose(f);
+}
+
+static std::vector<int16_t> Ramp(size_t samples) {
+    std::vector<int16_t> ramp(samples);
+    for (size_t i = 0; i < samples; i++) {
+        ramp[i] = (int16_t)(i * 7 - 1000);
+    }
+    return ramp;
+}
+
+TEST(ReadsStereoInputThenSilence) {
+    auto input = Ramp(2 * 1600);
+    WriteWav(TempPath("stereo_in.wav"), 16000, 2, input);
+
+    FileAudioCodec codec(TempPath("stereo_in.wav").c_str(), TempPath("stereo_out.wav").c_str(), 24000, 0);
+    CHECK_EQ(codec.input_sample_rate(), 16000);
+    CHECK_EQ(codec.input_channels(), 2);
+    CHECK(codec.input_reference());
+    CHECK_EQ(codec.output_sample_rate(), 24000);
+    codec.Start();
+
+    std::vector<int16_t> chunk(2 * 1000);
+    CHECK(codec.InputData(chunk));
+    CHECK(memcmp(chunk.data(), input.data(), chunk.size() * sizeof(int16_t)) == 0);
+    CHECK_EQ(codec.remaining_input_samples(), (long)(input.size() - chunk.size()));
+
+    // The file ends inside this chunk, the rest is silence
+    CHECK(codec.InputData(chunk));
+    size_t left = input.size() - chunk.size();
+    CHECK(memcmp(chunk.data(), input.data() + chunk.size(), left * sizeof(int16_t)) == 0);
+    bool silent = true;
+    for (size_t i = left; i < chunk.size(); i++) {
+        silent = silent && chunk[i] == 0;
+    }
+    CHECK(silent);
+    CHECK_EQ(codec.remaining_input_samples(), 0);
+}
+
+TEST(LoopsInput) {
+    auto input = Ramp(500);
+    WriteWav(TempPath("loop_in.wav"), 16000, 1, input);
+
+    FileAudioCodec codec(TempPath("loop_in.wav").c_str(), TempPath("loop_out.wav").c_str(), 16000, 0, true);
+    codec.Start();
+    std::vector<int16_t> chunk(1200);
+    CHECK(codec.InputData(chunk));
+    CHECK_EQ(chunk[0], input[0]);
+    CHECK_EQ(chunk[500], input[0]);
+    CHECK_EQ(chunk[1199], input[199]);
+    CHECK_EQ(codec.remaining_input_samples(), -1);
+}
+
+TEST(WritesPlayableOutput) {
+    auto playback = Ramp(3000);
+    {
+        FileAudioCodec codec("/nonexistent.wav", TempPath("playback.wav").c_str(), 24000, 0);
+        // Missing input keeps the pipeline running on silence
+        CHECK_EQ(codec.input_sample_rate(), 16000);
+        CHECK_EQ(codec.remaining_input_samples(), 0);
+        codec.Start();
+        std::vector<int16_t> frame(playback.begin(), playback.begin() + 1440);
+        codec.OutputData(frame);
+        frame.assign(playback.begin() + 1440, playback.end());
+        codec.OutputData(frame);
+    }
+
+    FILE* f = fopen(TempPath("playback.wav").c_str(), "rb");
+    CHECK(f != nullptr);
+    uint8_t header[44];
+    CHECK_EQ(fread(header, 1, sizeof(header), f), sizeof(header));
+    uint32_t sample_rate, data_size;
+    memcpy(&sample_rate, header + 24, 4);
+    memcpy(&data_size, header + 40, 4);
+    CHECK(memcmp(header, "RIFF", 4) == 0);
+    CHECK_EQ(sample_rate, 24000u);
+    CHECK_EQ(data_size, (uint32_t)(playback.size() * sizeof(int16_t)));
+    std::vector<int16_t> written(playback.size());
+    CHECK_EQ(fread(written.data(), sizeof(int16_t), written.size(), f), written.size());
+    CHECK(written == playback);
+    fclose(f);
+}
+
+TEST(PacesToTheSpeedUpClock) {
+    // 400 ms of audio at speed 4 takes about 100 ms
+    WriteWav(TempPath("paced_in.wav"), 16000, 1, Ramp(6400));
+    FileAudioCodec codec(TempPath("paced_in.wav").c_str(), TempPath("paced_out.wav").c_str(), 16000, 4);
+    codec.Start();
+    std::vector<int16_t> chunk(320);
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < 20; i++) {
+        codec.InputData(chunk);
+    }
+    int64_t elapsed_ms = (esp_timer_get_time() - start_us) / 1000;
+    CHECK(elapsed_ms >= 95);
+    CHECK(elapsed_ms < 200);
+}
+
+TEST(UnpacedStillBlocksEveryCall) {
+    WriteWav(TempPath("unpaced_in.wav"), 16000, 1, Ramp(1600));
+    FileAudioCodec codec(TempPath("unpaced_in.wav").c_str(), TempPath("unpaced_out.wav").c_str(), 16000, 0);
+    codec.Start();
+    std::vector<int16_t> chunk(16);
+    int64_t start_us = esp_timer_get_time();
+    for (int i = 0; i < 10; i++) {
+        codec.InputData(chunk);
+    }
+    // Each read gives up at least one 1 ms tick, so the audio tasks cannot starve lower priority ones
+    CHECK(esp_timer_get_time() - start_us >= 10 * 1000);
+}
+
+int main() {
+    return RunAllTests();
+}
@@ -0,0 +1,203 @@
+#include "host_test.h"
+#include "jitter_buffer.h"
+
+#define FRAME_MS 60
+#define FRAME_US (FRAME_MS * 1000)
+
+static std::unique_ptr<AudioStreamPacket> MakePacket(uint32_t sequence) {
+    auto packet = std::make_unique<AudioStreamPacket>();
+    packet->sample_rate = 16000;
+    packet->frame_duration = FRAME_MS;
+    packet->sequence = sequence;
+    packet->timestamp = sequence * FRAME_MS;
+    return packet;
+}
+
+// Get() one frame, returns the sequence played, 0 for a concealed frame and -1 when not ready
+static long GetFrame(JitterBuffer& buffer, int64_t now_us) {
+    std::unique_ptr<AudioStreamPacket> packet;
+    switch (buffer.Get(packet, now_us)) {
+    case JitterBuffer::kPacket:
+        return packet->sequence;
+    case JitterBuffer::kMissing:
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+TEST(PrefillsToMinDepthThenPlaysInOrder) {
+    JitterBuffer buffer(16, 3, 8);
+    CHECK(buffer.Idle());
+    buffer.Put(MakePacket(1), 0);
+    CHECK(!buffer.Idle());
+    CHECK_EQ(GetFrame(buffer, 0), -1);
+    buffer.Put(MakePacket(2), FRAME_US);
+    CHECK_EQ(GetFrame(buffer, FRAME_US), -1);
+    buffer.Put(MakePacket(3), 2 * FRAME_US);
+    CHECK_EQ(GetFrame(buffer, 2 * FRAME_US), 1);
+    CHECK_EQ(GetFrame(buffer, 3 * FRAME_US), 2);
+    CHECK_EQ(GetFrame(buffer, 4 * FRAME_US), 3);
+
+    // Ran dry while playing, an underrun once the stream turns out to go on
+    CHECK_EQ(GetFrame(buffer, 5 * FRAME_US), -1);
+    CHECK(buffer.Idle());
+    CHECK_EQ(buffer.GetStats().underruns, 0u);
+    buffer.Put(MakePacket(4), 5 * FRAME_US + 1000);
+    CHECK_EQ(buffer.GetStats().underruns, 1u);
+}
+
+TEST(EndOfStreamIsNotAnUnderrun) {
+    JitterBuffer buffer(16, 1, 8);
+    buffer.Put(MakePacket(1), 0);
+    CHECK_EQ(GetFrame(buffer, 0), 1);
+    CHECK_EQ(GetFrame(buffer, FRAME_US), -1);
+    // The next sentence continues the sequence long after the last one ended
+    buffer.Put(MakePacket(2), 20 * FRAME_US);
+    CHECK_EQ(GetFrame(buffer, 20 * FRAME_US), 2);
+    CHECK_EQ(buffer.GetStats().underruns, 0u);
+}
+
+TEST(StartsAfterTargetDepthWorthOfWaiting) {
+    JitterBuffer buffer(16, 3, 8);
+    buffer.Put(MakePacket(7), 0);
+    CHECK_EQ(GetFrame(buffer, 3 * FRAME_US - 1), -1);
+    CHECK_EQ(GetFrame(buffer, 3 * FRAME_US), 7);
+}
+
+TEST(ReordersBeforePlaybackStarts) {
+    JitterBuffer buffer(16, 2, 8);
+    buffer.Put(MakePacket(2), 0);
+    buffer.Put(MakePacket(1), 1000);
+    CHECK_EQ(GetFrame(buffer, 2000), 1);
+    CHECK_EQ(GetFrame(buffer, 2000 + FRAME_US), 2);
+}
+
+TEST(LatePacketAfterUnderrunDoesNotRewind) {
+    JitterBuffer buffer(16, 1, 8);
+    buffer.Put(MakePacket(8), 0);
+    buffer.Put(MakePacket(10), 2 * FRAME_US);
+    CHECK_EQ(GetFrame(buffer, 2 * FRAME_US), 8);
+    CHECK_EQ(GetFrame(buffer, 2 * FRAME_US), 0);
+    CHECK_EQ(GetFrame(buffer, 2 * FRAME_US), 10);
+    CHECK_EQ(GetFrame(buffer, 3 * FRAME_US), -1);
+
+    // 9 was already concealed, it must not be played after 10
+    CHECK(!buffer.Put(MakePacket(9), 3 * FRAME_US + 1000));
+    CHECK(buffer.Put(MakePacket(11), 3 * FRAME_US + 2000));
+    CHECK_EQ(GetFrame(buffer, 6 * FRAME_US), 11);
+    auto stats = buffer.GetStats();
+    CHECK_EQ(stats.late_packets, 1u);
+    CHECK_EQ(stats.underruns, 1u);
+    CHECK_EQ(stats.concealed_frames, 1u);
+}
+
+TEST(ConcealsReorderedFrameAfterUnderrun) {
+    JitterBuffer buffer(16, 1, 8);
+    buffer.Put(MakePacket(1), 0);
+    CHECK_EQ(GetFrame(buffer, 0), 1);
+    CHECK_EQ(GetFrame(buffer, FRAME_US), -1);
+
+    // 3 overtook 2, once the rebuffering deadline passes 2 is concealed rather than skipped
+    buffer.Put(MakePacket(3), FRAME_US + 1000);
+    CHECK_EQ(GetFrame(buffer, 4 * FRAME_US), 0);
+    CHECK_EQ(GetFrame(buffer, 4 * FRAME_US), 3);
+    CHECK(!buffer.Put(MakePacket(2), 4 * FRAME_US + 1000));
+    CHECK_EQ(buffer.GetStats().concealed_frames, 1u);
+}
+
+TEST(JitterEstimateSurvivesUnderruns) {
+    JitterBuffer buffer(16, 1, 6);
+    // Drained as soon as each packet arrives, as by the decoder ahead of the playback queue, so it
+    // keeps running dry. Every other packet is 40 ms late
+    for (uint32_t i = 0; i < 32; i++) {
+        int64_t arrival_us = i * FRAME_US + (i % 2) * 40000;
+        buffer.Put(MakePacket(i + 1), arrival_us);
+        while (GetFrame(buffer, arrival_us) >= 0) {
+        }
+    }
+    auto stats = buffer.GetStats();
+    CHECK(stats.jitter_ms > 0);
+    CHECK(stats.target_depth > 1);
+}
+
+TEST(ConcealsSingleLoss) {
+    JitterBuffer buffer(16, 3, 8);
+    buffer.Put(MakePacket(1), 0);
+    buffer.Put(MakePacket(2), 0);
+    buffer.Put(MakePacket(4), 0);
+    CHECK_EQ(GetFrame(buffer, 0), 1);
+    CHECK_EQ(GetFrame(buffer, 0), 2);
+    CHECK_EQ(GetFrame(buffer, 0), 0);
+    CHECK_EQ(GetFrame(buffer, 0), 4);
+    CHECK_EQ(buffer.GetStats().concealed_frames, 1u);
+}
+
+TEST(SkipsAheadAfterConsecutiveLosses) {
+    JitterBuffer buffer(16, 1, 8);
+    buffer.Put(MakePacket(1), 0);
+    buffer.Put(MakePacket(10), 0);
+    // Both arrived at once, the jitter raised the target depth, play after the start deadline
+    int64_t now_us = 8 * FRAME_US;
+    CHECK_EQ(GetFrame(buffer, now_us), 1);
+    CHECK_EQ(GetFrame(buffer, now_us), 0);
+    CHECK_EQ(GetFrame(buffer, now_us), 0);
+    CHECK_EQ(GetFrame(buffer, now_us), 0);
+    CHECK_EQ(GetFrame(buffer, now_us), 10);
+    CHECK_EQ(buffer.GetStats().concealed_frames, 3u);
+}
+
+TEST(DropsLateAndDuplicatePackets) {
+    JitterBuffer buffer(16, 1, 8);
+    CHECK(buffer.Put(MakePacket(1), 0));
+    CHECK(buffer.Put(MakePacket(2), 0));
+    CHECK(!buffer.Put(MakePacket(2), 0));
+    CHECK_EQ(GetFrame(buffer, 0), 1);
+    CHECK(!buffer.Put(MakePacket(1), 0));
+    auto stats = buffer.GetStats();
+    CHECK_EQ(stats.dropped_packets, 1u);
+    CHECK_EQ(stats.late_packets, 1u);
+    CHECK_EQ(stats.depth, 1u);
+}
+
+TEST(DropsPacketsTooFarAhead) {
+    JitterBuffer buffer(4, 1, 4);
+    CHECK(buffer.Put(MakePacket(1), 0));
+    CHECK(!buffer.Put(MakePacket(5), 0));
+    CHECK(buffer.Put(MakePacket(4), 0));
+    CHECK(buffer.Full() == false);
+}
+
+TEST(TargetDepthFollowsJitter) {
+    JitterBuffer buffer(32, 1, 6);
+    // Packets arrive in bursts of two every two frames
+    for (uint32_t i = 0; i < 32; i++) {
+        int64_t arrival_us = (i / 2) * 2 * FRAME_US;
+        buffer.Put(MakePacket(i + 1), arrival_us);
+        std::unique_ptr<AudioStreamPacket> packet;
+        buffer.Get(packet, arrival_us);
+    }
+    auto stats = buffer.GetStats();
+    CHECK(stats.jitter_ms > 0);
+    CHECK(stats.target_depth > 1);
+    CHECK(stats.target_depth <= 6);
+}
+
+TEST(ResetStartsNewStream) {
+    JitterBuffer buffer(16, 1, 8);
+    buffer.Put(MakePacket(100), 0);
+    buffer.Put(MakePacket(101), 0);
+    buffer.Reset();
+    CHECK(buffer.Empty());
+    CHECK(buffer.Idle());
+    CHECK_EQ(GetFrame(buffer, 0), -1);
+    // The jitter estimate survives the reset
+    CHECK(buffer.GetStats().target_depth > 1);
+    buffer.Put(MakePacket(5), FRAME_US);
+    CHECK_EQ(GetFrame(buffer, FRAME_US), -1);
+    CHECK_EQ(GetFrame(buffer, 9 * FRAME_US), 5);
+}
+
+int main() {
+    return RunAllTests();
+}
@@ -0,0 +1,105 @@
+#include "host_test.h"
+#include "multi_channel_resampler.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+/*
+ * Compares MultiChannelResampler with one independent OpusResampler per channel fed the
+ * deinterleaved input, over blocks of varying size so the per-channel state carries across calls.
+ */
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+static std::vector<int16_t> Noise(size_t samples, unsigned seed) {
+    std::vector<int16_t> noise(samples);
+    std::mt19937 rng(seed);
+    for (auto& sample : noise) {
+        sample = (int16_t)(rng() & 0xffff);
+    }
+    return noise;
+}
+
+// Returns the number of output samples that differ from the per-channel reference
+static int CompareWithReference(int input_rate, int output_rate, int channels) {
+    MultiChannelResampler resampler;
+    resampler.Configure(input_rate, output_rate, channels);
+    std::vector<OpusResampler> reference(channels);
+    for (auto& channel : reference) {
+        channel.Configure(input_rate, output_rate);
+    }
+
+    int mismatches = 0;
+    const int block_frames[] = {input_rate / 100, input_rate / 50, input_rate * 3 / 50, input_rate / 100};
+    unsigned seed = 1;
+    for (int frames : block_frames) {
+        auto input = Noise(frames * channels, seed++);
+        std::vector<int16_t> output(resampler.GetOutputFrames(frames) * channels);
+        int output_frames = resampler.Process(input.data(), frames, output.data());
+        if (output_frames * channels != (int)output.size()) {
+            mismatches++;
+            continue;
+        }
+
+        std::vector<int16_t> plane(frames);
+        std::vector<int16_t> expected(reference[0].GetOutputSamples(frames));
+        for (int c = 0; c < channels; c++) {
+            for (int i = 0; i < frames; i++) {
+                plane[i] = input[i * channels + c];
+            }
+            reference[c].Process(plane.data(), frames, expected.data());
+            for (int i = 0; i < output_frames; i++) {
+                mismatches += output[i * channels + c] != expected[i];
+            }
+        }
+    }
+    return mismatches;
+}
+
+TEST(MatchesIndependentResamplersPerChannel) {
+    for (int channels = 1; channels <= 3; channels++) {
+        CHECK_EQ(CompareWithReference(24000, 16000, channels), 0);
+        CHECK_EQ(CompareWithReference(48000, 16000, channels), 0);
+        CHECK_EQ(CompareWithReference(8000, 16000, channels), 0);
+    }
+}
+
+TEST(DoesNotAllocateOnceSized) {
+    MultiChannelResampler resampler;
+    resampler.Configure(24000, 16000, 2);
+    const int frames = 24000 * 60 / 1000;
+    auto input = Noise(frames * 2, 9);
+    std::vector<int16_t> output(resampler.GetOutputFrames(frames) * 2);
+    resampler.Process(input.data(), frames, output.data());
+
+    size_t before = allocations;
+    for (int i = 0; i < 10; i++) {
+        resampler.Process(input.data(), frames, output.data());
+        // Shorter frames reuse the buffers as well
+        resampler.Process(input.data(), frames / 3, output.data());
+    }
+    CHECK_EQ(allocations - before, 0u);
+}
+
+int main() {
+    return RunAllTests();
+}
@@ -0,0 +1,154 @@
+#include "host_test.h"
+#include "audio_service.h"
+#include "file_audio_codec.h"
+#include "spsc_ring.h"
+
+#include <esp_timer.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+/*
+ * Soak tests for the packet and task pools: once every buffer has grown to its frame size, the
+ * steady stream of frames must not touch the heap at all.
+ */
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// 24 hours of 60 ms frames
+#define SOAK_FRAMES (24 * 3600 * 1000 / 60)
+#define FRAME_SAMPLES 960
+// Frames each way through AudioService to warm up, then to measure
+#define SERVICE_FRAMES 1000
+
+static std::string TempPath(const char* name) {
+    return std::string(HOST_TEST_OUTPUT_DIR "/") + name;
+}
+
+TEST(PoolsRecycleFramesForADayWithoutAllocating) {
+    auto& packet_pool = ObjectPool<AudioStreamPacket>::GetInstance();
+    auto& task_pool = ObjectPool<AudioTask>::GetInstance();
+    packet_pool.Reserve(AUDIO_PACKET_POOL_SIZE);
+    task_pool.Reserve(AUDIO_TASK_POOL_SIZE);
+    SpscRing<std::unique_ptr<AudioTask>> encode_queue(MAX_ENCODE_TASKS_IN_QUEUE);
+    SpscRing<std::unique_ptr<AudioStreamPacket>> send_queue(MAX_SEND_PACKETS_IN_QUEUE);
+    std::vector<int16_t> input;
+
+    // The uplink hops of AudioService: the input buffer is swapped into a task, the task is encoded
+    // into a packet, and the packet is sent. Opus packets vary in size, so do these.
+    auto run_frame = [&](size_t i) {
+        input.resize(FRAME_SAMPLES);
+        auto task = AudioTask::Acquire();
+        task->pcm.swap(input);
+        encode_queue.Push(std::move(task));
+
+        std::unique_ptr<AudioTask> encoding;
+        encode_queue.Pop(encoding);
+        auto packet = AudioStreamPacket::Acquire();
+        packet->payload.assign(40 + i % 200, (uint8_t)i);
+        send_queue.Push(std::move(packet));
+
+        std::unique_ptr<AudioStreamPacket> sending;
+        send_queue.Pop(sending);
+    };
+
+    // Warm up every pooled buffer to its largest size
+    for (size_t i = 0; i < AUDIO_PACKET_POOL_SIZE * 200; i++) {
+        run_frame(i);
+    }
+    size_t before = allocations;
+    for (size_t i = 0; i < SOAK_FRAMES; i++) {
+        run_frame(i);
+    }
+    CHECK_EQ(allocations - before, 0u);
+    CHECK_EQ(packet_pool.misses(), 0u);
+    CHECK_EQ(task_pool.misses(), 0u);
+    CHECK_EQ(packet_pool.in_use(), 0u);
+    CHECK_EQ(task_pool.in_use(), 0u);
+}
+
+TEST(AudioServiceDoesNotAllocatePerFrame) {
+    // Looping microphone, so the uplink never runs out
+    {
+        std::vector<int16_t> samples(FRAME_SAMPLES * 4, 100);
+        uint32_t data_bytes = samples.size() * sizeof(int16_t);
+        uint32_t header[11] = {0x46464952, 36 + data_bytes, 0x45564157, 0x20746d66, 16, 0x00010001, 16000, 32000,
+            0x00100002, 0x61746164, data_bytes};
+        FILE* f = fopen(TempPath("pool_mic.wav").c_str(), "wb");
+        fwrite(header, sizeof(header), 1, f);
+        fwrite(samples.data(), sizeof(int16_t), samples.size(), f);
+        fclose(f);
+    }
+    FileAudioCodec codec(TempPath("pool_mic.wav").c_str(), TempPath("pool_out.wav").c_str(), 24000, 0, true);
+    Board::GetInstance().SetAudioCodec(&codec);
+    AudioService service;
+    service.Initialize(&codec);
+    service.Start();
+    service.EnableVoiceProcessing(true);
+
+    OpusEncoderWrapper encoder(16000, 1, OPUS_FRAME_DURATION_MS);
+    std::vector<uint8_t> downlink;
+    encoder.Encode(std::vector<int16_t>(FRAME_SAMPLES, 1000), downlink);
+    uint32_t sequence = 0;
+    int sent = 0;
+    size_t before = 0;
+    size_t packets_before = 0;
+    size_t tasks_before = 0;
+    auto& packet_pool = ObjectPool<AudioStreamPacket>::GetInstance();
+    auto& task_pool = ObjectPool<AudioTask>::GetInstance();
+    // Echo every uplink packet back as downlink, both directions run at once
+    int64_t deadline_us = esp_timer_get_time() + 20000000;
+    while (sent < 2 * SERVICE_FRAMES && esp_timer_get_time() < deadline_us) {
+        auto uplink = service.PopPacketFromSendQueue();
+        if (!uplink) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (++sent == SERVICE_FRAMES) {
+            before = allocations;
+            packets_before = packet_pool.high_water();
+            tasks_before = task_pool.high_water();
+        }
+        auto packet = AudioStreamPacket::Acquire();
+        packet->sample_rate = 16000;
+        packet->frame_duration = OPUS_FRAME_DURATION_MS;
+        packet->timestamp = 0;
+        packet->sequence = ++sequence;
+        packet->payload.assign(downlink.begin(), downlink.end());
+        service.PushPacketToDecodeQueue(std::move(packet), true);
+    }
+    size_t steady = allocations - before;
+    size_t new_objects = packet_pool.high_water() - packets_before + task_pool.high_water() - tasks_before;
+    service.Stop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    printf("%zu allocations in %d frames, %zu pooled objects used for the first time\n", steady, SERVICE_FRAMES,
+        new_objects);
+    CHECK_EQ(sent, 2 * SERVICE_FRAMES);
+    // A pooled object used for the first time grows its buffer, and a PCM buffer grows once more when
+    // it first moves from the 16 kHz uplink to the 24 kHz playback. Nothing allocates per frame.
+    CHECK(steady <= 2 * new_objects);
+    CHECK_EQ(packet_pool.misses(), 0u);
+    CHECK_EQ(task_pool.misses(), 0u);
+}
+
+int main() {
+    return RunAllTests();
+}
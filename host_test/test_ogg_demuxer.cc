@@ -0,0 +1,167 @@
+#include "host_test.h"
+#include "ogg_demuxer.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+// Builds Ogg pages in memory, the demuxer does not check CRCs so they are left zero
+class OggWriter {
+public:
+    // Packets are laced into one page, the last one may be left open to continue on the next page
+    void AddPage(const std::vector<std::vector<uint8_t>>& packets, bool continued, bool last_open = false) {
+        std::vector<uint8_t> lacing;
+        std::vector<uint8_t> body;
+        for (size_t i = 0; i < packets.size(); i++) {
+            size_t size = packets[i].size();
+            while (size >= 255) {
+                lacing.push_back(255);
+                size -= 255;
+            }
+            if (!(last_open && i + 1 == packets.size())) {
+                lacing.push_back(size);
+            }
+            body.insert(body.end(), packets[i].begin(), packets[i].end());
+        }
+        uint8_t header[27] = {'O', 'g', 'g', 'S'};
+        header[5] = continued ? 0x01 : 0x00;
+        header[26] = lacing.size();
+        data_.append(reinterpret_cast<char*>(header), sizeof(header));
+        data_.append(lacing.begin(), lacing.end());
+        data_.append(body.begin(), body.end());
+    }
+
+    void AddGarbage(const char* bytes) { data_.append(bytes); }
+    const std::string& data() const { return data_; }
+
+private:
+    std::string data_;
+};
+
+static std::vector<uint8_t> OpusHead(int channels, uint32_t sample_rate) {
+    std::vector<uint8_t> head(19, 0);
+    memcpy(head.data(), "OpusHead", 8);
+    head[8] = 1;
+    head[9] = channels;
+    for (int i = 0; i < 4; i++) {
+        head[12 + i] = (sample_rate >> (8 * i)) & 0xff;
+    }
+    return head;
+}
+
+static std::vector<uint8_t> OpusTags() {
+    std::vector<uint8_t> tags(16, 0);
+    memcpy(tags.data(), "OpusTags", 8);
+    return tags;
+}
+
+// TOC byte for a single 60 ms SILK wideband frame (config 11), then filler bytes
+static std::vector<uint8_t> OpusPacket(size_t size, uint8_t fill) {
+    std::vector<uint8_t> packet(size, fill);
+    packet[0] = 11 << 3;
+    return packet;
+}
+
+TEST(IndexesPacketsAndReadsHeader) {
+    OggWriter writer;
+    writer.AddPage({OpusHead(1, 24000)}, false);
+    writer.AddPage({OpusTags()}, false);
+    writer.AddPage({OpusPacket(40, 1), OpusPacket(50, 2), OpusPacket(60, 3)}, false);
+
+    OggDemuxer demuxer;
+    CHECK(demuxer.Parse(writer.data()));
+    CHECK_EQ(demuxer.packet_count(), 3u);
+    CHECK_EQ(demuxer.sample_rate(), 24000);
+    CHECK_EQ(demuxer.channels(), 1);
+    CHECK_EQ(demuxer.frame_duration(), 60);
+
+    std::vector<uint8_t> payload;
+    CHECK(demuxer.ReadPacket(1, payload));
+    CHECK(payload == OpusPacket(50, 2));
+    CHECK(demuxer.ReadPacket(2, payload));
+    CHECK(payload == OpusPacket(60, 3));
+    CHECK(!demuxer.ReadPacket(3, payload));
+}
+
+TEST(JoinsPacketsSplitAcrossPages) {
+    auto big = OpusPacket(700, 5);
+    std::vector<uint8_t> first(big.begin(), big.begin() + 510);
+    std::vector<uint8_t> second(big.begin() + 510, big.end());
+
+    OggWriter writer;
+    writer.AddPage({OpusHead(1, 16000)}, false);
+    writer.AddPage({OpusTags()}, false);
+    writer.AddPage({OpusPacket(30, 1), first}, false, true);
+    writer.AddPage({second, OpusPacket(20, 6)}, true);
+
+    OggDemuxer demuxer;
+    CHECK(demuxer.Parse(writer.data()));
+    CHECK_EQ(demuxer.packet_count(), 3u);
+    std::vector<uint8_t> payload;
+    CHECK(demuxer.ReadPacket(1, payload));
+    CHECK(payload == big);
+    CHECK(demuxer.ReadPacket(2, payload));
+    CHECK(payload == OpusPacket(20, 6));
+}
+
+TEST(ResyncsAfterGarbage) {
+    OggWriter writer;
+    writer.AddPage({OpusHead(1, 16000)}, false);
+    writer.AddPage({OpusTags()}, false);
+    writer.AddPage({OpusPacket(10, 1)}, false);
+    writer.AddGarbage("not a page");
+    writer.AddPage({OpusPacket(12, 2)}, false);
+
+    OggDemuxer demuxer;
+    CHECK(demuxer.Parse(writer.data()));
+    CHECK_EQ(demuxer.packet_count(), 2u);
+}
+
+TEST(DropsPacketWhoseContinuationIsMissing) {
+    auto big = OpusPacket(300, 4);
+    std::vector<uint8_t> first(big.begin(), big.begin() + 255);
+
+    OggWriter writer;
+    writer.AddPage({OpusHead(1, 16000)}, false);
+    writer.AddPage({OpusTags()}, false);
+    writer.AddPage({OpusPacket(10, 1), first}, false, true);
+    writer.AddPage({OpusPacket(20, 2)}, false);
+
+    OggDemuxer demuxer;
+    CHECK(demuxer.Parse(writer.data()));
+    CHECK_EQ(demuxer.packet_count(), 2u);
+    std::vector<uint8_t> payload;
+    CHECK(demuxer.ReadPacket(1, payload));
+    CHECK(payload == OpusPacket(20, 2));
+}
+
+TEST(RejectsDataWithoutOpusStream) {
+    OggWriter writer;
+    writer.AddPage({OpusPacket(10, 1)}, false);
+    OggDemuxer demuxer;
+    CHECK(!demuxer.Parse(writer.data()));
+    CHECK(!demuxer.Parse(std::string_view()));
+}
+
+TEST(ParsesBundledSounds) {
+    for (const char* name : {"popup.ogg", "success.ogg", "vibration.ogg"}) {
+        std::ifstream file(std::string(HOST_TEST_ASSETS_DIR "/") + name, std::ios::binary);
+        CHECK(file.good());
+        std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        OggDemuxer demuxer;
+        CHECK(demuxer.Parse(data));
+        CHECK(demuxer.packet_count() > 0);
+        CHECK_EQ(demuxer.sample_rate(), 16000);
+        std::vector<uint8_t> payload;
+        for (size_t i = 0; i < demuxer.packet_count(); i++) {
+            CHECK(demuxer.ReadPacket(i, payload));
+            CHECK(!payload.empty());
+        }
+    }
+}
+
+int main() {
+    return RunAllTests();
+}
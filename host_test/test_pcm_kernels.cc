@@ -0,0 +1,109 @@
+#include "host_test.h"
+#include "pcm_kernels.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*
+ * Compares every kernel against a plain scalar reference computed in 64 bits. Built twice, once as
+ * is and once with CONFIG_AUDIO_PCM_KERNELS_XTENSA for the unrolled loops.
+ */
+
+// Not a multiple of the unroll factor, so the tail loop runs as well
+#define SAMPLES 1027
+
+static int32_t ReferenceSaturate16(int64_t value) {
+    return (int32_t)std::clamp<int64_t>(value, -INT16_MAX, INT16_MAX);
+}
+
+static std::vector<int16_t> TestSamples() {
+    std::vector<int16_t> samples = {INT16_MIN, INT16_MIN + 1, -1, 0, 1, INT16_MAX - 1, INT16_MAX};
+    std::mt19937 rng(7);
+    while (samples.size() < SAMPLES) {
+        samples.push_back((int16_t)(rng() & 0xffff));
+    }
+    return samples;
+}
+
+TEST(ScaleToInt32MatchesReference) {
+    auto in = TestSamples();
+    std::vector<int32_t> out(in.size());
+    std::vector<int32_t> factors = {0, 1, -1, 4096, 65535, 65536, -65535, -65536, 65537, -65537,
+        1 << 20, -(1 << 20), INT32_MAX, INT32_MIN};
+    std::mt19937 rng(11);
+    for (int i = 0; i < 16; i++) {
+        factors.push_back((int32_t)rng());
+    }
+
+    for (int32_t factor : factors) {
+        PcmScaleToInt32(in.data(), out.data(), in.size(), factor);
+        int mismatches = 0;
+        for (size_t i = 0; i < in.size(); i++) {
+            int64_t expected = std::clamp<int64_t>((int64_t)in[i] * factor, INT32_MIN, INT32_MAX);
+            mismatches += out[i] != expected;
+        }
+        CHECK_EQ(mismatches, 0);
+    }
+}
+
+TEST(Int32ToInt16MatchesReference) {
+    std::vector<int32_t> in = {INT32_MIN, INT32_MIN + 1, -(INT16_MAX << 12) - 1, -1, 0, 1,
+        INT16_MAX << 12, (INT16_MAX + 1) << 12, INT32_MAX - 1, INT32_MAX};
+    std::mt19937 rng(13);
+    while (in.size() < SAMPLES) {
+        in.push_back((int32_t)rng());
+    }
+    std::vector<int16_t> out(in.size());
+
+    for (int shift = 0; shift < 32; shift++) {
+        PcmInt32ToInt16(in.data(), out.data(), in.size(), shift);
+        int mismatches = 0;
+        for (size_t i = 0; i < in.size(); i++) {
+            mismatches += out[i] != ReferenceSaturate16(in[i] >> shift);
+        }
+        CHECK_EQ(mismatches, 0);
+    }
+}
+
+TEST(ApplyGainMatchesReference) {
+    auto in = TestSamples();
+    for (int32_t gain : {0, 1, -1, 2, 30, 4096, 65535, 65536, -65535}) {
+        auto data = in;
+        PcmApplyGain(data.data(), data.size(), gain);
+        int mismatches = 0;
+        for (size_t i = 0; i < in.size(); i++) {
+            mismatches += data[i] != ReferenceSaturate16((int64_t)in[i] * gain);
+        }
+        CHECK_EQ(mismatches, 0);
+    }
+    // Never leaves the symmetric range, not even for full scale negative input at unity gain
+    std::vector<int16_t> data = {INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN, INT16_MIN};
+    PcmApplyGain(data.data(), data.size(), 1);
+    CHECK_EQ(*std::min_element(data.begin(), data.end()), -INT16_MAX);
+}
+
+TEST(InterleaveRoundTrips) {
+    auto in = TestSamples();
+    size_t frames = in.size() / 2;
+    std::vector<int16_t> left(frames), right(frames);
+    // Start one sample in, so the 32-bit frames are not aligned
+    PcmDeinterleave(in.data() + 1, left.data(), right.data(), frames - 1);
+    int mismatches = 0;
+    for (size_t i = 0; i < frames - 1; i++) {
+        mismatches += left[i] != in[1 + i * 2] || right[i] != in[2 + i * 2];
+    }
+    CHECK_EQ(mismatches, 0);
+
+    std::vector<int16_t> out(in.size() + 1, 0x5555);
+    PcmInterleave(left.data(), right.data(), out.data() + 1, frames - 1);
+    CHECK(std::equal(out.begin() + 1, out.begin() + 1 + (frames - 1) * 2, in.begin() + 1));
+    CHECK_EQ(out[0], 0x5555);
+    CHECK_EQ(out[1 + (frames - 1) * 2], 0x5555);
+}
+
+int main() {
+    return RunAllTests();
+}
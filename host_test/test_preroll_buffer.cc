@@ -0,0 +1,148 @@
+#include "host_test.h"
+#include "preroll_buffer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <new>
+#include <random>
+#include <vector>
+
+/*
+ * Checks PrerollBuffer against a deque holding the newest samples, across writes that wrap the
+ * ring, overrun it or exceed its capacity, and that feeding it does not allocate.
+ */
+
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// 100 ms at 16 kHz, small enough to wrap many times
+#define SAMPLE_RATE 16000
+#define DURATION_MS 100
+#define CAPACITY (SAMPLE_RATE * DURATION_MS / 1000)
+
+static std::vector<int16_t> ViewSamples(const PrerollView& view) {
+    std::vector<int16_t> samples(view.samples());
+    view.CopyTo(0, samples.data(), samples.size());
+    return samples;
+}
+
+TEST(KeepsTheNewestSamplesAcrossWraparound) {
+    PrerollBuffer buffer;
+    CHECK(buffer.Allocate(SAMPLE_RATE, DURATION_MS));
+    CHECK_EQ(buffer.capacity(), (size_t)CAPACITY);
+    CHECK_EQ(buffer.GetView().samples(), 0u);
+
+    std::deque<int16_t> reference;
+    std::mt19937 rng(7);
+    int16_t next = 0;
+    uint64_t written = 0;
+    int mismatches = 0;
+    // Block sizes around the feed chunk size, with the odd one larger than the whole ring
+    for (int i = 0; i < 500; i++) {
+        size_t samples = i % 37 == 0 ? CAPACITY + rng() % 500 : rng() % 700;
+        std::vector<int16_t> block(samples);
+        for (auto& sample : block) {
+            sample = next++;
+            reference.push_back(sample);
+        }
+        while (reference.size() > CAPACITY) {
+            reference.pop_front();
+        }
+        buffer.Write(block.data(), block.size());
+        written += samples;
+
+        auto view = buffer.GetView();
+        mismatches += buffer.size() != reference.size();
+        mismatches += view.samples() != reference.size();
+        mismatches += buffer.written() != written;
+        mismatches += ViewSamples(view) != std::vector<int16_t>(reference.begin(), reference.end());
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+TEST(CopiesFromAnyOffsetAcrossTheSeam) {
+    PrerollBuffer buffer;
+    CHECK(buffer.Allocate(SAMPLE_RATE, DURATION_MS));
+    std::vector<int16_t> samples(CAPACITY + CAPACITY / 3);
+    for (size_t i = 0; i < samples.size(); i++) {
+        samples[i] = (int16_t)i;
+    }
+    // Two writes so the ring has wrapped and the view is split in two runs
+    buffer.Write(samples.data(), CAPACITY / 2);
+    buffer.Write(samples.data() + CAPACITY / 2, samples.size() - CAPACITY / 2);
+    auto view = buffer.GetView();
+    CHECK(view.second_samples > 0);
+    CHECK_EQ(view.samples(), (size_t)CAPACITY);
+
+    // The oldest sample kept is the one written capacity samples before the end
+    int16_t oldest = (int16_t)(samples.size() - CAPACITY);
+    int mismatches = 0;
+    std::vector<int16_t> out(CAPACITY);
+    for (size_t offset = 0; offset < CAPACITY; offset += 97) {
+        for (size_t length : {(size_t)1, (size_t)320, CAPACITY - offset}) {
+            length = std::min(length, CAPACITY - offset);
+            view.CopyTo(offset, out.data(), length);
+            for (size_t i = 0; i < length; i++) {
+                mismatches += out[i] != (int16_t)(oldest + offset + i);
+            }
+        }
+    }
+    CHECK_EQ(mismatches, 0);
+}
+
+TEST(ClearKeepsTheStorageAndTheCount) {
+    PrerollBuffer buffer;
+    CHECK(buffer.Allocate(SAMPLE_RATE, DURATION_MS));
+    std::vector<int16_t> block(CAPACITY / 2, 5);
+    buffer.Write(block.data(), block.size());
+    buffer.Clear();
+    CHECK_EQ(buffer.size(), 0u);
+    CHECK_EQ(buffer.GetView().samples(), 0u);
+    CHECK_EQ(buffer.written(), (uint64_t)block.size());
+
+    block.assign(10, 9);
+    buffer.Write(block.data(), block.size());
+    CHECK(ViewSamples(buffer.GetView()) == block);
+    // Reallocating at the same size only clears
+    CHECK(buffer.Allocate(SAMPLE_RATE, DURATION_MS));
+    CHECK_EQ(buffer.size(), 0u);
+}
+
+TEST(DoesNotAllocateWhileFeeding) {
+    PrerollBuffer buffer;
+    CHECK(buffer.Allocate(SAMPLE_RATE, DURATION_MS));
+    // A 30 ms feed chunk, as the AFE hands it over
+    std::vector<int16_t> chunk(SAMPLE_RATE * 30 / 1000, 1);
+    std::vector<int16_t> out(CAPACITY);
+
+    size_t before = allocations;
+    for (int i = 0; i < 10000; i++) {
+        buffer.Write(chunk.data(), chunk.size());
+        if (i % 100 == 0) {
+            auto view = buffer.GetView();
+            view.CopyTo(0, out.data(), view.samples());
+        }
+    }
+    CHECK_EQ(allocations - before, 0u);
+}
+
+int main() {
+    return RunAllTests();
+}
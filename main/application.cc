@@ -3,6 +3,7 @@
 #include "display.h"
 #include "system_info.h"
 #include "audio_codec.h"
+#include "audio_flight_recorder.h"
 #include "mqtt_protocol.h"
 #include "websocket_protocol.h"
 #include "assets/lang_config.h"
@@ -214,7 +215,7 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
         digit_sound{'9', Lang::Sounds::OGG_9}
     }};
 
-    // This sentence uses 9KB of SRAM, so we need to wait for it to finish
+    // Sounds are queued in order, the digits play after the activation sentence
     Alert(Lang::Strings::ACTIVATION, message.c_str(), "link", Lang::Sounds::OGG_ACTIVATION);
 
     for (const auto& digit : code) {
@@ -228,6 +229,13 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
 
 void Application::Alert(const char* status, const char* message, const char* emotion, const std::string_view& sound) {
     ESP_LOGW(TAG, "Alert [%s] %s: %s", emotion, status, message);
+    if (strcmp(status, Lang::Strings::ERROR) == 0) {
+        // Keep the audio events that led to the error for a post-mortem
+        auto& recorder = AudioFlightRecorder::GetInstance();
+        recorder.Record(kFlightAlert, device_state_);
+        recorder.Freeze();
+        recorder.DumpToLog(true);
+    }
     auto display = Board::GetInstance().GetDisplay();
     display->SetStatus(status);
     display->SetEmotion(emotion);
@@ -454,6 +462,8 @@ void Application::Start() {
     });
     protocol_->OnAudioChannelOpened([this, codec, &board]() {
         board.SetPowerSaveMode(false);
+        audio_service_.SetEncoderConfig(protocol_->encoder_config());
+        audio_service_.SetDecodeFrameDuration(protocol_->server_frame_duration());
         if (protocol_->server_sample_rate() != codec->output_sample_rate()) {
             ESP_LOGW(TAG, "Server sample rate %d does not match device output sample rate %d, resampling may cause distortion",
                 protocol_->server_sample_rate(), codec->output_sample_rate());
@@ -495,7 +505,7 @@ void Application::Start() {
                     ESP_LOGI(TAG, "<< %s", text->valuestring);
                     Schedule([this, display, message = std::string(text->valuestring)]() {
                         display->SetChatMessage("assistant", message.c_str());
-                    });
+                    }, kTaskPriorityInteractive);
                 }
             }
         } else if (strcmp(type->valuestring, "stt") == 0) {
@@ -504,14 +514,14 @@ void Application::Start() {
                 ESP_LOGI(TAG, ">> %s", text->valuestring);
                 Schedule([this, display, message = std::string(text->valuestring)]() {
                     display->SetChatMessage("user", message.c_str());
-                });
+                }, kTaskPriorityInteractive);
             }
         } else if (strcmp(type->valuestring, "llm") == 0) {
             auto emotion = cJSON_GetObjectItem(root, "emotion");
             if (cJSON_IsString(emotion)) {
                 Schedule([this, display, emotion_str = std::string(emotion->valuestring)]() {
                     display->SetEmotion(emotion_str.c_str());
-                });
+                }, kTaskPriorityInteractive, "emotion");
             }
         } else if (strcmp(type->valuestring, "mcp") == 0) {
             auto payload = cJSON_GetObjectItem(root, "payload");
@@ -547,7 +557,7 @@ void Application::Start() {
             if (cJSON_IsObject(payload)) {
                 Schedule([this, display, payload_str = std::string(cJSON_PrintUnformatted(payload))]() {
                     display->SetChatMessage("system", payload_str.c_str());
-                });
+                }, kTaskPriorityInteractive);
             } else {
                 ESP_LOGW(TAG, "Invalid custom message format: missing payload");
             }
@@ -571,13 +581,142 @@ void Application::Start() {
     }
 }
 
+static const char* const TASK_PRIORITY_STRINGS[] = {
+    "realtime",
+    "interactive",
+    "background",
+};
+
+static const char* FileName(const char* path) {
+    auto slash = path != nullptr ? strrchr(path, '/') : nullptr;
+    return slash != nullptr ? slash + 1 : (path != nullptr ? path : "?");
+}
+
 // Add a async task to MainLoop
-void Application::Schedule(std::function<void()> callback) {
+bool Application::Schedule(std::function<void()> callback, TaskPriority priority, const char* coalesce_key,
+    const char* file, int line) {
     {
         std::lock_guard<std::mutex> lock(mutex_);
-        main_tasks_.push_back(std::move(callback));
+        auto& queue = main_tasks_[priority];
+        bool queued = false;
+        if (coalesce_key != nullptr) {
+            for (auto& task : queue) {
+                if (task.coalesce_key != nullptr && strcmp(task.coalesce_key, coalesce_key) == 0) {
+                    task.callback = std::move(callback);
+                    task.file = file;
+                    task.line = line;
+                    main_loop_stats_.coalesced++;
+                    queued = true;
+                    break;
+                }
+            }
+        }
+        if (!queued) {
+            if (queue.size() >= MAIN_TASK_QUEUE_SIZE && priority != kTaskPriorityRealtime) {
+                main_loop_stats_.dropped[priority]++;
+                ESP_LOGW(TAG, "Main loop %s queue full, drop task from %s:%d",
+                    TASK_PRIORITY_STRINGS[priority], FileName(file), line);
+                return false;
+            }
+            queue.push_back({std::move(callback), coalesce_key, file, line, esp_timer_get_time()});
+        }
+
+        size_t backlog = 0;
+        for (auto& q : main_tasks_) {
+            backlog += q.size();
+        }
+        if (backlog > main_loop_stats_.max_backlog) {
+            main_loop_stats_.max_backlog = backlog;
+        }
     }
     xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
+    return true;
+}
+
+size_t Application::GetMainTaskBacklog() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t backlog = 0;
+    for (auto& queue : main_tasks_) {
+        backlog += queue.size();
+    }
+    return backlog;
+}
+
+MainLoopStats Application::GetMainLoopStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return main_loop_stats_;
+}
+
+void Application::PrintMainLoopStats() {
+    auto stats = GetMainLoopStats();
+    ESP_LOGI(TAG, "Main loop: backlog %u (max %u), executed %lu/%lu/%lu, dropped %lu/%lu, coalesced %lu, slow %lu",
+        (unsigned)GetMainTaskBacklog(), (unsigned)stats.max_backlog,
+        (unsigned long)stats.executed[kTaskPriorityRealtime], (unsigned long)stats.executed[kTaskPriorityInteractive],
+        (unsigned long)stats.executed[kTaskPriorityBackground], (unsigned long)stats.dropped[kTaskPriorityInteractive],
+        (unsigned long)stats.dropped[kTaskPriorityBackground], (unsigned long)stats.coalesced, (unsigned long)stats.slow);
+}
+
+void Application::SendQueuedAudio() {
+    while (auto packet = audio_service_.PopPacketFromSendQueue()) {
+        if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
+            break;
+        }
+    }
+}
+
+// Runs the scheduled tasks highest class first, a task scheduled meanwhile with a higher class runs next.
+// Queued audio is sent between tasks. One call runs at most as many tasks as were queued when it started,
+// and yields after each background task, so other events are not held up behind tasks that keep
+// scheduling more work.
+void Application::RunScheduledTasks() {
+    size_t budget = GetMainTaskBacklog();
+    while (true) {
+        if (budget-- == 0) {
+            if (GetMainTaskBacklog() > 0) {
+                xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
+            }
+            return;
+        }
+
+        MainTask task;
+        int priority = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (priority < kTaskPriorityCount && main_tasks_[priority].empty()) {
+                priority++;
+            }
+            if (priority == kTaskPriorityCount) {
+                return;
+            }
+            task = std::move(main_tasks_[priority].front());
+            main_tasks_[priority].pop_front();
+        }
+
+        auto start_time = esp_timer_get_time();
+        task.callback();
+        auto elapsed_ms = (esp_timer_get_time() - start_time) / 1000;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            main_loop_stats_.executed[priority]++;
+            if (elapsed_ms >= MAIN_TASK_SLOW_THRESHOLD_MS) {
+                main_loop_stats_.slow++;
+            }
+        }
+        if (elapsed_ms >= MAIN_TASK_SLOW_THRESHOLD_MS) {
+            ESP_LOGW(TAG, "Slow %s task from %s:%d ran %ld ms, queued %ld ms", TASK_PRIORITY_STRINGS[priority],
+                FileName(task.file), task.line, (long)elapsed_ms, (long)((start_time - task.schedule_time) / 1000));
+        }
+
+        if (xEventGroupClearBits(event_group_, MAIN_EVENT_SEND_AUDIO) & MAIN_EVENT_SEND_AUDIO) {
+            SendQueuedAudio();
+        }
+        if (priority == kTaskPriorityBackground) {
+            if (GetMainTaskBacklog() > 0) {
+                xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
+            }
+            return;
+        }
+    }
 }
 
 // The Main Event Loop controls the chat state and websocket connection
@@ -598,11 +737,7 @@ void Application::MainEventLoop() {
         }
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
-            while (auto packet = audio_service_.PopPacketFromSendQueue()) {
-                if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
-                    break;
-                }
-            }
+            SendQueuedAudio();
         }
 
         if (bits & MAIN_EVENT_WAKE_WORD_DETECTED) {
@@ -617,12 +752,7 @@ void Application::MainEventLoop() {
         }
 
         if (bits & MAIN_EVENT_SCHEDULE) {
-            std::unique_lock<std::mutex> lock(mutex_);
-            auto tasks = std::move(main_tasks_);
-            lock.unlock();
-            for (auto& task : tasks) {
-                task();
-            }
+            RunScheduledTasks();
         }
 
         if (bits & MAIN_EVENT_CLOCK_TICK) {
@@ -635,7 +765,20 @@ void Application::MainEventLoop() {
                 // SystemInfo::PrintTaskCpuUsage(pdMS_TO_TICKS(1000));
                 // SystemInfo::PrintTaskList();
                 SystemInfo::PrintHeapStats();
+                SystemInfo::PrintSoundCacheStats();
+                audio_service_.PrintStats();
+                SystemInfo::PrintAudioLatencyStats();
+                PrintMainLoopStats();
             }
+
+#if CONFIG_AUDIO_CHANNEL_WARMUP
+            // Close the pre-opened channel if no conversation used it within the TTL
+            if (device_state_ == kDeviceStateIdle && clock_ticks_ >= CONFIG_AUDIO_CHANNEL_IDLE_TTL_SECONDS &&
+                protocol_ && protocol_->IsAudioChannelOpened()) {
+                ESP_LOGI(TAG, "Close idle audio channel after %d seconds", clock_ticks_);
+                protocol_->CloseAudioChannel();
+            }
+#endif
         }
     }
 }
@@ -646,9 +789,12 @@ void Application::OnWakeWordDetected() {
     }
 
     if (device_state_ == kDeviceStateIdle) {
+        auto start_time = esp_timer_get_time();
+        // The encoder runs on its own task, so it overlaps with opening the channel below
         audio_service_.EncodeWakeWord();
 
-        if (!protocol_->IsAudioChannelOpened()) {
+        bool warm = protocol_->IsAudioChannelOpened();
+        if (!warm) {
             SetDeviceState(kDeviceStateConnecting);
             if (!protocol_->OpenAudioChannel()) {
                 audio_service_.EnableWakeWordDetection(true);
@@ -663,6 +809,8 @@ void Application::OnWakeWordDetected() {
         while (auto packet = audio_service_.PopWakeWordPacket()) {
             protocol_->SendAudio(std::move(packet));
         }
+        ESP_LOGI(TAG, "Wake word data sent in %ld ms, %s channel", (long)((esp_timer_get_time() - start_time) / 1000),
+            warm ? "warm" : "new");
         // Set the chat state to wake word detected
         protocol_->SendWakeWordDetected(wake_word);
         SetListeningMode(aec_mode_ == kAecOff ? kListeningModeAutoStop : kListeningModeRealtime);
@@ -678,6 +826,15 @@ void Application::OnWakeWordDetected() {
     }
 }
 
+// Reopen the channel after a conversation, so the next wake word only sends the listen message.
+// Runs on the main loop like any other open, a failure is only logged.
+void Application::WarmUpAudioChannel() {
+    if (device_state_ != kDeviceStateIdle || !protocol_ || protocol_->IsAudioChannelOpened()) {
+        return;
+    }
+    protocol_->WarmUpAudioChannel();
+}
+
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
@@ -700,10 +857,11 @@ void Application::SetDeviceState(DeviceState state) {
     auto previous_state = device_state_;
     device_state_ = state;
     if (state == kDeviceStateSpeaking) {
-        // TTS 音频包可能在状态切换后立刻到达；先清空解码器，避免慢速墨水屏刷新后再 reset 丢掉首包音频。
+        // TTS 音频包可能在状态切换后立刻到达；先清空解码器，再更新显示（墨水屏在渲染任务中异步刷新）。
         audio_service_.ResetDecoder();
     }
     ESP_LOGI(TAG, "STATE: %s", STATE_STRINGS[device_state_]);
+    AudioFlightRecorder::GetInstance().Record(kFlightDeviceState, state, 0, previous_state);
 
     // Send the state change event
     DeviceStateEventManager::GetInstance().PostStateChangeEvent(previous_state, state);
@@ -724,6 +882,13 @@ void Application::SetDeviceState(DeviceState state) {
             display->SetEmotion("neutral");
             audio_service_.EnableVoiceProcessing(false);
             audio_service_.EnableWakeWordDetection(true);
+#if CONFIG_AUDIO_CHANNEL_WARMUP
+            if (previous_state == kDeviceStateListening || previous_state == kDeviceStateSpeaking) {
+                Schedule([this]() {
+                    WarmUpAudioChannel();
+                });
+            }
+#endif
             break;
         case kDeviceStateConnecting:
             display->SetStatus(Lang::Strings::CONNECTING);
@@ -876,7 +1041,7 @@ void Application::SendMcpMessage(const std::string& payload) {
     } else {
         Schedule([this, payload = std::move(payload)]() {
             protocol_->SendMcpMessage(payload);
-        });
+        }, kTaskPriorityInteractive);
     }
 }
 
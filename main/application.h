@@ -29,6 +29,19 @@
 #define MAIN_EVENT_CHECK_NEW_VERSION_DONE (1 << 5)
 #define MAIN_EVENT_CLOCK_TICK (1 << 6)
 
+#define MAIN_TASK_QUEUE_SIZE 32         // Per priority class
+#define MAIN_TASK_SLOW_THRESHOLD_MS 100 // Tasks running longer are logged with their call site
+
+// Scheduled tasks run highest class first. Realtime tasks (state changes, audio channel) are never dropped
+// and their queue is not bounded; it is the default class, so only callers that pick interactive (display
+// updates, MCP replies) or background (tool calls, reconnects) get a bounded queue and may be dropped.
+enum TaskPriority {
+    kTaskPriorityRealtime,
+    kTaskPriorityInteractive,
+    kTaskPriorityBackground,
+    kTaskPriorityCount
+};
+
 
 enum AecMode {
     kAecOff,
@@ -36,6 +49,22 @@ enum AecMode {
     kAecOnServerSide,
 };
 
+struct MainTask {
+    std::function<void()> callback;
+    const char* coalesce_key = nullptr;
+    const char* file = nullptr;
+    int line = 0;
+    int64_t schedule_time = 0;
+};
+
+struct MainLoopStats {
+    uint32_t executed[kTaskPriorityCount] = {};
+    uint32_t dropped[kTaskPriorityCount] = {};
+    uint32_t coalesced = 0;
+    uint32_t slow = 0;
+    size_t max_backlog = 0;
+};
+
 class Application {
 public:
     static Application& GetInstance() {
@@ -50,7 +79,13 @@ public:
     void MainEventLoop();
     DeviceState GetDeviceState() const { return device_state_; }
     bool IsVoiceDetected() const { return audio_service_.IsVoiceDetected(); }
-    void Schedule(std::function<void()> callback);
+    // A pending task with the same coalesce_key is replaced, so only the newest one runs.
+    // The call site is recorded for slow task tracing. Returns false if the queue was full and the task
+    // was dropped, callers that owe someone a reply must send it themselves then.
+    bool Schedule(std::function<void()> callback, TaskPriority priority = kTaskPriorityRealtime,
+        const char* coalesce_key = nullptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+    size_t GetMainTaskBacklog();
+    MainLoopStats GetMainLoopStats();
     void SetDeviceState(DeviceState state);
     void Alert(const char* status, const char* message, const char* emotion = "", const std::string_view& sound = "");
     void DismissAlert();
@@ -75,7 +110,8 @@ private:
     ~Application();
 
     std::mutex mutex_;
-    std::deque<std::function<void()>> main_tasks_;
+    std::deque<MainTask> main_tasks_[kTaskPriorityCount];
+    MainLoopStats main_loop_stats_;
     std::unique_ptr<Protocol> protocol_;
     EventGroupHandle_t event_group_ = nullptr;
     esp_timer_handle_t clock_timer_handle_ = nullptr;
@@ -92,6 +128,10 @@ private:
     TaskHandle_t main_event_loop_task_handle_ = nullptr;
 
     void OnWakeWordDetected();
+    void RunScheduledTasks();
+    void SendQueuedAudio();
+    void PrintMainLoopStats();
+    void WarmUpAudioChannel();
     void CheckNewVersion(Ota& ota);
     void CheckAssetsVersion();
     void ShowActivationCode(const std::string& code, const std::string& message);
@@ -0,0 +1,108 @@
+#include "aec_clock_aligner.h"
+#include <algorithm>
+#include <cstdlib>
+
+void AecClockAligner::Configure(int output_sample_rate, int dma_samples, int dma_chunk_samples, int input_sample_rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_sample_rate_ = output_sample_rate;
+    input_sample_rate_ = input_sample_rate;
+    dma_us_ = (int64_t)dma_samples * 1000000 / output_sample_rate;
+    dma_chunk_us_ = (int64_t)dma_chunk_samples * 1000000 / output_sample_rate;
+}
+
+void AecClockAligner::OnPlaybackWrite(uint32_t timestamp, bool local, size_t samples, int64_t write_start_us, int64_t write_end_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t duration_us = (int64_t)samples * 1000000 / output_sample_rate_;
+
+    // The DMA ran dry, it is sending silence and the frame starts after the descriptor in flight
+    if (playhead_end_us_ < write_start_us) {
+        playhead_end_us_ = write_start_us + dma_chunk_us_;
+    }
+    int64_t end_us = playhead_end_us_ + duration_us;
+
+    // After the write the DMA holds at most dma_us_ of audio, and if the write had to wait for a
+    // free descriptor it is full but for the descriptor being refilled
+    int64_t latest_us = write_end_us + dma_us_;
+    int64_t earliest_us = write_end_us - write_start_us > dma_chunk_us_ / 2 ? latest_us - dma_chunk_us_ : end_us;
+    int64_t corrected_us = std::clamp(end_us, std::min(earliest_us, latest_us), latest_us);
+    if (corrected_us != end_us) {
+        int32_t drift_us = end_us - corrected_us;
+        stats_.corrections++;
+        stats_.last_drift_us = drift_us;
+        if (std::abs(drift_us) > std::abs(stats_.max_drift_us)) {
+            stats_.max_drift_us = drift_us;
+        }
+        end_us = corrected_us;
+    }
+    playhead_end_us_ = end_us;
+    stats_.output_latency_us = end_us - write_end_us;
+    stats_.played_frames++;
+
+    played_[played_head_] = PlayedFrame{timestamp, local, end_us - duration_us, end_us};
+    played_head_ = (played_head_ + 1) % AEC_CLOCK_PLAYED_FRAMES;
+    played_count_ = std::min<size_t>(played_count_ + 1, AEC_CLOCK_PLAYED_FRAMES);
+}
+
+void AecClockAligner::OnCapture(size_t samples, int64_t capture_end_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    input_samples_ += samples;
+    anchors_[anchor_head_] = CaptureAnchor{input_samples_, capture_end_us};
+    anchor_head_ = (anchor_head_ + 1) % AEC_CLOCK_CAPTURE_ANCHORS;
+    anchor_count_ = std::min<size_t>(anchor_count_ + 1, AEC_CLOCK_CAPTURE_ANCHORS);
+}
+
+uint32_t AecClockAligner::StampUplinkFrame(size_t samples) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t first_sample = output_samples_;
+    output_samples_ += samples;
+    if (anchor_count_ == 0) {
+        stats_.silent_frames++;
+        return 0;
+    }
+
+    int64_t capture_us = CaptureTime(first_sample);
+    for (size_t i = 0; i < played_count_; i++) {
+        const auto& frame = played_[(played_head_ + AEC_CLOCK_PLAYED_FRAMES - 1 - i) % AEC_CLOCK_PLAYED_FRAMES];
+        if (capture_us >= frame.start_us && capture_us < frame.end_us) {
+            if (frame.local) {
+                // Not far-end audio
+                break;
+            }
+            stats_.stamped_frames++;
+            return frame.timestamp + (uint32_t)((capture_us - frame.start_us) / 1000);
+        }
+    }
+    stats_.silent_frames++;
+    return 0;
+}
+
+int64_t AecClockAligner::CaptureTime(uint64_t sample) {
+    // The chunk holding the sample is the oldest one ending after it, beyond the newest extrapolate
+    const CaptureAnchor* anchor = nullptr;
+    for (size_t i = 0; i < anchor_count_; i++) {
+        const auto& candidate = anchors_[(anchor_head_ + AEC_CLOCK_CAPTURE_ANCHORS - anchor_count_ + i) % AEC_CLOCK_CAPTURE_ANCHORS];
+        anchor = &candidate;
+        if (candidate.end_sample > sample) {
+            break;
+        }
+    }
+    return anchor->end_us - ((int64_t)anchor->end_sample - 1 - (int64_t)sample) * 1000000 / input_sample_rate_;
+}
+
+void AecClockAligner::ResetPlayback() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    played_count_ = 0;
+    playhead_end_us_ = 0;
+}
+
+void AecClockAligner::ResetCapture() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    anchor_count_ = 0;
+    input_samples_ = 0;
+    output_samples_ = 0;
+}
+
+AecClockAlignerStats AecClockAligner::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
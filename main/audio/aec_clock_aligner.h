@@ -0,0 +1,93 @@
+#ifndef AEC_CLOCK_ALIGNER_H
+#define AEC_CLOCK_ALIGNER_H
+
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+// Played frames remembered for stamping, must cover the microphone to uplink latency
+#define AEC_CLOCK_PLAYED_FRAMES 16
+// Microphone chunks remembered to find the capture time of a processed frame
+#define AEC_CLOCK_CAPTURE_ANCHORS 32
+
+struct AecClockAlignerStats {
+    uint32_t played_frames = 0;
+    uint32_t stamped_frames = 0;    // Uplink frames that heard far-end audio
+    uint32_t silent_frames = 0;     // Uplink frames captured while nothing was playing
+    uint32_t corrections = 0;       // Times the playback model was pulled back to the DMA bounds
+    int32_t last_drift_us = 0;      // Model minus observed position at the last correction
+    int32_t max_drift_us = 0;
+    int32_t output_latency_us = 0;  // Write to audible, as last estimated
+};
+
+/*
+ * Maps uplink frames to the far-end audio that was audible while they were captured,
+ * for server-side AEC.
+ *
+ * The playback side follows each decoded frame through the I2S DMA: frames play back to back
+ * from when they are written, and a write that had to wait for the DMA proves the DMA was full,
+ * which bounds where the playback position can be and corrects drift between esp_timer and the
+ * I2S clock. The capture side remembers when each microphone chunk was read, so the first sample
+ * of a processed frame gets its capture time by sample count.
+ *
+ * The stamp is the far-end timestamp of the frame playing at that capture time plus the offset
+ * into it, in milliseconds like AudioStreamPacket::timestamp, 0 when nothing was playing.
+ * Times are passed in so the model does not depend on the platform clock.
+ *
+ * Playback and capture are recorded from different tasks, a mutex guards both.
+ */
+class AecClockAligner {
+public:
+    // dma_samples: output samples the I2S DMA holds, dma_chunk_samples: one descriptor
+    void Configure(int output_sample_rate, int dma_samples, int dma_chunk_samples, int input_sample_rate);
+
+    // A decoded frame with far-end timestamp `timestamp` was handed to the codec between write_start_us
+    // and write_end_us. Local frames (sounds, concealment) have no far-end timestamp and stamp nothing
+    void OnPlaybackWrite(uint32_t timestamp, bool local, size_t samples, int64_t write_start_us, int64_t write_end_us);
+    // `samples` microphone samples (per channel) were read, the last one at capture_end_us
+    void OnCapture(size_t samples, int64_t capture_end_us);
+    // The next `samples` processed samples form an uplink frame, returns its far-end stamp
+    uint32_t StampUplinkFrame(size_t samples);
+
+    // Playback stopped, forget played frames
+    void ResetPlayback();
+    // The processor restarted, input and output sample counts start over
+    void ResetCapture();
+
+    AecClockAlignerStats GetStats();
+
+private:
+    struct PlayedFrame {
+        uint32_t timestamp;
+        bool local;
+        int64_t start_us;
+        int64_t end_us;
+    };
+    struct CaptureAnchor {
+        uint64_t end_sample;
+        int64_t end_us;
+    };
+
+    std::mutex mutex_;
+    int output_sample_rate_ = 16000;
+    int input_sample_rate_ = 16000;
+    int64_t dma_us_ = 0;
+    int64_t dma_chunk_us_ = 0;
+
+    PlayedFrame played_[AEC_CLOCK_PLAYED_FRAMES] = {};
+    size_t played_head_ = 0;
+    size_t played_count_ = 0;
+    int64_t playhead_end_us_ = 0;   // When everything written so far has been played
+
+    CaptureAnchor anchors_[AEC_CLOCK_CAPTURE_ANCHORS] = {};
+    size_t anchor_head_ = 0;
+    size_t anchor_count_ = 0;
+    uint64_t input_samples_ = 0;
+    uint64_t output_samples_ = 0;
+
+    AecClockAlignerStats stats_;
+
+    int64_t CaptureTime(uint64_t sample);
+};
+
+#endif // AEC_CLOCK_ALIGNER_H
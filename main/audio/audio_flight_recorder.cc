@@ -0,0 +1,178 @@
+#include "audio_flight_recorder.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "AudioFlight"
+
+namespace {
+
+AudioFlightEvent* AllocEvents(size_t count) {
+    return (AudioFlightEvent*)heap_caps_calloc_prefer(count, sizeof(AudioFlightEvent), 2,
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+}
+
+}  // namespace
+
+AudioFlightRecorder::AudioFlightRecorder() {
+    if (AUDIO_FLIGHT_RECORDER_EVENTS == 0) {
+        return;
+    }
+    events_ = AllocEvents(AUDIO_FLIGHT_RECORDER_EVENTS);
+    if (events_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %d events", AUDIO_FLIGHT_RECORDER_EVENTS);
+        return;
+    }
+    capacity_ = AUDIO_FLIGHT_RECORDER_EVENTS;
+}
+
+void AudioFlightRecorder::Record(AudioFlightEventType type, uint32_t id, uint16_t value, uint8_t arg, uint32_t extra) {
+    if (capacity_ == 0) {
+        return;
+    }
+    uint32_t index = head_.fetch_add(1, std::memory_order_relaxed);
+    AudioFlightEvent& event = events_[index % capacity_];
+    event.time_us = (uint32_t)esp_timer_get_time();
+    event.id = id;
+    event.extra = extra;
+    event.value = value;
+    event.type = type;
+    event.arg = arg;
+}
+
+void AudioFlightRecorder::Freeze() {
+    if (capacity_ == 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(frozen_mutex_);
+    if (frozen_ == nullptr) {
+        frozen_ = AllocEvents(capacity_);
+        if (frozen_ == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate the frozen copy");
+            return;
+        }
+    }
+
+    // Oldest event first
+    uint32_t total = head_.load(std::memory_order_relaxed);
+    uint32_t count = std::min(total, capacity_);
+    for (uint32_t i = 0; i < count; i++) {
+        frozen_[i] = events_[(total - count + i) % capacity_];
+    }
+    frozen_count_ = count;
+    frozen_total_ = total;
+    frozen_time_us_ = (uint32_t)esp_timer_get_time();
+    frozen_generation_++;
+    ESP_LOGW(TAG, "Froze %lu audio events", count);
+}
+
+bool AudioFlightRecorder::Write(bool frozen, const std::function<bool(const void* data, size_t size)>& writer) {
+    AudioFlightDumpHeader header = {};
+    header.magic = AUDIO_FLIGHT_DUMP_MAGIC;
+    header.version = AUDIO_FLIGHT_DUMP_VERSION;
+    header.event_size = sizeof(AudioFlightEvent);
+    header.capacity = capacity_;
+
+    if (frozen) {
+        // The writer may block on a socket or the UART, so the lock is only held to copy a chunk and
+        // Freeze() never waits for a dump
+        uint32_t generation;
+        {
+            std::lock_guard<std::mutex> lock(frozen_mutex_);
+            header.count = frozen_count_;
+            header.total = frozen_total_;
+            header.time_us = frozen_time_us_;
+            generation = frozen_generation_;
+        }
+        if (!writer(&header, sizeof(header))) {
+            return false;
+        }
+        AudioFlightEvent chunk[AUDIO_FLIGHT_DUMP_CHUNK_EVENTS];
+        for (uint32_t offset = 0; offset < header.count; offset += AUDIO_FLIGHT_DUMP_CHUNK_EVENTS) {
+            uint32_t count = std::min<uint32_t>(AUDIO_FLIGHT_DUMP_CHUNK_EVENTS, header.count - offset);
+            {
+                std::lock_guard<std::mutex> lock(frozen_mutex_);
+                if (frozen_generation_ != generation) {
+                    ESP_LOGW(TAG, "Frozen again during the dump, stopped");
+                    return false;
+                }
+                memcpy(chunk, frozen_ + offset, count * sizeof(AudioFlightEvent));
+            }
+            if (!writer(chunk, count * sizeof(AudioFlightEvent))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t total = head_.load(std::memory_order_relaxed);
+    header.count = std::min(total, capacity_);
+    header.total = total;
+    header.time_us = (uint32_t)esp_timer_get_time();
+    if (!writer(&header, sizeof(header))) {
+        return false;
+    }
+    if (header.count == 0) {
+        return true;
+    }
+    // The live ring wraps, write it as two spans
+    uint32_t start = (total - header.count) % capacity_;
+    uint32_t first = std::min(header.count, capacity_ - start);
+    if (!writer(events_ + start, first * sizeof(AudioFlightEvent))) {
+        return false;
+    }
+    return first == header.count || writer(events_, (header.count - first) * sizeof(AudioFlightEvent));
+}
+
+void AudioFlightRecorder::DumpToLog(bool frozen) {
+    if (capacity_ == 0 || dumping_.exchange(true)) {
+        return;
+    }
+    struct DumpArgs {
+        AudioFlightRecorder* recorder;
+        bool frozen;
+    };
+    auto args = new DumpArgs{this, frozen};
+    BaseType_t ret = xTaskCreate([](void* arg) {
+        auto args = (DumpArgs*)arg;
+        args->recorder->LogDump(args->frozen);
+        args->recorder->dumping_ = false;
+        delete args;
+        vTaskDelete(NULL);
+    }, "flight_dump", AUDIO_FLIGHT_DUMP_TASK_STACK_SIZE, args, 1, NULL);
+    if (ret != pdPASS) {
+        delete args;
+        dumping_ = false;
+    }
+}
+
+void AudioFlightRecorder::LogDump(bool frozen) {
+    // One line per 32 bytes, the host decoder joins the lines that follow the begin marker
+    ESP_LOGI(TAG, "AFR begin");
+    char line[32 * 2 + 1];
+    size_t line_bytes = 0;
+    static const char kHex[] = "0123456789abcdef";
+    Write(frozen, [&](const void* data, size_t size) {
+        auto bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++) {
+            line[line_bytes * 2] = kHex[bytes[i] >> 4];
+            line[line_bytes * 2 + 1] = kHex[bytes[i] & 0x0F];
+            if (++line_bytes == 32) {
+                line[sizeof(line) - 1] = '\0';
+                ESP_LOGI(TAG, "AFR %s", line);
+                line_bytes = 0;
+            }
+        }
+        return true;
+    });
+    if (line_bytes > 0) {
+        line[line_bytes * 2] = '\0';
+        ESP_LOGI(TAG, "AFR %s", line);
+    }
+    ESP_LOGI(TAG, "AFR end");
+}
@@ -0,0 +1,126 @@
+#ifndef AUDIO_FLIGHT_RECORDER_H
+#define AUDIO_FLIGHT_RECORDER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+
+#ifdef CONFIG_AUDIO_FLIGHT_RECORDER_EVENTS
+#define AUDIO_FLIGHT_RECORDER_EVENTS CONFIG_AUDIO_FLIGHT_RECORDER_EVENTS
+#else
+#define AUDIO_FLIGHT_RECORDER_EVENTS 1024
+#endif
+#define AUDIO_FLIGHT_DUMP_MAGIC 0x31524641  // "AFR1"
+#define AUDIO_FLIGHT_DUMP_VERSION 1
+#define AUDIO_FLIGHT_DUMP_TASK_STACK_SIZE 3072
+// Events copied out of the frozen ring at a time, the writer runs without the lock
+#define AUDIO_FLIGHT_DUMP_CHUNK_EVENTS 32
+
+enum AudioFlightEventType : uint8_t {
+    kFlightUplinkQueued = 1,    // id: uplink frame, value: encode queue depth
+    kFlightUplinkEncoded,       // id: uplink frame, value: opus bytes, extra: encode time in us
+    kFlightUplinkSent,          // id: uplink frame, value: send queue depth
+    kFlightDownlinkReceived,    // id: downlink frame, value: decode queue depth, extra: packet sequence
+    kFlightDownlinkDecoded,     // id: downlink frame, value: samples, arg: AudioFlightSource, extra: decode time in us
+    kFlightDownlinkPlayed,      // id: downlink frame, value: playback queue depth
+    kFlightDeviceState,         // id: new state, arg: previous state
+    kFlightAudioState,          // id: enabled, arg: AudioFlightComponent
+    kFlightVad,                 // id: speaking
+    kFlightDrop,                // id: frame, arg: AudioFlightDropReason
+    kFlightAlert,               // An error alert froze the recorder
+};
+
+enum AudioFlightSource : uint8_t {
+    kFlightSourcePacket,
+    kFlightSourceConcealed,
+    kFlightSourceSound,
+};
+
+enum AudioFlightComponent : uint8_t {
+    kFlightComponentWakeWord,
+    kFlightComponentProcessor,
+    kFlightComponentTesting,
+};
+
+enum AudioFlightDropReason : uint8_t {
+    kFlightDropEncodeFailed,
+    kFlightDropUnsupportedFrame,
+    kFlightDropDecodeFailed,
+};
+
+// 16 bytes, little endian, as stored in the ring and in dumps
+struct AudioFlightEvent {
+    uint32_t time_us;   // Low 32 bits of esp_timer_get_time()
+    uint32_t id;
+    uint32_t extra;
+    uint16_t value;
+    uint8_t type;
+    uint8_t arg;
+};
+static_assert(sizeof(AudioFlightEvent) == 16, "Flight events must stay 16 bytes");
+
+struct AudioFlightDumpHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t event_size;
+    uint32_t capacity;
+    uint32_t count;         // Events that follow, oldest first
+    uint32_t total;         // Events recorded since boot
+    uint32_t time_us;       // When the dump was taken
+};
+static_assert(sizeof(AudioFlightDumpHeader) == 24, "Dump header layout is read by the host decoder");
+
+/*
+ * Fixed-size ring of compact audio pipeline events for post-mortem analysis.
+ *
+ * Any task may record, a slot is claimed with one atomic increment and written without a lock,
+ * so an event costs a timer read and a 16 byte store. A dump taken while events are recorded
+ * may contain a few torn events at the write position.
+ *
+ * An error alert freezes a copy of the ring, so the events leading up to the error survive until
+ * the dump is read over HTTP or the serial log. scripts/audio_flight_decoder.py renders dumps as
+ * per-frame timelines.
+ */
+class AudioFlightRecorder {
+public:
+    static AudioFlightRecorder& GetInstance() {
+        static AudioFlightRecorder instance;
+        return instance;
+    }
+
+    AudioFlightRecorder(const AudioFlightRecorder&) = delete;
+    AudioFlightRecorder& operator=(const AudioFlightRecorder&) = delete;
+
+    void Record(AudioFlightEventType type, uint32_t id, uint16_t value = 0, uint8_t arg = 0, uint32_t extra = 0);
+
+    // Copy the ring aside, later events do not overwrite the copy
+    void Freeze();
+    bool HasFrozen() const { return frozen_count_ > 0; }
+
+    // Write a dump in chunks, stops when the writer returns false
+    bool Write(bool frozen, const std::function<bool(const void* data, size_t size)>& writer);
+    // Hex dump to the serial log, in a background task so the caller does not wait for the UART
+    void DumpToLog(bool frozen);
+
+private:
+    AudioFlightRecorder();
+
+    uint32_t capacity_ = 0;
+    AudioFlightEvent* events_ = nullptr;
+    std::atomic<uint32_t> head_{0};
+    // The frozen copy is written by Freeze() and read by dumps from other tasks
+    std::mutex frozen_mutex_;
+    AudioFlightEvent* frozen_ = nullptr;
+    uint32_t frozen_count_ = 0;
+    uint32_t frozen_total_ = 0;
+    uint32_t frozen_time_us_ = 0;
+    // Counts Freeze() calls, a dump of the frozen copy stops when it changes underneath
+    uint32_t frozen_generation_ = 0;
+    std::atomic<bool> dumping_{false};
+
+    void LogDump(bool frozen);
+};
+
+#endif // AUDIO_FLIGHT_RECORDER_H
@@ -0,0 +1,57 @@
+#include "audio_latency_profiler.h"
+
+void LatencyHistogram::Record(int64_t elapsed_us, int budget_ms) {
+    if (elapsed_us < 0) {
+        elapsed_us = 0;
+    }
+    frames++;
+    total_us += elapsed_us;
+    if (elapsed_us > max_us) {
+        max_us = elapsed_us;
+    }
+    if (elapsed_us > budget_ms * 1000) {
+        late++;
+    }
+
+    int bucket = 0;
+    uint32_t elapsed_ms = elapsed_us / 1000;
+    while (bucket < AUDIO_LATENCY_HISTOGRAM_BUCKETS - 1 && elapsed_ms >= (1u << bucket)) {
+        bucket++;
+    }
+    buckets[bucket]++;
+}
+
+void AudioLatencyProfiler::Record(AudioLatencyStage stage, int64_t elapsed_us, int budget_ms) {
+    stats_.stages[stage].Record(elapsed_us, budget_ms);
+}
+
+void AudioLatencyProfiler::RecordAfeLag(size_t chunks) {
+    if (chunks > stats_.max_afe_lag) {
+        stats_.max_afe_lag = chunks;
+    }
+}
+
+void AudioLatencyProfiler::RecordEncodeQueue(size_t depth) {
+    if (depth > stats_.max_encode_queue) {
+        stats_.max_encode_queue = depth;
+    }
+}
+
+void AudioLatencyProfiler::Reset() {
+    uint32_t afe_chunk_ms = stats_.afe_chunk_ms;
+    stats_ = AudioLatencyStats();
+    stats_.afe_chunk_ms = afe_chunk_ms;
+}
+
+const char* AudioLatencyProfiler::StageName(AudioLatencyStage stage) {
+    switch (stage) {
+        case kAudioLatencyStageAfe:
+            return "afe";
+        case kAudioLatencyStageOutput:
+            return "output";
+        case kAudioLatencyStageEncodeQueue:
+            return "encode_queue";
+        default:
+            return "unknown";
+    }
+}
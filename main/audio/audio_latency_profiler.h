@@ -0,0 +1,75 @@
+#ifndef AUDIO_LATENCY_PROFILER_H
+#define AUDIO_LATENCY_PROFILER_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Bucket i holds latencies below 2^i ms, the last bucket everything above
+#define AUDIO_LATENCY_HISTOGRAM_BUCKETS 10
+// AFE holds a few chunks for its own look-ahead, frames that stay longer are late
+#define AUDIO_LATENCY_AFE_BUDGET_MS 100
+
+enum AudioLatencyStage {
+    kAudioLatencyStageAfe,          // Feed() -> fetched from AFE
+    kAudioLatencyStageOutput,       // Fetched -> output callback returned, includes waiting for the encode queue
+    kAudioLatencyStageEncodeQueue,  // Queued for encoding -> picked up by the encoder
+    kAudioLatencyStageCount,
+};
+
+struct LatencyHistogram {
+    uint32_t frames = 0;
+    uint32_t late = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+    uint32_t buckets[AUDIO_LATENCY_HISTOGRAM_BUCKETS] = {};
+
+    void Record(int64_t elapsed_us, int budget_ms);
+};
+
+struct AudioLatencyStats {
+    LatencyHistogram stages[kAudioLatencyStageCount];
+    uint32_t max_afe_lag = 0;           // Most chunks fed but not fetched yet
+    uint32_t afe_chunk_ms = 0;
+    uint32_t afe_overflows = 0;         // Chunks fed while the AFE ring buffer was already full
+    uint32_t fetch_errors = 0;
+    uint32_t max_encode_queue = 0;      // Deepest encode queue seen by the encoder
+    uint32_t encode_drops = 0;          // Frames the encoder could not encode
+};
+
+/*
+ * Per-frame latency of the uplink between the microphone and the Opus encoder.
+ *
+ * Each stage is recorded by the one task that owns it, so recording takes no lock. Readers get a
+ * snapshot that may be off by the frame being recorded, which is fine for diagnostics.
+ */
+class AudioLatencyProfiler {
+public:
+    static AudioLatencyProfiler& GetInstance() {
+        static AudioLatencyProfiler instance;
+        return instance;
+    }
+
+    AudioLatencyProfiler(const AudioLatencyProfiler&) = delete;
+    AudioLatencyProfiler& operator=(const AudioLatencyProfiler&) = delete;
+
+    void Record(AudioLatencyStage stage, int64_t elapsed_us, int budget_ms);
+    void RecordAfeLag(size_t chunks);
+    void RecordEncodeQueue(size_t depth);
+    void SetAfeChunkDuration(int chunk_ms) { stats_.afe_chunk_ms = chunk_ms; }
+    void CountAfeOverflow() { stats_.afe_overflows++; }
+    void CountFetchError() { stats_.fetch_errors++; }
+    void CountEncodeDrop() { stats_.encode_drops++; }
+
+    AudioLatencyStats GetStats() const { return stats_; }
+    // Frames being recorded while resetting may be lost
+    void Reset();
+
+    static const char* StageName(AudioLatencyStage stage);
+
+private:
+    AudioLatencyProfiler() = default;
+
+    AudioLatencyStats stats_;
+};
+
+#endif // AUDIO_LATENCY_PROFILER_H
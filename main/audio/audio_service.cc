@@ -1,6 +1,7 @@
 #include "audio_service.h"
 #include <esp_log.h>
 #include <cstring>
+#include <algorithm>
 
 #if CONFIG_USE_AUDIO_PROCESSOR
 #include "processors/afe_audio_processor.h"
@@ -17,6 +18,24 @@
 
 #define TAG "AudioService"
 
+static bool IsSupportedFrameDuration(int frame_duration) {
+    static const int frame_durations[] = OPUS_FRAME_DURATIONS;
+    return std::find(std::begin(frame_durations), std::end(frame_durations), frame_duration) != std::end(frame_durations);
+}
+
+static bool IsSupportedBitrate(int bitrate) {
+    static const int bitrates[] = OPUS_BITRATES;
+    return std::find(std::begin(bitrates), std::end(bitrates), bitrate) != std::end(bitrates);
+}
+
+// Without bitrate control in the opus wrapper the encoder keeps its automatic bitrate
+template <typename Encoder>
+static void SetOpusBitrate(Encoder& encoder, int bitrate) {
+    if constexpr (OpusHasBitrateControl<Encoder>::value) {
+        encoder.SetBitrate(bitrate);
+    }
+}
+
 
 AudioService::AudioService() {
     event_group_ = xEventGroupCreate();
@@ -33,14 +52,26 @@ void AudioService::Initialize(AudioCodec* codec) {
     codec_ = codec;
     codec_->Start();
 
+    /* Recycle packets and PCM buffers instead of allocating them per frame */
+    ObjectPool<AudioStreamPacket>::GetInstance().Reserve(AUDIO_PACKET_POOL_SIZE);
+    ObjectPool<AudioTask>::GetInstance().Reserve(AUDIO_TASK_POOL_SIZE);
+    /* The rings are allocated for the shortest frames, limit them to the default frame duration */
+    audio_decode_queue_.SetLimit(AUDIO_QUEUE_DURATION_MS / OPUS_FRAME_DURATION_MS);
+    audio_send_queue_.SetLimit(AUDIO_QUEUE_DURATION_MS / OPUS_FRAME_DURATION_MS);
+    audio_testing_queue_.SetLimit(AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS);
+
     /* Setup the audio codec */
     opus_decoder_ = std::make_unique<OpusDecoderWrapper>(codec->output_sample_rate(), 1, OPUS_FRAME_DURATION_MS);
     opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, OPUS_FRAME_DURATION_MS);
     opus_encoder_->SetComplexity(0);
 
+#if CONFIG_USE_SERVER_AEC
+    aec_clock_aligner_.Configure(codec->output_sample_rate(), AUDIO_CODEC_DMA_DESC_NUM * AUDIO_CODEC_DMA_FRAME_NUM,
+        AUDIO_CODEC_DMA_FRAME_NUM, 16000);
+#endif
+
     if (codec->input_sample_rate() != 16000) {
-        input_resampler_.Configure(codec->input_sample_rate(), 16000);
-        reference_resampler_.Configure(codec->input_sample_rate(), 16000);
+        input_resampler_.Configure(codec->input_sample_rate(), 16000, codec->input_channels());
     }
 
 #if CONFIG_USE_AUDIO_PROCESSOR
@@ -49,12 +80,21 @@ void AudioService::Initialize(AudioCodec* codec) {
     audio_processor_ = std::make_unique<NoAudioProcessor>();
 #endif
 
+#if CONFIG_USE_AUDIO_DEBUGGER
+    audio_debugger_ = std::make_unique<AudioDebugger>();
+#endif
+
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugStreamProcessed, data, 1, 16000,
+            esp_timer_get_time() - (int64_t)data.size() * 1000000 / 16000);
+#endif
         PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
     });
 
     audio_processor_->OnVadStateChange([this](bool speaking) {
         voice_detected_ = speaking;
+        AudioFlightRecorder::GetInstance().Record(kFlightVad, speaking);
         if (callbacks_.on_vad_change) {
             callbacks_.on_vad_change(speaking);
         }
@@ -75,7 +115,8 @@ void AudioService::Initialize(AudioCodec* codec) {
 
 void AudioService::Start() {
     service_stopped_ = false;
-    xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING);
+    xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING | AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING |
+        AS_EVENT_QUEUE_WAKEUPS);
 
     esp_timer_start_periodic(audio_power_timer_, 1000000);
 
@@ -109,27 +150,41 @@ void AudioService::Start() {
     }, "audio_output", 2048, this, 4, &audio_output_task_handle_);
 #endif
 
-    /* Start the opus codec task */
+#if OPUS_SINGLE_CODEC_TASK
+    /* Start the opus codec task, it needs the stack of the encoder */
     xTaskCreate([](void* arg) {
         AudioService* audio_service = (AudioService*)arg;
         audio_service->OpusCodecTask();
         vTaskDelete(NULL);
-    }, "opus_codec", 2048 * 13, this, 2, &opus_codec_task_handle_);
+    }, "opus_codec", 2048 * 13, this, OPUS_CODEC_TASK_PRIORITY, &opus_encoder_task_handle_);
+    opus_decoder_task_handle_ = opus_encoder_task_handle_;
+#else
+    /* Start the opus decoder and encoder tasks on separate cores */
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusDecoderTask();
+        vTaskDelete(NULL);
+    }, "opus_decoder", 2048 * 6, this, OPUS_DECODER_TASK_PRIORITY, &opus_decoder_task_handle_, OPUS_DECODER_TASK_CORE);
+
+    xTaskCreatePinnedToCore([](void* arg) {
+        AudioService* audio_service = (AudioService*)arg;
+        audio_service->OpusEncoderTask();
+        vTaskDelete(NULL);
+    }, "opus_encoder", 2048 * 13, this, OPUS_ENCODER_TASK_PRIORITY, &opus_encoder_task_handle_, OPUS_ENCODER_TASK_CORE);
+#endif
 }
 
 void AudioService::Stop() {
     esp_timer_stop(audio_power_timer_);
     service_stopped_ = true;
+    audio_encode_queue_.Clear();
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
     xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
         AS_EVENT_WAKE_WORD_RUNNING |
-        AS_EVENT_AUDIO_PROCESSOR_RUNNING);
-
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    audio_encode_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+        AS_EVENT_AUDIO_PROCESSOR_RUNNING |
+        AS_EVENT_QUEUE_WAKEUPS);
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
@@ -140,31 +195,13 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
     }
 
     if (codec_->input_sample_rate() != sample_rate) {
-        data.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
-        if (!codec_->InputData(data)) {
+        input_buffer_.resize(samples * codec_->input_sample_rate() / sample_rate * codec_->input_channels());
+        if (!codec_->InputData(input_buffer_)) {
             return false;
         }
-        if (codec_->input_channels() == 2) {
-            auto mic_channel = std::vector<int16_t>(data.size() / 2);
-            auto reference_channel = std::vector<int16_t>(data.size() / 2);
-            for (size_t i = 0, j = 0; i < mic_channel.size(); ++i, j += 2) {
-                mic_channel[i] = data[j];
-                reference_channel[i] = data[j + 1];
-            }
-            auto resampled_mic = std::vector<int16_t>(input_resampler_.GetOutputSamples(mic_channel.size()));
-            auto resampled_reference = std::vector<int16_t>(reference_resampler_.GetOutputSamples(reference_channel.size()));
-            input_resampler_.Process(mic_channel.data(), mic_channel.size(), resampled_mic.data());
-            reference_resampler_.Process(reference_channel.data(), reference_channel.size(), resampled_reference.data());
-            data.resize(resampled_mic.size() + resampled_reference.size());
-            for (size_t i = 0, j = 0; i < resampled_mic.size(); ++i, j += 2) {
-                data[j] = resampled_mic[i];
-                data[j + 1] = resampled_reference[i];
-            }
-        } else {
-            auto resampled = std::vector<int16_t>(input_resampler_.GetOutputSamples(data.size()));
-            input_resampler_.Process(data.data(), data.size(), resampled.data());
-            data = std::move(resampled);
-        }
+        int frames = input_buffer_.size() / codec_->input_channels();
+        data.resize(input_resampler_.GetOutputFrames(frames) * codec_->input_channels());
+        input_resampler_.Process(input_buffer_.data(), frames, data.data());
     } else {
         data.resize(samples * codec_->input_channels());
         if (!codec_->InputData(data)) {
@@ -177,17 +214,27 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
     debug_statistics_.input_count++;
 
 #if CONFIG_USE_AUDIO_DEBUGGER
-    // 音频调试：发送原始音频数据
-    if (audio_debugger_ == nullptr) {
-        audio_debugger_ = std::make_unique<AudioDebugger>();
+    // 音频调试：发送原始麦克风和回采参考，时间戳取这帧第一个采样
+    {
+        int channels = codec_->input_channels();
+        int frames = data.size() / channels;
+        int64_t capture_us = esp_timer_get_time() - (int64_t)frames * 1000000 / sample_rate;
+        int mic_channels = codec_->input_reference() ? channels - 1 : channels;
+        audio_debugger_->Feed(kAudioDebugStreamMic, data.data(), frames, channels, 0, mic_channels,
+            sample_rate, capture_us);
+        if (codec_->input_reference()) {
+            audio_debugger_->Feed(kAudioDebugStreamReference, data.data(), frames, channels, channels - 1, 1,
+                sample_rate, capture_us);
+        }
     }
-    audio_debugger_->Feed(data);
 #endif
 
     return true;
 }
 
 void AudioService::AudioInputTask() {
+    /* Reused across reads, the encode queue hands back a recycled buffer for every frame it takes */
+    std::vector<int16_t> data;
     while (true) {
         EventBits_t bits = xEventGroupWaitBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING |
             AS_EVENT_WAKE_WORD_RUNNING | AS_EVENT_AUDIO_PROCESSOR_RUNNING,
@@ -204,21 +251,19 @@ void AudioService::AudioInputTask() {
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
-            if (audio_testing_queue_.size() >= AUDIO_TESTING_MAX_DURATION_MS / OPUS_FRAME_DURATION_MS) {
+            if (audio_testing_queue_.Full()) {
                 ESP_LOGW(TAG, "Audio testing queue is full, stopping audio testing");
                 EnableAudioTesting(false);
                 continue;
             }
-            std::vector<int16_t> data;
-            int samples = OPUS_FRAME_DURATION_MS * 16000 / 1000;
+            int samples = frame_duration_ms_ * 16000 / 1000;
             if (ReadAudioData(data, 16000, samples)) {
                 // If input channels is 2, we need to fetch the left channel data
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
+                    for (size_t i = 0, j = 0; j < data.size(); ++i, j += 2) {
+                        data[i] = data[j];
                     }
-                    data = std::move(mono_data);
+                    data.resize(data.size() / 2);
                 }
                 PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
                 continue;
@@ -227,7 +272,6 @@ void AudioService::AudioInputTask() {
 
         /* Feed the wake word */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
             int samples = wake_word_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
@@ -239,10 +283,12 @@ void AudioService::AudioInputTask() {
 
         /* Feed the audio processor */
         if (bits & AS_EVENT_AUDIO_PROCESSOR_RUNNING) {
-            std::vector<int16_t> data;
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
+#if CONFIG_USE_SERVER_AEC
+                    aec_clock_aligner_.OnCapture(data.size() / codec_->input_channels(), esp_timer_get_time());
+#endif
                     audio_processor_->Feed(std::move(data));
                     continue;
                 }
@@ -257,118 +303,283 @@ void AudioService::AudioInputTask() {
 }
 
 void AudioService::AudioOutputTask() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() { return !audio_playback_queue_.empty() || service_stopped_; });
-        if (service_stopped_) {
-            break;
+    while (!service_stopped_) {
+        std::unique_ptr<AudioTask> task;
+        if (!audio_playback_queue_.Pop(task)) {
+            xEventGroupWaitBits(event_group_, AS_EVENT_PLAYBACK_NOT_EMPTY, pdTRUE, pdFALSE, portMAX_DELAY);
+            continue;
         }
-
-        auto task = std::move(audio_playback_queue_.front());
-        audio_playback_queue_.pop_front();
-        audio_queue_cv_.notify_all();
-        lock.unlock();
+        xEventGroupSetBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP);
 
         if (!codec_->output_enabled()) {
             esp_timer_stop(audio_power_timer_);
             esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
             codec_->EnableOutput(true);
         }
+#if CONFIG_USE_AUDIO_DEBUGGER
+        audio_debugger_->Feed(kAudioDebugStreamPlayback, task->pcm, 1, codec_->output_sample_rate(),
+            esp_timer_get_time());
+#endif
+#if CONFIG_USE_SERVER_AEC
+        /* Track when this frame becomes audible, uplink frames are stamped against it */
+        int64_t write_start_us = esp_timer_get_time();
         codec_->OutputData(task->pcm);
+        aec_clock_aligner_.OnPlaybackWrite(task->timestamp, task->local, task->pcm.size(), write_start_us, esp_timer_get_time());
+#else
+        codec_->OutputData(task->pcm);
+#endif
+        AudioFlightRecorder::GetInstance().Record(kFlightDownlinkPlayed, task->trace_id, audio_playback_queue_.Size());
 
         /* Update the last output time */
         last_output_time_ = std::chrono::steady_clock::now();
         debug_statistics_.playback_count++;
+    }
 
-#if CONFIG_USE_SERVER_AEC
-        /* Record the timestamp for server AEC */
-        if (task->timestamp > 0) {
-            lock.lock();
-            timestamp_queue_.push_back(task->timestamp);
+    ESP_LOGW(TAG, "Audio output task stopped");
+}
+
+void AudioService::OpusDecoderTask() {
+    decode_queue_clears_ = audio_decode_queue_.clear_count();
+    local_packet_.reset();
+
+    while (!service_stopped_) {
+        if (!DecodeNextFrame()) {
+            /* Popping may have released slots discarded by Clear(), let blocked producers retry */
+            xEventGroupSetBits(event_group_, AS_EVENT_DECODE_QUEUE_NOT_FULL);
+            /* While the jitter buffer is filling up, wake up every frame to check its start deadline */
+            TickType_t timeout = jitter_buffer_.Empty() ? portMAX_DELAY : pdMS_TO_TICKS(jitter_buffer_.frame_duration());
+            xEventGroupWaitBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP, pdTRUE, pdFALSE, timeout);
         }
-#endif
     }
 
-    ESP_LOGW(TAG, "Audio output task stopped");
+    ESP_LOGW(TAG, "Opus decoder task stopped");
+}
+
+void AudioService::OpusEncoderTask() {
+    applied_complexity_ = 0;
+    applied_bitrate_ = 0;
+
+    while (!service_stopped_) {
+        if (!EncodeNextFrame()) {
+            /* Popping may have released slots discarded by Clear(), let blocked producers retry */
+            xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_NOT_FULL);
+            xEventGroupWaitBits(event_group_, AS_EVENT_OPUS_ENCODER_WAKEUP, pdTRUE, pdFALSE, portMAX_DELAY);
+        }
+    }
+
+    ESP_LOGW(TAG, "Opus encoder task stopped");
 }
 
+/* Single-core targets: decode and encode in turn, one frame each, so neither direction starves the other */
 void AudioService::OpusCodecTask() {
-    while (true) {
-        std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-        audio_queue_cv_.wait(lock, [this]() {
-            return service_stopped_ ||
-                (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
-        });
-        if (service_stopped_) {
+    decode_queue_clears_ = audio_decode_queue_.clear_count();
+    local_packet_.reset();
+    applied_complexity_ = 0;
+    applied_bitrate_ = 0;
+
+    while (!service_stopped_) {
+        bool busy = DecodeNextFrame();
+        busy |= EncodeNextFrame();
+        if (!busy) {
+            /* Popping may have released slots discarded by Clear(), let blocked producers retry */
+            xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_NOT_FULL | AS_EVENT_DECODE_QUEUE_NOT_FULL);
+            /* Either side wakes the task, the jitter buffer start deadline as in the decoder task */
+            TickType_t timeout = jitter_buffer_.Empty() ? portMAX_DELAY : pdMS_TO_TICKS(jitter_buffer_.frame_duration());
+            xEventGroupWaitBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP | AS_EVENT_OPUS_ENCODER_WAKEUP, pdTRUE,
+                pdFALSE, timeout);
+        }
+    }
+
+    ESP_LOGW(TAG, "Opus codec task stopped");
+}
+
+bool AudioService::DecodeNextFrame() {
+    bool busy = false;
+
+    /* ResetDecoder() clears the decode queue, drop whatever was taken from it before.
+       The decoder is only touched from this task, so its state is reset here as well */
+    if (audio_decode_queue_.clear_count() != decode_queue_clears_) {
+        decode_queue_clears_ = audio_decode_queue_.clear_count();
+        jitter_buffer_.Reset();
+        local_packet_.reset();
+        opus_decoder_->ResetState();
+    }
+
+    /* Move the arrived packets into the jitter buffer, local packets bypass it */
+    while (!local_packet_ && !jitter_buffer_.Full()) {
+        std::unique_ptr<AudioStreamPacket> packet;
+        if (!audio_decode_queue_.Pop(packet)) {
             break;
         }
+        xEventGroupSetBits(event_group_, AS_EVENT_DECODE_QUEUE_NOT_FULL);
+        if (audio_decode_queue_.clear_count() != decode_queue_clears_) {
+            // Cleared while popping, the packet may be stale
+            busy = true;
+            break;
+        }
+        if (packet->local) {
+            local_packet_ = std::move(packet);
+        } else {
+            jitter_buffer_.Put(std::move(packet), esp_timer_get_time());
+        }
+    }
+
+    /* Decode the next frame: a sound already started, downlink audio, a new sound, then the audio
+       testing replay. A sound only starts while no downlink stream is buffered or playing and then
+       plays to its end, so it is never spliced into the gaps of a stream */
+    if (!audio_playback_queue_.Full()) {
+        std::unique_ptr<AudioStreamPacket> packet;
+        std::unique_ptr<AudioTask> task;
+        auto result = JitterBuffer::kNotReady;
+        bool from_sound = false;
+        if (local_packet_) {
+            packet = std::move(local_packet_);
+        } else {
+            from_sound = ReadSoundFrame(packet, task, false);
+            if (!from_sound) {
+                result = jitter_buffer_.Get(packet, esp_timer_get_time());
+            }
+            if (!from_sound && result == JitterBuffer::kNotReady) {
+                from_sound = ReadSoundFrame(packet, task, jitter_buffer_.Idle());
+                if (!from_sound && !(xEventGroupGetBits(event_group_) & AS_EVENT_AUDIO_TESTING_RUNNING)) {
+                    audio_testing_queue_.Pop(packet);
+                }
+            }
+        }
 
-        /* Decode the audio from decode queue */
-        if (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
-            auto packet = std::move(audio_decode_queue_.front());
-            audio_decode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
+        if (task) {
+            /* Cached sound, skip the decoder */
+            busy = true;
+            audio_playback_queue_.Push(std::move(task));
+            xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_NOT_EMPTY);
+        } else if (packet || result == JitterBuffer::kMissing) {
+            busy = true;
 
-            auto task = std::make_unique<AudioTask>();
+            task = AudioTask::Acquire();
             task->type = kAudioTaskTypeDecodeToPlaybackQueue;
-            task->timestamp = packet->timestamp;
+            task->timestamp = packet ? packet->timestamp : 0;
+            task->local = from_sound || !packet;
+            task->trace_id = packet ? packet->trace_id : 0;
+            auto source = from_sound ? kFlightSourceSound : packet ? kFlightSourcePacket : kFlightSourceConcealed;
+
+            bool decoded;
+            int64_t start_time = esp_timer_get_time();
+            if (packet) {
+                SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
+                decoded = opus_decoder_->Decode(std::move(packet->payload), task->pcm);
+            } else {
+                /* An empty packet asks the decoder to conceal the lost frame, fall back to silence */
+                decoded = opus_decoder_->Decode(std::vector<uint8_t>(), task->pcm);
+                if (!decoded) {
+                    task->pcm.assign(opus_decoder_->sample_rate() * opus_decoder_->duration_ms() / 1000, 0);
+                    decoded = true;
+                }
+            }
 
-            SetDecodeSampleRate(packet->sample_rate, packet->frame_duration);
-            if (opus_decoder_->Decode(std::move(packet->payload), task->pcm)) {
+            if (decoded) {
                 // Resample if the sample rate is different
                 if (opus_decoder_->sample_rate() != codec_->output_sample_rate()) {
                     int target_size = output_resampler_.GetOutputSamples(task->pcm.size());
-                    std::vector<int16_t> resampled(target_size);
-                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resampled.data());
-                    task->pcm = std::move(resampled);
+                    resample_buffer_.resize(target_size);
+                    output_resampler_.Process(task->pcm.data(), task->pcm.size(), resample_buffer_.data());
+                    task->pcm.swap(resample_buffer_);
+                }
+
+                int64_t decode_time = esp_timer_get_time() - start_time;
+                debug_statistics_.decode_time.Record(decode_time, opus_decoder_->duration_ms());
+                AudioFlightRecorder::GetInstance().Record(kFlightDownlinkDecoded, task->trace_id, task->pcm.size(),
+                    source, decode_time);
+
+                if (from_sound && sound_capture_key_ != nullptr) {
+                    sound_capture_.insert(sound_capture_.end(), task->pcm.begin(), task->pcm.end());
+                    if (sound_capture_complete_) {
+                        PcmCache::GetInstance().Put(sound_capture_key_, sound_capture_.data(), sound_capture_.size(),
+                            codec_->output_sample_rate());
+                        sound_capture_key_ = nullptr;
+                        std::vector<int16_t>().swap(sound_capture_);
+                    }
                 }
 
-                lock.lock();
-                audio_playback_queue_.push_back(std::move(task));
-                audio_queue_cv_.notify_all();
+                audio_playback_queue_.Push(std::move(task));
+                xEventGroupSetBits(event_group_, AS_EVENT_PLAYBACK_NOT_EMPTY);
             } else {
                 ESP_LOGE(TAG, "Failed to decode audio");
-                lock.lock();
+                AudioFlightRecorder::GetInstance().Record(kFlightDrop, task->trace_id, 0, kFlightDropDecodeFailed);
+                if (from_sound) {
+                    sound_capture_key_ = nullptr;
+                }
             }
             debug_statistics_.decode_count++;
         }
-        
-        /* Encode the audio to send queue */
-        if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
-            auto task = std::move(audio_encode_queue_.front());
-            audio_encode_queue_.pop_front();
-            audio_queue_cv_.notify_all();
-            lock.unlock();
-
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->frame_duration = OPUS_FRAME_DURATION_MS;
-            packet->sample_rate = 16000;
-            packet->timestamp = task->timestamp;
-            if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
-                ESP_LOGE(TAG, "Failed to encode audio");
-                continue;
-            }
+    }
 
-            if (task->type == kAudioTaskTypeEncodeToSendQueue) {
-                {
-                    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                    audio_send_queue_.push_back(std::move(packet));
-                }
-                if (callbacks_.on_send_queue_available) {
-                    callbacks_.on_send_queue_available();
-                }
-            } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
-                std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-                audio_testing_queue_.push_back(std::move(packet));
-            }
-            debug_statistics_.encode_count++;
-            lock.lock();
+    return busy;
+}
+
+bool AudioService::EncodeNextFrame() {
+    /* Hold the frame back while the send queue is full */
+    std::unique_ptr<AudioTask> task;
+    if (audio_send_queue_.Full() || !audio_encode_queue_.Pop(task)) {
+        return false;
+    }
+    xEventGroupSetBits(event_group_, AS_EVENT_ENCODE_QUEUE_NOT_FULL);
+
+    /* The frame duration follows the PCM frames, so frames queued before a change are still encoded */
+    int frame_duration = task->pcm.size() * 1000 / 16000;
+    auto& profiler = AudioLatencyProfiler::GetInstance();
+    profiler.Record(kAudioLatencyStageEncodeQueue, esp_timer_get_time() - task->queued_time_us, frame_duration);
+    profiler.RecordEncodeQueue(audio_encode_queue_.Size() + 1);
+    if (frame_duration != opus_encoder_->duration_ms()) {
+        if (!IsSupportedFrameDuration(frame_duration)) {
+            ESP_LOGE(TAG, "Unsupported frame of %u samples", task->pcm.size());
+            profiler.CountEncodeDrop();
+            AudioFlightRecorder::GetInstance().Record(kFlightDrop, task->trace_id, 0, kFlightDropUnsupportedFrame);
+            return true;
+        }
+        ESP_LOGI(TAG, "Encoding %dms frames", frame_duration);
+        opus_encoder_ = std::make_unique<OpusEncoderWrapper>(16000, 1, frame_duration);
+        applied_complexity_ = -1;
+        applied_bitrate_ = -1;
+    }
+    if (applied_complexity_ != encoder_complexity_) {
+        applied_complexity_ = encoder_complexity_;
+        opus_encoder_->SetComplexity(applied_complexity_);
+    }
+    if (applied_bitrate_ != encoder_bitrate_) {
+        applied_bitrate_ = encoder_bitrate_;
+        if (applied_bitrate_ > 0) {
+            SetOpusBitrate(*opus_encoder_, applied_bitrate_);
         }
     }
 
-    ESP_LOGW(TAG, "Opus codec task stopped");
+    auto packet = AudioStreamPacket::Acquire();
+    packet->frame_duration = frame_duration;
+    packet->sample_rate = 16000;
+    packet->timestamp = task->timestamp;
+    packet->sequence = 0;
+    packet->trace_id = task->trace_id;
+    int64_t start_time = esp_timer_get_time();
+    if (!opus_encoder_->Encode(std::move(task->pcm), packet->payload)) {
+        ESP_LOGE(TAG, "Failed to encode audio");
+        profiler.CountEncodeDrop();
+        AudioFlightRecorder::GetInstance().Record(kFlightDrop, task->trace_id, 0, kFlightDropEncodeFailed);
+        return true;
+    }
+    int64_t encode_time = esp_timer_get_time() - start_time;
+    debug_statistics_.encode_time.Record(encode_time, frame_duration);
+    AudioFlightRecorder::GetInstance().Record(kFlightUplinkEncoded, packet->trace_id, packet->payload.size(), 0,
+        encode_time);
+
+    if (task->type == kAudioTaskTypeEncodeToSendQueue) {
+        audio_send_queue_.Push(std::move(packet));
+        if (callbacks_.on_send_queue_available) {
+            callbacks_.on_send_queue_available();
+        }
+    } else if (task->type == kAudioTaskTypeEncodeToTestingQueue) {
+        audio_testing_queue_.Push(std::move(packet));
+    }
+    debug_statistics_.encode_count++;
+    return true;
 }
 
 void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
@@ -387,56 +598,75 @@ void AudioService::SetDecodeSampleRate(int sample_rate, int frame_duration) {
 }
 
 void AudioService::PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm) {
-    auto task = std::make_unique<AudioTask>();
+    auto task = AudioTask::Acquire();
     task->type = type;
-    task->pcm = std::move(pcm);
-    
-    /* Push the task to the encode queue */
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-
-    /* If the task is to send queue, we need to set the timestamp */
-    if (type == kAudioTaskTypeEncodeToSendQueue && !timestamp_queue_.empty()) {
-        if (timestamp_queue_.size() <= MAX_TIMESTAMPS_IN_QUEUE) {
-            task->timestamp = timestamp_queue_.front();
-        } else {
-            ESP_LOGW(TAG, "Timestamp queue (%u) is full, dropping timestamp", timestamp_queue_.size());
-        }
-        timestamp_queue_.pop_front();
+    task->timestamp = 0;
+    task->local = false;
+    /* Waiting for room in the encode queue counts as queueing time */
+    task->queued_time_us = esp_timer_get_time();
+    task->trace_id = ++uplink_trace_id_;
+    /* Swap so the caller gets the recycled buffer back and can refill it without allocating */
+    task->pcm.swap(pcm);
+
+#if CONFIG_USE_SERVER_AEC
+    /* Stamp uplink frames with the far-end audio that was audible while they were captured */
+    if (type == kAudioTaskTypeEncodeToSendQueue) {
+        task->timestamp = aec_clock_aligner_.StampUplinkFrame(task->pcm.size());
     }
+#endif
 
-    audio_queue_cv_.wait(lock, [this]() { return audio_encode_queue_.size() < MAX_ENCODE_TASKS_IN_QUEUE; });
-    audio_encode_queue_.push_back(std::move(task));
-    audio_queue_cv_.notify_all();
+    /* Push the task to the encode queue, wait for the opus encoder task if it is full */
+    uint32_t trace_id = task->trace_id;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(encode_producer_mutex_);
+            if (audio_encode_queue_.Push(std::move(task))) {
+                break;
+            }
+        }
+        if (service_stopped_) {
+            return;
+        }
+        xEventGroupWaitBits(event_group_, AS_EVENT_ENCODE_QUEUE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
+    }
+    AudioFlightRecorder::GetInstance().Record(kFlightUplinkQueued, trace_id, audio_encode_queue_.Size());
+    xEventGroupSetBits(event_group_, AS_EVENT_OPUS_ENCODER_WAKEUP);
 }
 
 bool AudioService::PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait) {
-    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
-    if (audio_decode_queue_.size() >= MAX_DECODE_PACKETS_IN_QUEUE) {
-        if (wait) {
-            audio_queue_cv_.wait(lock, [this]() { return audio_decode_queue_.size() < MAX_DECODE_PACKETS_IN_QUEUE; });
-        } else {
+    packet->trace_id = ++downlink_trace_id_;
+    uint32_t trace_id = packet->trace_id;
+    uint32_t sequence = packet->sequence;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(decode_producer_mutex_);
+            if (audio_decode_queue_.Push(std::move(packet))) {
+                break;
+            }
+        }
+        if (!wait || service_stopped_) {
             return false;
         }
+        xEventGroupWaitBits(event_group_, AS_EVENT_DECODE_QUEUE_NOT_FULL, pdTRUE, pdFALSE, portMAX_DELAY);
     }
-    audio_decode_queue_.push_back(std::move(packet));
-    audio_queue_cv_.notify_all();
+    AudioFlightRecorder::GetInstance().Record(kFlightDownlinkReceived, trace_id, audio_decode_queue_.Size(), 0, sequence);
+    xEventGroupSetBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP);
     return true;
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopPacketFromSendQueue() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    if (audio_send_queue_.empty()) {
+    std::unique_ptr<AudioStreamPacket> packet;
+    if (!audio_send_queue_.Pop(packet)) {
         return nullptr;
     }
-    auto packet = std::move(audio_send_queue_.front());
-    audio_send_queue_.pop_front();
-    audio_queue_cv_.notify_all();
+    AudioFlightRecorder::GetInstance().Record(kFlightUplinkSent, packet->trace_id, audio_send_queue_.Size());
+    xEventGroupSetBits(event_group_, AS_EVENT_OPUS_ENCODER_WAKEUP);
     return packet;
 }
 
 void AudioService::EncodeWakeWord() {
     if (wake_word_) {
-        wake_word_->EncodeWakeWordData();
+        wake_word_->EncodeWakeWordData(frame_duration_ms_);
     }
 }
 
@@ -445,7 +675,12 @@ const std::string& AudioService::GetLastWakeWord() const {
 }
 
 std::unique_ptr<AudioStreamPacket> AudioService::PopWakeWordPacket() {
-    auto packet = std::make_unique<AudioStreamPacket>();
+    auto packet = AudioStreamPacket::Acquire();
+    packet->sample_rate = 0;
+    packet->frame_duration = frame_duration_ms_;
+    packet->timestamp = 0;
+    packet->sequence = 0;
+    packet->trace_id = 0;
     if (wake_word_->GetWakeWordOpus(packet->payload)) {
         return packet;
     }
@@ -458,6 +693,7 @@ void AudioService::EnableWakeWordDetection(bool enable) {
     }
 
     ESP_LOGD(TAG, "%s wake word detection", enable ? "Enabling" : "Disabling");
+    AudioFlightRecorder::GetInstance().Record(kFlightAudioState, enable, 0, kFlightComponentWakeWord);
     if (enable) {
         if (!wake_word_initialized_) {
             if (!wake_word_->Initialize(codec_, models_list_)) {
@@ -476,14 +712,16 @@ void AudioService::EnableWakeWordDetection(bool enable) {
 
 void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
+    AudioFlightRecorder::GetInstance().Record(kFlightAudioState, enable, 0, kFlightComponentProcessor);
     if (enable) {
         if (!audio_processor_initialized_) {
-            audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+            audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
             audio_processor_initialized_ = true;
         }
 
         /* We should make sure no audio is playing */
         ResetDecoder();
+        aec_clock_aligner_.ResetCapture();
         audio_input_need_warmup_ = true;
         audio_processor_->Start();
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_PROCESSOR_RUNNING);
@@ -495,21 +733,20 @@ void AudioService::EnableVoiceProcessing(bool enable) {
 
 void AudioService::EnableAudioTesting(bool enable) {
     ESP_LOGI(TAG, "%s audio testing", enable ? "Enabling" : "Disabling");
+    AudioFlightRecorder::GetInstance().Record(kFlightAudioState, enable, 0, kFlightComponentTesting);
     if (enable) {
         xEventGroupSetBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
     } else {
         xEventGroupClearBits(event_group_, AS_EVENT_AUDIO_TESTING_RUNNING);
-        /* Copy audio_testing_queue_ to audio_decode_queue_ */
-        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-        audio_decode_queue_ = std::move(audio_testing_queue_);
-        audio_queue_cv_.notify_all();
+        /* The opus decoder task replays audio_testing_queue_ once the decode queue is drained */
+        xEventGroupSetBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP);
     }
 }
 
 void AudioService::EnableDeviceAec(bool enable) {
     ESP_LOGI(TAG, "%s device AEC", enable ? "Enabling" : "Disabling");
     if (!audio_processor_initialized_) {
-        audio_processor_->Initialize(codec_, OPUS_FRAME_DURATION_MS, models_list_);
+        audio_processor_->Initialize(codec_, frame_duration_ms_, models_list_);
         audio_processor_initialized_ = true;
     }
 
@@ -527,111 +764,101 @@ void AudioService::PlaySound(const std::string_view& ogg) {
         codec_->EnableOutput(true);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
-
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+    {
+        std::lock_guard<std::mutex> lock(sounds_mutex_);
+        auto& demuxer = sound_index_[ogg.data()];
+        if (demuxer == nullptr) {
+            demuxer = std::make_unique<OggDemuxer>();
+            demuxer->Parse(ogg);
+        }
+        if (demuxer->packet_count() == 0) {
+            return;
         }
-        return static_cast<size_t>(-1);
-    };
 
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
+        PendingSound sound = {ogg.data(), demuxer.get(), 0, false, nullptr, 0};
+        auto& cache = PcmCache::GetInstance();
+        if (cache.enabled() && demuxer->packet_count() * demuxer->frame_duration() <= SOUND_PCM_CACHE_MAX_DURATION_MS) {
+            sound.cacheable = true;
+            sound.pcm = cache.Get(sound.key, codec_->output_sample_rate());
+        }
+        pending_sounds_.push_back(std::move(sound));
+    }
+    xEventGroupSetBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP);
+}
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) | 
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d", 
-                                   version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
-            }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
-            }
+/*
+ * Take the next frame of the queued sounds. A cached sound fills the task with PCM that goes
+ * straight to the playback queue, otherwise the packet needs decoding.
+ */
+bool AudioService::ReadSoundFrame(std::unique_ptr<AudioStreamPacket>& packet, std::unique_ptr<AudioTask>& task, bool may_start) {
+    std::lock_guard<std::mutex> lock(sounds_mutex_);
+    if (pending_sounds_.empty()) {
+        return false;
+    }
+    auto& sound = pending_sounds_.front();
+    if (!may_start && sound.next_packet == 0 && sound.next_sample == 0) {
+        return false;
+    }
 
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
+    if (sound.pcm != nullptr) {
+        size_t frame_samples = sound.pcm->sample_rate * sound.demuxer->frame_duration() / 1000;
+        size_t samples = std::min(frame_samples, sound.pcm->samples - sound.next_sample);
+        task = AudioTask::Acquire();
+        task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+        task->timestamp = 0;
+        task->local = true;
+        task->trace_id = 0;
+        auto begin = sound.pcm->data + sound.next_sample;
+        task->pcm.assign(begin, begin + samples);
+        sound.next_sample += samples;
+        if (sound.next_sample >= sound.pcm->samples) {
+            pending_sounds_.pop_front();
         }
+        return true;
+    }
 
-        offset = body_off + body_size;
+    if (sound.next_packet == 0) {
+        sound_capture_key_ = sound.cacheable ? sound.key : nullptr;
+        sound_capture_.clear();
+    }
+    packet = AudioStreamPacket::Acquire();
+    packet->sample_rate = sound.demuxer->sample_rate();
+    packet->frame_duration = sound.demuxer->frame_duration();
+    packet->timestamp = 0;
+    packet->sequence = 0;
+    packet->local = true;
+    packet->trace_id = 0;
+    sound.demuxer->ReadPacket(sound.next_packet++, packet->payload);
+    sound_capture_complete_ = sound.next_packet >= sound.demuxer->packet_count();
+    if (sound_capture_complete_) {
+        pending_sounds_.pop_front();
     }
+    return true;
 }
 
 bool AudioService::IsIdle() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    {
+        std::lock_guard<std::mutex> lock(sounds_mutex_);
+        if (!pending_sounds_.empty()) {
+            return false;
+        }
+    }
+    return audio_encode_queue_.Empty() && audio_decode_queue_.Empty() && jitter_buffer_.Empty() &&
+        audio_playback_queue_.Empty() && audio_testing_queue_.Empty();
 }
 
 void AudioService::ResetDecoder() {
-    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    opus_decoder_->ResetState();
-    timestamp_queue_.clear();
-    audio_decode_queue_.clear();
-    audio_playback_queue_.clear();
-    audio_testing_queue_.clear();
-    audio_queue_cv_.notify_all();
+    /* The decoder task resets the decoder when it sees the decode queue cleared */
+    aec_clock_aligner_.ResetPlayback();
+    audio_decode_queue_.Clear();
+    audio_playback_queue_.Clear();
+    audio_testing_queue_.Clear();
+    {
+        std::lock_guard<std::mutex> lock(sounds_mutex_);
+        pending_sounds_.clear();
+    }
+    /* Wake up the consumers to release the discarded packets */
+    xEventGroupSetBits(event_group_, AS_EVENT_OPUS_DECODER_WAKEUP | AS_EVENT_PLAYBACK_NOT_EMPTY);
 }
 
 void AudioService::CheckAndUpdateAudioPowerState() {
@@ -649,6 +876,69 @@ void AudioService::CheckAndUpdateAudioPowerState() {
     }
 }
 
+void AudioService::PrintStats() {
+    auto& packet_pool = ObjectPool<AudioStreamPacket>::GetInstance();
+    auto& task_pool = ObjectPool<AudioTask>::GetInstance();
+    ESP_LOGI(TAG, "packet pool: %u/%u used, peak %u, misses %u; task pool: %u/%u used, peak %u, misses %u",
+        packet_pool.in_use(), packet_pool.capacity(), packet_pool.high_water(), packet_pool.misses(),
+        task_pool.in_use(), task_pool.capacity(), task_pool.high_water(), task_pool.misses());
+
+    auto jitter = jitter_buffer_.GetStats();
+    ESP_LOGI(TAG, "jitter buffer: depth %u/%d, jitter %dms, underruns %lu, late %lu, dropped %lu, concealed %lu",
+        jitter.depth, jitter.target_depth, jitter.jitter_ms, jitter.underruns, jitter.late_packets,
+        jitter.dropped_packets, jitter.concealed_frames);
+
+    auto print_time = [](const char* name, const FrameTimeStats& stats) {
+        if (stats.frames > 0) {
+            ESP_LOGI(TAG, "%s: %lu frames, avg %lluus, max %luus, %lu over budget", name, stats.frames,
+                stats.total_us / stats.frames, stats.max_us, stats.over_budget);
+        }
+    };
+    print_time("decode", debug_statistics_.decode_time);
+    print_time("encode", debug_statistics_.encode_time);
+
+#if CONFIG_USE_SERVER_AEC
+    auto aec = aec_clock_aligner_.GetStats();
+    ESP_LOGI(TAG, "aec alignment: %lu played, %lu stamped, %lu silent, output latency %ldus, "
+        "%lu corrections, drift last %ldus max %ldus", aec.played_frames, aec.stamped_frames, aec.silent_frames,
+        aec.output_latency_us, aec.corrections, aec.last_drift_us, aec.max_drift_us);
+#endif
+}
+
+void AudioService::SetEncoderConfig(const OpusEncoderConfig& config) {
+    int frame_duration = config.frame_duration;
+    if (!IsSupportedFrameDuration(frame_duration)) {
+        ESP_LOGW(TAG, "Unsupported frame duration %dms, using %dms", frame_duration, OPUS_FRAME_DURATION_MS);
+        frame_duration = OPUS_FRAME_DURATION_MS;
+    }
+    int bitrate = config.bitrate;
+    if (bitrate != 0 && (!kSupportsBitrate || !IsSupportedBitrate(bitrate))) {
+        ESP_LOGW(TAG, "Unsupported bitrate %d, letting the encoder decide", bitrate);
+        bitrate = 0;
+    }
+    encoder_complexity_ = std::clamp(config.complexity, 0, OPUS_MAX_COMPLEXITY);
+    encoder_bitrate_ = bitrate;
+
+    if (frame_duration != frame_duration_ms_) {
+        ESP_LOGI(TAG, "Uplink frame duration %dms", frame_duration);
+        frame_duration_ms_ = frame_duration;
+        if (audio_processor_initialized_) {
+            audio_processor_->SetFrameDuration(frame_duration);
+        }
+    }
+    audio_send_queue_.SetLimit(AUDIO_QUEUE_DURATION_MS / frame_duration);
+    audio_testing_queue_.SetLimit(AUDIO_TESTING_MAX_DURATION_MS / frame_duration);
+    /* Wake up the encoder to apply the settings */
+    xEventGroupSetBits(event_group_, AS_EVENT_OPUS_ENCODER_WAKEUP);
+}
+
+void AudioService::SetDecodeFrameDuration(int frame_duration) {
+    if (frame_duration <= 0) {
+        return;
+    }
+    audio_decode_queue_.SetLimit(AUDIO_QUEUE_DURATION_MS / std::max(frame_duration, OPUS_MIN_FRAME_DURATION_MS));
+}
+
 void AudioService::SetModelsList(srmodel_list_t* models_list) {
     models_list_ = models_list;
 
@@ -3,9 +3,10 @@
 
 #include <memory>
 #include <deque>
-#include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
+#include <map>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
@@ -17,31 +18,67 @@
 #include <opus_decoder.h>
 #include <opus_resampler.h>
 
+#include "opus_config.h"
 #include "audio_codec.h"
 #include "audio_processor.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
 #include "protocol.h"
+#include "spsc_ring.h"
+#include "object_pool.h"
+#include "jitter_buffer.h"
+#include "ogg_demuxer.h"
+#include "pcm_cache.h"
+#include "multi_channel_resampler.h"
+#include "audio_latency_profiler.h"
+#include "audio_flight_recorder.h"
+#include "aec_clock_aligner.h"
 
 
 /*
  * There are two types of audio data flow:
  * 1. (MIC) -> [Processors] -> {Encode Queue} -> [Opus Encoder] -> {Send Queue} -> (Server)
- * 2. (Server) -> {Decode Queue} -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
+ * 2. (Server) -> {Decode Queue} -> [Jitter Buffer] -> [Opus Decoder] -> {Playback Queue} -> (Speaker)
  *
- * We use one task for MIC / Speaker / Processors, and one task for Opus Encoder / Opus Decoder.
+ * We use one task for MIC / Speaker / Processors, and one task each for Opus Encoder and Opus Decoder,
+ * so a burst in one direction does not delay the other.
  * 
  * Decode Queue and Send Queue are the main queues, because Opus packets are quite smaller than PCM packets.
  * 
+ * Every queue is a lock-free SPSC ring. Tasks sleep on their own bit in the event group,
+ * and whoever pushes or pops a ring sets the bit of the task on the other side.
+ * 
  */
 
-#define OPUS_FRAME_DURATION_MS 60
 #define MAX_ENCODE_TASKS_IN_QUEUE 2
 #define MAX_PLAYBACK_TASKS_IN_QUEUE 2
-#define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
-#define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
+// The decode and send queues hold this much audio, their packet limits follow the frame duration
+#define AUDIO_QUEUE_DURATION_MS 2400
+#define MAX_DECODE_PACKETS_IN_QUEUE (AUDIO_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+#define MAX_SEND_PACKETS_IN_QUEUE (AUDIO_QUEUE_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
-#define MAX_TIMESTAMPS_IN_QUEUE 3
+#define MAX_TESTING_PACKETS_IN_QUEUE (AUDIO_TESTING_MAX_DURATION_MS / OPUS_MIN_FRAME_DURATION_MS)
+// Enough for full decode and send queues at the default frame duration, shorter frames may fall back to the heap
+#define AUDIO_PACKET_POOL_SIZE (2 * AUDIO_QUEUE_DURATION_MS / OPUS_FRAME_DURATION_MS + 8)
+#define AUDIO_TASK_POOL_SIZE (MAX_ENCODE_TASKS_IN_QUEUE + MAX_PLAYBACK_TASKS_IN_QUEUE + 4)
+// Downlink jitter buffer depth in frames, the target adapts to the measured jitter within this range
+#define JITTER_BUFFER_MIN_DEPTH 1
+#define JITTER_BUFFER_MAX_DEPTH 6
+// Longer sounds are always decoded, see CONFIG_SOUND_PCM_CACHE_SIZE_KB
+#define SOUND_PCM_CACHE_MAX_DURATION_MS 2000
+
+// On one core a second codec task only costs its stack and context switches, encode and decode share one task
+#if CONFIG_FREERTOS_UNICORE || portNUM_PROCESSORS == 1
+#define OPUS_SINGLE_CODEC_TASK 1
+#else
+#define OPUS_SINGLE_CODEC_TASK 0
+#endif
+// The uplink encoder gets the core without the audio input task and a higher priority than the decoder
+#define OPUS_ENCODER_TASK_CORE 1
+#define OPUS_DECODER_TASK_CORE 0
+#define OPUS_ENCODER_TASK_PRIORITY 3
+#define OPUS_DECODER_TASK_PRIORITY 2
+#define OPUS_CODEC_TASK_PRIORITY 2
 
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
@@ -51,6 +88,13 @@
 #define AS_EVENT_WAKE_WORD_RUNNING          (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
 #define AS_EVENT_PLAYBACK_NOT_EMPTY         (1 << 3)
+#define AS_EVENT_OPUS_DECODER_WAKEUP        (1 << 4)
+#define AS_EVENT_ENCODE_QUEUE_NOT_FULL      (1 << 5)
+#define AS_EVENT_DECODE_QUEUE_NOT_FULL      (1 << 6)
+#define AS_EVENT_OPUS_ENCODER_WAKEUP        (1 << 7)
+#define AS_EVENT_QUEUE_WAKEUPS              (AS_EVENT_PLAYBACK_NOT_EMPTY | AS_EVENT_OPUS_DECODER_WAKEUP | \
+                                             AS_EVENT_OPUS_ENCODER_WAKEUP | AS_EVENT_ENCODE_QUEUE_NOT_FULL | \
+                                             AS_EVENT_DECODE_QUEUE_NOT_FULL)
 
 struct AudioServiceCallbacks {
     std::function<void(void)> on_send_queue_available;
@@ -70,6 +114,45 @@ struct AudioTask {
     AudioTaskType type;
     std::vector<int16_t> pcm;
     uint32_t timestamp;
+    bool local;             // Played audio that is not from the server: sounds and concealed frames
+    int64_t queued_time_us;
+    uint32_t trace_id;      // Frame id in the flight recorder, 0 for sounds and concealed frames
+
+    // Take a task from the pool, the PCM buffer keeps its capacity from the previous use
+    static std::unique_ptr<AudioTask> Acquire();
+};
+
+// Pooled tasks go back to the pool instead of being freed
+template <>
+struct std::default_delete<AudioTask> {
+    void operator()(AudioTask* task) const {
+        if (!ObjectPool<AudioTask>::GetInstance().Release(task)) {
+            delete task;
+        }
+    }
+};
+
+inline std::unique_ptr<AudioTask> AudioTask::Acquire() {
+    return ObjectPool<AudioTask>::GetInstance().Acquire();
+}
+
+// Time spent per frame, compared to the frame duration it has to keep up with
+struct FrameTimeStats {
+    uint32_t frames = 0;
+    uint32_t over_budget = 0;
+    uint32_t max_us = 0;
+    uint64_t total_us = 0;
+
+    void Record(int64_t elapsed_us, int frame_duration_ms) {
+        frames++;
+        total_us += elapsed_us;
+        if (elapsed_us > max_us) {
+            max_us = elapsed_us;
+        }
+        if (elapsed_us > frame_duration_ms * 1000) {
+            over_budget++;
+        }
+    }
 };
 
 struct DebugStatistics {
@@ -77,6 +160,8 @@ struct DebugStatistics {
     uint32_t decode_count = 0;
     uint32_t encode_count = 0;
     uint32_t playback_count = 0;
+    FrameTimeStats decode_time;
+    FrameTimeStats encode_time;
 };
 
 class AudioService {
@@ -105,10 +190,19 @@ public:
 
     bool PushPacketToDecodeQueue(std::unique_ptr<AudioStreamPacket> packet, bool wait = false);
     std::unique_ptr<AudioStreamPacket> PopPacketFromSendQueue();
+    // Queue an embedded Ogg/Opus sound and return, the decoder task pulls its frames on demand
     void PlaySound(const std::string_view& sound);
     bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples);
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
+    void PrintStats();
+    // Whether the opus wrapper can set a bitrate, hello only advertises bitrates when it can
+    static constexpr bool kSupportsBitrate = OpusHasBitrateControl<OpusEncoderWrapper>::value;
+    // Uplink opus settings picked by the server, unsupported values fall back to the defaults
+    void SetEncoderConfig(const OpusEncoderConfig& config);
+    // Downlink packet duration, the decode queue limit follows it
+    void SetDecodeFrameDuration(int frame_duration);
+    int frame_duration() const { return frame_duration_ms_; }
 
 private:
     AudioCodec* codec_ = nullptr;
@@ -118,9 +212,12 @@ private:
     std::unique_ptr<AudioDebugger> audio_debugger_;
     std::unique_ptr<OpusEncoderWrapper> opus_encoder_;
     std::unique_ptr<OpusDecoderWrapper> opus_decoder_;
-    OpusResampler input_resampler_;
-    OpusResampler reference_resampler_;
+    // Mic and reference channels are resampled together
+    MultiChannelResampler input_resampler_;
     OpusResampler output_resampler_;
+    std::vector<int16_t> resample_buffer_;
+    // Codec input of ReadAudioData before resampling, reused across reads
+    std::vector<int16_t> input_buffer_;
     DebugStatistics debug_statistics_;
     srmodel_list_t* models_list_ = nullptr;
 
@@ -129,22 +226,56 @@ private:
     // Audio encode / decode
     TaskHandle_t audio_input_task_handle_ = nullptr;
     TaskHandle_t audio_output_task_handle_ = nullptr;
-    TaskHandle_t opus_codec_task_handle_ = nullptr;
-    std::mutex audio_queue_mutex_;
-    std::condition_variable audio_queue_cv_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_send_queue_;
-    std::deque<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_encode_queue_;
-    std::deque<std::unique_ptr<AudioTask>> audio_playback_queue_;
+    // Both handles point to the one codec task with OPUS_SINGLE_CODEC_TASK
+    TaskHandle_t opus_decoder_task_handle_ = nullptr;
+    TaskHandle_t opus_encoder_task_handle_ = nullptr;
+    SpscRing<std::unique_ptr<AudioStreamPacket>> audio_decode_queue_{MAX_DECODE_PACKETS_IN_QUEUE};
+    SpscRing<std::unique_ptr<AudioStreamPacket>> audio_send_queue_{MAX_SEND_PACKETS_IN_QUEUE};
+    SpscRing<std::unique_ptr<AudioStreamPacket>> audio_testing_queue_{MAX_TESTING_PACKETS_IN_QUEUE};
+    SpscRing<std::unique_ptr<AudioTask>> audio_encode_queue_{MAX_ENCODE_TASKS_IN_QUEUE};
+    SpscRing<std::unique_ptr<AudioTask>> audio_playback_queue_{MAX_PLAYBACK_TASKS_IN_QUEUE};
+    JitterBuffer jitter_buffer_{MAX_DECODE_PACKETS_IN_QUEUE, JITTER_BUFFER_MIN_DEPTH, JITTER_BUFFER_MAX_DEPTH};
+    // Decode and encode queues have more than one producer, serialize them
+    std::mutex decode_producer_mutex_;
+    std::mutex encode_producer_mutex_;
     // For server AEC
-    std::deque<uint32_t> timestamp_queue_;
+    AecClockAligner aec_clock_aligner_;
+    // Sounds queued by PlaySound, each sound is indexed once on its first play
+    struct PendingSound {
+        const char* key;
+        const OggDemuxer* demuxer;
+        size_t next_packet;
+        bool cacheable;
+        // Cached sounds are played from their decoded PCM
+        std::shared_ptr<const PcmBuffer> pcm;
+        size_t next_sample;
+    };
+    std::mutex sounds_mutex_;
+    std::map<const char*, std::unique_ptr<OggDemuxer>> sound_index_;
+    std::deque<PendingSound> pending_sounds_;
+    // Decoded PCM of the sound being played, cached once it is complete
+    const char* sound_capture_key_ = nullptr;
+    bool sound_capture_complete_ = false;
+    std::vector<int16_t> sound_capture_;
 
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
     bool service_stopped_ = true;
     bool audio_input_need_warmup_ = false;
+    std::atomic<int> frame_duration_ms_{OPUS_FRAME_DURATION_MS};
+    std::atomic<int> encoder_complexity_{0};
+    std::atomic<int> encoder_bitrate_{0};
+    // Owned by the task that decodes: the last clear of the decode queue it saw and a local packet
+    // waiting to be decoded
+    uint32_t decode_queue_clears_ = 0;
+    std::unique_ptr<AudioStreamPacket> local_packet_;
+    // Owned by the task that encodes: the settings applied to the current encoder
+    int applied_complexity_ = 0;
+    int applied_bitrate_ = 0;
+    // Frame ids for the flight recorder
+    std::atomic<uint32_t> uplink_trace_id_{0};
+    std::atomic<uint32_t> downlink_trace_id_{0};
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
     std::chrono::steady_clock::time_point last_input_time_;
@@ -152,9 +283,15 @@ private:
 
     void AudioInputTask();
     void AudioOutputTask();
+    void OpusDecoderTask();
+    void OpusEncoderTask();
     void OpusCodecTask();
+    // One step of the decoder and encoder tasks, false when there was nothing to do
+    bool DecodeNextFrame();
+    bool EncodeNextFrame();
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
+    bool ReadSoundFrame(std::unique_ptr<AudioStreamPacket>& packet, std::unique_ptr<AudioTask>& task, bool may_start);
     void CheckAndUpdateAudioPowerState();
 };
 
@@ -0,0 +1,240 @@
+#include "file_audio_codec.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "FileAudioCodec"
+
+namespace {
+
+struct WavHeader {
+    char riff[4];
+    uint32_t riff_size;
+    char wave[4];
+    char fmt[4];
+    uint32_t fmt_size;
+    uint16_t format;
+    uint16_t channels;
+    uint32_t sample_rate;
+    uint32_t byte_rate;
+    uint16_t block_align;
+    uint16_t bits_per_sample;
+    char data[4];
+    uint32_t data_size;
+};
+static_assert(sizeof(WavHeader) == 44, "Canonical WAV header is 44 bytes");
+
+}  // namespace
+
+FileAudioCodec::FileAudioCodec(const char* input_path, const char* output_path, int output_sample_rate,
+                               float speed, bool loop)
+    : speed_(speed), loop_(loop) {
+    duplex_ = true;
+    output_channels_ = 1;
+    output_sample_rate_ = output_sample_rate;
+
+    if (!OpenInput(input_path)) {
+        // Keep the pipeline running on silence, the rate still has to be valid
+        input_sample_rate_ = 16000;
+        input_channels_ = 1;
+        input_reference_ = false;
+    }
+
+    output_file_ = fopen(output_path, "wb");
+    if (output_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s for playback", output_path);
+    } else {
+        WriteOutputHeader();
+    }
+    ESP_LOGI(TAG, "FileAudioCodec initialized, input %d Hz x%d, output %d Hz, speed %.1f",
+        input_sample_rate_, input_channels_, output_sample_rate_, speed_);
+}
+
+FileAudioCodec::~FileAudioCodec() {
+    if (input_file_ != nullptr) {
+        fclose(input_file_);
+    }
+    if (output_file_ != nullptr) {
+        WriteOutputHeader();
+        fclose(output_file_);
+    }
+}
+
+bool FileAudioCodec::OpenInput(const char* path) {
+    input_file_ = fopen(path, "rb");
+    if (input_file_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return false;
+    }
+
+    char riff[12];
+    if (fread(riff, 1, sizeof(riff), input_file_) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        ESP_LOGE(TAG, "%s is not a WAV file", path);
+        fclose(input_file_);
+        input_file_ = nullptr;
+        return false;
+    }
+
+    // Walk the chunks, recorders often put LIST chunks before data
+    bool has_format = false;
+    char chunk_id[4];
+    uint32_t chunk_size;
+    while (fread(chunk_id, 1, 4, input_file_) == 4 && fread(&chunk_size, 4, 1, input_file_) == 1) {
+        if (memcmp(chunk_id, "fmt ", 4) == 0 && chunk_size >= 16) {
+            uint16_t format, channels, block_align, bits_per_sample;
+            uint32_t sample_rate, byte_rate;
+            fread(&format, 2, 1, input_file_);
+            fread(&channels, 2, 1, input_file_);
+            fread(&sample_rate, 4, 1, input_file_);
+            fread(&byte_rate, 4, 1, input_file_);
+            fread(&block_align, 2, 1, input_file_);
+            fread(&bits_per_sample, 2, 1, input_file_);
+            if (format != 1 || bits_per_sample != 16 || channels < 1 || channels > 2) {
+                ESP_LOGE(TAG, "%s must be 16-bit PCM with 1 or 2 channels", path);
+                break;
+            }
+            input_sample_rate_ = sample_rate;
+            input_channels_ = channels;
+            input_reference_ = channels == 2;
+            has_format = true;
+            fseek(input_file_, (chunk_size - 16 + 1) & ~1u, SEEK_CUR);
+        } else if (memcmp(chunk_id, "data", 4) == 0) {
+            if (!has_format) {
+                break;
+            }
+            input_data_offset_ = ftell(input_file_);
+            input_data_size_ = chunk_size / 2;
+            return true;
+        } else {
+            fseek(input_file_, (chunk_size + 1) & ~1u, SEEK_CUR);
+        }
+    }
+
+    ESP_LOGE(TAG, "%s has no usable audio data", path);
+    fclose(input_file_);
+    input_file_ = nullptr;
+    return false;
+}
+
+void FileAudioCodec::WriteOutputHeader() {
+    uint32_t data_bytes = output_data_size_ * sizeof(int16_t);
+    WavHeader header;
+    memcpy(header.riff, "RIFF", 4);
+    header.riff_size = sizeof(WavHeader) - 8 + data_bytes;
+    memcpy(header.wave, "WAVE", 4);
+    memcpy(header.fmt, "fmt ", 4);
+    header.fmt_size = 16;
+    header.format = 1;
+    header.channels = output_channels_;
+    header.sample_rate = output_sample_rate_;
+    header.byte_rate = output_sample_rate_ * output_channels_ * sizeof(int16_t);
+    header.block_align = output_channels_ * sizeof(int16_t);
+    header.bits_per_sample = 16;
+    memcpy(header.data, "data", 4);
+    header.data_size = data_bytes;
+
+    long position = ftell(output_file_);
+    fseek(output_file_, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, output_file_);
+    if (position > (long)sizeof(header)) {
+        fseek(output_file_, position, SEEK_SET);
+    }
+    fflush(output_file_);
+}
+
+long FileAudioCodec::remaining_input_samples() const {
+    if (input_file_ == nullptr) {
+        return 0;
+    }
+    return loop_ ? -1 : input_data_size_ - input_position_;
+}
+
+void FileAudioCodec::EnableInput(bool enable) {
+    if (enable && !input_enabled_) {
+        input_start_us_ = 0;
+    }
+    AudioCodec::EnableInput(enable);
+}
+
+void FileAudioCodec::EnableOutput(bool enable) {
+    if (enable && !output_enabled_) {
+        output_start_us_ = 0;
+    }
+    if (!enable && output_enabled_ && output_file_ != nullptr) {
+        // Leave a playable file behind whenever playback pauses
+        WriteOutputHeader();
+    }
+    AudioCodec::EnableOutput(enable);
+}
+
+void FileAudioCodec::WaitForClock(int64_t start_us, int64_t frames, int sample_rate) {
+    // Block for at least one tick even when unpaced or running late, the audio tasks calling in a
+    // loop would otherwise starve lower priority tasks and the task watchdog
+    int64_t wait_us = 0;
+    if (speed_ > 0) {
+        int64_t due_us = start_us + (int64_t)(frames * 1000000.0 / (sample_rate * speed_));
+        wait_us = due_us - esp_timer_get_time();
+    }
+    vTaskDelay(std::max<TickType_t>(1, pdMS_TO_TICKS(std::max<int64_t>(wait_us, 0) / 1000)));
+}
+
+int FileAudioCodec::Read(int16_t* dest, int samples) {
+    if (input_start_us_ == 0) {
+        input_start_us_ = esp_timer_get_time();
+        input_frames_ = 0;
+    }
+
+    int read = 0;
+    while (read < samples && input_file_ != nullptr && !input_ended_) {
+        if (input_position_ >= input_data_size_) {
+            if (!loop_) {
+                input_ended_ = true;
+                ESP_LOGI(TAG, "Input file ended, feeding silence");
+                break;
+            }
+            fseek(input_file_, input_data_offset_, SEEK_SET);
+            input_position_ = 0;
+        }
+        size_t count = std::min<long>(samples - read, input_data_size_ - input_position_);
+        size_t got = fread(dest + read, sizeof(int16_t), count, input_file_);
+        if (got == 0) {
+            // Truncated data chunk, replay only what is there
+            if (input_position_ == 0) {
+                input_ended_ = true;
+                break;
+            }
+            input_data_size_ = input_position_;
+            continue;
+        }
+        read += got;
+        input_position_ += got;
+    }
+    if (read < samples) {
+        memset(dest + read, 0, (samples - read) * sizeof(int16_t));
+    }
+
+    input_frames_ += samples / input_channels_;
+    WaitForClock(input_start_us_, input_frames_, input_sample_rate_);
+    return samples;
+}
+
+int FileAudioCodec::Write(const int16_t* data, int samples) {
+    if (output_start_us_ == 0) {
+        output_start_us_ = esp_timer_get_time();
+        output_frames_ = 0;
+    }
+
+    if (output_file_ != nullptr) {
+        size_t written = fwrite(data, sizeof(int16_t), samples, output_file_);
+        output_data_size_ += written;
+    }
+
+    output_frames_ += samples / output_channels_;
+    WaitForClock(output_start_us_, output_frames_, output_sample_rate_);
+    return samples;
+}
@@ -0,0 +1,61 @@
+#ifndef _FILE_AUDIO_CODEC_H
+#define _FILE_AUDIO_CODEC_H
+
+#include "audio_codec.h"
+
+#include <cstdio>
+
+/*
+ * Audio codec backed by WAV files instead of I2S, for replaying a recorded session through
+ * the audio pipeline without a microphone or speaker.
+ *
+ * Input is 16-bit PCM, mono for the microphone only or stereo for microphone + reference.
+ * Playback is written to a mono 16-bit WAV, the header is patched when output is disabled
+ * and when the codec is destroyed.
+ *
+ * Both directions are paced by esp_timer like the I2S clock would, divided by speed,
+ * so speed 4 runs a session four times faster; speed 0 disables pacing. Every read and
+ * write still blocks for at least one tick.
+ *
+ * Built on host by host_test/, where it feeds the tests and benchmarks with WAV files.
+ */
+class FileAudioCodec : public AudioCodec {
+public:
+    FileAudioCodec(const char* input_path, const char* output_path, int output_sample_rate,
+                   float speed = 1.0f, bool loop = false);
+    virtual ~FileAudioCodec();
+
+    virtual void EnableInput(bool enable) override;
+    virtual void EnableOutput(bool enable) override;
+
+    // Input samples left before the file ends, -1 when looping
+    long remaining_input_samples() const;
+    // Playback samples written so far
+    long output_samples() const { return output_data_size_; }
+
+private:
+    FILE* input_file_ = nullptr;
+    FILE* output_file_ = nullptr;
+    long input_data_offset_ = 0;
+    long input_data_size_ = 0;
+    long input_position_ = 0;
+    long output_data_size_ = 0;
+    float speed_;
+    bool loop_;
+    bool input_ended_ = false;
+
+    // Pacing, samples per channel handled since the clock started
+    int64_t input_start_us_ = 0;
+    int64_t input_frames_ = 0;
+    int64_t output_start_us_ = 0;
+    int64_t output_frames_ = 0;
+
+    bool OpenInput(const char* path);
+    void WriteOutputHeader();
+    void WaitForClock(int64_t start_us, int64_t frames, int sample_rate);
+
+    virtual int Read(int16_t* dest, int samples) override;
+    virtual int Write(const int16_t* data, int samples) override;
+};
+
+#endif // _FILE_AUDIO_CODEC_H
@@ -0,0 +1,183 @@
+#include "jitter_buffer.h"
+#include <esp_log.h>
+#include <algorithm>
+#include <cstdlib>
+
+#define TAG "JitterBuffer"
+
+// Conceal at most this many frames in a row before skipping to the next available packet
+#define MAX_CONSECUTIVE_MISSING_FRAMES 3
+
+
+JitterBuffer::JitterBuffer(size_t capacity, int min_depth, int max_depth)
+    : slots_(new std::unique_ptr<AudioStreamPacket>[capacity]), capacity_(capacity),
+      min_depth_(min_depth), max_depth_(max_depth), target_depth_(min_depth) {
+}
+
+void JitterBuffer::Reset() {
+    for (size_t i = 0; i < capacity_; i++) {
+        slots_[i].reset();
+    }
+    count_ = 0;
+    synced_ = false;
+    playing_ = false;
+    started_ = false;
+    starved_ = false;
+    consecutive_missing_ = 0;
+    has_last_arrival_ = false;
+}
+
+bool JitterBuffer::Put(std::unique_ptr<AudioStreamPacket>&& packet, int64_t arrival_us) {
+    uint32_t sequence = packet->sequence;
+    frame_duration_ms_ = packet->frame_duration;
+
+    int32_t offset = static_cast<int32_t>(sequence - next_sequence_);
+    if (!synced_ || (count_ == 0 && (offset <= -(int32_t)capacity_ || offset >= (int32_t)capacity_))) {
+        // A new stream, or the sequence jumped while nothing was buffered
+        next_sequence_ = sequence;
+        synced_ = true;
+        playing_ = false;
+        started_ = false;
+        starved_ = false;
+        offset = 0;
+    } else if (offset < 0 && !started_ && MaxBufferedOffset() - offset < (int32_t)capacity_) {
+        // Reordered ahead of the stream start, it can still be played
+        next_sequence_ = sequence;
+        offset = 0;
+    }
+
+    if (offset < 0) {
+        stats_.late_packets++;
+        return false;
+    }
+    if (offset >= (int32_t)capacity_) {
+        ESP_LOGW(TAG, "Packet %lu is too far ahead of %lu, dropping", sequence, next_sequence_);
+        stats_.dropped_packets++;
+        return false;
+    }
+
+    auto& slot = slots_[sequence % capacity_];
+    if (slot) {
+        stats_.dropped_packets++;
+        return false;
+    }
+
+    bool talk_spurt = !started_;
+    if (starved_) {
+        // The stream went on after running dry, it was an underrun unless the pause was a new talk spurt
+        if (arrival_us - starved_us_ <= (int64_t)max_depth_ * frame_duration_ms_ * 1000) {
+            stats_.underruns++;
+        } else {
+            talk_spurt = true;
+        }
+        starved_ = false;
+    }
+    if (count_ == 0 && !playing_) {
+        first_arrival_us_ = arrival_us;
+        if (talk_spurt) {
+            // The silence before a talk spurt says nothing about network jitter, an underrun does
+            has_last_arrival_ = false;
+        }
+    }
+    UpdateJitter(sequence, arrival_us);
+    slot = std::move(packet);
+    count_++;
+    return true;
+}
+
+void JitterBuffer::UpdateJitter(uint32_t sequence, int64_t arrival_us) {
+    if (frame_duration_ms_ <= 0) {
+        return;
+    }
+    int64_t frame_us = frame_duration_ms_ * 1000;
+
+    if (has_last_arrival_) {
+        // Deviation of the arrival spacing from the media spacing, smoothed as in RFC 3550
+        int64_t expected_us = static_cast<int32_t>(sequence - last_sequence_) * frame_us;
+        int64_t deviation_us = (arrival_us - last_arrival_us_) - expected_us;
+        jitter_us_ += (std::abs(deviation_us) - jitter_us_) / 16;
+    }
+    if (!has_last_arrival_ || static_cast<int32_t>(sequence - last_sequence_) > 0) {
+        last_sequence_ = sequence;
+        last_arrival_us_ = arrival_us;
+        has_last_arrival_ = true;
+    }
+
+    // Keep about twice the jitter buffered on top of the frame being played
+    int depth = 1 + (2 * jitter_us_ + frame_us - 1) / frame_us;
+    target_depth_ = std::clamp(depth, min_depth_, max_depth_);
+}
+
+int32_t JitterBuffer::MaxBufferedOffset() const {
+    for (size_t i = capacity_; i > 0; i--) {
+        if (slots_[(next_sequence_ + i - 1) % capacity_]) {
+            return i - 1;
+        }
+    }
+    return 0;
+}
+
+bool JitterBuffer::SkipToNextPacket() {
+    for (size_t i = 1; i < capacity_; i++) {
+        if (slots_[(next_sequence_ + i) % capacity_]) {
+            next_sequence_ += i;
+            return true;
+        }
+    }
+    return false;
+}
+
+JitterBuffer::Result JitterBuffer::Get(std::unique_ptr<AudioStreamPacket>& packet, int64_t now_us) {
+    if (!playing_) {
+        if (count_ == 0) {
+            return kNotReady;
+        }
+        int64_t waited_us = now_us - first_arrival_us_;
+        if ((int)count_ < target_depth_ && waited_us < (int64_t)target_depth_ * frame_duration_ms_ * 1000) {
+            return kNotReady;
+        }
+        playing_ = true;
+        consecutive_missing_ = 0;
+        // The stream may not start at the first sequence we saw if packets were reordered. After an
+        // underrun the frame that is still missing is concealed, skipping it would shift the stream
+        if (!started_ && !slots_[next_sequence_ % capacity_]) {
+            SkipToNextPacket();
+        }
+        started_ = true;
+    }
+
+    auto& slot = slots_[next_sequence_ % capacity_];
+    if (slot) {
+        packet = std::move(slot);
+        count_--;
+        next_sequence_++;
+        consecutive_missing_ = 0;
+        return kPacket;
+    }
+
+    if (count_ == 0) {
+        // Ran dry, wait for the buffer to fill up to the target depth again
+        starved_ = true;
+        starved_us_ = now_us;
+        playing_ = false;
+        return kNotReady;
+    }
+
+    if (consecutive_missing_ >= MAX_CONSECUTIVE_MISSING_FRAMES && SkipToNextPacket()) {
+        consecutive_missing_ = 0;
+        return Get(packet, now_us);
+    }
+
+    consecutive_missing_++;
+    stats_.concealed_frames++;
+    next_sequence_++;
+    return kMissing;
+}
+
+JitterBufferStats JitterBuffer::GetStats() const {
+    JitterBufferStats stats = stats_;
+    stats.depth = count_;
+    stats.target_depth = target_depth_;
+    stats.jitter_ms = jitter_us_ / 1000;
+    return stats;
+}
@@ -0,0 +1,88 @@
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+#include "protocol.h"
+
+struct JitterBufferStats {
+    uint32_t underruns = 0;         // Ran dry while the stream was still arriving and had to rebuffer
+    uint32_t late_packets = 0;      // Arrived after their slot was played or concealed
+    uint32_t dropped_packets = 0;   // Duplicates and packets that did not fit
+    uint32_t concealed_frames = 0;  // Missing frames handed to the decoder for concealment
+    size_t depth = 0;
+    int target_depth = 0;
+    int jitter_ms = 0;
+};
+
+/*
+ * Reorders downlink packets by sequence number and paces them out to the decoder.
+ *
+ * Playback (re)starts once the buffer holds target_depth frames, or once the oldest frame has
+ * waited that long. The target follows the measured inter-arrival jitter between min_depth and
+ * max_depth. A hole in the sequence is reported as a missing frame so the caller can conceal it,
+ * and after too many missing frames in a row the buffer skips ahead to the next packet it has.
+ * Running dry only counts as an underrun if the stream continues within max_depth frames, otherwise
+ * the stream simply ended. After an underrun playback resumes where it stopped and the jitter
+ * estimate is kept.
+ *
+ * Not thread safe, owned by the opus decoder task.
+ */
+class JitterBuffer {
+public:
+    enum Result {
+        kNotReady,  // Nothing to play yet
+        kPacket,    // The next packet in sequence
+        kMissing,   // The next packet is missing, conceal one frame
+    };
+
+    JitterBuffer(size_t capacity, int min_depth, int max_depth);
+
+    // Drop every buffered packet and wait for a new stream, the jitter estimate is kept
+    void Reset();
+    // Returns false if the packet was dropped
+    bool Put(std::unique_ptr<AudioStreamPacket>&& packet, int64_t arrival_us);
+    Result Get(std::unique_ptr<AudioStreamPacket>& packet, int64_t now_us);
+
+    bool Empty() const { return count_ == 0; }
+    // No stream is buffered or being played out
+    bool Idle() const { return count_ == 0 && !playing_; }
+    bool Full() const { return count_ >= capacity_; }
+    // Frame duration of the buffered stream, 0 before the first packet
+    int frame_duration() const { return frame_duration_ms_; }
+    JitterBufferStats GetStats() const;
+
+private:
+    std::unique_ptr<std::unique_ptr<AudioStreamPacket>[]> slots_;
+    size_t capacity_;
+    std::atomic<size_t> count_{0};  // Also read by AudioService::IsIdle()
+    int min_depth_;
+    int max_depth_;
+    int target_depth_;
+    int frame_duration_ms_ = 0;
+
+    bool synced_ = false;
+    bool playing_ = false;
+    bool started_ = false;          // Played since the stream was synced, its start is fixed
+    bool starved_ = false;          // Ran dry, waiting to see whether the stream continues
+    int64_t starved_us_ = 0;
+    uint32_t next_sequence_ = 0;
+    int consecutive_missing_ = 0;
+    int64_t first_arrival_us_ = 0;
+
+    bool has_last_arrival_ = false;
+    uint32_t last_sequence_ = 0;
+    int64_t last_arrival_us_ = 0;
+    int64_t jitter_us_ = 0;
+
+    JitterBufferStats stats_;
+
+    void UpdateJitter(uint32_t sequence, int64_t arrival_us);
+    int32_t MaxBufferedOffset() const;
+    bool SkipToNextPacket();
+};
+
+#endif // JITTER_BUFFER_H
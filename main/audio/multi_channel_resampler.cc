@@ -0,0 +1,54 @@
+#include "multi_channel_resampler.h"
+#include "pcm_kernels.h"
+
+void MultiChannelResampler::Configure(int input_sample_rate, int output_sample_rate, int channels) {
+    channels_ = channels;
+    resamplers_.clear();
+    for (int i = 0; i < channels; i++) {
+        auto resampler = std::make_unique<OpusResampler>();
+        resampler->Configure(input_sample_rate, output_sample_rate);
+        resamplers_.push_back(std::move(resampler));
+    }
+}
+
+int MultiChannelResampler::GetOutputFrames(int input_frames) {
+    return resamplers_.empty() ? 0 : resamplers_[0]->GetOutputSamples(input_frames);
+}
+
+int MultiChannelResampler::Process(const int16_t* input, int input_frames, int16_t* output) {
+    int output_frames = GetOutputFrames(input_frames);
+    if (channels_ == 1) {
+        resamplers_[0]->Process(input, input_frames, output);
+        return output_frames;
+    }
+
+    planar_input_.resize(input_frames * channels_);
+    planar_output_.resize(output_frames * channels_);
+    if (channels_ == 2) {
+        PcmDeinterleave(input, planar_input_.data(), planar_input_.data() + input_frames, input_frames);
+    } else {
+        for (int c = 0; c < channels_; c++) {
+            int16_t* plane = planar_input_.data() + c * input_frames;
+            for (int i = 0; i < input_frames; i++) {
+                plane[i] = input[i * channels_ + c];
+            }
+        }
+    }
+
+    for (int c = 0; c < channels_; c++) {
+        resamplers_[c]->Process(planar_input_.data() + c * input_frames, input_frames,
+            planar_output_.data() + c * output_frames);
+    }
+
+    if (channels_ == 2) {
+        PcmInterleave(planar_output_.data(), planar_output_.data() + output_frames, output, output_frames);
+    } else {
+        for (int c = 0; c < channels_; c++) {
+            const int16_t* plane = planar_output_.data() + c * output_frames;
+            for (int i = 0; i < output_frames; i++) {
+                output[i * channels_ + c] = plane[i];
+            }
+        }
+    }
+    return output_frames;
+}
@@ -0,0 +1,34 @@
+#ifndef MULTI_CHANNEL_RESAMPLER_H
+#define MULTI_CHANNEL_RESAMPLER_H
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <opus_resampler.h>
+
+/*
+ * Resamples interleaved multi-channel PCM with one OpusResampler per channel.
+ *
+ * The SILK resampler behind OpusResampler only handles one channel, so the channels are split
+ * into preallocated planar buffers, resampled and written interleaved into the caller's buffer.
+ * Nothing is allocated once the buffers have grown to the frame size.
+ */
+class MultiChannelResampler {
+public:
+    void Configure(int input_sample_rate, int output_sample_rate, int channels);
+
+    int channels() const { return channels_; }
+    // Output frames (samples per channel) for input_frames
+    int GetOutputFrames(int input_frames);
+    // output must hold GetOutputFrames(input_frames) * channels() samples, returns the output frames
+    int Process(const int16_t* input, int input_frames, int16_t* output);
+
+private:
+    int channels_ = 0;
+    std::vector<std::unique_ptr<OpusResampler>> resamplers_;
+    std::vector<int16_t> planar_input_;
+    std::vector<int16_t> planar_output_;
+};
+
+#endif // MULTI_CHANNEL_RESAMPLER_H
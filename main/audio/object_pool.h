@@ -0,0 +1,101 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/*
+ * Fixed-size pool of reusable objects, one instance per type.
+ *
+ * Objects are not destroyed between uses, so the vectors inside them keep their capacity and a
+ * steady stream of audio frames stops touching the heap once every buffer has grown to its frame
+ * size. Objects come back as they were released, callers must set every field they rely on.
+ *
+ * Acquire() falls back to the heap when the pool is exhausted, such fallbacks are counted in
+ * misses(). Pooled types specialize std::default_delete to hand the objects back to the pool,
+ * so a plain std::unique_ptr<T> owns both pooled and heap objects.
+ */
+template <typename T>
+class ObjectPool {
+public:
+    static ObjectPool& GetInstance() {
+        static ObjectPool instance;
+        return instance;
+    }
+
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+
+    // Allocate the pool once, later calls are ignored
+    void Reserve(size_t capacity) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (objects_ != nullptr || capacity == 0) {
+            return;
+        }
+        free_list_.reserve(capacity);
+        objects_.reset(new T[capacity]());
+        for (size_t i = capacity; i > 0; --i) {
+            free_list_.push_back(&objects_[i - 1]);
+        }
+        capacity_ = capacity;
+    }
+
+    std::unique_ptr<T> Acquire() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_list_.empty()) {
+                T* object = free_list_.back();
+                free_list_.pop_back();
+                size_t in_use = capacity_ - free_list_.size();
+                if (in_use > high_water_) {
+                    high_water_ = in_use;
+                }
+                return std::unique_ptr<T>(object);
+            }
+            misses_++;
+        }
+        return std::unique_ptr<T>(new T());
+    }
+
+    // Returns false if the object does not belong to the pool
+    bool Release(T* object) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (capacity_ == 0 || std::less<T*>()(object, &objects_[0]) || !std::less<T*>()(object, &objects_[0] + capacity_)) {
+            return false;
+        }
+        free_list_.push_back(object);
+        return true;
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    size_t in_use() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return capacity_ - free_list_.size();
+    }
+
+    size_t high_water() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return high_water_;
+    }
+
+    size_t misses() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return misses_;
+    }
+
+private:
+    ObjectPool() = default;
+
+    std::mutex mutex_;
+    std::unique_ptr<T[]> objects_;
+    std::vector<T*> free_list_;
+    size_t capacity_ = 0;
+    size_t high_water_ = 0;
+    size_t misses_ = 0;
+};
+
+#endif // OBJECT_POOL_H
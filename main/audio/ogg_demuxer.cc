@@ -0,0 +1,170 @@
+#include "ogg_demuxer.h"
+#include <esp_log.h>
+#include <cstring>
+
+#define TAG "OggDemuxer"
+
+#define OGG_PAGE_HEADER_SIZE 27
+
+// Samples per frame at 48kHz for each Opus TOC configuration, RFC 6716 section 3.1
+static int GetOpusPacketDuration(const uint8_t* packet, size_t size) {
+    if (size < 1) {
+        return 0;
+    }
+    int config = packet[0] >> 3;
+    int samples;
+    if (config < 12) {
+        static const int silk[] = {480, 960, 1920, 2880};
+        samples = silk[config & 3];
+    } else if (config < 16) {
+        samples = (config & 1) ? 960 : 480;
+    } else {
+        static const int celt[] = {120, 240, 480, 960};
+        samples = celt[config & 3];
+    }
+    int frames;
+    switch (packet[0] & 3) {
+    case 0:
+        frames = 1;
+        break;
+    case 1:
+    case 2:
+        frames = 2;
+        break;
+    default:
+        frames = size >= 2 ? (packet[1] & 0x3f) : 0;
+        break;
+    }
+    return samples * frames / 48;
+}
+
+size_t OggDemuxer::FindPage(size_t start) const {
+    auto pos = data_.find("OggS", start, 4);
+    return pos == std::string_view::npos ? data_.size() : pos;
+}
+
+void OggDemuxer::AddPacket(size_t first_span, int& header_packets) {
+    size_t size = 0;
+    for (size_t i = first_span; i < spans_.size(); i++) {
+        size += spans_[i].size;
+    }
+    auto packet = reinterpret_cast<const uint8_t*>(data_.data()) + spans_[first_span].offset;
+    size_t contiguous = spans_[first_span].size;
+
+    if (header_packets == 0) {
+        // OpusHead: [0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip, [12-15] input_sample_rate
+        if (contiguous >= 19 && memcmp(packet, "OpusHead", 8) == 0) {
+            channels_ = packet[9];
+            sample_rate_ = packet[12] | (packet[13] << 8) | (packet[14] << 16) | (packet[15] << 24);
+            header_packets++;
+        }
+        spans_.resize(first_span);
+        return;
+    }
+    if (header_packets == 1) {
+        // OpusTags, may span several pages
+        if (contiguous >= 8 && memcmp(packet, "OpusTags", 8) == 0) {
+            header_packets++;
+        }
+        spans_.resize(first_span);
+        return;
+    }
+
+    if (size == 0) {
+        spans_.resize(first_span);
+        return;
+    }
+    if (packets_.empty()) {
+        int duration = GetOpusPacketDuration(packet, contiguous);
+        if (duration > 0) {
+            frame_duration_ = duration;
+        }
+    }
+    packets_.push_back(first_span);
+}
+
+bool OggDemuxer::Parse(const std::string_view& data) {
+    data_ = data;
+    spans_.clear();
+    packets_.clear();
+
+    int header_packets = 0;
+    size_t packet_start = 0;  // First span of the packet being assembled
+    size_t offset = FindPage(0);
+    while (offset + OGG_PAGE_HEADER_SIZE <= data_.size()) {
+        auto page = reinterpret_cast<const uint8_t*>(data_.data()) + offset;
+        if (memcmp(page, "OggS", 4) != 0) {
+            // Lost sync, drop the partial packet and look for the next page
+            spans_.resize(packet_start);
+            offset = FindPage(offset + 1);
+            continue;
+        }
+
+        bool continued = page[5] & 0x01;
+        uint8_t page_segments = page[26];
+        size_t body_offset = offset + OGG_PAGE_HEADER_SIZE + page_segments;
+        if (body_offset > data_.size()) {
+            break;
+        }
+        size_t body_size = 0;
+        for (size_t i = 0; i < page_segments; i++) {
+            body_size += page[OGG_PAGE_HEADER_SIZE + i];
+        }
+        if (body_offset + body_size > data_.size()) {
+            break;
+        }
+        if (!continued && spans_.size() > packet_start) {
+            // The previous page promised a continuation that never came
+            spans_.resize(packet_start);
+        }
+
+        size_t cur = body_offset;
+        size_t seg_idx = 0;
+        while (seg_idx < page_segments) {
+            size_t len = 0;
+            uint8_t lacing;
+            do {
+                lacing = page[OGG_PAGE_HEADER_SIZE + seg_idx++];
+                len += lacing;
+            } while (lacing == 255 && seg_idx < page_segments);
+
+            if (len > 0) {
+                spans_.push_back({static_cast<uint32_t>(cur), static_cast<uint32_t>(len)});
+            }
+            cur += len;
+            if (lacing == 255) {
+                // Continues on the next page
+                break;
+            }
+            if (spans_.size() > packet_start) {
+                AddPacket(packet_start, header_packets);
+            }
+            packet_start = spans_.size();
+        }
+
+        offset = body_offset + body_size;
+    }
+    spans_.resize(packet_start);
+
+    if (header_packets == 0 || packets_.empty()) {
+        ESP_LOGE(TAG, "No opus stream found in %u bytes", data_.size());
+        return false;
+    }
+    ESP_LOGD(TAG, "Indexed %u packets, sample_rate=%d, channels=%d, frame_duration=%d",
+        packets_.size(), sample_rate_, channels_, frame_duration_);
+    return true;
+}
+
+bool OggDemuxer::ReadPacket(size_t index, std::vector<uint8_t>& payload) const {
+    if (index >= packets_.size()) {
+        return false;
+    }
+    size_t first = packets_[index];
+    size_t last = index + 1 < packets_.size() ? packets_[index + 1] : spans_.size();
+    auto base = reinterpret_cast<const uint8_t*>(data_.data());
+    payload.assign(base + spans_[first].offset, base + spans_[first].offset + spans_[first].size);
+    for (size_t i = first + 1; i < last; i++) {
+        payload.insert(payload.end(), base + spans_[i].offset, base + spans_[i].offset + spans_[i].size);
+    }
+    return true;
+}
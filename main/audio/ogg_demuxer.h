@@ -0,0 +1,48 @@
+#ifndef OGG_DEMUXER_H
+#define OGG_DEMUXER_H
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Index of the Opus packets in an Ogg file held in memory.
+ *
+ * Parse() walks the pages once and records where every audio packet lives, ReadPacket() then
+ * copies any packet out without scanning the file again. The data is not copied, it must stay
+ * valid as long as the demuxer is used (embedded assets do).
+ */
+class OggDemuxer {
+public:
+    // Returns false if no OpusHead or no audio packet was found
+    bool Parse(const std::string_view& data);
+
+    size_t packet_count() const { return packets_.size(); }
+    int sample_rate() const { return sample_rate_; }
+    int channels() const { return channels_; }
+    // Duration of the first audio packet, read from its TOC byte
+    int frame_duration() const { return frame_duration_; }
+
+    // Packets split across pages are joined in the payload
+    bool ReadPacket(size_t index, std::vector<uint8_t>& payload) const;
+
+private:
+    struct Span {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    std::string_view data_;
+    std::vector<Span> spans_;
+    // First span of every audio packet, the packet ends where the next one starts
+    std::vector<uint32_t> packets_;
+    int sample_rate_ = 16000;
+    int channels_ = 1;
+    int frame_duration_ = 60;
+
+    size_t FindPage(size_t start) const;
+    void AddPacket(size_t first_span, int& header_packets);
+};
+
+#endif // OGG_DEMUXER_H
@@ -0,0 +1,33 @@
+#ifndef OPUS_CONFIG_H
+#define OPUS_CONFIG_H
+
+#include <type_traits>
+#include <utility>
+
+#include <opus_encoder.h>
+
+/*
+ * Uplink opus settings shared by AudioService and the hello message of Protocol, so the protocols
+ * advertise exactly what the encoder accepts without depending on AudioService.
+ */
+
+// Default uplink frame duration, the server may pick another one from the supported set in hello
+#define OPUS_FRAME_DURATION_MS 60
+#define OPUS_MIN_FRAME_DURATION_MS 20
+#define OPUS_FRAME_DURATIONS {20, 40, 60}
+#define OPUS_BITRATES {12000, 16000, 24000, 32000}
+#if CONFIG_IDF_TARGET_ESP32S3 || CONFIG_IDF_TARGET_ESP32P4
+#define OPUS_MAX_COMPLEXITY 5
+#else
+#define OPUS_MAX_COMPLEXITY 0
+#endif
+
+// Bitrate control depends on the version of the opus wrapper, older ones only have the automatic bitrate
+template <typename Encoder, typename = void>
+struct OpusHasBitrateControl : std::false_type {};
+
+template <typename Encoder>
+struct OpusHasBitrateControl<Encoder, std::void_t<decltype(std::declval<Encoder&>().SetBitrate(0))>>
+    : std::true_type {};
+
+#endif // OPUS_CONFIG_H
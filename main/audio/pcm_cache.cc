@@ -0,0 +1,76 @@
+#include "pcm_cache.h"
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstring>
+
+#define TAG "PcmCache"
+
+PcmBuffer::PcmBuffer(size_t samples, int sample_rate) : sample_rate(sample_rate) {
+    data = (int16_t*)heap_caps_malloc_prefer(samples * sizeof(int16_t), 2,
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (data != nullptr) {
+        this->samples = samples;
+    }
+}
+
+PcmBuffer::~PcmBuffer() {
+    heap_caps_free(data);
+}
+
+PcmCache::PcmCache() : budget_(CONFIG_SOUND_PCM_CACHE_SIZE_KB * 1024) {
+}
+
+std::shared_ptr<const PcmBuffer> PcmCache::Get(const void* key, int sample_rate) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end() || it->second->pcm->sample_rate != sample_rate) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->pcm;
+}
+
+bool PcmCache::Put(const void* key, const int16_t* pcm, size_t samples, int sample_rate) {
+    size_t bytes = samples * sizeof(int16_t);
+    if (bytes == 0 || bytes > budget_) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        bytes_ -= it->second->pcm->bytes();
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    while (bytes_ + bytes > budget_ && !entries_.empty()) {
+        auto& last = entries_.back();
+        bytes_ -= last.pcm->bytes();
+        index_.erase(last.key);
+        entries_.pop_back();
+    }
+
+    auto buffer = std::make_shared<PcmBuffer>(samples, sample_rate);
+    if (buffer->data == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes", bytes);
+        return false;
+    }
+    memcpy(buffer->data, pcm, bytes);
+    entries_.push_front({key, std::move(buffer)});
+    index_[key] = entries_.begin();
+    bytes_ += bytes;
+    return true;
+}
+
+PcmCacheStats PcmCache::GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    PcmCacheStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.bytes = bytes_;
+    stats.budget = budget_;
+    stats.entries = entries_.size();
+    return stats;
+}
@@ -0,0 +1,75 @@
+#ifndef PCM_CACHE_H
+#define PCM_CACHE_H
+
+#include <memory>
+#include <mutex>
+#include <list>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+// Decoded PCM of one sound, in PSRAM if present
+struct PcmBuffer {
+    int16_t* data = nullptr;
+    size_t samples = 0;
+    int sample_rate = 0;
+
+    PcmBuffer(size_t samples, int sample_rate);
+    ~PcmBuffer();
+    PcmBuffer(const PcmBuffer&) = delete;
+    PcmBuffer& operator=(const PcmBuffer&) = delete;
+
+    size_t bytes() const { return samples * sizeof(int16_t); }
+};
+
+struct PcmCacheStats {
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    size_t bytes = 0;
+    size_t budget = 0;
+    size_t entries = 0;
+};
+
+/*
+ * LRU cache of short sounds, decoded and resampled to the output sample rate.
+ *
+ * Keys are the addresses of the embedded Ogg files. Entries are shared, so a sound that is evicted
+ * while playing stays valid until its playback finishes. The byte budget comes from
+ * CONFIG_SOUND_PCM_CACHE_SIZE_KB, a budget of 0 disables the cache.
+ */
+class PcmCache {
+public:
+    static PcmCache& GetInstance() {
+        static PcmCache instance;
+        return instance;
+    }
+
+    PcmCache(const PcmCache&) = delete;
+    PcmCache& operator=(const PcmCache&) = delete;
+
+    bool enabled() const { return budget_ > 0; }
+
+    // Counts a hit or a miss, returns nullptr on a miss
+    std::shared_ptr<const PcmBuffer> Get(const void* key, int sample_rate);
+    // Evicts the least recently used sounds to make room, returns false if the sound is over budget
+    bool Put(const void* key, const int16_t* pcm, size_t samples, int sample_rate);
+    PcmCacheStats GetStats();
+
+private:
+    PcmCache();
+
+    struct Entry {
+        const void* key;
+        std::shared_ptr<const PcmBuffer> pcm;
+    };
+
+    std::mutex mutex_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::map<const void*, std::list<Entry>::iterator> index_;
+    size_t budget_ = 0;
+    size_t bytes_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+};
+
+#endif // PCM_CACHE_H
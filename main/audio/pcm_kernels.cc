@@ -0,0 +1,88 @@
+#include "pcm_kernels.h"
+#include <sdkconfig.h>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+static inline int32_t Saturate16(int32_t value) {
+#if CONFIG_AUDIO_PCM_KERNELS_XTENSA && defined(__XTENSA__)
+    // CLAMPS saturates to [-32768, 32767], MAX keeps the range symmetric
+    int32_t result;
+    __asm__("clamps %0, %1, 15" : "=a"(result) : "a"(value));
+    return std::max<int32_t>(result, -INT16_MAX);
+#else
+    return std::min<int32_t>(std::max<int32_t>(value, -INT16_MAX), INT16_MAX);
+#endif
+}
+
+void PcmScaleToInt32(const int16_t* in, int32_t* out, size_t samples, int32_t factor) {
+    if (factor <= -65536 || factor > 65536) {
+        for (size_t i = 0; i < samples; i++) {
+            int64_t value = int64_t(in[i]) * factor;
+            out[i] = static_cast<int32_t>(std::min<int64_t>(std::max<int64_t>(value, INT32_MIN), INT32_MAX));
+        }
+        return;
+    }
+
+    // With -65536 < factor <= 65536, in * factor lies in [-2^31, 2^31 - 65536] and fits in int32,
+    // no saturation needed. -32768 * -65536 would be 2^31, so -65536 takes the saturating path
+    size_t i = 0;
+#if CONFIG_AUDIO_PCM_KERNELS_XTENSA
+    for (; i + 4 <= samples; i += 4) {
+        out[i] = in[i] * factor;
+        out[i + 1] = in[i + 1] * factor;
+        out[i + 2] = in[i + 2] * factor;
+        out[i + 3] = in[i + 3] * factor;
+    }
+#endif
+    for (; i < samples; i++) {
+        out[i] = in[i] * factor;
+    }
+}
+
+void PcmInt32ToInt16(const int32_t* in, int16_t* out, size_t samples, int shift) {
+    size_t i = 0;
+#if CONFIG_AUDIO_PCM_KERNELS_XTENSA
+    for (; i + 4 <= samples; i += 4) {
+        out[i] = Saturate16(in[i] >> shift);
+        out[i + 1] = Saturate16(in[i + 1] >> shift);
+        out[i + 2] = Saturate16(in[i + 2] >> shift);
+        out[i + 3] = Saturate16(in[i + 3] >> shift);
+    }
+#endif
+    for (; i < samples; i++) {
+        out[i] = Saturate16(in[i] >> shift);
+    }
+}
+
+void PcmApplyGain(int16_t* data, size_t samples, int32_t gain) {
+    size_t i = 0;
+#if CONFIG_AUDIO_PCM_KERNELS_XTENSA
+    for (; i + 4 <= samples; i += 4) {
+        data[i] = Saturate16(data[i] * gain);
+        data[i + 1] = Saturate16(data[i + 1] * gain);
+        data[i + 2] = Saturate16(data[i + 2] * gain);
+        data[i + 3] = Saturate16(data[i + 3] * gain);
+    }
+#endif
+    for (; i < samples; i++) {
+        data[i] = Saturate16(data[i] * gain);
+    }
+}
+
+void PcmDeinterleave(const int16_t* in, int16_t* left, int16_t* right, size_t frames) {
+    // Little endian, the left sample is the low half of every 32-bit frame
+    for (size_t i = 0; i < frames; i++) {
+        uint32_t word;
+        memcpy(&word, in + i * 2, sizeof(word));
+        left[i] = static_cast<int16_t>(word & 0xffff);
+        right[i] = static_cast<int16_t>(word >> 16);
+    }
+}
+
+void PcmInterleave(const int16_t* left, const int16_t* right, int16_t* out, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        uint32_t word = static_cast<uint16_t>(left[i]) | (static_cast<uint32_t>(static_cast<uint16_t>(right[i])) << 16);
+        memcpy(out + i * 2, &word, sizeof(word));
+    }
+}
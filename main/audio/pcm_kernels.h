@@ -0,0 +1,26 @@
+#ifndef PCM_KERNELS_H
+#define PCM_KERNELS_H
+
+#include <cstdint>
+#include <cstddef>
+
+/*
+ * Sample conversion loops shared by the codecs and the audio service.
+ *
+ * 16-bit results saturate to [-INT16_MAX, INT16_MAX], the range the codecs always clamped to.
+ * With CONFIG_AUDIO_PCM_KERNELS_XTENSA the loops are unrolled and, on Xtensa, saturate with the
+ * CLAMPS/MAX instructions instead of branches. host_test/test_pcm_kernels checks both loop variants
+ * against a scalar reference, the CLAMPS saturation itself only runs on the target.
+ */
+
+// out = saturate32(in * factor), factor is Q16 (65536 is unity gain)
+void PcmScaleToInt32(const int16_t* in, int32_t* out, size_t samples, int32_t factor);
+// out = saturate16(in >> shift)
+void PcmInt32ToInt16(const int32_t* in, int16_t* out, size_t samples, int shift);
+// data = saturate16(data * gain), in place, -65536 < gain <= 65536 so the product fits in int32
+void PcmApplyGain(int16_t* data, size_t samples, int32_t gain);
+// Split a stereo frame buffer into two channels, and back
+void PcmDeinterleave(const int16_t* in, int16_t* left, int16_t* right, size_t frames);
+void PcmInterleave(const int16_t* left, const int16_t* right, int16_t* out, size_t frames);
+
+#endif // PCM_KERNELS_H
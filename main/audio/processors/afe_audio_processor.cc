@@ -1,5 +1,8 @@
 #include "afe_audio_processor.h"
+#include "audio_latency_profiler.h"
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <algorithm>
 
 #define PROCESSOR_RUNNING 0x01
 
@@ -64,8 +67,16 @@ void AfeAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srm
     afe_config->vad_init = true;
 #endif
 
+    // AFE drops audio once this many chunks wait to be fetched
+    if (afe_config->afe_ringbuf_size > 0) {
+        feed_times_.SetLimit(std::min<size_t>(afe_config->afe_ringbuf_size, AFE_FEED_TIMES_CAPACITY));
+    }
+
     afe_iface_ = esp_afe_handle_from_config(afe_config);
     afe_data_ = afe_iface_->create_from_config(afe_config);
+
+    // Every fetched chunk comes from the oldest fed chunk only if both have the same size
+    track_feed_times_ = afe_iface_->get_fetch_chunksize(afe_data_) == afe_iface_->get_feed_chunksize(afe_data_);
     
     xTaskCreate([](void* arg) {
         auto this_ = (AfeAudioProcessor*)arg;
@@ -88,10 +99,20 @@ size_t AfeAudioProcessor::GetFeedSize() {
     return afe_iface_->get_feed_chunksize(afe_data_);
 }
 
+void AfeAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 void AfeAudioProcessor::Feed(std::vector<int16_t>&& data) {
     if (afe_data_ == nullptr) {
         return;
     }
+    if (track_feed_times_) {
+        int64_t now = esp_timer_get_time();
+        if (!feed_times_.Push(std::move(now))) {
+            AudioLatencyProfiler::GetInstance().CountAfeOverflow();
+        }
+    }
     afe_iface_->feed(afe_data_, data.data());
 }
 
@@ -104,6 +125,7 @@ void AfeAudioProcessor::Stop() {
     if (afe_data_ != nullptr) {
         afe_iface_->reset_buffer(afe_data_);
     }
+    feed_times_.Clear();
 }
 
 bool AfeAudioProcessor::IsRunning() {
@@ -124,17 +146,32 @@ void AfeAudioProcessor::AudioProcessorTask() {
     ESP_LOGI(TAG, "Audio communication task started, feed size: %d fetch size: %d",
         feed_size, fetch_size);
 
+    auto& profiler = AudioLatencyProfiler::GetInstance();
+    profiler.SetAfeChunkDuration(fetch_size * 1000 / 16000);
+    if (!track_feed_times_) {
+        ESP_LOGW(TAG, "Feed and fetch sizes differ, AFE latency and overflows are not profiled");
+    }
+
     while (true) {
         xEventGroupWaitBits(event_group_, PROCESSOR_RUNNING, pdFALSE, pdTRUE, portMAX_DELAY);
 
         auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        int64_t fetch_time = esp_timer_get_time();
         if ((xEventGroupGetBits(event_group_) & PROCESSOR_RUNNING) == 0) {
             continue;
         }
+        int64_t feed_time = 0;
+        if (track_feed_times_) {
+            profiler.RecordAfeLag(feed_times_.Size());
+            if (feed_times_.Pop(feed_time)) {
+                profiler.Record(kAudioLatencyStageAfe, fetch_time - feed_time, AUDIO_LATENCY_AFE_BUDGET_MS);
+            }
+        }
         if (res == nullptr || res->ret_value == ESP_FAIL) {
             if (res != nullptr) {
                 ESP_LOGI(TAG, "Error code: %d", res->ret_value);
             }
+            profiler.CountFetchError();
             continue;
         }
 
@@ -155,19 +192,15 @@ void AfeAudioProcessor::AudioProcessorTask() {
             // Add data to buffer
             output_buffer_.insert(output_buffer_.end(), res->data, res->data + samples);
             
-            // Output complete frames when buffer has enough data
-            while (output_buffer_.size() >= frame_samples_) {
-                if (output_buffer_.size() == frame_samples_) {
-                    // If buffer size equals frame size, move the entire buffer
-                    output_callback_(std::move(output_buffer_));
-                    output_buffer_.clear();
-                    output_buffer_.reserve(frame_samples_);
-                } else {
-                    // If buffer size exceeds frame size, copy one frame and remove it
-                    output_callback_(std::vector<int16_t>(output_buffer_.begin(), output_buffer_.begin() + frame_samples_));
-                    output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples_);
-                }
+            // Output complete frames when buffer has enough data.
+            // The receiver swaps a recycled buffer into frame_buffer_, so no allocation per frame.
+            size_t frame_samples = frame_samples_;
+            while (output_buffer_.size() >= frame_samples) {
+                frame_buffer_.assign(output_buffer_.begin(), output_buffer_.begin() + frame_samples);
+                output_buffer_.erase(output_buffer_.begin(), output_buffer_.begin() + frame_samples);
+                output_callback_(std::move(frame_buffer_));
             }
+            profiler.Record(kAudioLatencyStageOutput, esp_timer_get_time() - fetch_time, frame_samples / 16);
         }
     }
 }
@@ -8,10 +8,15 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
 #include <functional>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "spsc_ring.h"
+
+// Feed times of the chunks inside AFE, for the latency profiler
+#define AFE_FEED_TIMES_CAPACITY 64
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
@@ -19,6 +24,7 @@ public:
     ~AfeAudioProcessor();
 
     void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
+    void SetFrameDuration(int frame_duration_ms) override;
     void Feed(std::vector<int16_t>&& data) override;
     void Start() override;
     void Stop() override;
@@ -35,9 +41,14 @@ private:
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    std::atomic<int> frame_samples_{0};
     bool is_speaking_ = false;
     std::vector<int16_t> output_buffer_;
+    std::vector<int16_t> frame_buffer_;
+    // Written by Feed() and read by the processor task, one entry per chunk in the AFE ring buffer
+    SpscRing<int64_t> feed_times_{AFE_FEED_TIMES_CAPACITY};
+    // Feed and fetch chunks have the same size, so feed times can be matched to fetched chunks
+    bool track_feed_times_ = false;
 
     void AudioProcessorTask();
 };
@@ -6,31 +6,64 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <errno.h>
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
 #include <string>
 #endif
 
 #define TAG "AudioDebugger"
 
+#if CONFIG_USE_AUDIO_DEBUGGER
+namespace {
+
+const int16_t kImaStepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+const int8_t kImaIndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+}  // namespace
+#endif
 
 AudioDebugger::AudioDebugger() {
 #if CONFIG_USE_AUDIO_DEBUGGER
+#if CONFIG_AUDIO_DEBUG_ENCODING_ADPCM
+    encoding_ = kAudioDebugEncodingImaAdpcm;
+#endif
+#if CONFIG_AUDIO_DEBUG_STREAM_MIC
+    stream_mask_ |= 1 << kAudioDebugStreamMic;
+#endif
+#if CONFIG_AUDIO_DEBUG_STREAM_REFERENCE
+    stream_mask_ |= 1 << kAudioDebugStreamReference;
+#endif
+#if CONFIG_AUDIO_DEBUG_STREAM_PROCESSED
+    stream_mask_ |= 1 << kAudioDebugStreamProcessed;
+#endif
+#if CONFIG_AUDIO_DEBUG_STREAM_PLAYBACK
+    stream_mask_ |= 1 << kAudioDebugStreamPlayback;
+#endif
+
     udp_sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
     if (udp_sockfd_ >= 0) {
         // 解析配置的服务器地址 "IP:PORT"
         std::string server_addr = CONFIG_AUDIO_DEBUG_UDP_SERVER;
         size_t colon_pos = server_addr.find(':');
-        
+
         if (colon_pos != std::string::npos) {
             std::string ip = server_addr.substr(0, colon_pos);
             int port = std::stoi(server_addr.substr(colon_pos + 1));
-            
+
             memset(&udp_server_addr_, 0, sizeof(udp_server_addr_));
             udp_server_addr_.sin_family = AF_INET;
             udp_server_addr_.sin_port = htons(port);
             inet_pton(AF_INET, ip.c_str(), &udp_server_addr_.sin_addr);
-            
-            ESP_LOGI(TAG, "Initialized server address: %s", CONFIG_AUDIO_DEBUG_UDP_SERVER);
+
+            ESP_LOGI(TAG, "Initialized server address: %s, streams 0x%x, %s", CONFIG_AUDIO_DEBUG_UDP_SERVER,
+                (unsigned)stream_mask_, encoding_ == kAudioDebugEncodingImaAdpcm ? "ADPCM" : "PCM");
         } else {
             ESP_LOGW(TAG, "Invalid server address: %s, should be IP:PORT", CONFIG_AUDIO_DEBUG_UDP_SERVER);
             close(udp_sockfd_);
@@ -51,18 +84,121 @@ AudioDebugger::~AudioDebugger() {
 #endif
 }
 
-void AudioDebugger::Feed(const std::vector<int16_t>& data) {
+void AudioDebugger::Feed(AudioDebugStream stream, const int16_t* data, size_t frames, int stride, int first_channel,
+                         int channels, int sample_rate, int64_t capture_us) {
 #if CONFIG_USE_AUDIO_DEBUGGER
-    if (udp_sockfd_ >= 0) {
-        ssize_t sent = sendto(udp_sockfd_, data.data(), data.size() * sizeof(int16_t), 0,
-                             (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
-        if (sent < 0) {
-            ESP_LOGW(TAG, "Failed to send audio data to %s: %d", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno);
-        } else {
-            ESP_LOGD(TAG, "Sent %d bytes audio data to %s", sent, CONFIG_AUDIO_DEBUG_UDP_SERVER);
+    if (udp_sockfd_ < 0 || !(stream_mask_ & (1 << stream)) || frames == 0 || channels <= 0) {
+        return;
+    }
+
+    // Split into frames that fit one datagram, ADPCM carries a 4 byte state per channel
+    size_t max_frames = encoding_ == kAudioDebugEncodingImaAdpcm
+        ? (AUDIO_DEBUG_MAX_PAYLOAD / channels - 4) * 2
+        : AUDIO_DEBUG_MAX_PAYLOAD / (channels * sizeof(int16_t));
+    auto& state = streams_[stream];
+    for (size_t offset = 0; offset < frames; offset += max_frames) {
+        int count = std::min(max_frames, frames - offset);
+        // Gather the requested channels, planar for ADPCM and interleaved for PCM
+        state.pcm.resize(count * channels);
+        const int16_t* src = data + offset * stride + first_channel;
+        for (int i = 0; i < count; i++) {
+            for (int ch = 0; ch < channels; ch++) {
+                if (encoding_ == kAudioDebugEncodingImaAdpcm) {
+                    state.pcm[ch * count + i] = src[i * stride + ch];
+                } else {
+                    state.pcm[i * channels + ch] = src[i * stride + ch];
+                }
+            }
         }
+        SendFrame(stream, state.pcm.data(), count, channels, sample_rate,
+            capture_us + (int64_t)offset * 1000000 / sample_rate);
+    }
+#endif
+}
+
+void AudioDebugger::SendFrame(AudioDebugStream stream, const int16_t* pcm, int samples, int channels,
+                              int sample_rate, int64_t capture_us) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    auto& state = streams_[stream];
+    state.packet.resize(sizeof(AudioDebugFrameHeader) + AUDIO_DEBUG_MAX_PAYLOAD);
+    uint8_t* payload = state.packet.data() + sizeof(AudioDebugFrameHeader);
+    size_t payload_size;
+    if (encoding_ == kAudioDebugEncodingImaAdpcm) {
+        payload_size = EncodeImaAdpcm(pcm, samples, channels, payload);
+    } else {
+        payload_size = samples * channels * sizeof(int16_t);
+        memcpy(payload, pcm, payload_size);
+    }
+
+    AudioDebugFrameHeader header = {};
+    header.magic = AUDIO_DEBUG_FRAME_MAGIC;
+    header.version = AUDIO_DEBUG_FRAME_VERSION;
+    header.stream = stream;
+    header.encoding = encoding_;
+    header.channels = channels;
+    header.sequence = state.sequence++;
+    header.sample_rate = sample_rate;
+    header.capture_us = capture_us;
+    header.samples = samples;
+    header.payload_size = payload_size;
+    memcpy(state.packet.data(), &header, sizeof(header));
+
+    ssize_t sent = sendto(udp_sockfd_, state.packet.data(), sizeof(header) + payload_size, 0,
+                         (struct sockaddr*)&udp_server_addr_, sizeof(udp_server_addr_));
+    if (sent < 0) {
+        ESP_LOGW(TAG, "Failed to send audio data to %s: %d", CONFIG_AUDIO_DEBUG_UDP_SERVER, errno);
+    } else {
+        ESP_LOGD(TAG, "Sent %d bytes of stream %d to %s", sent, stream, CONFIG_AUDIO_DEBUG_UDP_SERVER);
     }
 #endif
 }
 
- 
\ No newline at end of file
+// Planar input, each channel is encoded as its own block
+size_t AudioDebugger::EncodeImaAdpcm(const int16_t* pcm, int samples, int channels, uint8_t* out) {
+#if CONFIG_USE_AUDIO_DEBUGGER
+    uint8_t* p = out;
+    for (int ch = 0; ch < channels; ch++) {
+        const int16_t* src = pcm + ch * samples;
+        // Start from the first sample so the block does not need the previous frame, and pick the
+        // first step from the initial slope so loud frames do not start with a long ramp
+        int predictor = src[0];
+        int index = 0;
+        int slope = samples > 1 ? std::abs(src[1] - src[0]) : 0;
+        while (index < 88 && kImaStepTable[index] < slope) {
+            index++;
+        }
+        *p++ = predictor & 0xFF;
+        *p++ = (predictor >> 8) & 0xFF;
+        *p++ = index;
+        *p++ = 0;
+
+        memset(p, 0, (samples + 1) / 2);
+        for (int i = 0; i < samples; i++) {
+            int step = kImaStepTable[index];
+            int diff = src[i] - predictor;
+            int code = 0;
+            if (diff < 0) {
+                code = 8;
+                diff = -diff;
+            }
+            int delta = step >> 3;
+            if (diff >= step) { code |= 4; diff -= step; delta += step; }
+            step >>= 1;
+            if (diff >= step) { code |= 2; diff -= step; delta += step; }
+            step >>= 1;
+            if (diff >= step) { code |= 1; delta += step; }
+
+            predictor += (code & 8) ? -delta : delta;
+            predictor = std::clamp(predictor, -32768, 32767);
+            index = std::clamp(index + kImaIndexTable[code], 0, 88);
+
+            // Low nibble first
+            p[i / 2] |= (i & 1) ? code << 4 : code;
+        }
+        p += (samples + 1) / 2;
+    }
+    return p - out;
+#else
+    return 0;
+#endif
+}
@@ -3,20 +3,83 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
 
+#define AUDIO_DEBUG_FRAME_MAGIC 0x31464441  // "ADF1"
+#define AUDIO_DEBUG_FRAME_VERSION 1
+// Payload per datagram, keeps frames below the Wi-Fi MTU so they are not fragmented
+#define AUDIO_DEBUG_MAX_PAYLOAD 1024
+
+enum AudioDebugStream : uint8_t {
+    kAudioDebugStreamMic,           // Raw microphone channels
+    kAudioDebugStreamReference,     // AEC reference channel
+    kAudioDebugStreamProcessed,     // Audio processor (AFE) output
+    kAudioDebugStreamPlayback,      // Decoded audio handed to the codec
+    kAudioDebugStreamCount,
+};
+
+enum AudioDebugEncoding : uint8_t {
+    kAudioDebugEncodingPcm16,
+    // IMA ADPCM, 4 bits per sample. Each channel starts with a 4 byte state
+    // (int16 predictor, uint8 step index, uint8 reserved) so every frame decodes on its own
+    kAudioDebugEncodingImaAdpcm,
+};
+
+// 32 bytes, little endian, followed by payload_size bytes of interleaved audio
+struct AudioDebugFrameHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t stream;
+    uint8_t encoding;
+    uint8_t channels;
+    uint32_t sequence;          // Per stream, gaps are lost frames
+    uint32_t sample_rate;
+    int64_t capture_us;         // esp_timer time of the first sample
+    uint16_t samples;           // Samples per channel
+    uint16_t payload_size;
+    uint32_t reserved;
+};
+static_assert(sizeof(AudioDebugFrameHeader) == 32, "Frame header layout is read by scripts/audio_debug_server.py");
+
+/*
+ * Sends audio from several tap points to scripts/audio_debug_server.py over UDP.
+ *
+ * Every frame carries its stream, sequence number and capture time so the host can detect loss
+ * and line the streams up. Each stream must be fed from a single task, different streams may be
+ * fed concurrently.
+ */
 class AudioDebugger {
 public:
     AudioDebugger();
     ~AudioDebugger();
 
-    void Feed(const std::vector<int16_t>& data);
+    // Send `channels` channels starting at `first_channel` out of `frames` frames interleaved by `stride`
+    void Feed(AudioDebugStream stream, const int16_t* data, size_t frames, int stride, int first_channel,
+              int channels, int sample_rate, int64_t capture_us);
+    void Feed(AudioDebugStream stream, const std::vector<int16_t>& data, int channels, int sample_rate,
+              int64_t capture_us) {
+        Feed(stream, data.data(), data.size() / channels, channels, 0, channels, sample_rate, capture_us);
+    }
 
 private:
+    struct StreamState {
+        uint32_t sequence = 0;
+        std::vector<int16_t> pcm;
+        std::vector<uint8_t> packet;
+    };
+
     int udp_sockfd_ = -1;
     struct sockaddr_in udp_server_addr_;
+    AudioDebugEncoding encoding_ = kAudioDebugEncodingPcm16;
+    uint32_t stream_mask_ = 0;
+    StreamState streams_[kAudioDebugStreamCount];
+
+    void SendFrame(AudioDebugStream stream, const int16_t* pcm, int samples, int channels, int sample_rate,
+                   int64_t capture_us);
+    static size_t EncodeImaAdpcm(const int16_t* pcm, int samples, int channels, uint8_t* out);
 };
 
-#endif 
\ No newline at end of file
+#endif
@@ -8,6 +8,10 @@ void NoAudioProcessor::Initialize(AudioCodec* codec, int frame_duration_ms, srmo
     frame_samples_ = frame_duration_ms * 16000 / 1000;
 }
 
+void NoAudioProcessor::SetFrameDuration(int frame_duration_ms) {
+    frame_samples_ = frame_duration_ms * 16000 / 1000;
+}
+
 void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
     if (!is_running_ || !output_callback_) {
         return;
@@ -15,11 +19,11 @@ void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
 
     if (codec_->input_channels() == 2) {
         // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
+        output_buffer_.resize(data.size() / 2);
+        for (size_t i = 0, j = 0; i < output_buffer_.size(); ++i, j += 2) {
+            output_buffer_[i] = data[j];
         }
-        output_callback_(std::move(mono_data));
+        output_callback_(std::move(output_buffer_));
     } else {
         output_callback_(std::move(data));
     }
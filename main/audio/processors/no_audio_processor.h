@@ -2,6 +2,7 @@
 #define DUMMY_AUDIO_PROCESSOR_H
 
 #include <vector>
+#include <atomic>
 #include <functional>
 
 #include "audio_processor.h"
@@ -13,6 +14,7 @@ public:
     ~NoAudioProcessor() = default;
 
     void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
+    void SetFrameDuration(int frame_duration_ms) override;
     void Feed(std::vector<int16_t>&& data) override;
     void Start() override;
     void Stop() override;
@@ -24,10 +26,11 @@ public:
 
 private:
     AudioCodec* codec_ = nullptr;
-    int frame_samples_ = 0;
+    std::atomic<int> frame_samples_{0};
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     bool is_running_ = false;
+    std::vector<int16_t> output_buffer_;
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,114 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Fixed-capacity single-producer / single-consumer ring.
+ *
+ * Push() must only be called by one producer at a time and Pop() by one consumer at a time,
+ * neither of them takes a lock. Clear() may be called from any task: it discards everything
+ * pushed so far, and the consumer releases the discarded slots on its next Pop().
+ *
+ * The ring does not block, the owner decides how producers and consumers are woken up.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity = 0) {
+        Reserve(capacity);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Only call this when no producer or consumer is running
+    void Reserve(size_t capacity) {
+        slots_.reset(capacity > 0 ? new T[capacity]() : nullptr);
+        capacity_ = capacity;
+        limit_.store(capacity, std::memory_order_relaxed);
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+        discard_.store(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return capacity_; }
+
+    // Lower the number of items Push() accepts without reallocating, safe while the ring is in use
+    void SetLimit(size_t limit) {
+        limit_.store(limit < capacity_ ? limit : capacity_, std::memory_order_relaxed);
+    }
+
+    // Producer side. The item is only moved from when there is room for it.
+    bool Push(T&& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head - tail_.load(std::memory_order_acquire) >= limit_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        slots_[head % capacity_] = std::move(item);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool Pop(T& item) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t discard = discard_.load(std::memory_order_acquire);
+        while (static_cast<int32_t>(discard - tail) > 0) {
+            slots_[tail % capacity_] = T();
+            tail++;
+        }
+        if (tail == head_.load(std::memory_order_acquire)) {
+            tail_.store(tail, std::memory_order_release);
+            return false;
+        }
+        item = std::move(slots_[tail % capacity_]);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Any task
+    void Clear() {
+        uint32_t head = head_.load(std::memory_order_acquire);
+        uint32_t discard = discard_.load(std::memory_order_relaxed);
+        while (static_cast<int32_t>(head - discard) > 0 &&
+            !discard_.compare_exchange_weak(discard, head, std::memory_order_release, std::memory_order_relaxed)) {
+        }
+        clears_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Bumped after every Clear(), lets the consumer drop state derived from cleared items
+    uint32_t clear_count() const { return clears_.load(std::memory_order_acquire); }
+
+    // Number of items the consumer will still see
+    size_t Size() const {
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t discard = discard_.load(std::memory_order_acquire);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(discard - tail) > 0) {
+            tail = discard;
+        }
+        return head - tail;
+    }
+
+    bool Empty() const { return Size() == 0; }
+
+    // True if the producer cannot push, discarded slots count until the consumer releases them
+    bool Full() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire) >= limit_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    size_t capacity_ = 0;
+    std::atomic<uint32_t> limit_{0};
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    std::atomic<uint32_t> discard_{0};
+    std::atomic<uint32_t> clears_{0};
+};
+
+#endif // SPSC_RING_H
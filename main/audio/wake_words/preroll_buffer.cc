@@ -0,0 +1,89 @@
+#include "preroll_buffer.h"
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstring>
+
+#define TAG "PrerollBuffer"
+
+void PrerollView::CopyTo(size_t offset, int16_t* out, size_t samples) const {
+    if (offset < first_samples) {
+        size_t n = first_samples - offset < samples ? first_samples - offset : samples;
+        memcpy(out, first + offset, n * sizeof(int16_t));
+        out += n;
+        samples -= n;
+        offset = 0;
+    } else {
+        offset -= first_samples;
+    }
+    if (samples > 0) {
+        memcpy(out, second + offset, samples * sizeof(int16_t));
+    }
+}
+
+PrerollBuffer::~PrerollBuffer() {
+    heap_caps_free(buffer_);
+}
+
+bool PrerollBuffer::Allocate(int sample_rate, int duration_ms) {
+    size_t capacity = (size_t)sample_rate * duration_ms / 1000;
+    if (buffer_ != nullptr && capacity == capacity_) {
+        Clear();
+        return true;
+    }
+
+    heap_caps_free(buffer_);
+    buffer_ = (int16_t*)heap_caps_malloc_prefer(capacity * sizeof(int16_t), 2,
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    capacity_ = buffer_ != nullptr ? capacity : 0;
+    Clear();
+    if (buffer_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes", capacity * sizeof(int16_t));
+        return false;
+    }
+    return true;
+}
+
+void PrerollBuffer::Write(const int16_t* data, size_t samples) {
+    if (capacity_ == 0) {
+        return;
+    }
+    written_ += samples;
+    // Only the newest capacity_ samples can survive
+    if (samples > capacity_) {
+        data += samples - capacity_;
+        samples = capacity_;
+    }
+
+    size_t tail = capacity_ - head_;
+    if (samples <= tail) {
+        memcpy(buffer_ + head_, data, samples * sizeof(int16_t));
+    } else {
+        memcpy(buffer_ + head_, data, tail * sizeof(int16_t));
+        memcpy(buffer_, data + tail, (samples - tail) * sizeof(int16_t));
+    }
+    head_ = (head_ + samples) % capacity_;
+    size_ = size_ + samples > capacity_ ? capacity_ : size_ + samples;
+}
+
+void PrerollBuffer::Clear() {
+    head_ = 0;
+    size_ = 0;
+}
+
+PrerollView PrerollBuffer::GetView() const {
+    PrerollView view;
+    if (size_ == 0) {
+        return view;
+    }
+    size_t start = (head_ + capacity_ - size_) % capacity_;
+    if (start + size_ <= capacity_) {
+        view.first = buffer_ + start;
+        view.first_samples = size_;
+    } else {
+        view.first = buffer_ + start;
+        view.first_samples = capacity_ - start;
+        view.second = buffer_;
+        view.second_samples = size_ - view.first_samples;
+    }
+    return view;
+}
@@ -0,0 +1,57 @@
+#ifndef PREROLL_BUFFER_H
+#define PREROLL_BUFFER_H
+
+#include <sdkconfig.h>
+#include <cstdint>
+#include <cstddef>
+
+#ifndef CONFIG_WAKE_WORD_PREROLL_MS
+#define CONFIG_WAKE_WORD_PREROLL_MS 2000
+#endif
+
+// The buffered audio as at most two contiguous runs, oldest sample first
+struct PrerollView {
+    const int16_t* first = nullptr;
+    size_t first_samples = 0;
+    const int16_t* second = nullptr;
+    size_t second_samples = 0;
+
+    size_t samples() const { return first_samples + second_samples; }
+    // Copy samples starting at offset (0 is the oldest sample) into out
+    void CopyTo(size_t offset, int16_t* out, size_t samples) const;
+};
+
+/*
+ * Circular buffer that keeps the last few seconds of mono PCM before the wake word,
+ * so it can be sent to the server for voice recognition.
+ *
+ * The storage is allocated once in Allocate (PSRAM if present) and Write only copies samples,
+ * nothing is allocated while feeding. Not thread safe, PrerollEncoder serializes writes and reads.
+ */
+class PrerollBuffer {
+public:
+    PrerollBuffer() = default;
+    ~PrerollBuffer();
+    PrerollBuffer(const PrerollBuffer&) = delete;
+    PrerollBuffer& operator=(const PrerollBuffer&) = delete;
+
+    bool Allocate(int sample_rate, int duration_ms = CONFIG_WAKE_WORD_PREROLL_MS);
+    // Append samples, overwriting the oldest ones when full
+    void Write(const int16_t* data, size_t samples);
+    void Clear();
+    PrerollView GetView() const;
+
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return size_; }
+    // Samples written since allocation, the newest sample in the view is at written() - 1
+    uint64_t written() const { return written_; }
+
+private:
+    int16_t* buffer_ = nullptr;
+    size_t capacity_ = 0;
+    size_t head_ = 0;   // Next write position
+    size_t size_ = 0;
+    uint64_t written_ = 0;
+};
+
+#endif // PREROLL_BUFFER_H
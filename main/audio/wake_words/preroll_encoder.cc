@@ -0,0 +1,274 @@
+#include "preroll_encoder.h"
+#include "opus_config.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+
+#define TAG "PrerollEncoder"
+
+#define PREROLL_ENCODE_TASK_STACK_SIZE (4096 * 7)
+#define PREROLL_ROLLING_TASK_PRIORITY 1
+#define PREROLL_ROLLING_TASK_CORE 1
+
+#define ROLLING_NOTIFY_DATA (1 << 0)
+#define ROLLING_NOTIFY_FLUSH (1 << 1)
+
+PrerollEncoder::PrerollEncoder() {
+}
+
+PrerollEncoder::~PrerollEncoder() {
+    if (rolling_task_ != nullptr) {
+        vTaskDelete(rolling_task_);
+    }
+
+    if (encode_task_stack_ != nullptr) {
+        heap_caps_free(encode_task_stack_);
+    }
+
+    if (encode_task_buffer_ != nullptr) {
+        heap_caps_free(encode_task_buffer_);
+    }
+}
+
+bool PrerollEncoder::Initialize(int sample_rate) {
+    sample_rate_ = sample_rate;
+    frame_duration_ = OPUS_FRAME_DURATION_MS;
+    if (!pcm_.Allocate(sample_rate)) {
+        return false;
+    }
+
+    if (rolling_task_ == nullptr && StartRollingTask()) {
+        ESP_LOGI(TAG, "Rolling pre-roll encoder started, %u ms", (unsigned)CONFIG_WAKE_WORD_PREROLL_MS);
+    }
+    return true;
+}
+
+bool PrerollEncoder::StartRollingTask() {
+#if CONFIG_WAKE_WORD_ROLLING_ENCODE && CONFIG_FREERTOS_NUMBER_OF_CORES > 1
+    encode_task_stack_ = (StackType_t*)heap_caps_malloc(PREROLL_ENCODE_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+    encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+    assert(encode_task_stack_ != nullptr && encode_task_buffer_ != nullptr);
+
+    rolling_task_ = xTaskCreateStaticPinnedToCore([](void* arg) {
+        auto this_ = (PrerollEncoder*)arg;
+        this_->RollingEncoderTask();
+        vTaskDelete(NULL);
+    }, "preroll_encoder", PREROLL_ENCODE_TASK_STACK_SIZE, this, PREROLL_ROLLING_TASK_PRIORITY,
+        encode_task_stack_, encode_task_buffer_, PREROLL_ROLLING_TASK_CORE);
+    return rolling_task_ != nullptr;
+#else
+    return false;
+#endif
+}
+
+void PrerollEncoder::Write(const int16_t* data, size_t samples) {
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        pcm_.Write(data, samples);
+    }
+    if (rolling_task_ != nullptr) {
+        xTaskNotify(rolling_task_, ROLLING_NOTIFY_DATA, eSetBits);
+    }
+}
+
+void PrerollEncoder::Encode(int frame_duration) {
+    frame_duration_ = frame_duration;
+    {
+        std::lock_guard<std::mutex> lock(opus_mutex_);
+        opus_.clear();
+        encode_start_time_ = esp_timer_get_time();
+    }
+
+    if (rolling_task_ != nullptr) {
+        xTaskNotify(rolling_task_, ROLLING_NOTIFY_FLUSH, eSetBits);
+    } else {
+        EncodeOnDemand();
+    }
+}
+
+bool PrerollEncoder::GetOpus(std::vector<uint8_t>& opus) {
+    std::unique_lock<std::mutex> lock(opus_mutex_);
+    opus_cv_.wait(lock, [this]() {
+        return !opus_.empty();
+    });
+    opus.swap(opus_.front());
+    opus_.pop_front();
+    return !opus.empty();
+}
+
+PrerollEncoderStats PrerollEncoder::GetStats() {
+    std::lock_guard<std::mutex> lock(opus_mutex_);
+    return stats_;
+}
+
+void PrerollEncoder::PushOpus(std::vector<uint8_t>&& opus) {
+    std::lock_guard<std::mutex> lock(opus_mutex_);
+    opus_.emplace_back(std::move(opus));
+    opus_cv_.notify_all();
+}
+
+void PrerollEncoder::EncodeOnDemand() {
+    if (encode_task_stack_ == nullptr) {
+        encode_task_stack_ = (StackType_t*)heap_caps_malloc(PREROLL_ENCODE_TASK_STACK_SIZE, MALLOC_CAP_SPIRAM);
+        assert(encode_task_stack_ != nullptr);
+    }
+    if (encode_task_buffer_ == nullptr) {
+        encode_task_buffer_ = (StaticTask_t*)heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL);
+        assert(encode_task_buffer_ != nullptr);
+    }
+
+    encode_task_ = xTaskCreateStatic([](void* arg) {
+        auto this_ = (PrerollEncoder*)arg;
+        this_->EncodeRing();
+        vTaskDelete(NULL);
+    }, "encode_wake_word", PREROLL_ENCODE_TASK_STACK_SIZE, this, 2, encode_task_stack_, encode_task_buffer_);
+}
+
+void PrerollEncoder::EncodeRing() {
+    // A fresh encoder, so the first packet needs no history the server does not have
+    auto encoder = std::make_unique<OpusEncoderWrapper>(sample_rate_, 1, frame_duration_);
+    encoder->SetComplexity(0); // 0 is the fastest
+
+    // Detection has stopped, nothing writes to the ring until the next Start()
+    // Skip the oldest partial frame, so the last packet ends at the wake word
+    auto view = pcm_.GetView();
+    const size_t frame_samples = sample_rate_ * frame_duration_ / 1000;
+    int packets = 0;
+    for (size_t offset = view.samples() % frame_samples; offset < view.samples(); offset += frame_samples) {
+        std::vector<int16_t> pcm(frame_samples);
+        view.CopyTo(offset, pcm.data(), frame_samples);
+        std::vector<uint8_t> opus;
+        if (encoder->Encode(std::move(pcm), opus)) {
+            PushOpus(std::move(opus));
+        }
+        packets++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        pcm_.Clear();
+    }
+
+    std::lock_guard<std::mutex> lock(opus_mutex_);
+    stats_.last_flush_us = esp_timer_get_time() - encode_start_time_;
+    ESP_LOGI(TAG, "Encode wake word opus %d packets of %d ms in %ld ms", packets, frame_duration_,
+        (long)(stats_.last_flush_us / 1000));
+    opus_.push_back(std::vector<uint8_t>());
+    opus_cv_.notify_all();
+}
+
+void PrerollEncoder::ResetRollingEncoder() {
+    // A new stream at the current frame duration, packets of the old one are not sent with it
+    rolling_encoder_ = std::make_unique<OpusEncoderWrapper>(sample_rate_, 1, frame_duration_);
+    rolling_encoder_->SetComplexity(0);
+    rolling_frame_samples_ = sample_rate_ * frame_duration_ / 1000;
+    rolling_frame_.reserve(rolling_frame_samples_);
+    rolling_packets_.clear();
+}
+
+void PrerollEncoder::RollingEncoderTask() {
+    ResetRollingEncoder();
+
+    while (true) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        EncodeAvailableFrames();
+        if (bits & ROLLING_NOTIFY_FLUSH) {
+            FlushRollingPackets();
+        }
+    }
+}
+
+void PrerollEncoder::EncodeAvailableFrames() {
+    // One packet more than the pre-roll holds: it goes out first and primes the server's decoder,
+    // so the first packet of the pre-roll decodes with the history it was encoded with
+    const size_t max_packets = pcm_.capacity() / rolling_frame_samples_ + 1;
+    while (true) {
+        bool skipped_frames = false;
+        bool frame_ready = false;
+        {
+            std::lock_guard<std::mutex> lock(pcm_mutex_);
+            uint64_t written = pcm_.written();
+            uint64_t oldest = written - pcm_.size();
+            if (rolling_position_ < oldest) {
+                uint64_t skipped = (oldest - rolling_position_ + rolling_frame_samples_ - 1) / rolling_frame_samples_;
+                rolling_position_ += skipped * rolling_frame_samples_;
+                skipped_frames = true;
+                std::lock_guard<std::mutex> stats_lock(opus_mutex_);
+                stats_.skipped_frames += skipped;
+            }
+            if (written - rolling_position_ >= rolling_frame_samples_) {
+                rolling_frame_.resize(rolling_frame_samples_);
+                pcm_.GetView().CopyTo(rolling_position_ - oldest, rolling_frame_.data(), rolling_frame_samples_);
+                rolling_position_ += rolling_frame_samples_;
+                frame_ready = true;
+            }
+        }
+        if (skipped_frames) {
+            // Fell behind by a whole pre-roll, the encoder history no longer matches the audio after the gap
+            ResetRollingEncoder();
+        }
+        if (!frame_ready) {
+            break;
+        }
+
+        // Recycle the oldest packet buffer once the pre-roll is full
+        std::vector<uint8_t> opus;
+        if (rolling_packets_.size() >= max_packets) {
+            opus.swap(rolling_packets_.front());
+            rolling_packets_.pop_front();
+        }
+        auto start_time = esp_timer_get_time();
+        if (rolling_encoder_->Encode(std::move(rolling_frame_), opus)) {
+            rolling_packets_.emplace_back(std::move(opus));
+        }
+        std::lock_guard<std::mutex> lock(opus_mutex_);
+        stats_.encode_us += esp_timer_get_time() - start_time;
+        stats_.frames++;
+    }
+}
+
+void PrerollEncoder::FlushRollingPackets() {
+    if (rolling_encoder_->duration_ms() != frame_duration_) {
+        // The server picked another frame duration since these packets were encoded, the ring still has the audio
+        ESP_LOGI(TAG, "Frame duration changed from %d to %d ms, encoding the pre-roll again",
+            rolling_encoder_->duration_ms(), frame_duration_);
+        EncodeRing();
+        {
+            std::lock_guard<std::mutex> lock(pcm_mutex_);
+            rolling_position_ = pcm_.written();
+        }
+        ResetRollingEncoder();
+        return;
+    }
+
+    // The partial frame at the end is dropped, at most one frame of audio after the wake word
+    {
+        std::lock_guard<std::mutex> lock(pcm_mutex_);
+        pcm_.Clear();
+        rolling_position_ = pcm_.written();
+    }
+
+    size_t packets = rolling_packets_.size();
+    PrerollEncoderStats stats;
+    {
+        std::lock_guard<std::mutex> lock(opus_mutex_);
+        for (auto& opus : rolling_packets_) {
+            opus_.emplace_back(std::move(opus));
+        }
+        opus_.push_back(std::vector<uint8_t>());
+        stats_.last_flush_us = esp_timer_get_time() - encode_start_time_;
+        stats = stats_;
+        opus_cv_.notify_all();
+    }
+
+    // Start the next pre-roll with a fresh encoder, the server decodes every one as a new stream
+    ResetRollingEncoder();
+
+    int64_t frame_us = stats.frames > 0 ? stats.encode_us / stats.frames : 0;
+    ESP_LOGI(TAG, "Rolling wake word opus %u packets ready in %ld ms, on-demand would take ~%ld ms",
+        (unsigned)packets, (long)(stats.last_flush_us / 1000), (long)(frame_us * packets / 1000));
+    ESP_LOGI(TAG, "Rolling encoder cost %ld us/frame, %.1f%% of one core, %lu frames, %lu skipped",
+        (long)frame_us, frame_us * 100.0 / (frame_duration_ * 1000),
+        (unsigned long)stats.frames, (unsigned long)stats.skipped_frames);
+}
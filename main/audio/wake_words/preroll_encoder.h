@@ -0,0 +1,87 @@
+#ifndef PREROLL_ENCODER_H
+#define PREROLL_ENCODER_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+
+#include "preroll_buffer.h"
+
+class OpusEncoderWrapper;
+
+struct PrerollEncoderStats {
+    uint32_t frames = 0;            // Frames encoded by the rolling encoder
+    uint32_t skipped_frames = 0;    // Frames overwritten before the rolling encoder got to them
+    int64_t encode_us = 0;          // Total rolling encode time
+    int64_t last_flush_us = 0;      // Detection to last packet ready, either mode
+};
+
+/*
+ * Audio before the wake word and its Opus packets, shared by the wake word implementations.
+ *
+ * By default the pre-roll is encoded on demand by a short lived task after the wake word is
+ * detected. With CONFIG_WAKE_WORD_ROLLING_ENCODE a background task on the second core encodes
+ * each frame as it is written, so on detection only the last frame is left to encode. Single core
+ * chips always use the on-demand path.
+ */
+class PrerollEncoder {
+public:
+    PrerollEncoder();
+    ~PrerollEncoder();
+    PrerollEncoder(const PrerollEncoder&) = delete;
+    PrerollEncoder& operator=(const PrerollEncoder&) = delete;
+
+    bool Initialize(int sample_rate);
+    // Called by the detection task, never blocks on the encoder
+    void Write(const int16_t* data, size_t samples);
+    // Called after detection stopped, the packets are read with GetOpus()
+    // frame_duration is the uplink frame duration the server negotiated
+    void Encode(int frame_duration);
+    // Blocks until the next packet, returns false after the last one
+    bool GetOpus(std::vector<uint8_t>& opus);
+
+    bool rolling() const { return rolling_task_ != nullptr; }
+    PrerollEncoderStats GetStats();
+
+private:
+    int sample_rate_ = 16000;
+    // Set by Initialize() and Encode() before the encoder tasks read it
+    int frame_duration_ = 0;
+    std::mutex pcm_mutex_;
+    PrerollBuffer pcm_;
+
+    std::mutex opus_mutex_;
+    std::condition_variable opus_cv_;
+    std::deque<std::vector<uint8_t>> opus_;
+    int64_t encode_start_time_ = 0;
+    PrerollEncoderStats stats_;
+
+    // On-demand encoding
+    TaskHandle_t encode_task_ = nullptr;
+    StaticTask_t* encode_task_buffer_ = nullptr;
+    StackType_t* encode_task_stack_ = nullptr;
+
+    // Rolling encoding, only touched by rolling_task_
+    TaskHandle_t rolling_task_ = nullptr;
+    std::unique_ptr<OpusEncoderWrapper> rolling_encoder_;
+    std::deque<std::vector<uint8_t>> rolling_packets_;
+    std::vector<int16_t> rolling_frame_;
+    size_t rolling_frame_samples_ = 0;
+    uint64_t rolling_position_ = 0;
+
+    bool StartRollingTask();
+    void ResetRollingEncoder();
+    void RollingEncoderTask();
+    void EncodeAvailableFrames();
+    void FlushRollingPackets();
+    void EncodeOnDemand();
+    void EncodeRing();
+    void PushOpus(std::vector<uint8_t>&& opus);
+};
+
+#endif // PREROLL_ENCODER_H
@@ -267,16 +267,14 @@ bool CustomPageManager::DeletePage(int page) {
     // 从屏幕删除该页的 label
     auto* epaper = Board::GetInstance().GetEpaperDisplay();
     if (epaper) {
+        // 渲染任务会并发遍历 label，增删 label 必须持有显示锁
+        DisplayLockGuard lock(epaper);
         std::string prefix = GetPagePrefix(page);
         // 收集要删除的 label id
         std::vector<String> to_remove;
-        auto* labels = epaper->GetAllLabels();
-        if (labels) {
-            for (const auto& pair : *labels) {
-                if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) == 0) {
-                    to_remove.push_back(pair.first);
-                }
-            }
+        auto& labels = epaper->GetLabelStore();
+        for (auto handle : labels.PrefixLabels(prefix.c_str())) {
+            to_remove.push_back(labels.Name(handle));
         }
         for (const auto& id : to_remove) {
             epaper->RemoveLabel(id);
@@ -341,20 +339,6 @@ bool CustomPageManager::AddElement(int page, const std::string& id, const std::s
     std::string prefix = GetPagePrefix(page);
     std::string full_id = prefix + id;
 
-    // 检查元素数量上限
-    int count = 0;
-    auto* labels = epaper->GetAllLabels();
-    if (labels) {
-        for (const auto& pair : *labels) {
-            if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) == 0) count++;
-        }
-    }
-    // 如果不是替换已有元素
-    if (epaper->GetLabel(String(full_id.c_str())) == nullptr && count >= MAX_ELEMENTS_PER_PAGE) {
-        ESP_LOGW(TAG, "Page %d element limit reached (%d)", page, MAX_ELEMENTS_PER_PAGE);
-        return false;
-    }
-
     const uint8_t* font = GetCustomTextFont(font_size);
 
     EpaperTextAlign ealign = EpaperTextAlign::LEFT;
@@ -406,10 +390,10 @@ bool CustomPageManager::AddElement(int page, const std::string& id, const std::s
             fclose(imgf);
             return false;
         }
-        uint8_t* bitmap = (uint8_t*)malloc(total_bytes);
+        auto bitmap = EpaperLabel::AllocBitmap(total_bytes);
         if (!bitmap) { fclose(imgf); return false; }
-        size_t rd = fread(bitmap, 1, total_bytes, imgf);
-        if (rd < total_bytes) memset(bitmap + rd, 0, total_bytes - rd);
+        size_t rd = fread(bitmap.get(), 1, total_bytes, imgf);
+        if (rd < total_bytes) memset(bitmap.get() + rd, 0, total_bytes - rd);
         fclose(imgf);
         label = new EpaperLabel(
             EpaperLabel::Bitmap(x, y, bitmap, w, h, 1, 1, false, false, false, true, page, image_name.c_str()));
@@ -417,8 +401,22 @@ bool CustomPageManager::AddElement(int page, const std::string& id, const std::s
 
     if (!label) return false;
 
-    epaper->AddLabel(String(full_id.c_str()), label);
-    SavePageLayout(page);
+    std::string layout;
+    {
+        // 渲染任务会并发遍历 label，增删 label 必须持有显示锁；布局文件在释放锁后再写
+        DisplayLockGuard lock(epaper);
+        // 检查元素数量上限
+        int count = (int)epaper->GetLabelStore().PrefixLabels(prefix.c_str()).size();
+        // 如果不是替换已有元素
+        if (epaper->GetLabel(String(full_id.c_str())) == nullptr && count >= MAX_ELEMENTS_PER_PAGE) {
+            ESP_LOGW(TAG, "Page %d element limit reached (%d)", page, MAX_ELEMENTS_PER_PAGE);
+            delete label;
+            return false;
+        }
+        epaper->AddLabel(String(full_id.c_str()), label);
+        layout = BuildPageLayout(page);
+    }
+    WritePageLayout(page, layout);
     ESP_LOGI(TAG, "Added element '%s' (type=%s) to page %d", id.c_str(), type.c_str(), page);
     return true;
 }
@@ -431,17 +429,22 @@ bool CustomPageManager::UpdateElementText(int page, const std::string& id, const
     if (!epaper) return false;
 
     std::string full_id = GetPagePrefix(page) + id;
-    EpaperLabel* label = epaper->GetLabel(String(full_id.c_str()));
-    if (!label) {
-        ESP_LOGW(TAG, "Element '%s' not found on page %d", id.c_str(), page);
-        return false;
-    }
+    std::string layout;
+    {
+        DisplayLockGuard lock(epaper);
+        EpaperLabel* label = epaper->GetLabel(String(full_id.c_str()));
+        if (!label) {
+            ESP_LOGW(TAG, "Element '%s' not found on page %d", id.c_str(), page);
+            return false;
+        }
 
-    // 更新文本值（创建静态 TextValue）
-    label->text = text.c_str();
+        // 更新文本值（创建静态 TextValue）
+        label->text = text.c_str();
+        layout = BuildPageLayout(page);
+    }
 
     // 持久化到 LittleFS，确保重启后文字不丢失
-    SavePageLayout(page);
+    WritePageLayout(page, layout);
 
     ESP_LOGI(TAG, "Updated element '%s' on page %d: %s", id.c_str(), page, text.c_str());
     return true;
@@ -455,9 +458,14 @@ bool CustomPageManager::RemoveElement(int page, const std::string& id) {
     if (!epaper) return false;
 
     std::string full_id = GetPagePrefix(page) + id;
-    epaper->RemoveLabel(String(full_id.c_str()));
+    std::string layout;
+    {
+        DisplayLockGuard lock(epaper);
+        epaper->RemoveLabel(String(full_id.c_str()));
+        layout = BuildPageLayout(page);
+    }
 
-    SavePageLayout(page);
+    WritePageLayout(page, layout);
     ESP_LOGI(TAG, "Removed element '%s' from page %d", id.c_str(), page);
     return true;
 }
@@ -470,18 +478,17 @@ std::string CustomPageManager::ListElements(int page) {
     if (!epaper) return "[]";
 
     std::string prefix = GetPagePrefix(page);
-    auto* labels = epaper->GetAllLabels();
-    if (!labels) return "[]";
+    DisplayLockGuard lock(epaper);
+    auto& labels = epaper->GetLabelStore();
 
     std::string json = "[";
     bool first = true;
-    for (const auto& pair : *labels) {
-        if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) != 0) continue;
-        EpaperLabel* label = pair.second;
+    for (auto handle : labels.PrefixLabels(prefix.c_str())) {
+        EpaperLabel* label = labels.Get(handle);
         if (label->page != page) continue;
 
         // 提取不含前缀的 id
-        std::string short_id = pair.first.c_str() + prefix.size();
+        std::string short_id = labels.Name(handle).c_str() + prefix.size();
 
         if (!first) json += ",";
         first = false;
@@ -549,16 +556,15 @@ bool CustomPageManager::ClearPage(int page) {
 
     std::string prefix = GetPagePrefix(page);
     std::vector<String> to_remove;
-    auto* labels = epaper->GetAllLabels();
-    if (labels) {
-        for (const auto& pair : *labels) {
-            if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) == 0) {
-                to_remove.push_back(pair.first);
-            }
+    {
+        DisplayLockGuard lock(epaper);
+        auto& labels = epaper->GetLabelStore();
+        for (auto handle : labels.PrefixLabels(prefix.c_str())) {
+            to_remove.push_back(labels.Name(handle));
+        }
+        for (const auto& id : to_remove) {
+            epaper->RemoveLabel(id);
         }
-    }
-    for (const auto& id : to_remove) {
-        epaper->RemoveLabel(id);
     }
 
     // 删除布局文件
@@ -571,26 +577,79 @@ bool CustomPageManager::ClearPage(int page) {
 
 // ==================== 布局持久化 ====================
 
-void CustomPageManager::SavePageLayout(int page) {
-    if (!IsCustomPage(page)) return;
+// 注意：调用者必须已持有显示锁；该页没有可保存的元素时返回空串
+std::string CustomPageManager::BuildPageLayout(int page) {
+    if (!IsCustomPage(page)) return "";
 
     auto* epaper = Board::GetInstance().GetEpaperDisplay();
-    if (!epaper) return;
+    if (!epaper) return "";
 
     std::string prefix = GetPagePrefix(page);
-    std::string path = GetLayoutPath(page);
-
-    // 统计该页的元素数量
+    auto& labels = epaper->GetLabelStore();
+    std::string elements;
     int count = 0;
-    auto* labels = epaper->GetAllLabels();
-    if (labels) {
-        for (const auto& pair : *labels) {
-            if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) == 0 &&
-                pair.second->page == page) count++;
+
+    for (auto handle : labels.PrefixLabels(prefix.c_str())) {
+        EpaperLabel* label = labels.Get(handle);
+        if (label->page != page) continue;
+
+        std::string short_id = labels.Name(handle).c_str() + prefix.size();
+        std::string element;
+
+        switch (label->type) {
+            case EpaperObjectType::TEXT:
+                element = "{\"type\":\"text\",\"id\":\"" + short_id +
+                    "\",\"text\":\"" + EscapeJson(label->text().c_str()) +
+                    "\",\"x\":" + std::to_string((int)label->x) +
+                    ",\"y\":" + std::to_string(GetStoredTextY(label)) +
+                    ",\"font_size\":" + std::to_string(GetStoredFontSize(label)) +
+                    ",\"align\":\"" + (label->align == EpaperTextAlign::CENTER ? "center" :
+                                        label->align == EpaperTextAlign::RIGHT ? "right" : "left") + "\"";
+                // 如果是动态元素，追加 dtype 字段
+                if (label->dynamic_type[0] != '\0') {
+                    element += ",\"dtype\":\"" + std::string(label->dynamic_type) + "\"";
+                }
+                element += "}";
+                break;
+            case EpaperObjectType::RECT:
+                element = "{\"type\":\"rect\",\"id\":\"" + short_id +
+                    "\",\"x\":" + std::to_string((int)label->x) + ",\"y\":" + std::to_string((int)label->y) +
+                    ",\"w\":" + std::to_string((int)label->w) + ",\"h\":" + std::to_string((int)label->h) +
+                    ",\"filled\":" + (label->filled ? "true" : "false") + "}";
+                break;
+            case EpaperObjectType::LINE:
+                element = "{\"type\":\"line\",\"id\":\"" + short_id +
+                    "\",\"x1\":" + std::to_string((int)label->x) + ",\"y1\":" + std::to_string((int)label->y) +
+                    ",\"x2\":" + std::to_string((int)label->x1) + ",\"y2\":" + std::to_string((int)label->y1) +
+                    ",\"width\":" + std::to_string((int)label->width) + "}";
+                break;
+            case EpaperObjectType::BITMAP:
+                if (label->image_name[0] != '\0') {
+                    element = "{\"type\":\"image\",\"id\":\"" + short_id +
+                        "\",\"name\":\"" + label->image_name +
+                        "\",\"x\":" + std::to_string((int)label->x) + ",\"y\":" + std::to_string((int)label->y) +
+                        ",\"w\":" + std::to_string((int)label->w) + ",\"h\":" + std::to_string((int)label->h) + "}";
+                }
+                break;
+            default:
+                break;
         }
+
+        // 没有图片名的位图无法恢复，不写入
+        if (element.empty()) continue;
+        if (count > 0) elements += ",";
+        elements += element;
+        count++;
     }
 
-    if (count == 0) {
+    if (count == 0) return "";
+    return "{\"page\":" + std::to_string(page) + ",\"elements\":[" + elements + "]}";
+}
+
+// 在显示锁外调用，写 LittleFS 时不阻塞渲染任务
+void CustomPageManager::WritePageLayout(int page, const std::string& layout) {
+    std::string path = GetLayoutPath(page);
+    if (layout.empty()) {
         unlink(path.c_str());
         ESP_LOGI(TAG, "No elements on page %d, layout file deleted", page);
         return;
@@ -601,65 +660,9 @@ void CustomPageManager::SavePageLayout(int page) {
         ESP_LOGW(TAG, "Failed to open %s for writing", path.c_str());
         return;
     }
-
-    fprintf(f, "{\"page\":%d,\"elements\":[", page);
-    bool first = true;
-
-    if (labels) {
-        for (const auto& pair : *labels) {
-            if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) != 0) continue;
-            EpaperLabel* label = pair.second;
-            if (label->page != page) continue;
-
-            std::string short_id = pair.first.c_str() + prefix.size();
-
-            if (!first) fprintf(f, ",");
-            first = false;
-
-            switch (label->type) {
-                case EpaperObjectType::TEXT:
-                    fprintf(f, "{\"type\":\"text\",\"id\":\"%s\",\"text\":\"%s\",\"x\":%d,\"y\":%d,\"font_size\":%d,\"align\":\"%s\"",
-                            short_id.c_str(),
-                            EscapeJson(label->text().c_str()).c_str(),
-                            (int)label->x, GetStoredTextY(label),
-                            GetStoredFontSize(label),
-                            label->align == EpaperTextAlign::CENTER ? "center" :
-                            label->align == EpaperTextAlign::RIGHT ? "right" : "left");
-                    // 如果是动态元素，追加 dtype 字段
-                    if (label->dynamic_type[0] != '\0') {
-                        fprintf(f, ",\"dtype\":\"%s\"", label->dynamic_type);
-                    }
-                    fprintf(f, "}");
-                    break;
-                case EpaperObjectType::RECT:
-                    fprintf(f, "{\"type\":\"rect\",\"id\":\"%s\",\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d,\"filled\":%s}",
-                            short_id.c_str(),
-                            (int)label->x, (int)label->y, (int)label->w, (int)label->h,
-                            label->filled ? "true" : "false");
-                    break;
-                case EpaperObjectType::LINE:
-                    fprintf(f, "{\"type\":\"line\",\"id\":\"%s\",\"x1\":%d,\"y1\":%d,\"x2\":%d,\"y2\":%d,\"width\":%d}",
-                            short_id.c_str(),
-                            (int)label->x, (int)label->y, (int)label->x1, (int)label->y1,
-                            (int)label->width);
-                    break;
-                case EpaperObjectType::BITMAP:
-                    if (label->image_name[0] != '\0') {
-                        fprintf(f, "{\"type\":\"image\",\"id\":\"%s\",\"name\":\"%s\",\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d}",
-                                short_id.c_str(),
-                                label->image_name,
-                                (int)label->x, (int)label->y, (int)label->w, (int)label->h);
-                    }
-                    break;
-                default:
-                    break;
-            }
-        }
-    }
-
-    fprintf(f, "]}");
+    fwrite(layout.data(), 1, layout.size(), f);
     fclose(f);
-    ESP_LOGI(TAG, "Page %d layout saved (%d elements)", page, count);
+    ESP_LOGI(TAG, "Page %d layout saved (%u bytes)", page, (unsigned)layout.size());
 }
 
 void CustomPageManager::LoadPageLayout(int page) {
@@ -685,6 +688,8 @@ void CustomPageManager::LoadPageLayout(int page) {
 
     auto* epaper = Board::GetInstance().GetEpaperDisplay();
     if (!epaper) { free(buf); return; }
+    // 恢复在独立任务中进行，渲染任务可能同时在遍历 label
+    DisplayLockGuard lock(epaper);
 
     std::string prefix = GetPagePrefix(page);
     const char* p = strstr(buf, "[");  // 跳过外层 {"page":N,"elements": 直接到数组
@@ -775,12 +780,12 @@ void CustomPageManager::LoadPageLayout(int page) {
             if (!dtype.empty()) {
                 // 动态元素: 创建带 lambda 的 TextValue
                 std::string dt = dtype;
-                epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
+                auto* lbl = new EpaperLabel(
                     EpaperLabel::Text([dt]() -> String { return String(CustomPageManager::FormatDynamicValue(dt).c_str()); },
-                                     x, y, 276, text_h, font_height, font, GxEPD_BLACK, ealign, 1, true, false, page)));
-                // 设置 dynamic_type 字段
-                auto* lbl = epaper->GetLabel(String(full_id.c_str()));
-                if (lbl) strncpy(lbl->dynamic_type, dt.c_str(), sizeof(lbl->dynamic_type) - 1);
+                                     x, y, 276, text_h, font_height, font, GxEPD_BLACK, ealign, 1, true, false, page));
+                // 设置 dynamic_type 字段，需在 AddLabel 前设置才会计入动态元素统计
+                strncpy(lbl->dynamic_type, dt.c_str(), sizeof(lbl->dynamic_type) - 1);
+                epaper->AddLabel(String(full_id.c_str()), lbl);
             } else {
                 epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
                     EpaperLabel::Text(text.c_str(), x, y, 276, text_h, font_height,
@@ -813,10 +818,10 @@ void CustomPageManager::LoadPageLayout(int page) {
                     fclose(imgf);
                     continue;
                 }
-                uint8_t* bitmap = (uint8_t*)malloc(total_bytes);
+                auto bitmap = EpaperLabel::AllocBitmap(total_bytes);
                 if (bitmap) {
-                    size_t rdb = fread(bitmap, 1, total_bytes, imgf);
-                    if (rdb < total_bytes) memset(bitmap + rdb, 0, total_bytes - rdb);
+                    size_t rdb = fread(bitmap.get(), 1, total_bytes, imgf);
+                    if (rdb < total_bytes) memset(bitmap.get() + rdb, 0, total_bytes - rdb);
                     epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
                         EpaperLabel::Bitmap(x, y, bitmap, w, h, 1, 1, false, false, false, true, page, img_name.c_str())));
                     count++;
@@ -905,24 +910,10 @@ void CustomPageManager::TickDynamicUpdate() {
     // 只在自定义页面 (7-15) 更新
     if (current_page < MIN_CUSTOM_PAGE || current_page > MAX_CUSTOM_PAGE) return;
 
-    // 检查当前页是否有动态元素
-    std::string prefix = GetPagePrefix(current_page);
-    auto* labels = epaper->GetAllLabels();
-    if (!labels) return;
-
-    bool has_dynamic = false;
-    for (const auto& pair : *labels) {
-        if (strncmp(pair.first.c_str(), prefix.c_str(), prefix.size()) != 0) continue;
-        if (pair.second->type == EpaperObjectType::TEXT &&
-            pair.second->dynamic_type[0] != '\0') {
-            has_dynamic = true;
-            break;
-        }
-    }
-
-    if (!has_dynamic) return;
+    DisplayLockGuard lock(epaper);
+    // 检查当前页是否有动态元素（存储按页统计，不用遍历 label）
+    if (epaper->GetLabelStore().DynamicCount(current_page) == 0) return;
 
     // 只做局部刷新（false = partial）
-    DisplayLockGuard lock(epaper);
     epaper->UpdateUI(false);
 }
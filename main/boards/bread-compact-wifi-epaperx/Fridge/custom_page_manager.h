@@ -34,7 +34,8 @@ public:
     bool ClearPage(int page);
 
     // 持久化
-    void SavePageLayout(int page);
+    std::string BuildPageLayout(int page);                          // 生成布局 JSON，调用者必须已持有显示锁
+    void WritePageLayout(int page, const std::string& layout);      // 写布局文件，空串删除文件，在锁外调用
     void LoadPageLayout(int page);
     void LoadAllPages();    // 启动时调用，加载所有自定义页面
 
@@ -16,7 +16,8 @@ static const char* TAG = "FridgeMCP";
 static const char* CANVAS_LAYOUT_FILE = "/canvas/layout.json";
 
 // 前向声明（实现在后面的 namespace 块中）
-static void SaveCanvasLayout();
+static std::string BuildCanvasLayout();
+static void WriteCanvasLayout(const std::string& layout);
 static void LoadCanvasLayout();
 
 static size_t CanvasBitmapBytes(int w, int h) {
@@ -1375,15 +1376,7 @@ static const int CANVAS_MAX_LABELS = 30;
 static int CountCanvasLabels() {
     auto* epaper = Board::GetInstance().GetEpaperDisplay();
     if (epaper == nullptr) return 0;
-    auto* labels = epaper->GetAllLabels();
-    if (labels == nullptr) return 0;
-    int count = 0;
-    for (const auto& pair : *labels) {
-        if (strncmp(pair.first.c_str(), CANVAS_PREFIX, 7) == 0) {
-            count++;
-        }
-    }
-    return count;
+    return (int)epaper->GetLabelStore().PrefixLabels(CANVAS_PREFIX).size();
 }
 
 // 检查控件数量是否超限（用于 add 操作前检查）
@@ -1414,14 +1407,79 @@ static bool CheckCanvasLabelLimit(const std::string& full_id) {
 //   {"type":"image","id":"heart","name":"heart","x":116,"y":30,"w":64,"h":64}
 // ]
 
-// 保存当前 canvas 布局到 LittleFS
-static void SaveCanvasLayout() {
+// 生成当前 canvas 布局的 JSON，没有可保存的控件时返回空串
+// 注意：调用者必须已持有显示锁
+static std::string BuildCanvasLayout() {
     auto* epaper = Board::GetInstance().GetEpaperDisplay();
-    if (epaper == nullptr) return;
+    if (epaper == nullptr) return "";
+
+    std::string json;
+    bool first = true;
+
+    // 遍历所有 canvas_ 前缀的 label
+    auto& labels = epaper->GetLabelStore();
+    for (auto handle : labels.PrefixLabels(CANVAS_PREFIX)) {
+        const String& label_id = labels.Name(handle);
+        EpaperLabel* label = labels.Get(handle);
+
+        // 跳过 layout.json 自身
+        if (label->page != 6) continue;
+
+        // 提取不含前缀的 id
+        std::string short_id = label_id.c_str() + 7;
+        std::string element;
+
+        switch (label->type) {
+            case EpaperObjectType::TEXT:
+                element = "{\"type\":\"text\",\"id\":\"" + short_id +
+                    "\",\"text\":\"" + EscapeJsonString(label->text().c_str()) +
+                    "\",\"x\":" + std::to_string((int)label->x) +
+                    ",\"y\":" + std::to_string((int)(label->y - label->h + 4)) +  // 反算原始 y
+                    ",\"font_size\":" + std::to_string((int)label->h - 4) +        // 反算 font_size
+                    ",\"align\":\"" + (label->align == EpaperTextAlign::CENTER ? "center" :
+                                        label->align == EpaperTextAlign::RIGHT ? "right" : "left") +
+                    "\",\"max_width\":" + std::to_string((int)label->w_max) + "}";
+                break;
+            case EpaperObjectType::RECT:
+                element = "{\"type\":\"rect\",\"id\":\"" + short_id +
+                    "\",\"x\":" + std::to_string((int)label->x) + ",\"y\":" + std::to_string((int)label->y) +
+                    ",\"w\":" + std::to_string((int)label->w) + ",\"h\":" + std::to_string((int)label->h) +
+                    ",\"filled\":" + (label->filled ? "true" : "false") + "}";
+                break;
+            case EpaperObjectType::LINE:
+                element = "{\"type\":\"line\",\"id\":\"" + short_id +
+                    "\",\"x1\":" + std::to_string((int)label->x) + ",\"y1\":" + std::to_string((int)label->y) +
+                    ",\"x2\":" + std::to_string((int)label->x1) + ",\"y2\":" + std::to_string((int)label->y1) +
+                    ",\"width\":" + std::to_string((int)label->width) + "}";
+                break;
+            case EpaperObjectType::BITMAP:
+                // 保存图片信息：name, x, y, w, h
+                if (label->image_name[0] != '\0') {
+                    element = "{\"type\":\"image\",\"id\":\"" + short_id +
+                        "\",\"name\":\"" + label->image_name +
+                        "\",\"x\":" + std::to_string((int)label->x) + ",\"y\":" + std::to_string((int)label->y) +
+                        ",\"w\":" + std::to_string((int)label->w) + ",\"h\":" + std::to_string((int)label->h) + "}";
+                }
+                break;
+            default:
+                break;
+        }
+
+        // 没有图片名的位图无法恢复，不写入
+        if (element.empty()) continue;
+        if (!first) json += ",";
+        first = false;
+        json += element;
+    }
 
+    if (first) return "";
+    return "[" + json + "]";
+}
+
+// 把 BuildCanvasLayout 的结果写入 LittleFS，在显示锁外调用，写文件时不阻塞渲染任务
+static void WriteCanvasLayout(const std::string& layout) {
     // 如果没有 canvas 控件，删除布局文件而不是写空数组
-    int count = CountCanvasLabels();
-    if (count == 0) {
+    if (layout.empty()) {
         unlink(CANVAS_LAYOUT_FILE);
         ESP_LOGI(TAG, "No canvas labels, layout file deleted");
         return;
@@ -1432,67 +1490,7 @@ static void SaveCanvasLayout() {
         ESP_LOGW(TAG, "Failed to open layout file for writing");
         return;
     }
-
-    fputc('[', f);
-    bool first = true;
-
-    // 遍历所有 canvas_ 前缀的 label
-    auto* labels = epaper->GetAllLabels();
-    if (labels) {
-        for (const auto& pair : *labels) {
-            const String& label_id = pair.first;
-            EpaperLabel* label = pair.second;
-
-            // 只保存 canvas_ 前缀的
-            if (strncmp(label_id.c_str(), CANVAS_PREFIX, 7) != 0) continue;
-            // 跳过 layout.json 自身
-            if (label->page != 6) continue;
-
-            // 提取不含前缀的 id
-            std::string short_id = label_id.c_str() + 7;
-
-            if (!first) fputc(',', f);
-            first = false;
-
-            switch (label->type) {
-                case EpaperObjectType::TEXT:
-                    fprintf(f, "{\"type\":\"text\",\"id\":\"%s\",\"text\":\"%s\",\"x\":%d,\"y\":%d,\"font_size\":%d,\"align\":\"%s\",\"max_width\":%d}",
-                            short_id.c_str(),
-                            EscapeJsonString(label->text().c_str()).c_str(),
-                            (int)label->x, (int)(label->y - label->h + 4),  // 反算原始 y
-                            (int)label->h - 4,  // 反算 font_size
-                            label->align == EpaperTextAlign::CENTER ? "center" :
-                            label->align == EpaperTextAlign::RIGHT ? "right" : "left",
-                            (int)label->w_max);
-                    break;
-                case EpaperObjectType::RECT:
-                    fprintf(f, "{\"type\":\"rect\",\"id\":\"%s\",\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d,\"filled\":%s}",
-                            short_id.c_str(),
-                            (int)label->x, (int)label->y, (int)label->w, (int)label->h,
-                            label->filled ? "true" : "false");
-                    break;
-                case EpaperObjectType::LINE:
-                    fprintf(f, "{\"type\":\"line\",\"id\":\"%s\",\"x1\":%d,\"y1\":%d,\"x2\":%d,\"y2\":%d,\"width\":%d}",
-                            short_id.c_str(),
-                            (int)label->x, (int)label->y, (int)label->x1, (int)label->y1,
-                            (int)label->width);
-                    break;
-                case EpaperObjectType::BITMAP:
-                    // 保存图片信息：name, x, y, w, h
-                    if (label->image_name[0] != '\0') {
-                        fprintf(f, "{\"type\":\"image\",\"id\":\"%s\",\"name\":\"%s\",\"x\":%d,\"y\":%d,\"w\":%d,\"h\":%d}",
-                                short_id.c_str(),
-                                label->image_name,
-                                (int)label->x, (int)label->y, (int)label->w, (int)label->h);
-                    }
-                    break;
-                default:
-                    break;
-            }
-        }
-    }
-
-    fputc(']', f);
+    fwrite(layout.data(), 1, layout.size(), f);
     fclose(f);
     ESP_LOGI(TAG, "Canvas layout saved to %s", CANVAS_LAYOUT_FILE);
 }
@@ -1534,6 +1532,8 @@ static void LoadCanvasLayout() {
 
     // 清理旧 canvas labels
     epaper->ClearCanvasLabels();
+    // 恢复在独立任务中进行，渲染任务可能同时在遍历 label
+    DisplayLockGuard lock(epaper);
 
     const char* p = buf;
     int count = 0;
@@ -1669,11 +1669,11 @@ static void LoadCanvasLayout() {
                     fclose(imgf);
                     continue;
                 }
-                uint8_t* bitmap = (uint8_t*)malloc(total_bytes);
+                auto bitmap = EpaperLabel::AllocBitmap(total_bytes);
                 if (bitmap) {
-                    size_t rd = fread(bitmap, 1, total_bytes, imgf);
+                    size_t rd = fread(bitmap.get(), 1, total_bytes, imgf);
                     if (rd < total_bytes) {
-                        memset(bitmap + rd, 0, total_bytes - rd);
+                        memset(bitmap.get() + rd, 0, total_bytes - rd);
                     }
                     epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
                         EpaperLabel::Bitmap(x, y, bitmap, w, h, 1, 1, false, false, false, true, 6, img_name.c_str())));
@@ -1990,19 +1990,25 @@ ReturnValue FridgeMcpTools::HandleCanvasAddText(const PropertyList& properties)
         EpaperTextAlign align = ParseAlign(align_str);
         std::string full_id = MakeCanvasId(id);
 
-        // 检查控件数量上限
-        if (!CheckCanvasLabelLimit(full_id)) {
-            return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
-        }
+        std::string layout;
+        {
+            // 渲染任务会并发遍历 label，增删前必须持有显示锁；刷新前释放，ShowCanvasPage 会自己加锁
+            DisplayLockGuard lock(epaper);
+            // 检查控件数量上限
+            if (!CheckCanvasLabelLimit(full_id)) {
+                return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
+            }
 
-        // font_height = font_size (12 或 16)
-        int h = font_size + 4;  // 给点余量
+            // font_height = font_size (12 或 16)
+            int h = font_size + 4;  // 给点余量
 
-        epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
-            EpaperLabel::Text(text.c_str(), x, y, max_width, h, font_size,
-                             font, GxEPD_BLACK, align, 1, true, false, 6)));
+            epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
+                EpaperLabel::Text(text.c_str(), x, y, max_width, h, font_size,
+                                 font, GxEPD_BLACK, align, 1, true, false, 6)));
 
-        SaveCanvasLayout();
+            layout = BuildCanvasLayout();
+        }
+        WriteCanvasLayout(layout);
         RefreshCanvasIfNeeded(refresh);
 
         std::string result = "{\"status\":\"success\",\"id\":\"" + EscapeJsonString(id) +
@@ -2034,14 +2040,19 @@ ReturnValue FridgeMcpTools::HandleCanvasAddRect(const PropertyList& properties)
 
         std::string full_id = MakeCanvasId(id);
 
-        if (!CheckCanvasLabelLimit(full_id)) {
-            return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
-        }
+        std::string layout;
+        {
+            DisplayLockGuard lock(epaper);
+            if (!CheckCanvasLabelLimit(full_id)) {
+                return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
+            }
 
-        epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
-            EpaperLabel::Rect(x, y, w, h, filled, GxEPD_BLACK, 1, true, 6)));
+            epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
+                EpaperLabel::Rect(x, y, w, h, filled, GxEPD_BLACK, 1, true, 6)));
 
-        SaveCanvasLayout();
+            layout = BuildCanvasLayout();
+        }
+        WriteCanvasLayout(layout);
         RefreshCanvasIfNeeded(refresh);
 
         std::string result = "{\"status\":\"success\",\"id\":\"" + EscapeJsonString(id) +
@@ -2073,14 +2084,19 @@ ReturnValue FridgeMcpTools::HandleCanvasAddLine(const PropertyList& properties)
 
         std::string full_id = MakeCanvasId(id);
 
-        if (!CheckCanvasLabelLimit(full_id)) {
-            return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
-        }
+        std::string layout;
+        {
+            DisplayLockGuard lock(epaper);
+            if (!CheckCanvasLabelLimit(full_id)) {
+                return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
+            }
 
-        epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
-            EpaperLabel::Line(x1, y1, x2, y2, width, GxEPD_BLACK, 1, true, 6)));
+            epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
+                EpaperLabel::Line(x1, y1, x2, y2, width, GxEPD_BLACK, 1, true, 6)));
 
-        SaveCanvasLayout();
+            layout = BuildCanvasLayout();
+        }
+        WriteCanvasLayout(layout);
         RefreshCanvasIfNeeded(refresh);
 
         std::string result = "{\"status\":\"success\",\"id\":\"" + EscapeJsonString(id) +
@@ -2105,9 +2121,13 @@ ReturnValue FridgeMcpTools::HandleCanvasRemove(const PropertyList& properties) {
         }
 
         std::string full_id = MakeCanvasId(id);
-        epaper->RemoveLabel(String(full_id.c_str()));
-
-        SaveCanvasLayout();
+        std::string layout;
+        {
+            DisplayLockGuard lock(epaper);
+            epaper->RemoveLabel(String(full_id.c_str()));
+            layout = BuildCanvasLayout();
+        }
+        WriteCanvasLayout(layout);
         RefreshCanvasIfNeeded(refresh);
 
         std::string result = "{\"status\":\"success\",\"removed\":\"" + EscapeJsonString(id) + "\"}";
@@ -2162,8 +2182,11 @@ ReturnValue FridgeMcpTools::HandleCanvasAddImage(const PropertyList& properties)
         std::string full_id = MakeCanvasId(id);
 
         // 检查控件数量上限
-        if (!CheckCanvasLabelLimit(full_id)) {
-            return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
+        {
+            DisplayLockGuard lock(epaper);
+            if (!CheckCanvasLabelLimit(full_id)) {
+                return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
+            }
         }
 
         // 构造文件路径
@@ -2187,26 +2210,35 @@ ReturnValue FridgeMcpTools::HandleCanvasAddImage(const PropertyList& properties)
             fclose(f);
             return ReturnValue("Invalid image size");
         }
-        uint8_t* bitmap = (uint8_t*)malloc(total_bytes);
+        auto bitmap = EpaperLabel::AllocBitmap(total_bytes);
         if (!bitmap) {
             fclose(f);
             return ReturnValue("Not enough memory for image");
         }
 
-        size_t read = fread(bitmap, 1, total_bytes, f);
+        size_t read = fread(bitmap.get(), 1, total_bytes, f);
         fclose(f);
 
         if (read < total_bytes) {
             ESP_LOGW(TAG, "Image file smaller than expected: %d/%d bytes", (int)read, (int)total_bytes);
             // 剩余部分填0（白色）
-            memset(bitmap + read, 0, total_bytes - read);
+            memset(bitmap.get() + read, 0, total_bytes - read);
         }
 
-        epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
-            EpaperLabel::Bitmap(x, y, bitmap, w, h, 1, 1, false, false, false, true, 6, name.c_str())));
+        std::string layout;
+        {
+            // 读文件时没有持锁，添加前重新检查上限
+            DisplayLockGuard lock(epaper);
+            if (!CheckCanvasLabelLimit(full_id)) {
+                return ReturnValue("Canvas label limit reached (30). Call fridge.canvas.clear first.");
+            }
+            epaper->AddLabel(String(full_id.c_str()), new EpaperLabel(
+                EpaperLabel::Bitmap(x, y, bitmap, w, h, 1, 1, false, false, false, true, 6, name.c_str())));
 
-        // 注意：bitmap 指针由 EpaperLabel 持有，不再在这里释放
-        SaveCanvasLayout();
+            // 位图缓冲区由 EpaperLabel 持有，删除 label 时释放
+            layout = BuildCanvasLayout();
+        }
+        WriteCanvasLayout(layout);
         RefreshCanvasIfNeeded(refresh);
 
         std::string result = "{\"status\":\"success\",\"id\":\"" + EscapeJsonString(id) +
@@ -2227,18 +2259,15 @@ ReturnValue FridgeMcpTools::HandleCanvasList(const PropertyList& properties) {
             return ReturnValue("E-paper display not found on this board.");
         }
 
-        auto* labels = epaper->GetAllLabels();
-        if (!labels) {
-            return std::string("[]");
-        }
+        DisplayLockGuard lock(epaper);
+        auto& labels = epaper->GetLabelStore();
 
         std::string json = "[";
         bool first = true;
-        for (const auto& pair : *labels) {
-            const String& label_id = pair.first;
-            EpaperLabel* label = pair.second;
+        for (auto handle : labels.PrefixLabels(CANVAS_PREFIX)) {
+            const String& label_id = labels.Name(handle);
+            EpaperLabel* label = labels.Get(handle);
 
-            if (strncmp(label_id.c_str(), CANVAS_PREFIX, 7) != 0) continue;
             if (label->page != 6) continue;
 
             std::string short_id = label_id.c_str() + 7;
@@ -5,6 +5,7 @@
 #include "Fridge/fridge_mcp.h"
 #include "system_info.h"
 #include "settings.h"
+#include "audio_flight_recorder.h"
 #include <esp_log.h>
 #include <esp_wifi.h>
 #include <esp_netif.h>
@@ -339,6 +340,15 @@ void LocalControl::Start() {
     };
     httpd_register_uri_handler(server_, &name_options);
 
+    // GET /api/audio_trace — 下载音频事件记录
+    httpd_uri_t audio_trace_uri = {
+        .uri = "/api/audio_trace",
+        .method = HTTP_GET,
+        .handler = HandleAudioTrace,
+        .user_ctx = this
+    };
+    httpd_register_uri_handler(server_, &audio_trace_uri);
+
     // 获取 IP 地址并打印
     esp_netif_ip_info_t ip_info;
     auto netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
@@ -356,6 +366,7 @@ void LocalControl::Start() {
         ESP_LOGI(TAG, "  POST /api/canvas_image       Upload image");
         ESP_LOGI(TAG, "  GET|POST /api/device_name     Device name (NVS)");
         ESP_LOGI(TAG, "  GET  /api/canvas_image       List images");
+        ESP_LOGI(TAG, "  GET  /api/audio_trace        Audio flight recorder dump");
         ESP_LOGI(TAG, "========================================");
     } else {
         ESP_LOGW(TAG, "HTTP server started but IP info unavailable");
@@ -489,6 +500,36 @@ esp_err_t LocalControl::HandleDeviceNameSet(httpd_req_t* req) {
     return ESP_OK;
 }
 
+// 二进制 dump，格式见 audio_flight_recorder.h，用 scripts/audio_flight_decoder.py 解析
+esp_err_t LocalControl::HandleAudioTrace(httpd_req_t* req) {
+    auto& recorder = AudioFlightRecorder::GetInstance();
+    bool frozen = false;
+    char query[32] = {0};
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char frozen_val[8] = {0};
+        if (httpd_query_key_value(query, "frozen", frozen_val, sizeof(frozen_val)) == ESP_OK) {
+            frozen = strcmp(frozen_val, "1") == 0;
+        }
+    }
+    if (frozen && !recorder.HasFrozen()) {
+        httpd_resp_set_type(req, "application/json");
+        SetCorsHeaders(req);
+        httpd_resp_sendstr(req, "{\"error\":\"No frozen audio trace\"}");
+        return ESP_OK;
+    }
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    SetCorsHeaders(req);
+    bool ok = recorder.Write(frozen, [req](const void* data, size_t size) {
+        return httpd_resp_send_chunk(req, (const char*)data, size) == ESP_OK;
+    });
+    if (!ok) {
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, nullptr, 0);
+    return ESP_OK;
+}
+
 esp_err_t LocalControl::HandleUi(httpd_req_t* req) {
     httpd_resp_set_type(req, "text/html; charset=utf-8");
     SetCorsHeaders(req);
@@ -16,6 +16,7 @@
 //   GET  /api/canvas_image?name= 下载已存储的 raw 图片
 //   GET  /api/device_name        查询设备显示名称（NVS 持久化，可自定义）
 //   POST /api/device_name        设置设备显示名称 {"name":"xxx"}，空名恢复默认
+//   GET  /api/audio_trace        下载音频 flight recorder 事件（?frozen=1 取最近一次错误时冻结的副本）
 //   GET  /ui                     设备扫描与选择页面
 //
 // mDNS: 设备注册为 xiaozhi-<mac后6位>.local（多设备不冲突）
@@ -44,6 +45,7 @@ private:
     static esp_err_t HandleCanvasImageList(httpd_req_t* req);
     static esp_err_t HandleDeviceNameGet(httpd_req_t* req);
     static esp_err_t HandleDeviceNameSet(httpd_req_t* req);
+    static esp_err_t HandleAudioTrace(httpd_req_t* req);
     static esp_err_t HandleUi(httpd_req_t* req);
 
     // 挂载 canvas_data 分区为 LittleFS
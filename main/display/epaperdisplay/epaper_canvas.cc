@@ -0,0 +1,164 @@
+#include "epaper_canvas.h"
+
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+#define TAG "EpaperCanvas"
+
+EpaperCanvas::EpaperCanvas(uint16_t native_width, uint16_t native_height)
+    : GFXcanvas1(native_width, native_height) {
+    size_t size = row_bytes() * HEIGHT;
+    pushed_ = (uint8_t*)heap_caps_malloc_prefer(size, 2,
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pushed_ == nullptr || getBuffer() == nullptr) {
+        ESP_LOGE(TAG, "Failed to allocate %u bytes frame buffers", (unsigned)size * 2);
+        heap_caps_free(pushed_);
+        pushed_ = nullptr;
+        return;
+    }
+    // 构造时屏幕已清为白色
+    memset(pushed_, 0xFF, size);
+    memset(getBuffer(), 0xFF, size);
+}
+
+EpaperCanvas::~EpaperCanvas() {
+    heap_caps_free(pushed_);
+}
+
+void EpaperCanvas::SetClip(const EpaperRect& rect) {
+    clip_ = rect;
+    clipped_ = true;
+}
+
+void EpaperCanvas::drawPixel(int16_t x, int16_t y, uint16_t color) {
+    if (clipped_ && (x < clip_.x || x >= clip_.right() || y < clip_.y || y >= clip_.bottom())) {
+        return;
+    }
+    GFXcanvas1::drawPixel(x, y, color);
+}
+
+void EpaperCanvas::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (clipped_) {
+        if (x < clip_.x || x >= clip_.right()) return;
+        int32_t y0 = std::max<int32_t>(y, clip_.y);
+        int32_t y1 = std::min<int32_t>(y + h, clip_.bottom());
+        if (y1 <= y0) return;
+        y = y0;
+        h = y1 - y0;
+    }
+    GFXcanvas1::drawFastVLine(x, y, h, color);
+}
+
+void EpaperCanvas::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (clipped_) {
+        if (y < clip_.y || y >= clip_.bottom()) return;
+        int32_t x0 = std::max<int32_t>(x, clip_.x);
+        int32_t x1 = std::min<int32_t>(x + w, clip_.right());
+        if (x1 <= x0) return;
+        x = x0;
+        w = x1 - x0;
+    }
+    GFXcanvas1::drawFastHLine(x, y, w, color);
+}
+
+void EpaperCanvas::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (clipped_) {
+        int32_t x0 = std::max<int32_t>(x, clip_.x);
+        int32_t y0 = std::max<int32_t>(y, clip_.y);
+        int32_t x1 = std::min<int32_t>(x + w, clip_.right());
+        int32_t y1 = std::min<int32_t>(y + h, clip_.bottom());
+        if (x1 <= x0 || y1 <= y0) return;
+        x = x0;
+        y = y0;
+        w = x1 - x0;
+        h = y1 - y0;
+    }
+    GFXcanvas1::fillRect(x, y, w, h, color);
+}
+
+EpaperRect EpaperCanvas::ToNative(const EpaperRect& rect) const {
+    // 与 GxEPD2 的 _rotate 相同的换算
+    int32_t x = rect.x, y = rect.y, w = rect.w, h = rect.h;
+    switch (getRotation()) {
+        case 1:
+            std::swap(x, y);
+            std::swap(w, h);
+            x = WIDTH - x - w;
+            break;
+        case 2:
+            x = WIDTH - x - w;
+            y = HEIGHT - y - h;
+            break;
+        case 3:
+            std::swap(x, y);
+            std::swap(w, h);
+            y = HEIGHT - y - h;
+            break;
+    }
+
+    int32_t x0 = std::max<int32_t>(x, 0) / 8 * 8;
+    int32_t y0 = std::max<int32_t>(y, 0);
+    int32_t x1 = std::min<int32_t>((x + w + 7) / 8 * 8, WIDTH);
+    int32_t y1 = std::min<int32_t>(y + h, HEIGHT);
+    EpaperRect native;
+    if (x1 > x0 && y1 > y0) {
+        native.x = x0;
+        native.y = y0;
+        native.w = x1 - x0;
+        native.h = y1 - y0;
+    }
+    return native;
+}
+
+EpaperRect EpaperCanvas::NativeScreen() const {
+    EpaperRect native;
+    native.w = WIDTH;
+    native.h = HEIGHT;
+    return native;
+}
+
+EpaperRect EpaperCanvas::FindChanges(const EpaperRect& native) const {
+    const uint8_t* frame = const_cast<EpaperCanvas*>(this)->getBuffer();
+    const size_t stride = row_bytes();
+    const size_t byte_start = native.x / 8;
+    const size_t byte_end = (native.right() + 7) / 8;
+
+    int32_t first_row = -1, last_row = -1;
+    size_t first_byte = byte_end, last_byte = byte_start;
+    for (int32_t y = native.y; y < native.bottom(); y++) {
+        const uint8_t* row = frame + y * stride;
+        const uint8_t* old_row = pushed_ + y * stride;
+        if (memcmp(row + byte_start, old_row + byte_start, byte_end - byte_start) == 0) {
+            continue;
+        }
+        if (first_row < 0) first_row = y;
+        last_row = y;
+        for (size_t b = byte_start; b < byte_end; b++) {
+            if (row[b] != old_row[b]) {
+                first_byte = std::min(first_byte, b);
+                last_byte = std::max(last_byte, b + 1);
+            }
+        }
+    }
+
+    EpaperRect changed;
+    if (first_row >= 0) {
+        changed.x = first_byte * 8;
+        changed.y = first_row;
+        changed.w = (last_byte - first_byte) * 8;
+        changed.h = last_row - first_row + 1;
+    }
+    return changed;
+}
+
+void EpaperCanvas::MarkPushed(const EpaperRect& native) {
+    const uint8_t* frame = getBuffer();
+    const size_t stride = row_bytes();
+    const size_t byte_start = native.x / 8;
+    const size_t byte_end = (native.right() + 7) / 8;
+    for (int32_t y = native.y; y < native.bottom(); y++) {
+        memcpy(pushed_ + y * stride + byte_start, frame + y * stride + byte_start, byte_end - byte_start);
+    }
+}
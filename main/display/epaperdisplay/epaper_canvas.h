@@ -0,0 +1,50 @@
+#ifndef EPAPER_CANVAS_H
+#define EPAPER_CANVAS_H
+
+#include <cstdint>
+#include <Adafruit_GFX.h>
+
+#include "epaper_dirty_region.h"
+
+/*
+ * 常驻的 1-bpp 帧缓冲，布局与 GxEPD2 控制器原生缓冲一致（每行 WIDTH/8 字节，1=白色），
+ * 可以直接交给 epd2.writeImagePart 写入控制器。
+ *
+ * 场景只渲染一次到这里，再与上次推送到屏幕的帧比较，只把有变化的字节行写入控制器并刷新。
+ * 绘制可以裁剪到一个逻辑矩形，脏区外的像素保持不变。
+ */
+class EpaperCanvas : public GFXcanvas1 {
+public:
+    EpaperCanvas(uint16_t native_width, uint16_t native_height);
+    ~EpaperCanvas();
+    EpaperCanvas(const EpaperCanvas&) = delete;
+    EpaperCanvas& operator=(const EpaperCanvas&) = delete;
+
+    bool valid() const { return pushed_ != nullptr; }
+
+    // 只绘制逻辑矩形内的像素
+    void SetClip(const EpaperRect& rect);
+    void ResetClip() { clipped_ = false; }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+
+    // 旋转后的逻辑矩形换算到控制器原生坐标，x 方向按 8 像素对齐
+    EpaperRect ToNative(const EpaperRect& rect) const;
+    EpaperRect NativeScreen() const;
+    // 原生区域内与已推送帧不同的字节行和字节列范围，没有变化时返回空矩形
+    EpaperRect FindChanges(const EpaperRect& native) const;
+    // 原生区域已写入屏幕
+    void MarkPushed(const EpaperRect& native);
+
+private:
+    uint8_t* pushed_ = nullptr;     // 上次推送到屏幕的帧
+    EpaperRect clip_;
+    bool clipped_ = false;
+
+    size_t row_bytes() const { return (WIDTH + 7) / 8; }
+};
+
+#endif // EPAPER_CANVAS_H
@@ -0,0 +1,131 @@
+#include "epaper_dirty_region.h"
+
+#include <algorithm>
+
+namespace {
+
+// 把 [start, end) 对齐到 8 像素边界（向外扩展）
+void AlignSpan(int32_t& start, int32_t& end, int32_t limit) {
+    start -= start % 8;
+    end = std::min<int32_t>((end + 7) / 8 * 8, limit);
+}
+
+// 原生坐标方向与逻辑坐标相反时（旋转 1/2），在原生坐标系下对齐再换算回来
+void AlignMirroredSpan(int32_t& start, int32_t& end, int32_t limit) {
+    int32_t native_start = limit - end;
+    int32_t native_end = limit - start;
+    AlignSpan(native_start, native_end, limit);
+    start = limit - native_end;
+    end = limit - native_start;
+}
+
+}  // namespace
+
+bool EpaperRect::Intersects(const EpaperRect& other) const {
+    return x < other.right() && other.x < right() && y < other.bottom() && other.y < bottom();
+}
+
+bool EpaperRect::Touches(const EpaperRect& other, int16_t gap) const {
+    return x <= other.right() + gap && other.x <= right() + gap &&
+           y <= other.bottom() + gap && other.y <= bottom() + gap;
+}
+
+EpaperRect EpaperRect::Union(const EpaperRect& other) const {
+    if (empty()) return other;
+    if (other.empty()) return *this;
+    EpaperRect rect;
+    rect.x = std::min(x, other.x);
+    rect.y = std::min(y, other.y);
+    rect.w = std::max(right(), other.right()) - rect.x;
+    rect.h = std::max(bottom(), other.bottom()) - rect.y;
+    return rect;
+}
+
+EpaperDirtyRegion::EpaperDirtyRegion(uint16_t native_width, uint16_t native_height)
+    : native_width_(native_width), native_height_(native_height) {
+}
+
+void EpaperDirtyRegion::SetRotation(uint8_t rotation) {
+    if (rotation_ != (rotation & 3)) {
+        rotation_ = rotation & 3;
+        regions_.clear();
+    }
+}
+
+EpaperRect EpaperDirtyRegion::ClipAndAlign(const EpaperRect& rect) const {
+    const bool swapped = (rotation_ & 1) != 0;
+    const int32_t screen_w = swapped ? native_height_ : native_width_;
+    const int32_t screen_h = swapped ? native_width_ : native_height_;
+
+    int32_t x0 = std::max<int32_t>(rect.x, 0);
+    int32_t y0 = std::max<int32_t>(rect.y, 0);
+    int32_t x1 = std::min<int32_t>(rect.right(), screen_w);
+    int32_t y1 = std::min<int32_t>(rect.bottom(), screen_h);
+    if (x1 <= x0 || y1 <= y0) {
+        return EpaperRect();
+    }
+
+    switch (rotation_) {
+        case 0: AlignSpan(x0, x1, screen_w); break;
+        case 1: AlignMirroredSpan(y0, y1, screen_h); break;
+        case 2: AlignMirroredSpan(x0, x1, screen_w); break;
+        case 3: AlignSpan(y0, y1, screen_h); break;
+    }
+
+    EpaperRect aligned;
+    aligned.x = x0;
+    aligned.y = y0;
+    aligned.w = x1 - x0;
+    aligned.h = y1 - y0;
+    return aligned;
+}
+
+void EpaperDirtyRegion::Add(const EpaperRect& rect) {
+    EpaperRect aligned = ClipAndAlign(rect);
+    if (aligned.empty()) {
+        return;
+    }
+    Merge(aligned);
+
+    // 区域太多时，合并增加面积最少的一对，直到不超过上限
+    while (regions_.size() > EPAPER_DIRTY_MAX_REGIONS) {
+        size_t best_i = 0, best_j = 1;
+        uint32_t best_cost = UINT32_MAX;
+        for (size_t i = 0; i < regions_.size(); i++) {
+            for (size_t j = i + 1; j < regions_.size(); j++) {
+                uint32_t cost = regions_[i].Union(regions_[j]).area() - regions_[i].area() - regions_[j].area();
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        EpaperRect merged = regions_[best_i].Union(regions_[best_j]);
+        regions_.erase(regions_.begin() + best_j);
+        regions_.erase(regions_.begin() + best_i);
+        Merge(merged);
+    }
+}
+
+void EpaperDirtyRegion::Merge(EpaperRect rect) {
+    // 合并后的矩形可能又和其他区域相邻，重复直到没有可合并的区域
+    for (size_t i = 0; i < regions_.size();) {
+        if (regions_[i].Touches(rect, EPAPER_DIRTY_MERGE_GAP)) {
+            rect = rect.Union(regions_[i]);
+            regions_.erase(regions_.begin() + i);
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    regions_.push_back(rect);
+}
+
+uint32_t EpaperDirtyRegion::area() const {
+    uint32_t total = 0;
+    for (const auto& region : regions_) {
+        total += region.area();
+    }
+    return total;
+}
@@ -0,0 +1,56 @@
+#ifndef EPAPER_DIRTY_REGION_H
+#define EPAPER_DIRTY_REGION_H
+
+#include <cstdint>
+#include <vector>
+
+// 每个合并区域都要跑一次局部刷新波形（GxEPD2_290_T5D 约 750ms），超过上限时继续合并
+#define EPAPER_DIRTY_MAX_REGIONS 2
+// 波形时间与窗口大小基本无关，间距不超过这个值的区域直接合并，多刷一点面积换少一次波形
+#define EPAPER_DIRTY_MERGE_GAP 16
+
+struct EpaperRect {
+    int16_t x = 0, y = 0;
+    uint16_t w = 0, h = 0;
+
+    bool empty() const { return w == 0 || h == 0; }
+    uint32_t area() const { return (uint32_t)w * h; }
+    int32_t right() const { return x + w; }
+    int32_t bottom() const { return y + h; }
+    bool Intersects(const EpaperRect& other) const;
+    // 重叠、共享一条边，或者两个方向上的间距都不超过 gap
+    bool Touches(const EpaperRect& other, int16_t gap = 0) const;
+    EpaperRect Union(const EpaperRect& other) const;
+};
+
+/*
+ * 墨水屏脏区跟踪：记录 label 变化前后的包围盒，合并重叠、相邻或相距很近的矩形，
+ * 每个合并后的区域对应一次 setPartialWindow。
+ *
+ * 坐标使用旋转后的逻辑坐标，加入时按控制器的寻址粒度对齐：
+ * 控制器原生 x 方向（旋转 1/3 时为逻辑 y 方向）必须是 8 像素的倍数，
+ * 对齐后再合并，避免 GxEPD2 内部扩展窗口后产生意外的重叠。
+ */
+class EpaperDirtyRegion {
+public:
+    EpaperDirtyRegion(uint16_t native_width, uint16_t native_height);
+
+    void SetRotation(uint8_t rotation);
+    void Add(const EpaperRect& rect);
+    void Clear() { regions_.clear(); }
+
+    bool empty() const { return regions_.empty(); }
+    const std::vector<EpaperRect>& regions() const { return regions_; }
+    uint32_t area() const;
+
+private:
+    uint16_t native_width_;
+    uint16_t native_height_;
+    uint8_t rotation_ = 0;
+    std::vector<EpaperRect> regions_;
+
+    EpaperRect ClipAndAlign(const EpaperRect& rect) const;
+    void Merge(EpaperRect rect);
+};
+
+#endif // EPAPER_DIRTY_REGION_H
@@ -1,6 +1,7 @@
 #include <esp_log.h>
 #include <esp_err.h>
 #include <string>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
@@ -36,7 +37,9 @@ bool IsSystemTimeValid() {
 }  // namespace
 
 EpaperDisplay::EpaperDisplay(gpio_num_t cs, gpio_num_t dc, gpio_num_t rst, gpio_num_t busy) :
-    display_epaper(GxEPD2_290_T5D(cs, dc, rst, busy)){
+    display_epaper(GxEPD2_290_T5D(cs, dc, rst, busy)),
+    text_layout_(u8g2_for_gfx),
+    dirty_region_(GxEPD2_290_T5D::WIDTH, GxEPD2_290_T5D::HEIGHT) {
     // 创建互斥锁
     mutex_ = xSemaphoreCreateMutex();
     if (mutex_ == nullptr) {
@@ -86,8 +89,20 @@ EpaperDisplay::EpaperDisplay(gpio_num_t cs, gpio_num_t dc, gpio_num_t rst, gpio_
         display_epaper.fillScreen(GxEPD_WHITE);
     } while (display_epaper.nextPage());
 
-    // 初始化 U8g2 字体渲染器
-    u8g2_for_gfx.begin(display_epaper);
+    // 常驻帧缓冲，分配失败时退回 GxEPD2 的分页绘制
+    canvas_ = new EpaperCanvas(GxEPD2_290_T5D::WIDTH, GxEPD2_290_T5D::HEIGHT);
+    if (canvas_->valid()) {
+        canvas_->setRotation(display_rotation_);
+        gfx_ = canvas_;
+    } else {
+        delete canvas_;
+        canvas_ = nullptr;
+        gfx_ = &display_epaper;
+    }
+
+    // 初始化 U8g2 字体渲染器，绘制到当前渲染目标
+    u8g2_for_gfx.begin(*gfx_);
+    dirty_region_.SetRotation(display_rotation_);
 
     // 初始化 UI（不立即刷新，避免重复刷新卡顿）
     SetupUI();
@@ -99,9 +114,20 @@ EpaperDisplay::EpaperDisplay(gpio_num_t cs, gpio_num_t dc, gpio_num_t rst, gpio_
     FridgeManager::GetInstance().SetOnDataChanged([this]() {
         this->RefreshFridgeLabels();
     });
+
+    // 启动渲染任务，之后的刷屏都在该任务中完成
+    xTaskCreate([](void* arg) {
+        static_cast<EpaperDisplay*>(arg)->RenderTask();
+        vTaskDelete(NULL);
+    }, "epaper_render", EPAPER_RENDER_TASK_STACK_SIZE, this, EPAPER_RENDER_TASK_PRIORITY, &render_task_);
+    // 构造期间排队的刷新
+    RequestRender();
 }
 
 EpaperDisplay::~EpaperDisplay() {
+    if (render_task_ != nullptr) {
+        vTaskDelete(render_task_);
+    }
     if (notification_timer_ != nullptr) {
         esp_timer_stop(notification_timer_);
         esp_timer_delete(notification_timer_);
@@ -113,10 +139,8 @@ EpaperDisplay::~EpaperDisplay() {
         vSemaphoreDelete(mutex_);
     }
     // 清理 UI 元素
-    for (auto& pair : ui_labels_) {
-        delete pair.second;
-    }
-    ui_labels_.clear();
+    ui_labels_.Clear();
+    delete canvas_;
 }
 
 void EpaperDisplay::SetStatus(const char* status) {
@@ -312,11 +336,8 @@ void EpaperDisplay::ShowCanvasPage() {
 int EpaperDisplay::ClearCanvasLabels() {
     DisplayLockGuard lock(this);
     std::vector<String> to_remove;
-    for (auto& pair : ui_labels_) {
-        // 检查 id 是否以 "canvas_" 开头
-        if (strncmp(pair.first.c_str(), "canvas_", 7) == 0) {
-            to_remove.push_back(pair.first);
-        }
+    for (auto handle : ui_labels_.PrefixLabels("canvas_")) {
+        to_remove.push_back(ui_labels_.Name(handle));
     }
     int removed = 0;
     for (const auto& id : to_remove) {
@@ -834,41 +855,52 @@ void EpaperDisplay::Unlock() {
     }
 }
 
+void EpaperDisplay::AssertLocked() const {
+    // mutex_ 创建失败时 DisplayLockGuard 也无法加锁，不再断言
+    assert(mutex_ == nullptr || xSemaphoreGetMutexHolder(mutex_) == xTaskGetCurrentTaskHandle());
+}
+
 // ===============================
 //   UI 管理方法实现
 // ===============================
 
 EpaperLabel* EpaperDisplay::GetLabel(const String& id) {
-    auto it = ui_labels_.find(id);
-    if (it != ui_labels_.end()) {
-        return it->second;
+    auto handle = ui_labels_.Find(id);
+    if (handle != EpaperLabelStore::kInvalidHandle) {
+        return ui_labels_.Get(handle);
     }
     ESP_LOGW(TAG, "Label '%s' not found", id.c_str());
     return nullptr;
 }
 
+EpaperLabelStore& EpaperDisplay::GetLabelStore() {
+    AssertLocked();
+    return ui_labels_;
+}
+
 void EpaperDisplay::AddLabel(const String& id, EpaperLabel* label) {
-    if (ui_labels_.find(id) != ui_labels_.end()) {
+    AssertLocked();
+    if (ui_labels_.Find(id) != EpaperLabelStore::kInvalidHandle) {
         ESP_LOGW(TAG, "Label '%s' already exists, replacing", id.c_str());
-        delete ui_labels_[id];
+        RemoveLabel(id);
     }
-    ui_labels_[id] = label;
+    ui_labels_.Add(id, std::move(*label));
+    delete label;
     ui_dirty_ = true;
 }
 
 void EpaperDisplay::RemoveLabel(const String& id) {
-    auto it = ui_labels_.find(id);
-    if (it != ui_labels_.end()) {
-        delete it->second;
-        ui_labels_.erase(it);
+    AssertLocked();
+    auto handle = ui_labels_.Find(id);
+    if (handle != EpaperLabelStore::kInvalidHandle) {
+        // 屏幕上的旧内容在下次刷新时清除，句柄之后会被复用
+        InvalidateDrawnRect(ui_labels_.Get(handle));
+        dirty_labels_.erase(handle);
+        ui_labels_.Remove(handle);
         ui_dirty_ = true;
     }
 }
 
-std::map<String, EpaperLabel*>* EpaperDisplay::GetAllLabels() {
-    return &ui_labels_;
-}
-
 void EpaperDisplay::LabelShow(const String& id) {
     // 注意：调用者必须已持有锁
     EpaperLabel* label = GetLabel(id);
@@ -900,97 +932,10 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
     if (label == nullptr) return;
 
     // 设置旋转方向
-    display_epaper.setRotation(display_rotation_);
+    gfx_->setRotation(display_rotation_);
 
-    // 如果不可见，仅用白色填充区域来清除内容
+    // 不可见的 label 不绘制，刷新窗口在绘制前已清空
     if (!label->visible) {
-        // 计算需要清除的区域
-        int16_t clear_x = label->x;
-        int16_t clear_y = label->y;
-        uint16_t clear_w = 0;
-        uint16_t clear_h = 0;
-
-        // 根据标签类型确定清除区域
-        switch (label->type) {
-            case EpaperObjectType::TEXT: {
-                // 对于文本类型，需要动态计算边界以确保清除完整
-                if (label->u8g2_font != nullptr) {
-                    auto bounds = CalculateTextBounds(label);
-                    clear_x = bounds.x;
-                    clear_y = bounds.y;
-                    clear_w = bounds.w;
-                    clear_h = bounds.h;
-                } else {
-                    // 如果没有字体信息，使用默认大小
-                    clear_w = (label->w_max > 0) ? label->w_max : 50;
-                    clear_h = 20;
-                }
-                break;
-            }
-
-            case EpaperObjectType::BITMAP:
-            case EpaperObjectType::RECT:
-            case EpaperObjectType::ROUND_RECT: {
-                // 对于这些类型，直接使用标签的 w 和 h 属性
-                clear_w = label->w;
-                clear_h = label->h;
-                break;
-            }
-
-            case EpaperObjectType::LINE: {
-                // 对于线条，计算包围盒，考虑线寽
-                int16_t min_x = std::min(label->x, label->x1);
-                int16_t max_x = std::max(label->x, label->x1);
-                int16_t min_y = std::min(label->y, label->y1);
-                int16_t max_y = std::max(label->y, label->y1);
-                clear_x = min_x - label->width / 2;
-                clear_y = min_y - label->width / 2;
-                clear_w = max_x - min_x + label->width;
-                clear_h = max_y - min_y + label->width;
-                break;
-            }
-
-            case EpaperObjectType::CIRCLE: {
-                // 对于圆形，计算包围盒
-                clear_x = label->x - label->radius;
-                clear_y = label->y - label->radius;
-                clear_w = label->radius * 2 + 1;
-                clear_h = label->radius * 2 + 1;
-                break;
-            }
-
-            case EpaperObjectType::TRIANGLE: {
-                // 对于三角形，计算包围盒
-                int16_t min_x = std::min({label->x, label->x1, label->x2});
-                int16_t max_x = std::max({label->x, label->x1, label->x2});
-                int16_t min_y = std::min({label->y, label->y1, label->y2});
-                int16_t max_y = std::max({label->y, label->y1, label->y2});
-                clear_x = min_x;
-                clear_y = min_y;
-                clear_w = max_x - min_x + 1;
-                clear_h = max_y - min_y + 1;
-                break;
-            }
-
-            case EpaperObjectType::PIXEL: {
-                // 对于像素点，只清除单个像素
-                clear_w = 1;
-                clear_h = 1;
-                break;
-            }
-
-            default: {
-                // 默认情况使用较小的清除区域
-                clear_w = 50;
-                clear_h = 20;
-                break;
-            }
-        }
-
-        // 用白色填充区域（清除）
-        if (clear_w > 0 && clear_h > 0) {
-            display_epaper.fillRect(clear_x, clear_y, clear_w, clear_h, GxEPD_WHITE);
-        }
         return;
     }
 
@@ -1007,7 +952,7 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
                     // 计算文本边界以确定背景填充区域
                     auto bounds = CalculateTextBounds(label);
                     uint16_t bg_color = (label->color == GxEPD_BLACK) ? GxEPD_BLACK : GxEPD_WHITE;
-                    display_epaper.fillRect(bounds.x, bounds.y, bounds.w, bounds.h, bg_color);
+                    gfx_->fillRect(bounds.x, bounds.y, bounds.w, bounds.h, bg_color);
                 }
 
                 u8g2_for_gfx.setForegroundColor(label->invert ?
@@ -1037,9 +982,9 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
 
         case EpaperObjectType::RECT: {
             if (label->filled) {
-                display_epaper.fillRect(label->x, label->y, label->w, label->h, label->color);
+                gfx_->fillRect(label->x, label->y, label->w, label->h, label->color);
             } else {
-                display_epaper.drawRect(label->x, label->y, label->w, label->h, label->color);
+                gfx_->drawRect(label->x, label->y, label->w, label->h, label->color);
             }
             break;
         }
@@ -1048,7 +993,7 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
             // 平行估綗：简化处理线寽，针对水平线和端切线
             if (label->width <= 1) {
                 // 单像素线条
-                display_epaper.drawLine(label->x, label->y, label->x1, label->y1, label->color);
+                gfx_->drawLine(label->x, label->y, label->x1, label->y1, label->color);
             } else {
                 // 根据线段水平/端切方向绘制多条线
                 int16_t dx = label->x1 - label->x;
@@ -1059,17 +1004,17 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
                     // 端切线（竫直）- 根据线寽扩展 x
                     for (int16_t offset = 0; offset < label->width; offset++) {
                         int16_t draw_x = label->x - label->width / 2 + offset;
-                        display_epaper.drawLine(draw_x, label->y, draw_x, label->y1, label->color);
+                        gfx_->drawLine(draw_x, label->y, draw_x, label->y1, label->color);
                     }
                 } else if (dy == 0) {
                     // 水平线 - 根据线寽扩展 y
                     for (int16_t offset = 0; offset < label->width; offset++) {
                         int16_t draw_y = label->y - label->width / 2 + offset;
-                        display_epaper.drawLine(label->x, draw_y, label->x1, draw_y, label->color);
+                        gfx_->drawLine(label->x, draw_y, label->x1, draw_y, label->color);
                     }
                 } else {
                     // 云字线，仅绘制中心线
-                    display_epaper.drawLine(label->x, label->y, label->x1, label->y1, label->color);
+                    gfx_->drawLine(label->x, label->y, label->x1, label->y1, label->color);
                 }
             }
             break;
@@ -1077,21 +1022,21 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
 
         case EpaperObjectType::CIRCLE: {
             if (label->filled) {
-                display_epaper.fillCircle(label->x, label->y, label->radius, label->color);
+                gfx_->fillCircle(label->x, label->y, label->radius, label->color);
             } else {
-                display_epaper.drawCircle(label->x, label->y, label->radius, label->color);
+                gfx_->drawCircle(label->x, label->y, label->radius, label->color);
             }
             break;
         }
 
         case EpaperObjectType::TRIANGLE: {
             if (label->filled) {
-                display_epaper.fillTriangle(label->x, label->y,
+                gfx_->fillTriangle(label->x, label->y,
                                           label->x1, label->y1,
                                           label->x2, label->y2,
                                           label->color);
             } else {
-                display_epaper.drawTriangle(label->x, label->y,
+                gfx_->drawTriangle(label->x, label->y,
                                           label->x1, label->y1,
                                           label->x2, label->y2,
                                           label->color);
@@ -1101,11 +1046,11 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
 
         case EpaperObjectType::ROUND_RECT: {
             if (label->filled) {
-                display_epaper.fillRoundRect(label->x, label->y,
+                gfx_->fillRoundRect(label->x, label->y,
                                            label->w, label->h,
                                            label->radius, label->color);
             } else {
-                display_epaper.drawRoundRect(label->x, label->y,
+                gfx_->drawRoundRect(label->x, label->y,
                                            label->w, label->h,
                                            label->radius, label->color);
             }
@@ -1113,7 +1058,7 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
         }
 
         case EpaperObjectType::PIXEL: {
-            display_epaper.drawPixel(label->x, label->y, label->color);
+            gfx_->drawPixel(label->x, label->y, label->color);
             break;
         }
 
@@ -1122,16 +1067,8 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
                 // 处理镜像操作
                 int16_t draw_x = label->x;
                 int16_t draw_y = label->y;
-                const uint8_t* bitmap_src = label->bitmap;
-                uint8_t* temp_bitmap = nullptr;
-
-                // 如果需要镜像，记录警告（需要实现位图变换）
-                if (label->mirror_h || label->mirror_v) {
-                    temp_bitmap = mirrorBitmap(label->bitmap, label->w, label->h,
-                                               label->mirror_h, label->mirror_v);
-                    bitmap_src = temp_bitmap;
-                }
-
+                // 镜像位图在 label 上缓存，只在镜像参数或源位图变化时重新生成
+                const uint8_t* bitmap_src = label->GetDrawBitmap();
 
                 // 根据 depth 选择不同的绘制方法
                 if (label->depth == 1) {
@@ -1141,22 +1078,21 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
                         uint16_t fg = (label->color == GxEPD_BLACK) ? GxEPD_WHITE : GxEPD_BLACK;
                         uint16_t bg = (label->color == GxEPD_BLACK) ? GxEPD_BLACK : GxEPD_WHITE;
 
-                        display_epaper.fillRect(draw_x, draw_y, label->w, label->h, bg);
-                        display_epaper.drawBitmap(draw_x, draw_y, bitmap_src,
+                        gfx_->fillRect(draw_x, draw_y, label->w, label->h, bg);
+                        gfx_->drawBitmap(draw_x, draw_y, bitmap_src,
                                                 label->w, label->h, fg, bg);
                     } else {
                         // 正常绘制：仅使用前景色
-                        display_epaper.drawBitmap(draw_x, draw_y, bitmap_src,
+                        gfx_->drawBitmap(draw_x, draw_y, bitmap_src,
                                                 label->w, label->h, label->color, GxEPD_WHITE);
                     }
                 }
                 // 多色屏支持（需要使用 GxEPD2_3C 或 GxEPD2_7C）
                 // else if (label->depth == 3) {
                 //     // 三色屏: 黑/白/红(或黄)
-                //     // display_epaper.drawImage(draw_x, draw_y,
+                //     // gfx_->drawImage(draw_x, draw_y,
                 //     label->bitmap, label->w, label->h);
                 // }
-                if (temp_bitmap) free(temp_bitmap);
             }
             break;
         }
@@ -1164,84 +1100,375 @@ void EpaperDisplay::RenderLabel(EpaperLabel* label) {
 }
 
 void EpaperDisplay::UpdateLabel(const String& id) {
-  // 注意：调用者必须已持有锁
-    auto it = ui_labels_.find(id);
-    if (it == ui_labels_.end()) {
+    // 注意：调用者必须已持有锁
+    // 只记录待刷新的 label，实际刷屏由渲染任务完成，调用方立即返回
+    auto handle = ui_labels_.Find(id);
+    if (handle == EpaperLabelStore::kInvalidHandle) {
         ESP_LOGW(TAG, "Label '%s' not found for update", id.c_str());
         return;
     }
 
-    // 局部刷新：根据 label 区域设置局部窗口
-    EpaperLabel* label = it->second;
-
     // 页面判断，非当前页不更新
+    EpaperLabel* label = ui_labels_.Get(handle);
     if (label->page != current_page_) {
         ESP_LOGD(TAG, "Skip update for label '%s' on page %d (current %d)", id.c_str(), label->page, current_page_);
         return;
     }
 
-    String label_text = label->text();
+    // 已有整页刷新在排队时，单个 label 会随整页一起刷新
+    if (pending_refresh_ == kPageRefreshNone) {
+        dirty_labels_.insert(handle);
+    }
+    RequestRender();
+}
 
-    // 计算刷新区域
-    int16_t refresh_x = label->x;
-    int16_t refresh_y = label->y;
-    uint16_t refresh_w = 50;
-    uint16_t refresh_h = 20;
+bool EpaperDisplay::GetLabelBounds(EpaperLabel* label, EpaperRect& rect) {
+    // 注意：调用者必须已持有锁
+    switch (label->type) {
+        case EpaperObjectType::TEXT: {
+            if (label->u8g2_font == nullptr) {
+                return false;
+            }
+            gfx_->setRotation(display_rotation_);
+            auto bounds = CalculateTextBounds(label);
+            rect.y = bounds.y;
+            rect.h = bounds.h;
+            if (label->w_max > 0) {
+                // 换行文本按对齐方式在 w_max 内摆放，使用整个文本框宽度
+                rect.x = label->x;
+                rect.w = label->w_max;
+            } else {
+                rect.x = bounds.x;
+                rect.w = bounds.w;
+            }
+            break;
+        }
 
-    // 如果是文本类型，需要动态计算边界
+        case EpaperObjectType::BITMAP:
+        case EpaperObjectType::RECT:
+        case EpaperObjectType::ROUND_RECT: {
+            rect.x = label->x;
+            rect.y = label->y;
+            rect.w = label->w;
+            rect.h = label->h;
+            break;
+        }
+
+        case EpaperObjectType::LINE: {
+            // 线条的包围盒，考虑线宽
+            int16_t min_x = std::min(label->x, label->x1);
+            int16_t max_x = std::max(label->x, label->x1);
+            int16_t min_y = std::min(label->y, label->y1);
+            int16_t max_y = std::max(label->y, label->y1);
+            rect.x = min_x - label->width / 2;
+            rect.y = min_y - label->width / 2;
+            rect.w = max_x - min_x + label->width;
+            rect.h = max_y - min_y + label->width;
+            break;
+        }
+
+        case EpaperObjectType::CIRCLE: {
+            rect.x = label->x - label->radius;
+            rect.y = label->y - label->radius;
+            rect.w = label->radius * 2 + 1;
+            rect.h = label->radius * 2 + 1;
+            break;
+        }
+
+        case EpaperObjectType::TRIANGLE: {
+            int16_t min_x = std::min({label->x, label->x1, label->x2});
+            int16_t max_x = std::max({label->x, label->x1, label->x2});
+            int16_t min_y = std::min({label->y, label->y1, label->y2});
+            int16_t max_y = std::max({label->y, label->y1, label->y2});
+            rect.x = min_x;
+            rect.y = min_y;
+            rect.w = max_x - min_x + 1;
+            rect.h = max_y - min_y + 1;
+            break;
+        }
+
+        case EpaperObjectType::PIXEL: {
+            rect.x = label->x;
+            rect.y = label->y;
+            rect.w = 1;
+            rect.h = 1;
+            break;
+        }
+    }
+    return !rect.empty();
+}
+
+uint32_t EpaperDisplay::LabelContentHash(EpaperLabel* label) {
+    // FNV-1a，只用于判断 label 的绘制内容是否变化
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const void* data, size_t size) {
+        auto bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    auto mix_value = [&mix](auto value) {
+        mix(&value, sizeof(value));
+    };
+
+    mix_value(label->type);
+    mix_value(label->x);
+    mix_value(label->y);
+    mix_value(label->color);
+    mix_value(label->invert);
     if (label->type == EpaperObjectType::TEXT) {
-        display_epaper.setRotation(display_rotation_);
+        String text = label->text();
+        mix(text.c_str(), text.length());
+        mix_value(label->u8g2_font);
+        mix_value(label->align);
+        mix_value(label->w_max);
+    } else {
+        mix_value(label->w);
+        mix_value(label->h);
+        mix_value(label->x1);
+        mix_value(label->y1);
+        mix_value(label->x2);
+        mix_value(label->y2);
+        mix_value(label->width);
+        mix_value(label->radius);
+        mix_value(label->filled);
+        mix_value(label->bitmap);
+        mix_value(label->mirror_h);
+        mix_value(label->mirror_v);
+    }
+    return hash;
+}
 
-        // 使用 U8g2 字体边界计算
-        if (label->u8g2_font != nullptr) {
-            u8g2_for_gfx.setFont(label->u8g2_font);
+bool EpaperDisplay::UpdateDrawnState(EpaperLabel* label) {
+    // 注意：调用者必须已持有锁
+    // 与上次绘制的状态比较，变化时把旧区域和新区域都加入脏区
+    EpaperRect rect;
+    bool on_screen = label->page == current_page_ && label->visible && GetLabelBounds(label, rect);
+    uint32_t hash = on_screen ? LabelContentHash(label) : 0;
+
+    if (on_screen == label->drawn &&
+        (!on_screen || (rect.x == label->drawn_x && rect.y == label->drawn_y &&
+                        rect.w == label->drawn_w && rect.h == label->drawn_h && hash == label->drawn_hash))) {
+        return false;
+    }
 
-            // 保存旧的宽度和高度
-            uint16_t old_h = label->h;
+    InvalidateDrawnRect(label);
+    if (on_screen) {
+        dirty_region_.Add(rect);
+        label->drawn = true;
+        label->drawn_x = rect.x;
+        label->drawn_y = rect.y;
+        label->drawn_w = rect.w;
+        label->drawn_h = rect.h;
+        label->drawn_hash = hash;
+    }
+    return true;
+}
 
-            // 动态计算新文本的边界
-            auto bounds = CalculateTextBounds(label);
-            uint16_t new_w = bounds.w;
-            uint16_t new_h = bounds.h;
-
-            // 宽度和高度都比较取最大值
-            refresh_x = bounds.x;
-            refresh_y = bounds.y;
-            refresh_w = label->w_max;  // 取较大的宽度
-            refresh_h = (old_h > new_h) ? old_h : new_h;  // 取较大的高度
-
-            // 更新 label 的 h 为新计算的值
-            label->h = new_h;
-
-            ESP_LOGI(TAG, "Label '%s',refresh_x=%d,refresh_y=%d, old_h=%d, new: w=%d h=%d, refresh: w=%d h=%d",
-                     id.c_str(), refresh_x, refresh_y, old_h, new_w, new_h, refresh_w, refresh_h);
-        } else {
-            refresh_x = label->x;
-            refresh_y = label->y - 20;
-            refresh_w = 50;
-            refresh_h = 20;
+void EpaperDisplay::InvalidateDrawnRect(EpaperLabel* label) {
+    // 注意：调用者必须已持有锁
+    if (label->drawn) {
+        EpaperRect old_rect;
+        old_rect.x = label->drawn_x;
+        old_rect.y = label->drawn_y;
+        old_rect.w = label->drawn_w;
+        old_rect.h = label->drawn_h;
+        dirty_region_.Add(old_rect);
+        label->drawn = false;
+    }
+}
+
+void EpaperDisplay::RequestRender() {
+    if (render_task_ != nullptr) {
+        xTaskNotifyGive(render_task_);
+    }
+}
+
+void EpaperDisplay::RenderTask() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        // 等待同一批的其他更新，合并为一次刷新
+        vTaskDelay(pdMS_TO_TICKS(EPAPER_RENDER_COALESCE_MS));
+        ulTaskNotifyTake(pdTRUE, 0);
+        RenderPending();
+    }
+}
+
+void EpaperDisplay::RenderPending() {
+    if (!Lock()) {
+        return;
+    }
+
+    PageRefresh page_refresh = pending_refresh_;
+    pending_refresh_ = kPageRefreshNone;
+    // 屏幕上还是别的页面时，局部更新无从比较，只能整页刷新
+    if (screen_page_ != current_page_ && page_refresh == kPageRefreshNone &&
+        (!dirty_labels_.empty() || !dirty_region_.empty())) {
+        page_refresh = kPageRefreshPartial;
+    }
+    uint16_t page = current_page_;
+
+    // 同一页面的整页局部刷新也只刷新内容有变化的 label
+    size_t changed = 0;
+    if (page_refresh == kPageRefreshPartial && screen_page_ == page) {
+        // 屏幕上只有本页的 label，不用遍历其他页
+        for (auto handle : ui_labels_.PageLabels(page)) {
+            changed += UpdateDrawnState(ui_labels_.Get(handle));
+        }
+        page_refresh = kPageRefreshNone;
+    } else if (page_refresh == kPageRefreshNone) {
+        for (auto handle : dirty_labels_) {
+            changed += UpdateDrawnState(ui_labels_.Get(handle));
         }
+    }
+    dirty_labels_.clear();
+
+    if (page_refresh == kPageRefreshNone && dirty_region_.empty()) {
+        Unlock();
+        return;
+    }
+
+    if (pm_lock_ != nullptr) {
+        esp_pm_lock_acquire(pm_lock_);
+    }
+    auto start_time = esp_timer_get_time();
+    if (page_refresh != kPageRefreshNone) {
+        // 整页刷新后屏幕内容与当前页的 label 一致，原来屏幕上那一页的 label 不再显示
+        if (screen_page_ != page) {
+            for (auto handle : ui_labels_.PageLabels(screen_page_)) {
+                ui_labels_.Get(handle)->drawn = false;
+            }
+        }
+        for (auto handle : ui_labels_.PageLabels(page)) {
+            EpaperLabel* label = ui_labels_.Get(handle);
+            EpaperRect rect;
+            label->drawn = label->visible && GetLabelBounds(label, rect);
+            if (label->drawn) {
+                label->drawn_x = rect.x;
+                label->drawn_y = rect.y;
+                label->drawn_w = rect.w;
+                label->drawn_h = rect.h;
+                label->drawn_hash = LabelContentHash(label);
+            }
+        }
+        dirty_region_.Clear();
+        screen_page_ = page;
+        RefreshWindow(nullptr, page_refresh == kPageRefreshFull, page);
+        ESP_LOGD(TAG, "Rendered page %d (%s) in %ld ms", page, page_refresh == kPageRefreshFull ? "full" : "partial",
+                 (long)((esp_timer_get_time() - start_time) / 1000));
     } else {
-        // 其他类型使用 label 自身的尺寸
-        refresh_x = label->x;
-        refresh_y = label->y;
-        refresh_w = label->w;
-        refresh_h = label->h;
+        // 刷屏期间释放锁，其他任务可能继续加入脏区，先取出本轮的区域
+        std::vector<EpaperRect> windows = dirty_region_.regions();
+        uint32_t area = dirty_region_.area();
+        dirty_region_.Clear();
+        for (const auto& window : windows) {
+            RefreshWindow(&window, false, page);
+        }
+        ESP_LOGD(TAG, "Rendered %u changed labels in %u windows, %lu px, %ld ms", (unsigned)changed,
+                 (unsigned)windows.size(), (unsigned long)area, (long)((esp_timer_get_time() - start_time) / 1000));
     }
+    if (pm_lock_ != nullptr) {
+        esp_pm_lock_release(pm_lock_);
+    }
+    Unlock();
+}
 
-    // 边界检查
-    if(refresh_x < 0||refresh_y < 0||refresh_w <= 0||refresh_h <= 0)
-    {
+void EpaperDisplay::RenderWindowLabels(const EpaperRect* rect, uint16_t page) {
+    // 窗口已清空，只绘制屏幕上与窗口相交的 label，窗口外的像素被裁剪
+    for (auto handle : ui_labels_.PageLabels(page)) {
+        EpaperLabel* label = ui_labels_.Get(handle);
+        if (!label->visible) continue;
+        if (rect != nullptr) {
+            EpaperRect drawn_rect;
+            drawn_rect.x = label->drawn_x;
+            drawn_rect.y = label->drawn_y;
+            drawn_rect.w = label->drawn_w;
+            drawn_rect.h = label->drawn_h;
+            if (!label->drawn || !drawn_rect.Intersects(*rect)) continue;
+        }
+        RenderLabel(label);
+    }
+}
+
+void EpaperDisplay::RefreshWindow(const EpaperRect* rect, bool full_refresh, uint16_t page) {
+    // 注意：调用者必须已持有锁，返回时仍持有锁
+    if (canvas_ != nullptr) {
+        RefreshRetained(rect, full_refresh, page);
         return;
     }
 
+    // 没有常驻帧缓冲时使用 GxEPD2 的分页绘制
     display_epaper.setRotation(display_rotation_);
-    display_epaper.setPartialWindow(label->x, refresh_y, refresh_w, refresh_h);
+    if (full_refresh) {
+        // 全屏刷新
+        display_epaper.setFullWindow();
+    } else if (rect == nullptr) {
+        // 局部刷新（刷新整个屏幕）
+        display_epaper.setPartialWindow(0, 0, display_epaper.width(), display_epaper.height());
+    } else {
+        display_epaper.setPartialWindow(rect->x, rect->y, rect->w, rect->h);
+    }
+
+    bool more_pages;
     display_epaper.firstPage();
     do {
-        // display_epaper.fillScreen(GxEPD_WHITE);  // 清空局部区域
-        RenderLabel(label);
-    } while (display_epaper.nextPage());
+        display_epaper.fillScreen(GxEPD_WHITE);
+        RenderWindowLabels(rect, page);
+
+        // 数据写入和刷屏波形耗时数百毫秒，期间释放锁，调用方可以继续修改 label
+        Unlock();
+        more_pages = display_epaper.nextPage();
+        Lock();
+    } while (more_pages);
+}
+
+void EpaperDisplay::RefreshRetained(const EpaperRect* rect, bool full_refresh, uint16_t page) {
+    // 注意：调用者必须已持有锁，返回时仍持有锁
+    // 场景只渲染一次到常驻帧缓冲，窗口外的内容保持上次的结果
+    auto start_time = esp_timer_get_time();
+    if (rect != nullptr) {
+        canvas_->SetClip(*rect);
+        canvas_->fillRect(rect->x, rect->y, rect->w, rect->h, GxEPD_WHITE);
+    } else {
+        canvas_->ResetClip();
+        canvas_->fillScreen(GxEPD_WHITE);
+    }
+    RenderWindowLabels(rect, page);
+    canvas_->ResetClip();
+    auto render_us = esp_timer_get_time() - start_time;
+
+    // 只把与上次推送不同的字节行写入控制器
+    EpaperRect native = rect != nullptr ? canvas_->ToNative(*rect) : canvas_->NativeScreen();
+    EpaperRect changed = full_refresh ? canvas_->NativeScreen() : canvas_->FindChanges(native);
+    if (changed.empty()) {
+        ESP_LOGD(TAG, "Render %ld us, no pixel changed, refresh skipped", (long)render_us);
+        return;
+    }
+
+    // 帧缓冲只在渲染任务中修改，写入控制器期间可以释放锁
+    Unlock();
+    const uint8_t* frame = canvas_->getBuffer();
+    auto& epd2 = display_epaper.epd2;
+    if (full_refresh) {
+        epd2.writeImageForFullRefresh(frame, 0, 0, changed.w, changed.h);
+        epd2.refresh(false);
+        if (epd2.hasFastPartialUpdate) {
+            epd2.writeImageAgain(frame, 0, 0, changed.w, changed.h);
+        }
+        epd2.powerOff();
+    } else {
+        epd2.writeImagePart(frame, changed.x, changed.y, native_width(), native_height(),
+                            changed.x, changed.y, changed.w, changed.h);
+        epd2.refresh(changed.x, changed.y, changed.w, changed.h);
+        if (epd2.hasFastPartialUpdate) {
+            epd2.writeImagePartAgain(frame, changed.x, changed.y, native_width(), native_height(),
+                                     changed.x, changed.y, changed.w, changed.h);
+        }
+    }
+    Lock();
+    canvas_->MarkPushed(changed);
+    ESP_LOGD(TAG, "Render %ld us, pushed %dx%d at (%d,%d) native, %ld ms", (long)render_us,
+             changed.w, changed.h, changed.x, changed.y, (long)((esp_timer_get_time() - start_time) / 1000));
 }
 
 void EpaperDisplay::RefreshFridgeLabels() {
@@ -1330,55 +1557,15 @@ void EpaperDisplay::RefreshFridgeLabelsInternal() {
 
 void EpaperDisplay::UpdateUI(bool fullRefresh) {
     // 注意：调用者必须已持有锁
+    // 整页刷新覆盖所有待刷新的 label
     if (fullRefresh) {
-        // 全屏刷新
-        display_epaper.setFullWindow();
-    } else {
-        // 局部刷新（默认刷新整个屏幕）
-        display_epaper.setPartialWindow(0, 0, display_epaper.width(), display_epaper.height());
+        pending_refresh_ = kPageRefreshFull;
+    } else if (pending_refresh_ == kPageRefreshNone) {
+        pending_refresh_ = kPageRefreshPartial;
     }
-
-    display_epaper.firstPage();
-    do {
-        display_epaper.fillScreen(GxEPD_WHITE);
-
-        // 渲染所有 label
-        for (auto& pair : ui_labels_) {
-            EpaperLabel* label = pair.second;
-            if (label->page != current_page_) continue;
-            RenderLabel(label);
-        }
-    } while (display_epaper.nextPage());
-
+    dirty_labels_.clear();
     ui_dirty_ = false;
-}
-
-// 反转一个字节的 bit 顺序，比如 0b01100010 -> 0b01000110
-uint8_t EpaperDisplay::reverseByte(uint8_t b) {
-    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
-    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
-    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
-    return b;
-}
-
-// 对 PROGMEM 中的 bitmap 进行镜像复制到新的缓冲区
-uint8_t* EpaperDisplay::mirrorBitmap(const uint8_t* src, int16_t w, int16_t h,
-                      bool mirror_h, bool mirror_v) {
-    int row_bytes = (w + 7) / 8;
-    int total_bytes = row_bytes * h;
-    uint8_t* dst = (uint8_t*)malloc(total_bytes);
-    if (!dst) return nullptr;
-
-    for (int y = 0; y < h; y++) {
-        int src_row = mirror_v ? (h - 1 - y) : y;
-        for (int bx = 0; bx < row_bytes; bx++) {
-            int src_bx = mirror_h ? (row_bytes - 1 - bx) : bx;
-            uint8_t b = pgm_read_byte(&src[src_row * row_bytes + src_bx]);
-            if (mirror_h) b = reverseByte(b);
-            dst[y * row_bytes + bx] = b;
-        }
-    }
-    return dst;
+    RequestRender();
 }
 
 // 渲染带有换行的文本
@@ -1390,97 +1577,15 @@ void EpaperDisplay::RenderTextWithWrap(EpaperLabel* label) {
     u8g2_for_gfx.setFont(label->u8g2_font);
     u8g2_for_gfx.setForegroundColor(label->color);
 
-    String text = label->text();
     int16_t cursor_y = label->y;
     int16_t line_height = u8g2_for_gfx.getFontAscent() + 6;
 
-    auto render_line = [&](const String& line) {
-        int16_t line_width = u8g2_for_gfx.getUTF8Width(line.c_str());
-        int16_t cursor_x = label->x;
-        if (label->align == EpaperTextAlign::CENTER) {
-            cursor_x = label->x + (label->w_max - line_width) / 2;
-        } else if (label->align == EpaperTextAlign::RIGHT) {
-            cursor_x = label->x + label->w_max - line_width;
-        }
-
-        u8g2_for_gfx.setCursor(cursor_x, cursor_y);
-        u8g2_for_gfx.print(line);
+    // 断行结果与 CalculateTextBounds 共用缓存
+    const auto& lines = text_layout_.Layout(label->text(), label->u8g2_font, label->w_max, label->align);
+    for (const auto& line : lines) {
+        u8g2_for_gfx.setCursor(label->x + line.offset, cursor_y);
+        u8g2_for_gfx.print(line.text.c_str());
         cursor_y += line_height;
-    };
-
-    int text_len = text.length();
-    int start_idx = 0;
-
-    while (start_idx < text_len) {
-        int explicit_break = text.indexOf('\n', start_idx);
-        String paragraph = (explicit_break >= 0) ? text.substring(start_idx, explicit_break) : text.substring(start_idx);
-
-        if (paragraph.length() == 0) {
-            render_line("");
-        } else {
-            int paragraph_len = paragraph.length();
-            int local_start = 0;
-
-            while (local_start < paragraph_len) {
-                String line = "";
-                int local_end = local_start;
-
-                while (local_end < paragraph_len) {
-                    String next_char = "";
-                    uint8_t c = paragraph[local_end];
-
-                    if ((c & 0x80) == 0) {
-                        next_char = String((char)c);
-                        local_end++;
-                    } else if ((c & 0xE0) == 0xC0) {
-                        if (local_end + 1 < paragraph_len) {
-                            next_char = paragraph.substring(local_end, local_end + 2);
-                            local_end += 2;
-                        } else {
-                            break;
-                        }
-                    } else if ((c & 0xF0) == 0xE0) {
-                        if (local_end + 2 < paragraph_len) {
-                            next_char = paragraph.substring(local_end, local_end + 3);
-                            local_end += 3;
-                        } else {
-                            break;
-                        }
-                    } else if ((c & 0xF8) == 0xF0) {
-                        if (local_end + 3 < paragraph_len) {
-                            next_char = paragraph.substring(local_end, local_end + 4);
-                            local_end += 4;
-                        } else {
-                            break;
-                        }
-                    } else {
-                        local_end++;
-                        continue;
-                    }
-
-                    String test_line = line + next_char;
-                    int16_t test_width = u8g2_for_gfx.getUTF8Width(test_line.c_str());
-                    if (test_width > label->w_max && line.length() > 0) {
-                        local_end -= next_char.length();
-                        break;
-                    }
-
-                    line = test_line;
-                }
-
-                render_line(line);
-
-                if (local_end == local_start) {
-                    local_end++;
-                }
-                local_start = local_end;
-            }
-        }
-
-        if (explicit_break < 0) {
-            break;
-        }
-        start_idx = explicit_break + 1;
     }
 }
 
@@ -1497,7 +1602,7 @@ EpaperDisplay::TextBounds EpaperDisplay::CalculateTextBounds(EpaperLabel* label)
     int16_t descent = u8g2_for_gfx.getFontDescent();
     // 优先使用设置的高度参数 label->h，这是用户期望的清除区域高度
     int16_t line_height = (label->h > 0) ? label->h : (ascent + abs(descent));
-    ESP_LOGI(TAG, "ascent=%d, descent=%d, set_height=%d, use_height=%d", ascent, descent, label->h, line_height);
+    ESP_LOGD(TAG, "ascent=%d, descent=%d, set_height=%d, use_height=%d", ascent, descent, label->h, line_height);
 
     // --- ①：如果 w_max==0 → 单行文本 ---
     if (label->w_max == 0) {
@@ -1515,87 +1620,14 @@ EpaperDisplay::TextBounds EpaperDisplay::CalculateTextBounds(EpaperLabel* label)
         bounds.h = line_height;
         return bounds;
     }
-    String text = label_text;
-    int text_len = text.length();
-    int start_idx = 0;
+    const auto& lines = text_layout_.Layout(label_text, label->u8g2_font, label->w_max, label->align);
     int16_t max_width = 0;
-    int line_count = 0;
-
-    while (start_idx < text_len) {
-        int explicit_break = text.indexOf('\n', start_idx);
-        String paragraph = (explicit_break >= 0) ? text.substring(start_idx, explicit_break) : text.substring(start_idx);
-
-        if (paragraph.length() == 0) {
-            line_count++;
-        } else {
-            int paragraph_len = paragraph.length();
-            int local_start = 0;
-
-            while (local_start < paragraph_len) {
-                String line = "";
-                int local_end = local_start;
-
-                while (local_end < paragraph_len) {
-                    String next_char = "";
-                    uint8_t c = paragraph[local_end];
-
-                    if ((c & 0x80) == 0) {
-                        next_char = String((char)c);
-                        local_end++;
-                    } else if ((c & 0xE0) == 0xC0) {
-                        if (local_end + 1 < paragraph_len) {
-                            next_char = paragraph.substring(local_end, local_end + 2);
-                            local_end += 2;
-                        } else {
-                            break;
-                        }
-                    } else if ((c & 0xF0) == 0xE0) {
-                        if (local_end + 2 < paragraph_len) {
-                            next_char = paragraph.substring(local_end, local_end + 3);
-                            local_end += 3;
-                        } else {
-                            break;
-                        }
-                    } else if ((c & 0xF8) == 0xF0) {
-                        if (local_end + 3 < paragraph_len) {
-                            next_char = paragraph.substring(local_end, local_end + 4);
-                            local_end += 4;
-                        } else {
-                            break;
-                        }
-                    } else {
-                        local_end++;
-                        continue;
-                    }
-
-                    String test_line = line + next_char;
-                    int16_t test_w = u8g2_for_gfx.getUTF8Width(test_line.c_str());
-                    if (test_w > label->w_max && line.length() > 0) {
-                        local_end -= next_char.length();
-                        break;
-                    }
-
-                    line = test_line;
-                }
-
-                int16_t line_width = u8g2_for_gfx.getUTF8Width(line.c_str());
-                if (line_width > max_width) {
-                    max_width = line_width;
-                }
-
-                line_count++;
-                if (local_end == local_start) {
-                    local_end++;
-                }
-                local_start = local_end;
-            }
-        }
-
-        if (explicit_break < 0) {
-            break;
+    for (const auto& line : lines) {
+        if (line.width > max_width) {
+            max_width = line.width;
         }
-        start_idx = explicit_break + 1;
     }
+    int line_count = lines.size();
 
     // --- ④：根据对齐方式计算 bounds.x ---
     int16_t bounds_x = label->x;
@@ -8,8 +8,11 @@
 #include <esp_pm.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
+#include <freertos/task.h>
 #include <string>
 #include <chrono>
+#include <set>
+#include <vector>
 
 //##################   墨水屏头文件 start
 #include <stdio.h>
@@ -48,11 +51,20 @@
 //##################   Epaperdisplay类的实现 start
 #include "display/epaperdisplay/epaperui.h"
 #include "display/epaperdisplay/epaper_image.h"
+#include "display/epaperdisplay/epaper_dirty_region.h"
+#include "display/epaperdisplay/epaper_canvas.h"
+#include "display/epaperdisplay/epaper_text_layout.h"
+#include "display/epaperdisplay/epaper_label_store.h"
 #include "../boards/bread-compact-wifi-epaperx/Fridge/fridge_manager.h"
 #include <map>
 
 //##################   Epaperdisplay类的实现 end
 
+// 渲染任务：调用方只修改 label 状态，刷新在低优先级任务中合并执行
+#define EPAPER_RENDER_TASK_STACK_SIZE (4096 * 2)
+#define EPAPER_RENDER_TASK_PRIORITY 1
+#define EPAPER_RENDER_COALESCE_MS 50   // 等待同一批更新（状态+表情+消息）全部到达后再刷新
+
 enum EpaperPage {
     BOOT_PAGE = 0,
     CHAT_PAGE = 1,
@@ -80,12 +92,13 @@ public:
 
     // UI 管理方法
     EpaperLabel* GetLabel(const String& id);           // 获取 label 指针，用于修改属性
-    void UpdateLabel(const String& id);                 // 刷新单个 label
-    void UpdateUI(bool fullRefresh = false);            // 刷新所有 label
+    void UpdateLabel(const String& id);                 // 标记单个 label 待刷新（异步）
+    void UpdateUI(bool fullRefresh = false);            // 标记整页待刷新（异步）
     void SetPage(uint16_t page, bool refresh = true);     // 切换页面，可选择是否立即全局刷新
-    void AddLabel(const String& id, EpaperLabel* label); // 动态添加 label
+    // 以下三个方法的调用者必须已持有显示锁（DisplayLockGuard），渲染任务会并发遍历 label
+    void AddLabel(const String& id, EpaperLabel* label); // 动态添加 label，label 移入存储后释放
     void RemoveLabel(const String& id);                 // 移除 label
-    std::map<String, EpaperLabel*>* GetAllLabels();     // 获取全部 labels（用于持久化遍历）
+    EpaperLabelStore& GetLabelStore();                  // 按前缀/页面遍历 labels（用于持久化）
     uint16_t GetCurrentPage() const { return current_page_; }  // 获取当前页面编号
     
     // 显示/隐藏控制方法
@@ -105,16 +118,31 @@ protected:
     // 2.9寸屏
     GxEPD2_BW<GxEPD2_290_T5D, GxEPD2_290_T5D::HEIGHT> display_epaper;
     U8G2_FOR_ADAFRUIT_GFX u8g2_for_gfx;  // U8g2 字体渲染器
+    EpaperTextLayout text_layout_;       // 换行文本的排版缓存
+    EpaperCanvas* canvas_ = nullptr;     // 常驻帧缓冲，为空时使用分页绘制
+    Adafruit_GFX* gfx_ = nullptr;        // 当前渲染目标（canvas_ 或 display_epaper）
 
     std::chrono::system_clock::time_point last_status_update_time_;
     esp_timer_handle_t notification_timer_ = nullptr;
 
     // UI 管理
-    std::map<String, EpaperLabel*> ui_labels_;  // 存储所有 UI 元素
+    EpaperLabelStore ui_labels_;                // 存储所有 UI 元素
     bool ui_dirty_ = false;                      // 标记是否需要刷新
     uint16_t current_page_ = BOOT_PAGE;         // 当前页面
     uint8_t display_rotation_ = 3;              // 显示旋转: 1=正常, 3=180°旋转
 
+    // 异步渲染队列，受 mutex_ 保护
+    enum PageRefresh {
+        kPageRefreshNone,
+        kPageRefreshPartial,   // 整屏局部刷新
+        kPageRefreshFull,      // 全屏刷新
+    };
+    TaskHandle_t render_task_ = nullptr;
+    std::set<EpaperLabelStore::Handle> dirty_labels_; // 当前页待刷新的 label
+    PageRefresh pending_refresh_ = kPageRefreshNone;
+    EpaperDirtyRegion dirty_region_;             // 已确定需要刷新的区域
+    uint16_t screen_page_ = UINT16_MAX;          // 屏幕上实际显示的页面
+
     // 纪念日相关
     bool memorial_date_set_ = false;
     int memorial_year_ = 0;
@@ -125,6 +153,18 @@ protected:
     void RenderLabel(EpaperLabel *label); // 渲染单个 label
     void RenderTextWithWrap(EpaperLabel* label); // 渲染换行文本
     void ApplyChatPageLayoutForState(); // 根据设备状态调整对话页布局
+    void RequestRender();                // 唤醒渲染任务
+    void RenderTask();                   // 渲染任务主循环
+    void RenderPending();                // 合并并执行待刷新的区域
+    bool GetLabelBounds(EpaperLabel* label, EpaperRect& rect); // 计算 label 的包围盒
+    uint32_t LabelContentHash(EpaperLabel* label);       // label 绘制内容的摘要
+    bool UpdateDrawnState(EpaperLabel* label);           // 内容或位置变化时把新旧区域加入脏区
+    void InvalidateDrawnRect(EpaperLabel* label);        // 把屏幕上的旧区域加入脏区
+    void RefreshWindow(const EpaperRect* rect, bool full_refresh, uint16_t page); // 刷新一个窗口，刷屏期间释放锁
+    void RefreshRetained(const EpaperRect* rect, bool full_refresh, uint16_t page); // 常驻帧缓冲的刷新路径
+    void RenderWindowLabels(const EpaperRect* rect, uint16_t page); // 绘制窗口内的 label
+    static constexpr uint16_t native_width() { return GxEPD2_290_T5D::WIDTH; }
+    static constexpr uint16_t native_height() { return GxEPD2_290_T5D::HEIGHT; }
     
     // 文本边界计算
     struct TextBounds {
@@ -132,10 +172,8 @@ protected:
         uint16_t w, h;
     };
     TextBounds CalculateTextBounds(EpaperLabel* label); // 计算文本边界
+    void AssertLocked() const;                          // 断言当前任务持有 mutex_
     
-    uint8_t reverseByte(uint8_t b); // 反转一个字节的 bit 顺序
-    uint8_t* mirrorBitmap(const uint8_t* src, int16_t w, int16_t h,
-                                  bool mirror_h, bool mirror_v);
 
     friend class DisplayLockGuard;
     virtual bool Lock(int timeout_ms = 0) override;
@@ -0,0 +1,163 @@
+#include "epaper_label_store.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "EpaperLabelStore"
+
+EpaperLabel* EpaperLabelStore::Add(const String& id, EpaperLabel&& label) {
+    Handle old = Find(id);
+    if (old != kInvalidHandle) {
+        Remove(old);
+    }
+
+    Handle handle = AllocSlot();
+    if (handle == kInvalidHandle) {
+        ESP_LOGE(TAG, "Too many labels, drop '%s'", id.c_str());
+        return nullptr;
+    }
+    Slot& slot = SlotAt(handle);
+    slot.id = id;
+    slot.label.emplace(std::move(label));
+    index_.emplace(slot.id.c_str(), handle);
+
+    PageIndex* page = FindPage(slot.label->page);
+    if (page == nullptr) {
+        pages_.push_back(PageIndex{slot.label->page, {}, 0});
+        page = &pages_.back();
+    }
+    InsertSorted(page->labels, handle);
+    if (IsDynamic(*slot.label)) {
+        page->dynamic++;
+    }
+
+    for (auto& prefix : prefixes_) {
+        if (strncmp(slot.id.c_str(), prefix.prefix.c_str(), prefix.prefix.length()) == 0) {
+            InsertSorted(prefix.labels, handle);
+        }
+    }
+    return &*slot.label;
+}
+
+void EpaperLabelStore::Remove(Handle handle) {
+    Slot& slot = SlotAt(handle);
+    if (!slot.label.has_value()) {
+        return;
+    }
+
+    PageIndex* page = FindPage(slot.label->page);
+    if (page != nullptr) {
+        EraseHandle(page->labels, handle);
+        if (IsDynamic(*slot.label)) {
+            page->dynamic--;
+        }
+    }
+    for (auto& prefix : prefixes_) {
+        if (strncmp(slot.id.c_str(), prefix.prefix.c_str(), prefix.prefix.length()) == 0) {
+            EraseHandle(prefix.labels, handle);
+        }
+    }
+
+    index_.erase(slot.id.c_str());
+    slot.label.reset();
+    slot.id = String();
+    slot.next_free = free_head_;
+    free_head_ = handle;
+}
+
+void EpaperLabelStore::Clear() {
+    index_.clear();
+    pages_.clear();
+    prefixes_.clear();
+    chunks_.clear();
+    capacity_ = 0;
+    free_head_ = kInvalidHandle;
+}
+
+EpaperLabelStore::Handle EpaperLabelStore::Find(const String& id) const {
+    auto it = index_.find(id.c_str());
+    return it != index_.end() ? it->second : kInvalidHandle;
+}
+
+const std::vector<EpaperLabelStore::Handle>& EpaperLabelStore::PageLabels(uint16_t page) const {
+    static const std::vector<Handle> empty;
+    const PageIndex* index = FindPage(page);
+    return index != nullptr ? index->labels : empty;
+}
+
+size_t EpaperLabelStore::DynamicCount(uint16_t page) const {
+    const PageIndex* index = FindPage(page);
+    return index != nullptr ? index->dynamic : 0;
+}
+
+const std::vector<EpaperLabelStore::Handle>& EpaperLabelStore::PrefixLabels(const char* prefix) {
+    for (const auto& index : prefixes_) {
+        if (index.prefix == prefix) {
+            return index.labels;
+        }
+    }
+
+    // 第一次查询：扫描一遍现有 label 登记这个前缀
+    prefixes_.push_back(PrefixIndex{String(prefix), {}});
+    PrefixIndex& index = prefixes_.back();
+    size_t length = strlen(prefix);
+    for (const auto& pair : index_) {
+        if (strncmp(pair.first, prefix, length) == 0) {
+            InsertSorted(index.labels, pair.second);
+        }
+    }
+    return index.labels;
+}
+
+EpaperLabelStore::Handle EpaperLabelStore::AllocSlot() {
+    if (free_head_ == kInvalidHandle) {
+        if (capacity_ + EPAPER_LABEL_CHUNK_SIZE > kInvalidHandle) {
+            return kInvalidHandle;
+        }
+        // 新的一块槽位，逆序挂到空闲链表上，先用低位的槽
+        chunks_.emplace_back(new Slot[EPAPER_LABEL_CHUNK_SIZE]);
+        for (int i = EPAPER_LABEL_CHUNK_SIZE - 1; i >= 0; i--) {
+            Handle handle = capacity_ + i;
+            SlotAt(handle).next_free = free_head_;
+            free_head_ = handle;
+        }
+        capacity_ += EPAPER_LABEL_CHUNK_SIZE;
+    }
+
+    Handle handle = free_head_;
+    free_head_ = SlotAt(handle).next_free;
+    SlotAt(handle).next_free = kInvalidHandle;
+    return handle;
+}
+
+EpaperLabelStore::PageIndex* EpaperLabelStore::FindPage(uint16_t page) {
+    for (auto& index : pages_) {
+        if (index.page == page) {
+            return &index;
+        }
+    }
+    return nullptr;
+}
+
+const EpaperLabelStore::PageIndex* EpaperLabelStore::FindPage(uint16_t page) const {
+    return const_cast<EpaperLabelStore*>(this)->FindPage(page);
+}
+
+void EpaperLabelStore::InsertSorted(std::vector<Handle>& list, Handle handle) const {
+    const char* id = Name(handle).c_str();
+    auto it = std::lower_bound(list.begin(), list.end(), id, [this](Handle h, const char* key) {
+        return strcmp(Name(h).c_str(), key) < 0;
+    });
+    list.insert(it, handle);
+}
+
+void EpaperLabelStore::EraseHandle(std::vector<Handle>& list, Handle handle) {
+    auto it = std::find(list.begin(), list.end(), handle);
+    if (it != list.end()) {
+        list.erase(it);
+    }
+}
+
+bool EpaperLabelStore::IsDynamic(const EpaperLabel& label) {
+    return label.type == EpaperObjectType::TEXT && label.dynamic_type[0] != '\0';
+}
@@ -0,0 +1,105 @@
+#ifndef EPAPER_LABEL_STORE_H
+#define EPAPER_LABEL_STORE_H
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include <Arduino.h>
+
+#include "epaperui.h"
+
+#define EPAPER_LABEL_CHUNK_SIZE 16      // arena 每块连续存放的 label 数量
+
+/*
+ * label 的扁平存储，替代 std::map<String, EpaperLabel*>。
+ *
+ * label 按块连续存放在 arena 中，删除前地址不变，GetLabel 返回的指针可以一直持有；
+ * 删除后的槽位放入空闲链表复用。id 只保存一份，按 id 查找是一次哈希，内部用 16 位句柄引用。
+ *
+ * 每个页面、每个登记过的前缀（canvas_、cp_pN_）各维护一个按 id 排序的句柄列表：
+ * 渲染一页只遍历该页的 label，绘制顺序与原来按 id 排序的 std::map 一致；
+ * 前缀统计和遍历不再扫描全部 label。
+ *
+ * page 和 dynamic_type 在 Add 时建立索引，之后要修改需要重新 Add。
+ */
+class EpaperLabelStore {
+public:
+    using Handle = uint16_t;
+    static constexpr Handle kInvalidHandle = UINT16_MAX;
+
+    EpaperLabelStore() = default;
+    EpaperLabelStore(const EpaperLabelStore&) = delete;
+    EpaperLabelStore& operator=(const EpaperLabelStore&) = delete;
+
+    // 加入 label，同名的旧 label 会被替换；返回存储中的 label
+    EpaperLabel* Add(const String& id, EpaperLabel&& label);
+    void Remove(Handle handle);
+    void Clear();
+
+    Handle Find(const String& id) const;
+    EpaperLabel* Get(Handle handle) { return &*SlotAt(handle).label; }
+    const String& Name(Handle handle) const { return SlotAt(handle).id; }
+    size_t size() const { return index_.size(); }
+
+    // 某页的 label，按 id 排序
+    const std::vector<Handle>& PageLabels(uint16_t page) const;
+    // 某页带 dynamic_type 的文本 label 数量
+    size_t DynamicCount(uint16_t page) const;
+    // 指定前缀的 label，按 id 排序；前缀第一次查询时扫描登记，之后随 Add/Remove 维护。
+    // 返回的引用在下次 Add/Remove 前有效
+    const std::vector<Handle>& PrefixLabels(const char* prefix);
+
+private:
+    struct Slot {
+        String id;
+        std::optional<EpaperLabel> label;
+        Handle next_free = kInvalidHandle;
+    };
+    struct PageIndex {
+        uint16_t page;
+        std::vector<Handle> labels;
+        size_t dynamic = 0;
+    };
+    struct PrefixIndex {
+        String prefix;
+        std::vector<Handle> labels;
+    };
+    struct CStrHash {
+        size_t operator()(const char* s) const {
+            // FNV-1a
+            uint32_t hash = 2166136261u;
+            while (*s) {
+                hash = (hash ^ (uint8_t)*s++) * 16777619u;
+            }
+            return hash;
+        }
+    };
+    struct CStrEqual {
+        bool operator()(const char* a, const char* b) const { return strcmp(a, b) == 0; }
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    Handle capacity_ = 0;
+    Handle free_head_ = kInvalidHandle;
+    // key 指向 Slot::id 的内容，槽位不移动，所以 id 只存一份
+    std::unordered_map<const char*, Handle, CStrHash, CStrEqual> index_;
+    std::deque<PageIndex> pages_;
+    std::deque<PrefixIndex> prefixes_;
+
+    Slot& SlotAt(Handle handle) { return chunks_[handle / EPAPER_LABEL_CHUNK_SIZE][handle % EPAPER_LABEL_CHUNK_SIZE]; }
+    const Slot& SlotAt(Handle handle) const {
+        return chunks_[handle / EPAPER_LABEL_CHUNK_SIZE][handle % EPAPER_LABEL_CHUNK_SIZE];
+    }
+    Handle AllocSlot();
+    PageIndex* FindPage(uint16_t page);
+    const PageIndex* FindPage(uint16_t page) const;
+    void InsertSorted(std::vector<Handle>& list, Handle handle) const;
+    static void EraseHandle(std::vector<Handle>& list, Handle handle);
+    static bool IsDynamic(const EpaperLabel& label);
+};
+
+#endif // EPAPER_LABEL_STORE_H
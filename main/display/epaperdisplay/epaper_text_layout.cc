@@ -0,0 +1,159 @@
+#include "epaper_text_layout.h"
+
+#include <cstring>
+
+namespace {
+
+uint32_t HashText(const char* data, size_t length) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// UTF-8 首字节对应的字节数，0 表示无效的首字节
+size_t Utf8SequenceLength(uint8_t c) {
+    if ((c & 0x80) == 0) return 1;
+    if ((c & 0xE0) == 0xC0) return 2;
+    if ((c & 0xF0) == 0xE0) return 3;
+    if ((c & 0xF8) == 0xF0) return 4;
+    return 0;
+}
+
+}  // namespace
+
+EpaperTextLayout::EpaperTextLayout(U8G2_FOR_ADAFRUIT_GFX& u8g2) : u8g2_(u8g2) {
+}
+
+void EpaperTextLayout::Clear() {
+    entries_.clear();
+    glyphs_.clear();
+}
+
+const std::vector<EpaperTextLine>& EpaperTextLayout::Layout(const String& text, const uint8_t* font,
+                                                            uint16_t w_max, EpaperTextAlign align) {
+    uint32_t hash = HashText(text.c_str(), text.length());
+    use_counter_++;
+
+    Entry* slot = nullptr;
+    for (auto& entry : entries_) {
+        if (entry.hash == hash && entry.length == text.length() && entry.font == font &&
+            entry.w_max == w_max && entry.align == align) {
+            entry.last_used = use_counter_;
+            hits_++;
+            return entry.lines;
+        }
+        if (slot == nullptr || entry.last_used < slot->last_used) {
+            slot = &entry;
+        }
+    }
+
+    // 未命中：缓存未满时新增，否则替换最久未使用的一项
+    misses_++;
+    if (entries_.size() < EPAPER_TEXT_LAYOUT_CACHE_SIZE) {
+        entries_.emplace_back();
+        slot = &entries_.back();
+    }
+    slot->hash = hash;
+    slot->length = text.length();
+    slot->font = font;
+    slot->w_max = w_max;
+    slot->align = align;
+    slot->last_used = use_counter_;
+    BreakLines(text, font, w_max, align, slot->lines);
+    return slot->lines;
+}
+
+const EpaperTextLayout::GlyphMetrics& EpaperTextLayout::GetGlyph(const uint8_t* font, const char* utf8, size_t bytes) {
+    uint32_t key = 0;
+    memcpy(&key, utf8, bytes);
+
+    auto& glyphs = glyphs_[font];
+    auto it = glyphs.find(key);
+    if (it != glyphs.end()) {
+        return it->second;
+    }
+    if (glyphs.size() >= EPAPER_GLYPH_CACHE_SIZE) {
+        glyphs.clear();
+    }
+
+    // u8g2 的字符串宽度是前面字形的步进之和加上最后一个字形的宽度，
+    // 所以两个相同字形的宽度减去一个字形的宽度就是步进
+    char single[5] = {0};
+    char twice[9] = {0};
+    memcpy(single, utf8, bytes);
+    memcpy(twice, utf8, bytes);
+    memcpy(twice + bytes, utf8, bytes);
+    GlyphMetrics metrics;
+    metrics.width = u8g2_.getUTF8Width(single);
+    metrics.advance = u8g2_.getUTF8Width(twice) - metrics.width;
+    return glyphs.emplace(key, metrics).first->second;
+}
+
+void EpaperTextLayout::BreakLines(const String& text, const uint8_t* font, uint16_t w_max, EpaperTextAlign align,
+                                  std::vector<EpaperTextLine>& lines) {
+    lines.clear();
+    const char* data = text.c_str();
+    const size_t length = text.length();
+
+    auto add_line = [&](EpaperTextLine&& line) {
+        if (align == EpaperTextAlign::CENTER) {
+            line.offset = (w_max - line.width) / 2;
+        } else if (align == EpaperTextAlign::RIGHT) {
+            line.offset = w_max - line.width;
+        }
+        lines.emplace_back(std::move(line));
+    };
+
+    size_t start = 0;
+    while (start < length) {
+        const char* newline = (const char*)memchr(data + start, '\n', length - start);
+        size_t paragraph_end = newline != nullptr ? newline - data : length;
+
+        if (paragraph_end == start) {
+            add_line(EpaperTextLine());
+        }
+
+        size_t pos = start;
+        while (pos < paragraph_end) {
+            EpaperTextLine line;
+            int32_t advance = 0;    // 行内已有字形的步进之和
+            size_t line_start = pos;
+
+            while (pos < paragraph_end) {
+                size_t bytes = Utf8SequenceLength(data[pos]);
+                if (bytes == 0) {
+                    // 跳过无效字节
+                    pos++;
+                    continue;
+                }
+                if (pos + bytes > paragraph_end) {
+                    break;
+                }
+
+                const auto& glyph = GetGlyph(font, data + pos, bytes);
+                int32_t width = advance + glyph.width;
+                if (width > w_max && !line.text.empty()) {
+                    break;
+                }
+                line.text.append(data + pos, bytes);
+                line.width = width;
+                advance += glyph.advance;
+                pos += bytes;
+            }
+
+            add_line(std::move(line));
+            // 截断的多字节字符，跳过首字节避免死循环
+            if (pos == line_start) {
+                pos++;
+            }
+        }
+
+        if (newline == nullptr) {
+            break;
+        }
+        start = paragraph_end + 1;
+    }
+}
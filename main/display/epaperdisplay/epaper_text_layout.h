@@ -0,0 +1,69 @@
+#ifndef EPAPER_TEXT_LAYOUT_H
+#define EPAPER_TEXT_LAYOUT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <Arduino.h>
+#include <U8g2_for_Adafruit_GFX.h>
+
+#include "epaperui.h"
+
+#define EPAPER_TEXT_LAYOUT_CACHE_SIZE 16     // 缓存的排版结果数量
+#define EPAPER_GLYPH_CACHE_SIZE 2048         // 每个字体缓存的字形数量上限
+
+struct EpaperTextLine {
+    std::string text;
+    int16_t width = 0;      // 行宽，与 getUTF8Width 结果一致
+    int16_t offset = 0;     // 按对齐方式相对 label->x 的偏移
+};
+
+/*
+ * U8g2 换行文本的排版缓存。
+ *
+ * 按 (文本摘要, 字体, w_max, 对齐) 缓存断行结果和每行宽度，CalculateTextBounds 和
+ * RenderTextWithWrap 共用同一份结果。断行按字形逐个累加宽度，每个字形的宽度只测量一次，
+ * 排版一段文本是 O(n) 的，不再对逐渐变长的行反复调用 getUTF8Width。
+ */
+class EpaperTextLayout {
+public:
+    explicit EpaperTextLayout(U8G2_FOR_ADAFRUIT_GFX& u8g2);
+
+    // 调用前字体必须已经设置到 u8g2 上；返回的引用在下次 Layout 前有效
+    const std::vector<EpaperTextLine>& Layout(const String& text, const uint8_t* font,
+                                              uint16_t w_max, EpaperTextAlign align);
+    void Clear();
+
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+
+private:
+    struct GlyphMetrics {
+        int16_t advance;    // 后面还有字形时占用的宽度
+        int16_t width;      // 作为行尾最后一个字形时的宽度
+    };
+    struct Entry {
+        uint32_t hash = 0;
+        size_t length = 0;
+        const uint8_t* font = nullptr;
+        uint16_t w_max = 0;
+        EpaperTextAlign align = EpaperTextAlign::LEFT;
+        uint32_t last_used = 0;
+        std::vector<EpaperTextLine> lines;
+    };
+
+    U8G2_FOR_ADAFRUIT_GFX& u8g2_;
+    std::vector<Entry> entries_;
+    std::map<const uint8_t*, std::unordered_map<uint32_t, GlyphMetrics>> glyphs_;
+    uint32_t use_counter_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+
+    const GlyphMetrics& GetGlyph(const uint8_t* font, const char* utf8, size_t bytes);
+    void BreakLines(const String& text, const uint8_t* font, uint16_t w_max, EpaperTextAlign align,
+                    std::vector<EpaperTextLine>& lines);
+};
+
+#endif // EPAPER_TEXT_LAYOUT_H
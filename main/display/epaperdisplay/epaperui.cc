@@ -1,3 +1,82 @@
 #include "epaperui.h"
 
+#include <array>
+#include <esp_heap_caps.h>
 
+namespace {
+
+// 字节内 bit 反转表，比如 0b01100010 -> 0b01000110
+constexpr std::array<uint8_t, 256> MakeReverseTable() {
+    std::array<uint8_t, 256> table = {};
+    for (int i = 0; i < 256; i++) {
+        uint8_t b = i;
+        b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+        b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+        b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+        table[i] = b;
+    }
+    return table;
+}
+
+constexpr std::array<uint8_t, 256> kReverseBits = MakeReverseTable();
+
+// 1bpp 位图镜像，每行按字节补齐；水平镜像时补齐位保持在行尾
+void MirrorBitmap(const uint8_t* src, uint8_t* dst, int w, int h, bool mirror_h, bool mirror_v) {
+    const int row_bytes = (w + 7) / 8;
+    const int pad = row_bytes * 8 - w;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t* src_row = src + (mirror_v ? (h - 1 - y) : y) * row_bytes;
+        uint8_t* dst_row = dst + y * row_bytes;
+        if (!mirror_h) {
+            for (int bx = 0; bx < row_bytes; bx++) {
+                dst_row[bx] = pgm_read_byte(&src_row[bx]);
+            }
+            continue;
+        }
+
+        // 整行反转后补齐位跑到了行首，再整体左移 pad 位
+        for (int bx = 0; bx < row_bytes; bx++) {
+            dst_row[bx] = kReverseBits[pgm_read_byte(&src_row[row_bytes - 1 - bx])];
+        }
+        if (pad > 0) {
+            for (int bx = 0; bx < row_bytes; bx++) {
+                uint8_t next = (bx + 1 < row_bytes) ? dst_row[bx + 1] : 0;
+                dst_row[bx] = (dst_row[bx] << pad) | (next >> (8 - pad));
+            }
+        }
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<uint8_t> EpaperLabel::AllocBitmap(size_t bytes) {
+    auto buffer = (uint8_t*)heap_caps_malloc_prefer(bytes, 2,
+        MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (buffer == nullptr) {
+        return nullptr;
+    }
+    return std::shared_ptr<uint8_t>(buffer, [](uint8_t* p) { heap_caps_free(p); });
+}
+
+const uint8_t* EpaperLabel::GetDrawBitmap() {
+    if (bitmap == nullptr || (!mirror_h && !mirror_v)) {
+        mirrored_bitmap_.reset();
+        return bitmap;
+    }
+
+    if (mirrored_bitmap_ == nullptr || mirrored_src_ != bitmap || mirrored_w_ != w || mirrored_h_ != h ||
+        mirrored_h_flag_ != mirror_h || mirrored_v_flag_ != mirror_v) {
+        mirrored_bitmap_ = AllocBitmap((size_t)(w + 7) / 8 * h);
+        if (mirrored_bitmap_ == nullptr) {
+            return bitmap;
+        }
+        MirrorBitmap(bitmap, mirrored_bitmap_.get(), w, h, mirror_h, mirror_v);
+        mirrored_src_ = bitmap;
+        mirrored_w_ = w;
+        mirrored_h_ = h;
+        mirrored_h_flag_ = mirror_h;
+        mirrored_v_flag_ = mirror_v;
+    }
+    return mirrored_bitmap_.get();
+}
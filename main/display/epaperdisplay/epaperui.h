@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <Arduino.h>
 #include <functional>
+#include <memory>
 #include <vector>
 #include <GxEPD2_BW.h>
 #include <U8g2_for_Adafruit_GFX.h>
@@ -84,6 +85,7 @@ public:
 
     // 位图属性
     const uint8_t* bitmap = nullptr;
+    std::shared_ptr<uint8_t> bitmap_owner;  // bitmap 由 label 持有时非空（如从文件加载的图片），随 label 释放
     uint16_t depth = 1;      // 1=黑白, 3=三色, 7=七色
     char image_name[32] = {0};  // 图片文件名（用于持久化恢复，canvas.add_image 时设置）
     char dynamic_type[16] = {0};  // 动态类型: clock/date/datetime/cpu_temp/heap/uptime
@@ -99,6 +101,17 @@ public:
     // 圆形/圆角矩形属性
     uint16_t radius = 0;
 
+    // 分配位图缓冲区（优先 PSRAM），交给 label 持有
+    static std::shared_ptr<uint8_t> AllocBitmap(size_t bytes);
+    // 镜像后的位图，镜像参数或源位图变化时重新生成，之后直接复用
+    const uint8_t* GetDrawBitmap();
+
+    // 屏幕上的绘制状态（由 EpaperDisplay 维护，用于计算脏区）
+    bool drawn = false;                 // 当前是否显示在屏幕上
+    int16_t drawn_x = 0, drawn_y = 0;   // 上次绘制的包围盒
+    uint16_t drawn_w = 0, drawn_h = 0;
+    uint32_t drawn_hash = 0;            // 上次绘制的内容摘要
+
     // --- 工厂函数们 ---
     
     // 文本（统一使用 U8g2 字体，支持中英文）
@@ -195,6 +208,23 @@ public:
         return obj;
     }
 
+    // 位图，缓冲区由 label 持有
+    static EpaperLabel Bitmap(int16_t x, int16_t y, std::shared_ptr<uint8_t> bitmap,
+                              uint16_t w, uint16_t h,
+                              uint16_t depth = 1,
+                              uint8_t rotation = 1,
+                              bool mirror_h = false,
+                              bool mirror_v = false,
+                              bool invert = false,
+                              bool visible = true,
+                              uint16_t page = 1,
+                              const char* image_name = nullptr) {
+        EpaperLabel obj = Bitmap(x, y, (const uint8_t*)bitmap.get(), w, h, depth, rotation,
+                                 mirror_h, mirror_v, invert, visible, page, image_name);
+        obj.bitmap_owner = std::move(bitmap);
+        return obj;
+    }
+
     // 圆形
     static EpaperLabel Circle(int16_t x, int16_t y, uint16_t radius,
                               bool filled = false, uint16_t color = GxEPD_BLACK, uint8_t rotation = 1,
@@ -273,6 +303,12 @@ public:
 
 private:
     EpaperLabel() = default; // 限制只能通过工厂函数创建
+
+    // 镜像位图缓存及生成时的参数
+    std::shared_ptr<uint8_t> mirrored_bitmap_;
+    const uint8_t* mirrored_src_ = nullptr;
+    uint16_t mirrored_w_ = 0, mirrored_h_ = 0;
+    bool mirrored_h_flag_ = false, mirrored_v_flag_ = false;
 };
 
 
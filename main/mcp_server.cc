@@ -15,6 +15,8 @@
 #include "oled_display.h"
 #include "board.h"
 #include "settings.h"
+#include "system_info.h"
+#include "audio_latency_profiler.h"
 #include "lvgl_theme.h"
 #include "lvgl_display.h"
 
@@ -135,6 +137,20 @@ void McpServer::AddUserOnlyTools() {
             return board.GetSystemInfoJson();
         });
 
+    AddUserOnlyTool("self.audio.get_latency_stats",
+        "Per-stage latency of the uplink audio (AFE, output callback, encode queue) with histograms, "
+        "lag and drop counters. Set `reset` to start a new measurement window after reading.",
+        PropertyList({
+            Property("reset", kPropertyTypeBoolean, false)
+        }),
+        [](const PropertyList& properties) -> ReturnValue {
+            cJSON* json = SystemInfo::GetAudioLatencyJson();
+            if (properties["reset"].value<bool>()) {
+                AudioLatencyProfiler::GetInstance().Reset();
+            }
+            return json;
+        });
+
     AddUserOnlyTool("self.reboot", "Reboot the system",
         PropertyList(),
         [this](const PropertyList& properties) -> ReturnValue {
@@ -158,16 +174,14 @@ void McpServer::AddUserOnlyTools() {
             ESP_LOGI(TAG, "User requested firmware upgrade from URL: %s", url.c_str());
             
             auto& app = Application::GetInstance();
-            app.Schedule([url, &app]() {
+            return app.Schedule([url, &app]() {
                 auto ota = std::make_unique<Ota>();
                 
                 bool success = app.UpgradeFirmware(*ota, url);
                 if (!success) {
                     ESP_LOGE(TAG, "Firmware upgrade failed");
                 }
-            });
-            
-            return true;
+            }, kTaskPriorityBackground, "firmware_upgrade");
         });
 
     // Display control
@@ -552,14 +566,17 @@ void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* to
         return;
     }
 
-    // Use main thread to call the tool
+    // Use main thread to call the tool, the caller waits for a reply even if the main loop is too busy
     auto& app = Application::GetInstance();
-    app.Schedule([this, id, tool_iter, arguments = std::move(arguments)]() {
+    bool scheduled = app.Schedule([this, id, tool_iter, arguments = std::move(arguments)]() {
         try {
             ReplyResult(id, (*tool_iter)->Call(arguments));
         } catch (const std::exception& e) {
             ESP_LOGE(TAG, "tools/call: %s", e.what());
             ReplyError(id, e.what());
         }
-    });
+    }, kTaskPriorityBackground);
+    if (!scheduled) {
+        ReplyError(id, "Device busy, try again later");
+    }
 }
@@ -42,6 +42,7 @@ private:
     std::unique_ptr<Udp> udp_;
     mbedtls_aes_context aes_ctx_;
     std::string aes_nonce_;
+    std::string send_buffer_;
     std::string udp_server_;
     int udp_port_;
     uint32_t local_sequence_;
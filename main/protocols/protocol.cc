@@ -1,6 +1,8 @@
 #include "protocol.h"
+#include "opus_config.h"
 
 #include <esp_log.h>
+#include <esp_timer.h>
 
 #define TAG "Protocol"
 
@@ -34,6 +36,10 @@ void Protocol::OnDisconnected(std::function<void()> callback) {
 
 void Protocol::SetError(const std::string& message) {
     error_occurred_ = true;
+    if (warming_up_) {
+        ESP_LOGW(TAG, "Warm up failed: %s", message.c_str());
+        return;
+    }
     if (on_network_error_ != nullptr) {
         on_network_error_(message);
     }
@@ -78,6 +84,36 @@ void Protocol::SendMcpMessage(const std::string& payload) {
     SendText(message);
 }
 
+bool Protocol::WarmUpAudioChannel() {
+    warming_up_ = true;
+    bool success = OpenAudioChannel();
+    warming_up_ = false;
+    return success;
+}
+
+void Protocol::BeginConnectTimings() {
+    connect_timings_ = ConnectTimings();
+    connect_timings_.warm_up = warming_up_;
+    connect_phase_time_ = esp_timer_get_time();
+}
+
+int Protocol::EndConnectPhase() {
+    int64_t now = esp_timer_get_time();
+    int elapsed_ms = (now - connect_phase_time_) / 1000;
+    connect_phase_time_ = now;
+    connect_timings_.total_ms = (connect_timings_.total_ms < 0 ? 0 : connect_timings_.total_ms) + elapsed_ms;
+    return elapsed_ms;
+}
+
+void Protocol::EndConnectTimings(bool success) {
+    EndConnectPhase();
+    connect_timings_.success = success;
+    auto& t = connect_timings_;
+    ESP_LOGI(TAG, "%s%s in %d ms: dns %d, connect %d, hello %d, channel %d",
+        t.warm_up ? "Warm up " : "Open audio channel ", success ? "done" : "failed",
+        t.total_ms, t.dns_ms, t.connect_ms, t.hello_ms, t.channel_ms);
+}
+
 bool Protocol::IsTimeout() const {
     const int kTimeoutSeconds = 120;
     auto now = std::chrono::steady_clock::now();
@@ -88,3 +124,60 @@ bool Protocol::IsTimeout() const {
     }
     return timeout;
 }
+
+cJSON* Protocol::CreateAudioParams() const {
+    cJSON* audio_params = cJSON_CreateObject();
+    cJSON_AddStringToObject(audio_params, "format", "opus");
+    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
+    cJSON_AddNumberToObject(audio_params, "channels", 1);
+    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
+
+    // What the server may pick for the uplink
+    static const int frame_durations[] = OPUS_FRAME_DURATIONS;
+    cJSON_AddItemToObject(audio_params, "frame_durations",
+        cJSON_CreateIntArray(frame_durations, sizeof(frame_durations) / sizeof(frame_durations[0])));
+    // The same check as AudioService::kSupportsBitrate, without the bitrate control the encoder ignores it
+    if constexpr (OpusHasBitrateControl<OpusEncoderWrapper>::value) {
+        static const int bitrates[] = OPUS_BITRATES;
+        cJSON_AddItemToObject(audio_params, "bitrates",
+            cJSON_CreateIntArray(bitrates, sizeof(bitrates) / sizeof(bitrates[0])));
+    }
+    cJSON_AddNumberToObject(audio_params, "max_complexity", OPUS_MAX_COMPLEXITY);
+    return audio_params;
+}
+
+void Protocol::ParseAudioParams(const cJSON* audio_params) {
+    encoder_config_ = OpusEncoderConfig();
+    encoder_config_.frame_duration = OPUS_FRAME_DURATION_MS;
+    if (!cJSON_IsObject(audio_params)) {
+        return;
+    }
+
+    auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
+    if (cJSON_IsNumber(sample_rate)) {
+        server_sample_rate_ = sample_rate->valueint;
+    }
+    auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
+    if (cJSON_IsNumber(frame_duration)) {
+        server_frame_duration_ = frame_duration->valueint;
+    }
+
+    // Optional uplink choice: {"frame_duration": 20, "bitrate": 24000, "complexity": 3}
+    auto uplink = cJSON_GetObjectItem(audio_params, "uplink");
+    if (cJSON_IsObject(uplink)) {
+        auto uplink_frame_duration = cJSON_GetObjectItem(uplink, "frame_duration");
+        if (cJSON_IsNumber(uplink_frame_duration)) {
+            encoder_config_.frame_duration = uplink_frame_duration->valueint;
+        }
+        auto complexity = cJSON_GetObjectItem(uplink, "complexity");
+        if (cJSON_IsNumber(complexity)) {
+            encoder_config_.complexity = complexity->valueint;
+        }
+        auto bitrate = cJSON_GetObjectItem(uplink, "bitrate");
+        if (cJSON_IsNumber(bitrate)) {
+            encoder_config_.bitrate = bitrate->valueint;
+        }
+        ESP_LOGI(TAG, "Server picked uplink frame_duration=%d, complexity=%d, bitrate=%d",
+            encoder_config_.frame_duration, encoder_config_.complexity, encoder_config_.bitrate);
+    }
+}
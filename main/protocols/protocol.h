@@ -6,14 +6,40 @@
 #include <functional>
 #include <chrono>
 #include <vector>
+#include <memory>
+
+#include "object_pool.h"
 
 struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
     uint32_t timestamp = 0;
+    uint32_t sequence = 0;
+    bool local = false;     // Local sounds, they bypass the jitter buffer
+    uint32_t trace_id = 0;  // Frame id in the audio flight recorder
     std::vector<uint8_t> payload;
+
+    // Take a packet from the pool, the payload keeps its capacity from the previous use
+    static std::unique_ptr<AudioStreamPacket> Acquire();
+};
+
+// Pooled packets go back to the pool instead of being freed
+template <>
+struct std::default_delete<AudioStreamPacket> {
+    void operator()(AudioStreamPacket* packet) const {
+        if (!ObjectPool<AudioStreamPacket>::GetInstance().Release(packet)) {
+            delete packet;
+        }
+    }
 };
 
+inline std::unique_ptr<AudioStreamPacket> AudioStreamPacket::Acquire() {
+    auto packet = ObjectPool<AudioStreamPacket>::GetInstance().Acquire();
+    // A pooled packet may have been a local one
+    packet->local = false;
+    return packet;
+}
+
 struct BinaryProtocol2 {
     uint16_t version;
     uint16_t type;          // Message type (0: OPUS, 1: JSON)
@@ -30,6 +56,24 @@ struct BinaryProtocol3 {
     uint8_t payload[];
 } __attribute__((packed));
 
+// Uplink opus settings, the client offers the supported ones in hello and the server picks
+struct OpusEncoderConfig {
+    int frame_duration = 60;
+    int complexity = 0;
+    int bitrate = 0;  // bits per second, 0 lets the encoder decide
+};
+
+// Time spent in each phase of one OpenAudioChannel attempt, -1 when the phase did not run
+struct ConnectTimings {
+    int dns_ms = -1;        // Host lookup ahead of the connect, WebSocket over Wi-Fi only
+    int connect_ms = -1;    // TCP, TLS and WebSocket upgrade (or MQTT reconnect), the network layer does not split them
+    int hello_ms = -1;      // Client hello to server hello
+    int channel_ms = -1;    // UDP channel setup, MQTT only
+    int total_ms = -1;
+    bool success = false;
+    bool warm_up = false;   // Opened ahead of a conversation by WarmUpAudioChannel
+};
+
 enum AbortReason {
     kAbortReasonNone,
     kAbortReasonWakeWordDetected
@@ -54,6 +98,12 @@ public:
     inline const std::string& session_id() const {
         return session_id_;
     }
+    inline const OpusEncoderConfig& encoder_config() const {
+        return encoder_config_;
+    }
+    inline const ConnectTimings& last_connect_timings() const {
+        return connect_timings_;
+    }
 
     void OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback);
     void OnIncomingJson(std::function<void(const cJSON* root)> callback);
@@ -73,6 +123,8 @@ public:
     virtual void SendStopListening();
     virtual void SendAbortSpeaking(AbortReason reason);
     virtual void SendMcpMessage(const std::string& message);
+    // Open the channel ahead of a conversation, failures are logged instead of reported as network errors
+    bool WarmUpAudioChannel();
 
 protected:
     std::function<void(const cJSON* root)> on_incoming_json_;
@@ -85,13 +137,24 @@ protected:
 
     int server_sample_rate_ = 24000;
     int server_frame_duration_ = 60;
+    OpusEncoderConfig encoder_config_;
     bool error_occurred_ = false;
+    bool warming_up_ = false;
+    ConnectTimings connect_timings_;
+    int64_t connect_phase_time_ = 0;
     std::string session_id_;
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
 
     virtual bool SendText(const std::string& text) = 0;
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
+    // The audio_params of the client hello, and parsing them from the server hello
+    cJSON* CreateAudioParams() const;
+    void ParseAudioParams(const cJSON* audio_params);
+    // Connect phase timing, EndConnectTimings logs the attempt
+    void BeginConnectTimings();
+    int EndConnectPhase();  // Milliseconds since the previous phase ended
+    void EndConnectTimings(bool success);
 };
 
 #endif // PROTOCOL_H
@@ -25,6 +25,8 @@ private:
     EventGroupHandle_t event_group_handle_;
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
+    // TCP keeps the order, number the packets so the jitter buffer can pace them
+    uint32_t incoming_sequence_ = 0;
 
     void ParseServerHello(const cJSON* root);
     bool SendText(const std::string& text) override;
@@ -1,4 +1,6 @@
 #include "system_info.h"
+#include "pcm_cache.h"
+#include "audio_latency_profiler.h"
 
 #include <freertos/task.h>
 #include <esp_log.h>
@@ -149,3 +151,56 @@ void SystemInfo::PrintHeapStats() {
     int min_free_sram = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
     ESP_LOGI(TAG, "free sram: %u minimal sram: %u", free_sram, min_free_sram);
 }
+
+void SystemInfo::PrintSoundCacheStats() {
+    auto stats = PcmCache::GetInstance().GetStats();
+    ESP_LOGI(TAG, "sound cache: %u hits, %u misses, %u sounds, %u/%u bytes",
+        (unsigned)stats.hits, (unsigned)stats.misses, stats.entries, stats.bytes, stats.budget);
+}
+
+void SystemInfo::PrintAudioLatencyStats() {
+    auto stats = AudioLatencyProfiler::GetInstance().GetStats();
+    for (int i = 0; i < kAudioLatencyStageCount; i++) {
+        const auto& stage = stats.stages[i];
+        if (stage.frames == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "latency %s: %lu frames, avg %lluus, max %luus, %lu late",
+            AudioLatencyProfiler::StageName((AudioLatencyStage)i), stage.frames,
+            stage.total_us / stage.frames, stage.max_us, stage.late);
+    }
+    ESP_LOGI(TAG, "latency afe lag: max %lu chunks of %lums, %lu overflows, %lu fetch errors; "
+        "encode queue: max %lu, %lu dropped", stats.max_afe_lag, stats.afe_chunk_ms, stats.afe_overflows,
+        stats.fetch_errors, stats.max_encode_queue, stats.encode_drops);
+}
+
+cJSON* SystemInfo::GetAudioLatencyJson() {
+    auto stats = AudioLatencyProfiler::GetInstance().GetStats();
+    cJSON* json = cJSON_CreateObject();
+
+    cJSON* stages = cJSON_AddObjectToObject(json, "stages");
+    for (int i = 0; i < kAudioLatencyStageCount; i++) {
+        const auto& stage = stats.stages[i];
+        cJSON* item = cJSON_AddObjectToObject(stages, AudioLatencyProfiler::StageName((AudioLatencyStage)i));
+        cJSON_AddNumberToObject(item, "frames", stage.frames);
+        cJSON_AddNumberToObject(item, "late", stage.late);
+        cJSON_AddNumberToObject(item, "avg_us", stage.frames > 0 ? (double)(stage.total_us / stage.frames) : 0);
+        cJSON_AddNumberToObject(item, "max_us", stage.max_us);
+        // Bucket i counts frames below 2^i ms, the last one everything above
+        cJSON* histogram = cJSON_AddArrayToObject(item, "histogram_ms");
+        for (int b = 0; b < AUDIO_LATENCY_HISTOGRAM_BUCKETS; b++) {
+            cJSON_AddItemToArray(histogram, cJSON_CreateNumber(stage.buckets[b]));
+        }
+    }
+
+    cJSON* afe = cJSON_AddObjectToObject(json, "afe");
+    cJSON_AddNumberToObject(afe, "chunk_ms", stats.afe_chunk_ms);
+    cJSON_AddNumberToObject(afe, "max_lag_chunks", stats.max_afe_lag);
+    cJSON_AddNumberToObject(afe, "overflows", stats.afe_overflows);
+    cJSON_AddNumberToObject(afe, "fetch_errors", stats.fetch_errors);
+
+    cJSON* encoder = cJSON_AddObjectToObject(json, "encoder");
+    cJSON_AddNumberToObject(encoder, "max_queue", stats.max_encode_queue);
+    cJSON_AddNumberToObject(encoder, "dropped", stats.encode_drops);
+    return json;
+}
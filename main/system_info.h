@@ -5,6 +5,7 @@
 
 #include <esp_err.h>
 #include <freertos/FreeRTOS.h>
+#include <cJSON.h>
 
 class SystemInfo {
 public:
@@ -17,6 +18,9 @@ public:
     static esp_err_t PrintTaskCpuUsage(TickType_t xTicksToWait);
     static void PrintTaskList();
     static void PrintHeapStats();
+    static void PrintSoundCacheStats();
+    static void PrintAudioLatencyStats();
+    static cJSON* GetAudioLatencyJson();
 };
 
 #endif // _SYSTEM_INFO_H_
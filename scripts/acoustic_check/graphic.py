@@ -37,6 +37,12 @@ class UDPServerProtocol(asyncio.DatagramProtocol):
         
         # 只处理来自已记录客户端的数据
         if addr == self.client_address:
+            # 带帧头的固件（见 audio_debugger.h）只取 PCM 编码的麦克风流，去掉 32 字节帧头
+            if len(data) >= 32 and data[:4] == b'ADF1':
+                stream, encoding = data[5], data[6]
+                if stream != 0 or encoding != 0:
+                    return
+                data = data[32:]
             # 将接收到的音频数据添加到队列
             self.data_queue.extend(data)
         else:
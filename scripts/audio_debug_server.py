@@ -1,54 +1,309 @@
 import socket
+import struct
+import threading
+import time
+import math
 import wave
 import argparse
 
 
 '''
-  Create a UDP socket and bind it to the server's IP:8000.
-  Listen for incoming messages and print them to the console.
-  Save the audio to a WAV file.
+  Receive audio debugging frames from AudioDebugger (main/audio/processors/audio_debugger.h) over UDP.
+
+  Each frame carries a stream id, a per stream sequence number, the sample rate, channel count and
+  capture time of its first sample. On exit the streams are written as one multichannel WAV, lined
+  up by capture time and resampled to --samplerate, and a loss / latency report is printed.
+
+  Datagrams without the frame header are treated as raw PCM from older firmware and saved to
+  {samplerate}_{channels}.wav like before.
+
+  --selftest sends synthetic frames to the local server, no device needed.
 '''
-def main(samplerate, channels):
+
+FRAME_MAGIC = 0x31464441
+HEADER = struct.Struct('<IBBBBIIqHHI')
+STREAM_NAMES = ['mic', 'reference', 'processed', 'playback']
+ENCODING_PCM16 = 0
+ENCODING_IMA_ADPCM = 1
+
+IMA_STEPS = [
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+]
+IMA_INDEX = [-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8]
+
+
+def ima_step(code, predictor, index):
+    step = IMA_STEPS[index]
+    delta = step >> 3
+    if code & 4:
+        delta += step
+    if code & 2:
+        delta += step >> 1
+    if code & 1:
+        delta += step >> 2
+    predictor += -delta if code & 8 else delta
+    predictor = max(-32768, min(32767, predictor))
+    index = max(0, min(88, index + IMA_INDEX[code]))
+    return predictor, index
+
+
+def decode_ima_adpcm(payload, samples, channels):
+    '''Planar blocks, one per channel: int16 predictor, uint8 index, reserved, then low nibble first'''
+    block = 4 + (samples + 1) // 2
+    planes = []
+    for ch in range(channels):
+        data = payload[ch * block:(ch + 1) * block]
+        predictor, index = struct.unpack_from('<hB', data)
+        out = []
+        for i in range(samples):
+            byte = data[4 + i // 2]
+            code = byte >> 4 if i & 1 else byte & 0x0F
+            predictor, index = ima_step(code, predictor, index)
+            out.append(predictor)
+        planes.append(out)
+    return [planes[ch][i] for i in range(samples) for ch in range(channels)]
+
+
+def encode_ima_adpcm(pcm, channels):
+    '''Mirror of AudioDebugger::EncodeImaAdpcm, used by the self test'''
+    samples = len(pcm) // channels
+    out = bytearray()
+    for ch in range(channels):
+        src = pcm[ch::channels]
+        predictor, index = src[0], 0
+        slope = abs(src[1] - src[0]) if samples > 1 else 0
+        while index < 88 and IMA_STEPS[index] < slope:
+            index += 1
+        block = bytearray(struct.pack('<hBB', predictor, index, 0)) + bytearray((samples + 1) // 2)
+        for i, sample in enumerate(src):
+            step = IMA_STEPS[index]
+            diff = sample - predictor
+            code = 0
+            if diff < 0:
+                code, diff = 8, -diff
+            if diff >= step:
+                code |= 4
+                diff -= step
+            if diff >= step >> 1:
+                code |= 2
+                diff -= step >> 1
+            if diff >= step >> 2:
+                code |= 1
+            predictor, index = ima_step(code, predictor, index)
+            block[4 + i // 2] |= code << 4 if i & 1 else code
+        out += block
+    return bytes(out)
+
+
+class Stream:
+    def __init__(self, id, sample_rate, channels):
+        self.id = id
+        self.name = STREAM_NAMES[id] if id < len(STREAM_NAMES) else f'stream{id}'
+        self.sample_rate = sample_rate
+        self.channels = channels
+        self.frames = []        # (sequence, capture_us, receive_us, samples)
+        self.duplicates = 0
+
+    def add(self, sequence, capture_us, receive_us, samples):
+        self.frames.append((sequence, capture_us, receive_us, samples))
+
+    def report(self):
+        frames = sorted(self.frames)
+        sequences = [f[0] for f in frames]
+        unique = sorted(set(sequences))
+        self.duplicates = len(sequences) - len(unique)
+        expected = unique[-1] - unique[0] + 1
+        lost = expected - len(unique)
+        reordered = sum(1 for a, b in zip(self.frames, self.frames[1:]) if b[0] < a[0])
+        # Clock offset between device and host is unknown, report delay relative to the fastest frame
+        delays = [f[2] - f[1] for f in self.frames]
+        base = min(delays)
+        jitter = sorted(d - base for d in delays)
+        duration = sum(len(f[3]) for f in frames) / self.channels / self.sample_rate
+        print(f'  {self.name:<10} {self.sample_rate:>5} Hz x{self.channels}  {duration:7.2f}s  '
+              f'frames={len(unique)} lost={lost} ({lost * 100 / expected:.1f}%) reordered={reordered} '
+              f'dup={self.duplicates}  delay p50={jitter[len(jitter) // 2] / 1000:.1f}ms '
+              f'p95={jitter[int(len(jitter) * 0.95)] / 1000:.1f}ms max={jitter[-1] / 1000:.1f}ms')
+
+    def render(self, start_us, rate, length):
+        '''Place the stream on a timeline at `rate`, one list per channel, gaps stay silent'''
+        out = [[0] * length for _ in range(self.channels)]
+        frames = {}
+        for frame in self.frames:
+            frames.setdefault(frame[0], frame)
+        position = None
+        last_sequence = None
+        for sequence in sorted(frames):
+            _, capture_us, _, samples = frames[sequence]
+            # Contiguous frames follow each other sample exactly, after a loss re-anchor on the timestamp
+            if position is None or sequence != last_sequence + 1:
+                position = (capture_us - start_us) * self.sample_rate / 1e6
+            last_sequence = sequence
+            count = len(samples) // self.channels
+            for ch in range(self.channels):
+                plane = samples[ch::self.channels]
+                first = max(0, math.ceil(position * rate / self.sample_rate))
+                last = min(length, int((position + count) * rate / self.sample_rate))
+                for n in range(first, last):
+                    # Linear interpolation between source samples
+                    x = n * self.sample_rate / rate - position
+                    i = int(x)
+                    frac = x - i
+                    a = plane[min(i, count - 1)]
+                    b = plane[min(i + 1, count - 1)]
+                    out[ch][n] = int(a + (b - a) * frac)
+            position += count
+        return out
+
+
+def write_aligned_wav(streams, filename, rate):
+    streams = [s for s in sorted(streams.values(), key=lambda s: s.id) if s.frames]
+    if not streams:
+        return
+    start_us = min(f[1] for s in streams for f in s.frames)
+    end_us = max(f[1] + len(f[3]) / s.channels * 1e6 / s.sample_rate for s in streams for f in s.frames)
+    length = int((end_us - start_us) * rate / 1e6)
+    channels = []
+    layout = []
+    for stream in streams:
+        rendered = stream.render(start_us, rate, length)
+        channels += rendered
+        layout += [stream.name if stream.channels == 1 else f'{stream.name}{ch}' for ch in range(stream.channels)]
+
+    with wave.open(filename, 'wb') as wav_file:
+        wav_file.setnchannels(len(channels))
+        wav_file.setsampwidth(2)
+        wav_file.setframerate(rate)
+        frames = bytearray()
+        for n in range(length):
+            for channel in channels:
+                frames += struct.pack('<h', channel[n])
+        wav_file.writeframes(bytes(frames))
+    print(f"Aligned WAV '{filename}' saved, {length / rate:.2f}s, channels: {', '.join(layout)}")
+
+
+def parse_frame(message):
+    if len(message) < HEADER.size:
+        return None
+    (magic, version, stream, encoding, channels, sequence, sample_rate, capture_us,
+     samples, payload_size, _) = HEADER.unpack_from(message)
+    if magic != FRAME_MAGIC or version != 1 or channels == 0:
+        return None
+    payload = message[HEADER.size:HEADER.size + payload_size]
+    if encoding == ENCODING_IMA_ADPCM:
+        pcm = decode_ima_adpcm(payload, samples, channels)
+    else:
+        pcm = list(struct.unpack(f'<{samples * channels}h', payload[:samples * channels * 2]))
+    return stream, sequence, sample_rate, channels, capture_us, pcm
+
+
+def selftest_sender(port, duration, encoding):
+    '''Fake device: mic picks up the reference 30 ms late, every 50th processed frame is lost'''
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sequences = [0] * len(STREAM_NAMES)
+    start = time.monotonic()
+    frame_ms = 32
+    for n in range(int(duration * 1000 / frame_ms)):
+        capture_us = int(n * frame_ms * 1000)
+        for stream, rate, channels in ((0, 16000, 1), (1, 16000, 1), (2, 16000, 1), (3, 24000, 1)):
+            samples = rate * frame_ms // 1000
+            pcm = []
+            for i in range(samples):
+                t = (capture_us / 1e6) + i / rate
+                delay = 0.03 if stream in (0, 2) else 0
+                pcm.append(int(8000 * math.sin(2 * math.pi * 440 * (t - delay))))
+            sequence = sequences[stream]
+            sequences[stream] += 1
+            if stream == 2 and sequence % 50 == 49:
+                continue
+            payload = encode_ima_adpcm(pcm, channels) if encoding == ENCODING_IMA_ADPCM else \
+                struct.pack(f'<{len(pcm)}h', *pcm)
+            header = HEADER.pack(FRAME_MAGIC, 1, stream, encoding, channels, sequence, rate, capture_us,
+                                 samples, len(payload), 0)
+            sock.sendto(header + payload, ('127.0.0.1', port))
+        # Send at real time so the receiver sees realistic arrival jitter
+        time.sleep(max(0, start + (n + 1) * frame_ms / 1000 - time.monotonic()))
+    sock.close()
+
+
+def main(samplerate, channels, port, output, duration, selftest, encoding):
     # Create a UDP socket
     server_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
-    server_socket.bind(('0.0.0.0', 8000))
+    server_socket.bind(('0.0.0.0', port))
+    server_socket.settimeout(0.5)
 
-    # Create WAV file with parameters
-    filename = f"{samplerate}_{channels}.wav"
-    wav_file = wave.open(filename, "wb")
-    wav_file.setnchannels(channels)     # channels parameter
-    wav_file.setsampwidth(2)            # 2 bytes per sample (16-bit)
-    wav_file.setframerate(samplerate)   # samplerate parameter
+    streams = {}
+    legacy_wav = None
+    print(f"Start receiving audio from 0.0.0.0:{port}...")
 
-    print(f"Start saving audio from 0.0.0.0:8000 to {filename}...")
+    if selftest:
+        duration = duration or 3
+        threading.Thread(target=selftest_sender, args=(port, duration, encoding), daemon=True).start()
 
+    started = time.monotonic()
     try:
-        while True:
-            # Receive a message from the client
-            message, address = server_socket.recvfrom(8000)
-            
-            # Write PCM data to WAV file
-            wav_file.writeframes(message)
-
-            # Print length of the message
-            print(f"Received {len(message)} bytes from {address}")
-    
+        while not duration or time.monotonic() - started < duration + 1:
+            try:
+                message, address = server_socket.recvfrom(4096)
+            except socket.timeout:
+                continue
+            receive_us = int(time.monotonic() * 1e6)
+
+            frame = parse_frame(message)
+            if frame is None:
+                # Raw PCM from firmware without framing
+                if legacy_wav is None:
+                    filename = f"{samplerate}_{channels}.wav"
+                    legacy_wav = wave.open(filename, "wb")
+                    legacy_wav.setnchannels(channels)
+                    legacy_wav.setsampwidth(2)
+                    legacy_wav.setframerate(samplerate)
+                    print(f"Unframed audio from {address}, saving to {filename}")
+                legacy_wav.writeframes(message)
+                continue
+
+            stream_id, sequence, rate, stream_channels, capture_us, pcm = frame
+            stream = streams.get(stream_id)
+            if stream is None:
+                stream = streams[stream_id] = Stream(stream_id, rate, stream_channels)
+                print(f"New stream {stream.name} from {address}: {rate} Hz x{stream_channels}")
+            stream.add(sequence, capture_us, receive_us, pcm)
+
     except KeyboardInterrupt:
         print("\nStopping recording...")
-    
+
     finally:
-        # Close files and socket
-        wav_file.close()
         server_socket.close()
-        print(f"WAV file '{filename}' saved successfully")
+        if legacy_wav is not None:
+            legacy_wav.close()
+        if streams:
+            print("Streams:")
+            for stream in sorted(streams.values(), key=lambda s: s.id):
+                stream.report()
+            write_aligned_wav(streams, output, samplerate)
 
 
 if __name__ == "__main__":
-    parser = argparse.ArgumentParser(description='UDP音频数据接收器，保存为WAV文件')
-    parser.add_argument('--samplerate', '-s', type=int, default=16000, 
-                        help='采样率 (默认: 16000)')
-    parser.add_argument('--channels', '-c', type=int, default=2, 
-                        help='声道数 (默认: 2)')
-    
+    parser = argparse.ArgumentParser(description='UDP音频调试数据接收器，按采集时间对齐多路音频并保存为WAV文件')
+    parser.add_argument('--samplerate', '-s', type=int, default=16000,
+                        help='输出采样率，无帧头的旧固件数据也按此采样率保存 (默认: 16000)')
+    parser.add_argument('--channels', '-c', type=int, default=2,
+                        help='无帧头的旧固件数据的声道数 (默认: 2)')
+    parser.add_argument('--port', '-p', type=int, default=8000,
+                        help='UDP端口 (默认: 8000)')
+    parser.add_argument('--output', '-o', default='audio_debug.wav',
+                        help='对齐后的多声道WAV文件 (默认: audio_debug.wav)')
+    parser.add_argument('--duration', '-d', type=float, default=0,
+                        help='接收秒数，0 表示直到 Ctrl+C (默认: 0)')
+    parser.add_argument('--selftest', action='store_true',
+                        help='向本机发送模拟数据，无需设备')
+    parser.add_argument('--adpcm', action='store_true',
+                        help='自测时使用 IMA ADPCM 编码')
+
     args = parser.parse_args()
-    main(args.samplerate, args.channels)
+    main(args.samplerate, args.channels, args.port, args.output, args.duration, args.selftest,
+         ENCODING_IMA_ADPCM if args.adpcm else ENCODING_PCM16)
@@ -0,0 +1,209 @@
+import argparse
+import re
+import struct
+import sys
+
+
+'''
+  Decode an audio flight recorder dump (main/audio/audio_flight_recorder.h).
+
+  The dump is either the binary returned by GET http://<device>:8080/api/audio_trace
+  or a serial log containing the "AFR begin" ... "AFR end" hex lines printed after an error alert.
+  Prints the events, per-frame timelines and end to end latency of both directions.
+'''
+
+DUMP_MAGIC = 0x31524641
+HEADER = struct.Struct('<IHHIIII')
+EVENT = struct.Struct('<IIIHBB')
+
+EVENT_NAMES = {
+    1: 'uplink_queued',
+    2: 'uplink_encoded',
+    3: 'uplink_sent',
+    4: 'downlink_received',
+    5: 'downlink_decoded',
+    6: 'downlink_played',
+    7: 'device_state',
+    8: 'audio_state',
+    9: 'vad',
+    10: 'drop',
+    11: 'alert',
+}
+SOURCES = ['packet', 'concealed', 'sound']
+COMPONENTS = ['wake_word', 'processor', 'testing']
+DROP_REASONS = ['encode_failed', 'unsupported_frame', 'decode_failed']
+DEVICE_STATES = ['unknown', 'starting', 'wifi_configuring', 'idle', 'connecting', 'listening',
+                 'speaking', 'upgrading', 'activating', 'audio_testing', 'fatal_error']
+
+UPLINK_STAGES = ['uplink_queued', 'uplink_encoded', 'uplink_sent']
+DOWNLINK_STAGES = ['downlink_received', 'downlink_decoded', 'downlink_played']
+
+
+def name_of(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def read_dump(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from('<I', data)[0] == DUMP_MAGIC:
+        return data
+
+    # Serial log, take the last complete dump
+    text = data.decode('utf-8', errors='replace')
+    dumps = []
+    current = None
+    for line in text.splitlines():
+        match = re.search(r'AFR (begin|end|[0-9a-f]+)\s*(\x1b\[0m)?$', line.strip())
+        if not match:
+            continue
+        token = match.group(1)
+        if token == 'begin':
+            current = []
+        elif token == 'end':
+            if current is not None:
+                dumps.append(bytes.fromhex(''.join(current)))
+            current = None
+        elif current is not None:
+            current.append(token)
+    if not dumps:
+        sys.exit(f'{path}: no flight recorder dump found')
+    return dumps[-1]
+
+
+def parse_dump(data):
+    magic, version, event_size, capacity, count, total, time_us = HEADER.unpack_from(data)
+    if magic != DUMP_MAGIC:
+        sys.exit(f'Bad magic 0x{magic:08x}')
+    if version != 1 or event_size != EVENT.size:
+        sys.exit(f'Unsupported dump version {version}, event size {event_size}')
+    count = min(count, (len(data) - HEADER.size) // event_size)
+    header = {'capacity': capacity, 'count': count, 'total': total, 'time_us': time_us}
+
+    events = []
+    base = 0
+    last = None
+    for i in range(count):
+        time_us, id, extra, value, type, arg = EVENT.unpack_from(data, HEADER.size + i * event_size)
+        if type not in EVENT_NAMES:
+            continue  # Torn or never written slot
+        # Timestamps are the low 32 bits of esp_timer_get_time(), unwrap them
+        if last is not None and time_us < last and last - time_us > 0x80000000:
+            base += 1 << 32
+        last = time_us
+        events.append({'time_us': base + time_us, 'name': EVENT_NAMES[type], 'id': id,
+                       'value': value, 'arg': arg, 'extra': extra})
+    return header, events
+
+
+def describe(event):
+    name, id, value, arg, extra = event['name'], event['id'], event['value'], event['arg'], event['extra']
+    if name == 'uplink_queued':
+        return f'frame={id} encode_queue={value}'
+    if name == 'uplink_encoded':
+        return f'frame={id} bytes={value} encode_us={extra}'
+    if name == 'uplink_sent':
+        return f'frame={id} send_queue={value}'
+    if name == 'downlink_received':
+        return f'frame={id} decode_queue={value} seq={extra}'
+    if name == 'downlink_decoded':
+        return f'frame={id} samples={value} source={name_of(SOURCES, arg)} decode_us={extra}'
+    if name == 'downlink_played':
+        return f'frame={id} playback_queue={value}'
+    if name == 'device_state':
+        return f'{name_of(DEVICE_STATES, arg)} -> {name_of(DEVICE_STATES, id)}'
+    if name == 'audio_state':
+        return f'{name_of(COMPONENTS, arg)} {"on" if id else "off"}'
+    if name == 'vad':
+        return 'speaking' if id else 'silence'
+    if name == 'drop':
+        return f'frame={id} reason={name_of(DROP_REASONS, arg)}'
+    if name == 'alert':
+        return f'state={name_of(DEVICE_STATES, id)}'
+    return ''
+
+
+def build_timelines(events, stages):
+    frames = {}
+    for event in events:
+        if event['name'] in stages and event['id'] != 0:
+            frames.setdefault(event['id'], {}).setdefault(event['name'], event['time_us'])
+    return frames
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def print_latency(title, frames, stages):
+    print(f'\n{title}: {len(frames)} frames')
+    if not frames:
+        return
+    pairs = [(stages[i], stages[i + 1]) for i in range(len(stages) - 1)] + [(stages[0], stages[-1])]
+    for start, end in pairs:
+        values = [f[end] - f[start] for f in frames.values() if start in f and end in f]
+        incomplete = sum(1 for f in frames.values() if start in f and end not in f)
+        if not values:
+            print(f'  {start} -> {end}: no complete frames')
+            continue
+        print(f'  {start} -> {end}: n={len(values)} avg={sum(values) / len(values) / 1000:.1f}ms '
+              f'p50={percentile(values, 50) / 1000:.1f}ms p95={percentile(values, 95) / 1000:.1f}ms '
+              f'max={max(values) / 1000:.1f}ms incomplete={incomplete}')
+
+
+def print_timelines(frames, stages, limit):
+    ids = sorted(frames)[-limit:] if limit > 0 else sorted(frames)
+    for id in ids:
+        frame = frames[id]
+        start = min(frame.values())
+        steps = ' '.join(f'{stage.split("_")[1]}=+{(frame[stage] - start) / 1000:.1f}ms'
+                         for stage in stages if stage in frame)
+        print(f'  frame {id}: {steps}')
+
+
+def main(path, show_events, timelines):
+    header, events = parse_dump(read_dump(path))
+    print(f'{header["count"]} of {header["total"]} events (capacity {header["capacity"]}), '
+          f'dumped at {header["time_us"] / 1e6:.3f}s')
+    if not events:
+        return
+    start = events[0]['time_us']
+
+    if show_events:
+        for event in events:
+            print(f'{(event["time_us"] - start) / 1000:10.1f}ms  {event["name"]:<18} {describe(event)}')
+
+    uplink = build_timelines(events, UPLINK_STAGES)
+    downlink = build_timelines(events, DOWNLINK_STAGES)
+    print_latency('Uplink', uplink, UPLINK_STAGES)
+    if timelines:
+        print_timelines(uplink, UPLINK_STAGES, timelines)
+    print_latency('Downlink', downlink, DOWNLINK_STAGES)
+    if timelines:
+        print_timelines(downlink, DOWNLINK_STAGES, timelines)
+
+    drops = {}
+    for event in events:
+        if event['name'] == 'drop':
+            reason = name_of(DROP_REASONS, event['arg'])
+            drops[reason] = drops.get(reason, 0) + 1
+    concealed = sum(1 for e in events if e['name'] == 'downlink_decoded' and e['arg'] == 1)
+    print(f'\nDrops: {drops or "none"}, concealed frames: {concealed}')
+
+    print('State changes:')
+    for event in events:
+        if event['name'] in ('device_state', 'audio_state', 'alert'):
+            print(f'  {(event["time_us"] - start) / 1000:10.1f}ms  {event["name"]:<13} {describe(event)}')
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description='解析音频 flight recorder dump（二进制或串口日志）')
+    parser.add_argument('dump', help='GET /api/audio_trace 保存的二进制文件，或包含 AFR 行的串口日志')
+    parser.add_argument('--events', '-e', action='store_true',
+                        help='打印全部事件')
+    parser.add_argument('--timelines', '-t', type=int, default=0,
+                        help='打印最近 N 帧的逐帧时间线 (默认: 0)')
+
+    args = parser.parse_args()
+    main(args.dump, args.events, args.timelines)